@@ -0,0 +1,125 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// DxilCompileTimeReport.h                                                   //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Time and memory used by each phase and pass of a compile.                 //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/IR/LegacyPassManagers.h"
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace llvm {
+class raw_ostream;
+}
+
+namespace hlsl {
+
+/// Collects wall time, CPU time and heap usage for each phase of a compile,
+/// and wall time, CPU time and instruction counts for each pass run by the
+/// LLVM pass managers. Install it as the pass execution listener of the
+/// compiling thread to collect pass information.
+///
+/// Phases nest, and so do passes; starting one pauses the enclosing one of
+/// the same kind, so that those times are exclusive. Pass times are a
+/// breakdown of the phase they run in. CPU time is that of the compiling
+/// thread. Heap usage
+/// is process-wide and sampled at phase boundaries and around module passes,
+/// so peaks are approximate and include concurrent compiles.
+class DxilCompileTimeReport : public llvm::PassExecutionListener {
+public:
+  struct Measurement {
+    double WallMs = 0;
+    double CpuMs = 0;
+    int64_t AllocatedBytes = 0; // Net heap growth while active.
+    uint64_t PeakBytes = 0;     // Largest heap usage sampled while active.
+  };
+
+  struct PhaseEntry {
+    std::string Name;
+    Measurement Measure;
+  };
+
+  struct PassEntry {
+    llvm::Pass *P;
+    std::string Name;
+    std::string Argument; // Empty if the pass isn't registered.
+    unsigned Runs = 0;
+    Measurement Measure;
+    bool HasInstructionCounts = false;
+    uint64_t InstructionsBefore = 0; // Summed over runs.
+    uint64_t InstructionsAfter = 0;  // Summed over runs.
+    // Statistics reported by the pass, summed over runs, in report order.
+    std::vector<std::pair<std::string, uint64_t>> Statistics;
+  };
+
+  DxilCompileTimeReport();
+
+  void StartPhase(llvm::StringRef Name);
+  void StopPhase();
+
+  void passStarted(llvm::Pass *P, llvm::Module *M, llvm::Function *F) override;
+  void passFinished(llvm::Pass *P, llvm::Module *M, llvm::Function *F) override;
+  void passStatistic(llvm::Pass *P, llvm::StringRef Name,
+                     uint64_t Value) override;
+
+  const std::vector<PhaseEntry> &GetPhases() const { return m_phases; }
+  const std::vector<PassEntry> &GetPasses() const { return m_passes; }
+
+  void WriteJson(llvm::raw_ostream &OS) const;
+
+  /// Runs a phase for the lifetime of the scope; a null report is allowed.
+  class PhaseScope {
+    DxilCompileTimeReport *m_pReport;
+  public:
+    PhaseScope(DxilCompileTimeReport *pReport, llvm::StringRef Name)
+        : m_pReport(pReport) {
+      if (m_pReport)
+        m_pReport->StartPhase(Name);
+    }
+    ~PhaseScope() {
+      if (m_pReport)
+        m_pReport->StopPhase();
+    }
+  };
+
+private:
+  struct Sample {
+    double WallMs;
+    double CpuMs;
+    uint64_t HeapBytes;
+    bool HasHeap;
+  };
+
+  struct ActivePass {
+    unsigned Index;
+    bool HasInstructionCounts;
+    uint64_t InstructionsBefore;
+  };
+
+  Sample TakeSample(bool withHeap) const;
+  void Charge(const Sample &now);
+  unsigned GetPassIndex(llvm::Pass *P);
+
+  std::vector<PhaseEntry> m_phases;
+  std::vector<PassEntry> m_passes;
+  llvm::DenseMap<llvm::Pass *, unsigned> m_passIndex;
+  // Elapsed time is charged to the innermost phase and the innermost pass.
+  std::vector<unsigned> m_phaseStack;
+  std::vector<ActivePass> m_passStack;
+  Sample m_last;
+  Sample m_start;
+  uint64_t m_lastHeapBytes;
+};
+
+} // namespace hlsl
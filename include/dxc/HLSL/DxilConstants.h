@@ -210,6 +210,7 @@ namespace DXIL {
     Default = 0, // Choose default packing algorithm based on target (currently PrefixStable)
     PrefixStable, // Maintain assumption that all elements are packed in order and stable as new elements are added.
     Optimized, // Optimize packing of all elements together (all elements must be present, in the same order, for identical placement of any individual element)
+    Minimal, // Search for the placement using the fewest rows, starting from the Optimized placement (same requirements as Optimized)
     Invalid,
   };
 
@@ -40,6 +40,40 @@ struct DxilContainerHash {
   uint8_t Digest[DxilContainerHashSize];
 };
 
+/// Use this type to represent the content digest stored in the
+/// DFCC_ShaderHash part. The container header hash is left to the validator.
+struct DxilShaderHash {
+  uint32_t Flags; // Reserved, must be zero.
+  uint8_t Digest[DxilContainerHashSize];
+};
+
+/// Use this type to represent the instruction statistics stored in the
+/// DFCC_ShaderStatistics part, so they can be reflected without loading
+/// function bodies. Counts use the D3D12_SHADER_DESC categories.
+struct DxilShaderStatistics {
+  uint32_t InstructionCount;
+  uint32_t TempArrayCount;
+  uint32_t TextureNormalInstructions;
+  uint32_t TextureLoadInstructions;
+  uint32_t TextureCompInstructions;
+  uint32_t TextureBiasInstructions;
+  uint32_t TextureGradientInstructions;
+  uint32_t FloatInstructionCount;
+  uint32_t IntInstructionCount;
+  uint32_t UintInstructionCount;
+  uint32_t StaticFlowControlCount;
+  uint32_t DynamicFlowControlCount;
+  uint32_t ArrayInstructionCount;
+  uint32_t CutInstructionCount;
+  uint32_t EmitInstructionCount;
+  uint32_t BarrierInstructions;
+  uint32_t InterlockedInstructions;
+  uint32_t TextureStoreInstructions;
+  uint32_t MovcInstructionCount;
+  uint32_t ConversionInstructionCount;
+  uint32_t BitwiseInstructionCount;
+};
+
 struct DxilContainerVersion {
   uint16_t Major;
   uint16_t Minor;
@@ -81,6 +115,7 @@ enum DxilFourCC {
   DFCC_RootSignature            = DXIL_FOURCC('R', 'T', 'S', '0'),
   DFCC_DXIL                     = DXIL_FOURCC('D', 'X', 'I', 'L'),
   DFCC_PipelineStateValidation  = DXIL_FOURCC('P', 'S', 'V', '0'),
+  DFCC_ShaderHash               = DXIL_FOURCC('H', 'A', 'S', 'H'),
 };
 
 #undef DXIL_FOURCC
@@ -262,6 +297,21 @@ const DxilContainerHeader *IsDxilContainerLike(const void *ptr, size_t length);
 /// Checks whether the DXIL container is valid and in-bounds.
 bool IsValidDxilContainer(const DxilContainerHeader *pHeader, size_t length);
 
+/// Computes the content digest of a valid container. Only parts that affect
+/// runtime behavior are included; debug info, statistics, private data and
+/// the shader hash part itself are skipped, so stripping them leaves the
+/// digest unchanged.
+void ComputeDxilContainerHash(const DxilContainerHeader *pHeader,
+                              _Out_ DxilContainerHash *pHash);
+
+/// Stores the content digest of a fully written container in its
+/// DFCC_ShaderHash part. Containers without one are left unchanged.
+void UpdateDxilContainerHash(DxilContainerHeader *pHeader);
+
+/// Checks whether the DFCC_ShaderHash part matches the container contents.
+/// Fails if the container has no such part.
+bool VerifyDxilContainerHash(const DxilContainerHeader *pHeader, size_t length);
+
 /// Use this type as a unary predicate functor.
 struct DxilPartIsType {
   uint32_t IsFourCC;
@@ -394,9 +444,15 @@ public:
 
 DxilContainerWriter *NewDxilContainerWriter();
 
+// Serializes pModule into a DXIL container. pModuleBitcode is the module's
+// bitcode if the caller already has it, or null to serialize it here. The
+// root signature and debug info are stripped from the module. A
+// DFCC_ShaderHash part is added only if bIncludeShaderHash is set, as
+// validators that don't know the part reject the container.
 void SerializeDxilContainerForModule(hlsl::DxilModule *pModule,
                                      AbstractMemoryStream *pModuleBitcode,
-                                     AbstractMemoryStream *pStream);
+                                     AbstractMemoryStream *pStream,
+                                     bool bIncludeShaderHash = false);
 void SerializeDxilContainerForRootSignature(hlsl::RootSignatureHandle *pRootSigHandle,
                                      AbstractMemoryStream *pStream);
 
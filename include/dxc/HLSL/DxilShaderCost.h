@@ -0,0 +1,78 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// DxilShaderCost.h                                                          //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Static instruction statistics and cost estimate for a DXIL module.        //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace llvm {
+class BasicBlock;
+class Function;
+class Module;
+}
+
+namespace hlsl {
+
+struct DxilShaderStatistics;
+
+/// Estimated cost of one basic block.
+struct DxilBlockCost {
+  const llvm::Function *F;
+  const llvm::BasicBlock *BB;
+  unsigned InstructionCount;
+  unsigned LoopDepth;
+  uint64_t ExecutionCount; // Estimated executions per invocation of F.
+  uint64_t Cost;           // Sum of instruction weights times ExecutionCount.
+};
+
+/// Instruction statistics in the categories reported by D3D12_SHADER_DESC,
+/// along with a weighted cost estimate for each basic block.
+struct DxilShaderCost {
+  unsigned InstructionCount;
+  unsigned TempArrayCount;
+  unsigned TextureNormalInstructions;
+  unsigned TextureLoadInstructions;
+  unsigned TextureCompInstructions;
+  unsigned TextureBiasInstructions;
+  unsigned TextureGradientInstructions;
+  unsigned FloatInstructionCount;
+  unsigned IntInstructionCount;
+  unsigned UintInstructionCount;
+  unsigned StaticFlowControlCount;
+  unsigned DynamicFlowControlCount;
+  unsigned ArrayInstructionCount;
+  unsigned CutInstructionCount;
+  unsigned EmitInstructionCount;
+  unsigned BarrierInstructions;
+  unsigned InterlockedInstructions;
+  unsigned TextureStoreInstructions;
+  unsigned MovcInstructionCount;
+  unsigned ConversionInstructionCount;
+  unsigned BitwiseInstructionCount;
+  uint64_t EstimatedCost;
+  std::vector<DxilBlockCost> Blocks;
+};
+
+/// Loops whose trip count cannot be determined statically are assumed to
+/// run this many times.
+static const unsigned DxilDefaultLoopTripCount = 8;
+
+/// Computes instruction statistics and the cost estimate in a single pass
+/// over every function defined in M. Function bodies must be materialized.
+void AnalyzeDxilShaderCost(llvm::Module &M, DxilShaderCost &Cost);
+
+/// Copies the instruction statistics of Cost into the layout of the
+/// DFCC_ShaderStatistics part.
+void GetDxilShaderStatistics(const DxilShaderCost &Cost,
+                             DxilShaderStatistics &Stats);
+
+} // namespace hlsl
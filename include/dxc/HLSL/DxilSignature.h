@@ -40,7 +40,8 @@ public:
   const std::vector<std::unique_ptr<DxilSignatureElement> > &GetElements() const;
 
   // Packs the signature elements per DXIL constraints and returns the number of rows used for the signature
-  unsigned PackElements(DXIL::PackingStrategy packing);
+  // If pRowsSaved is provided, it receives the rows Minimal packing saved over Optimized packing.
+  unsigned PackElements(DXIL::PackingStrategy packing, unsigned *pRowsSaved = nullptr);
 
   // Returns true if all signature elements that should be allocated are allocated
   bool IsFullyAllocated();
@@ -85,6 +85,13 @@ public:
   // Pack in a prefix-stable way - appended elements do not affect positions of prior elements.
   unsigned PackPrefixStable(std::vector<DxilSignatureElement*> elements, unsigned startRow, unsigned numRows);
 
+  // Minimal packing - bounded branch-and-bound search seeded with the PackOptimized result.
+  // The search visits at most kMinimalSearchBudget placements, so results are deterministic.
+  // If pOptimizedRowsUsed is provided, it receives the rows used by PackOptimized for comparison.
+  static const unsigned kMinimalSearchBudget = 100000;
+  unsigned PackMinimal(std::vector<DxilSignatureElement*> elements, unsigned startRow, unsigned numRows,
+                       unsigned *pOptimizedRowsUsed = nullptr);
+
 };
 
 
@@ -97,9 +97,9 @@ struct HLOptions {
   unsigned bAllResourcesBound      : 1;
   unsigned bDisableOptimizations   : 1;
   unsigned bLegacyCBufferLoad      : 1;
-  unsigned PackingStrategy         : 2;
-  static_assert((unsigned)DXIL::PackingStrategy::Invalid < 4, "otherwise 2 bits is not enough to store PackingStrategy");
-  unsigned unused                  : 25;
+  unsigned PackingStrategy         : 3;
+  static_assert((unsigned)DXIL::PackingStrategy::Invalid < 8, "otherwise 3 bits is not enough to store PackingStrategy");
+  unsigned unused                  : 24;
 };
 
 /// Use this class to manipulate HLDXIR of a shader.
@@ -33,6 +33,15 @@ UINT32 DxcCodePageFromBytes(_In_count_(byteLen) const char *bytes,
 HRESULT DxcCreateBlobFromFile(LPCWSTR pFileName, _In_opt_ UINT32 *pCodePage,
                               _COM_Outptr_ IDxcBlobEncoding **pBlobEncoding) throw();
 
+// Files at least this large are mapped by DxcCreateBlobFromFileMapping.
+static const DWORD DxcMinMappedFileSize = 64 * 1024;
+
+// Like DxcCreateBlobFromFile, but maps large files into memory rather than
+// reading them. The file can't be written while the blob is alive, so this is
+// meant for blobs that live no longer than a compilation.
+HRESULT DxcCreateBlobFromFileMapping(LPCWSTR pFileName, _In_opt_ UINT32 *pCodePage,
+                                     _COM_Outptr_ IDxcBlobEncoding **pBlobEncoding) throw();
+
 // Given a blob, creates a subrange view.
 HRESULT DxcCreateBlobFromBlob(_In_ IDxcBlob *pBlob, UINT32 offset,
                               UINT32 length,
@@ -89,6 +89,7 @@ public:
   llvm::opt::InputArgList Args = llvm::opt::InputArgList(nullptr, nullptr); // Original arguments.
 
   llvm::StringRef AssemblyCode; // OPT_Fc
+  llvm::StringRef CostReport;   // OPT_cost_report
   llvm::StringRef DebugFile;    // OPT_Fd
   llvm::StringRef EntryPoint;   // OPT_entrypoint
   llvm::StringRef ExternalFn;   // OPT_external_fn
@@ -106,6 +107,12 @@ public:
   llvm::StringRef RootSignatureSource; // OPT_setrootsignature
   llvm::StringRef VerifyRootSignatureSource; //OPT_verifyrootsignature
   llvm::StringRef RootSignatureDefine; // OPT_rootsig_define
+  llvm::StringRef CompileCacheDirectory; // OPT_compile_cache
+  llvm::StringRef TimeReportFile; // OPT_time_report_file
+  llvm::StringRef BatchFile; // OPT_batch
+  llvm::StringRef DependencyFile; // OPT_MF
+  llvm::StringRef DependencyTarget; // OPT_MT
+  llvm::StringRef UsePch; // OPT_Yu
 
   bool AllResourcesBound; // OPT_all_resources_bound
   bool AstDump; // OPT_ast_dump
@@ -119,6 +126,8 @@ public:
   bool DefaultRowMajor;  // OPT_Zpr
   bool DisableValidation; // OPT_VD
   unsigned OptLevel;      // OPT_O0/O1/O2/O3
+  unsigned CompileCacheMaxSizeMB; // OPT_compile_cache_size
+  unsigned BatchThreads; // OPT_batch_threads
   bool DisableOptimizations; // OPT_Od
   bool AvoidFlowControl;     // OPT_Gfa
   bool PreferFlowControl;    // OPT_Gfp
@@ -136,7 +145,13 @@ public:
   bool NotUseLegacyCBufLoad;  // OPT_not_use_legacy_cbuf_load
   bool PackPrefixStable;  // OPT_pack_prefix_stable
   bool PackOptimized;  // OPT_pack_optimized
+  bool PackMinimal;  // OPT_pack_minimal
   bool DisplayIncludeProcess; // OPT__vi
+  bool TimeReport; // OPT_time_report
+  bool ShaderHash; // OPT_shader_hash
+  bool ScanDependencies; // OPT_M
+  bool DependenciesAsJson; // OPT_Mjson
+  bool CreatePch; // OPT_Yc
   bool RecompileFromBinary; // OPT _Recompile (Recompiling the DXBC binary file not .hlsl file)
   bool StripDebug; // OPT Qstrip_debug
   bool StripRootSignature; // OPT_Qstrip_rootsignature
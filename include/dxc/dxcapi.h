@@ -128,6 +128,12 @@ struct DxcDefine {
   _Maybenull_ LPCWSTR Value;
 };
 
+// Concurrency: Compile, Preprocess and Disassemble may be called on the same
+// compiler instance from any number of threads at once, and each call may be
+// given its own include handler. Calls that configure an instance (the
+// IDxcLangExtensions and IDxcContainerEvent methods) must complete before
+// the instance is used to compile. Calls are not reentrant on a thread: an
+// include handler must not call back into a compiler.
 struct __declspec(uuid("8c210bf3-011f-4422-8d70-6f9acb8db617"))
 IDxcCompiler : public IUnknown {
   // Compile a single entry point to the target shader model
@@ -162,6 +168,49 @@ IDxcCompiler : public IUnknown {
     ) = 0;
 };
 
+// One entry point, profile and set of defines to compile in a batch.
+struct DxcPermutation {
+  LPCWSTR pEntryPoint;                            // entry point name
+  LPCWSTR pTargetProfile;                         // shader profile to compile
+  _In_count_(defineCount) const DxcDefine *pDefines; // Array of defines
+  UINT32 defineCount;                             // Number of defines
+};
+
+struct __declspec(uuid("3e6d6c1b-9a53-4b0e-8f51-27c4d8a6e0f2"))
+IDxcBatchCompiler : public IUnknown {
+  // Compile many permutations of one source. Arguments are shared by every
+  // permutation, and are parsed once. Each included file is requested from
+  // the include handler at most once for the whole batch.
+  virtual HRESULT STDMETHODCALLTYPE CompileBatch(
+    _In_ IDxcBlob *pSource,                       // Source text to compile
+    _In_opt_ LPCWSTR pSourceName,                 // Optional file name for pSource. Used in errors and include handlers.
+    _In_count_(argCount) LPCWSTR *pArguments,     // Array of pointers to arguments shared by all permutations
+    _In_ UINT32 argCount,                         // Number of arguments
+    _In_count_(permutationCount) const DxcPermutation *pPermutations, // Array of permutations to compile
+    _In_ UINT32 permutationCount,                 // Number of permutations
+    _In_opt_ IDxcIncludeHandler *pIncludeHandler, // user-provided interface to handle #include directives (optional)
+    _Out_writes_(permutationCount) IDxcOperationResult **ppResults // One compiler output per permutation, in order
+  ) = 0;
+};
+
+struct __declspec(uuid("9c5e7a42-3f1b-4d8e-a6c0-2b7d94e1f358"))
+IDxcDependencyScanner : public IUnknown {
+  // List the files included by source text, without compiling it. Only the
+  // preprocessor runs. The result is UTF-8 text with one file name per line:
+  // the source name, then each included file in the order it was first
+  // opened.
+  virtual HRESULT STDMETHODCALLTYPE ScanDependencies(
+    _In_ IDxcBlob *pSource,                       // Source text to scan
+    _In_opt_ LPCWSTR pSourceName,                 // Optional file name for pSource. Used in errors and include handlers.
+    _In_count_(argCount) LPCWSTR *pArguments,     // Array of pointers to arguments
+    _In_ UINT32 argCount,                         // Number of arguments
+    _In_count_(defineCount) const DxcDefine *pDefines,  // Array of defines
+    _In_ UINT32 defineCount,                      // Number of defines
+    _In_opt_ IDxcIncludeHandler *pIncludeHandler, // user-provided interface to handle #include directives (optional)
+    _COM_Outptr_ IDxcOperationResult **ppResult   // Dependency list, status, and errors
+  ) = 0;
+};
+
 static const UINT32 DxcValidatorFlags_Default = 0;
 static const UINT32 DxcValidatorFlags_InPlaceEdit = 1;  // Validator is allowed to update shader blob in-place.
 static const UINT32 DxcValidatorFlags_RootSignatureOnly = 2;
@@ -177,6 +226,20 @@ IDxcValidator : public IUnknown {
     ) = 0;
 };
 
+// Memoizes validation results in a directory that may be shared across
+// processes. Entries are keyed on the validator version and binary, the
+// validation flags and the bytes being validated, so re-validating an
+// unchanged shader with the same validator is a lookup.
+struct __declspec(uuid("d7e2b4a1-6c3f-4e58-a0b9-31f5c8d26e47"))
+IDxcValidatorCache : public IUnknown {
+  // Enables the cache in pDirectory, trimmed to maxSizeInMB; pass nullptr to
+  // disable it.
+  virtual HRESULT STDMETHODCALLTYPE SetValidationCache(
+    _In_opt_z_ LPCWSTR pDirectory, UINT32 maxSizeInMB) = 0;
+  virtual HRESULT STDMETHODCALLTYPE GetValidationCacheStats(
+    _Out_ UINT64 *pHits, _Out_ UINT64 *pMisses) = 0;
+};
+
 struct __declspec(uuid("334b1f50-2292-4b35-99a1-25588d8c17fe"))
 IDxcContainerBuilder : public IUnknown {
   virtual HRESULT STDMETHODCALLTYPE Load(_In_ IDxcBlob *pDxilContainerHeader) = 0;                // Loads DxilContainer to the builder
@@ -223,6 +286,33 @@ IDxcOptimizer : public IUnknown {
     _COM_Outptr_opt_ IDxcBlobEncoding **ppOutputText) = 0;
 };
 
+// A RunOptimizer option list parsed once, to be run over many modules. Bitcode
+// input is read in place rather than copied.
+struct __declspec(uuid("5f3a1c9e-7b24-4d6a-9e85-c2d0b7a3f641"))
+IDxcOptimizerPipeline : public IUnknown {
+  // Same results as IDxcOptimizer::RunOptimizer with the pipeline's options.
+  virtual HRESULT STDMETHODCALLTYPE RunOptimizer(IDxcBlob *pBlob,
+    _COM_Outptr_ IDxcBlob **ppOutputModule,
+    _COM_Outptr_opt_ IDxcBlobEncoding **ppOutputText) = 0;
+  // Runs each blob on one of up to threadCount threads (0 for one per core);
+  // pResults receives the status of each blob. Each run reports fatal errors
+  // through its own result only, so calls may overlap with each other and
+  // with other optimizer runs.
+  virtual HRESULT STDMETHODCALLTYPE RunOptimizerParallel(UINT32 blobCount,
+    _In_count_(blobCount) IDxcBlob **ppBlobs, UINT32 threadCount,
+    _Out_writes_opt_(blobCount) IDxcBlob **ppOutputModules,
+    _Out_writes_opt_(blobCount) IDxcBlobEncoding **ppOutputTexts,
+    _Out_writes_(blobCount) HRESULT *pResults) = 0;
+};
+
+// Implemented by the optimizer object alongside IDxcOptimizer.
+struct __declspec(uuid("a8c47e15-2d96-4b3f-8f1e-6b9d05c2e7a3"))
+IDxcOptimizerPipelineBuilder : public IUnknown {
+  virtual HRESULT STDMETHODCALLTYPE CreatePipeline(
+    _In_count_(optionCount) LPCWSTR *ppOptions, UINT32 optionCount,
+    _COM_Outptr_ IDxcOptimizerPipeline **ppPipeline) = 0;
+};
+
 static const UINT32 DxcVersionInfoFlags_None = 0;
 static const UINT32 DxcVersionInfoFlags_Debug = 1; // Matches VS_FF_DEBUG
 
@@ -229,4 +229,52 @@ public:
   virtual HRESULT STDMETHODCALLTYPE RegisterDxilContainerEventHandler(IDxcContainerEventsHandler *pHandler, UINT64 *pCookie) = 0;
   virtual HRESULT STDMETHODCALLTYPE UnRegisterDxilContainerEventHandler(UINT64 cookie) = 0;
 };
+
+struct __declspec(uuid("5b1f8a3e-6c2d-4f57-9e3a-0d8c47b21e69"))
+IDxcCompileCacheStats : public IUnknown
+{
+public:
+  // Counters are accumulated across all compilers in the process that were
+  // given a compile cache directory.
+  virtual HRESULT STDMETHODCALLTYPE GetCompileCacheStats(
+    _Out_ UINT64 *pHits, _Out_ UINT64 *pMisses, _Out_ UINT64 *pStores,
+    _Out_ UINT64 *pEvictions) = 0;
+};
+
+// Estimated cost of one basic block of a shader, as reported through
+// IDxcShaderCostReflection.
+struct DxcShaderBlockCost {
+  LPCSTR FunctionName;     // Function that contains the block
+  UINT32 InstructionCount; // Instructions in the block
+  UINT32 LoopDepth;        // Number of loops that contain the block
+  UINT64 ExecutionCount;   // Estimated executions per invocation of the function
+  UINT64 Cost;             // Weighted instruction cost times ExecutionCount
+};
+
+// Available from the ID3D12ShaderReflection object returned by
+// IDxcContainerReflection::GetPartReflection for DXIL parts.
+struct __declspec(uuid("a1c6e3f4-2b7d-4e58-9c0a-6f3d8b21e457"))
+IDxcShaderCostReflection : public IUnknown
+{
+public:
+  // Sum of the cost of every block. Loops whose trip count cannot be
+  // determined statically are assumed to run a fixed number of times.
+  virtual HRESULT STDMETHODCALLTYPE GetEstimatedCost(_Out_ UINT64 *pCost) = 0;
+  virtual HRESULT STDMETHODCALLTYPE GetBlockCount(_Out_ UINT32 *pCount) = 0;
+  // Blocks are listed function by function, in module order. FunctionName
+  // remains valid for the lifetime of the reflection object.
+  virtual HRESULT STDMETHODCALLTYPE GetBlockCost(
+    UINT32 index, _Out_ DxcShaderBlockCost *pBlockCost) = 0;
+};
+
+// Available from the IDxcOperationResult of a compile run with -time-report.
+struct __declspec(uuid("c4e9b2d7-8a3f-4d61-b05e-2f7a9c13d846"))
+IDxcCompileTimeReport : public IUnknown
+{
+public:
+  // UTF-8 JSON with wall and CPU time for each phase and pass, heap usage
+  // for each phase and instruction counts around each pass.
+  virtual HRESULT STDMETHODCALLTYPE GetTimeReport(
+    _COM_Outptr_result_maybenull_ IDxcBlobEncoding **ppReport) = 0;
+};
 #endif
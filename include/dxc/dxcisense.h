@@ -724,6 +724,9 @@ IDxcTranslationUnit : public IUnknown
   virtual HRESULT STDMETHODCALLTYPE GetDiagnostic(unsigned index, _Outptr_result_nullonfailure_ IDxcDiagnostic** pValue) = 0;
   virtual HRESULT STDMETHODCALLTYPE GetFile(_In_ const char* name, _Outptr_result_nullonfailure_ IDxcFile** pResult) = 0;
   virtual HRESULT STDMETHODCALLTYPE GetFileName(_Outptr_result_maybenull_ LPSTR* pResult) = 0;
+  // Returns the existing AST if no unsaved file or included file changed;
+  // otherwise the whole translation unit is parsed again. There is no
+  // incremental or precompiled-preamble reparse.
   virtual HRESULT STDMETHODCALLTYPE Reparse(
     _In_count_(num_unsaved_files) IDxcUnsavedFile** unsaved_files,
     unsigned num_unsaved_files) = 0;
@@ -741,6 +744,32 @@ IDxcTranslationUnit : public IUnknown
   virtual HRESULT STDMETHODCALLTYPE GetInclusionList(_Out_ unsigned* pResultCount, _Outptr_result_buffer_(*pResultCount) IDxcInclusion*** pResult) = 0;
 };
 
+// Parse counters for a translation unit, used to confirm that Reparse calls
+// which leave the sources unchanged do not pay for a full reparse. Calls with
+// real edits always do.
+typedef struct DxcTranslationUnitStatistics
+{
+  // Number of times the sources were actually parsed, including the initial parse.
+  unsigned ParseCount;
+  // Number of Reparse calls.
+  unsigned ReparseCount;
+  // Number of Reparse calls satisfied from the existing AST, because no unsaved
+  // file contents and no included file on disk had changed.
+  unsigned ReparseSkippedCount;
+  // Number of unsaved files whose contents changed in the last Reparse call.
+  unsigned LastChangedFileCount;
+  // Duration of the last parse or Reparse call, in microseconds.
+  UINT64 LastParseMicroseconds;
+  // Accumulated duration of the initial parse and all Reparse calls, in microseconds.
+  UINT64 TotalParseMicroseconds;
+} DxcTranslationUnitStatistics;
+
+struct __declspec(uuid("b3a6d0d1-5c8e-4f27-9e1a-4d2f7c6b8e90"))
+IDxcTranslationUnitStatistics : public IUnknown
+{
+  virtual HRESULT STDMETHODCALLTYPE GetStatistics(_Out_ DxcTranslationUnitStatistics* pValue) = 0;
+};
+
 struct __declspec(uuid("2ec912fd-b144-4a15-ad0d-1c5439c81e46"))
 IDxcType : public IUnknown
 {
@@ -474,6 +474,54 @@ public:
 
 Timer *getPassTimer(Pass *);
 
+// HLSL Change Starts
+/// Receives a notification before and after each pass that the legacy pass
+/// managers run on the current thread. Pass managers themselves are not
+/// reported, only the passes they contain. The unit being run is provided
+/// for module and function passes; finer-grained passes run many times per
+/// function and report null instead.
+///
+/// Passes may also report named statistics about the work they did, which
+/// listeners are free to ignore.
+class PassExecutionListener {
+public:
+  virtual ~PassExecutionListener() {}
+  virtual void passStarted(Pass *P, Module *M, Function *F) = 0;
+  virtual void passFinished(Pass *P, Module *M, Function *F) = 0;
+  virtual void passStatistic(Pass *P, StringRef Name, uint64_t Value) {}
+};
+
+PassExecutionListener *getPassExecutionListener();
+
+/// Installs a listener for the current thread for the lifetime of the scope.
+class PassExecutionListenerScope {
+  PassExecutionListener *Prior;
+public:
+  explicit PassExecutionListenerScope(PassExecutionListener *L);
+  ~PassExecutionListenerScope();
+};
+
+/// Notifies the listener of the current thread, if any, around a pass run.
+class PassExecutionRegion {
+  PassExecutionListener *L;
+  Pass *P;
+  Module *M;
+  Function *F;
+public:
+  PassExecutionRegion(Pass *P, Module *M, Function *F)
+      : L(getPassExecutionListener()), P(P), M(M), F(F) {
+    if (L && P->getAsPMDataManager())
+      L = nullptr;
+    if (L)
+      L->passStarted(P, M, F);
+  }
+  ~PassExecutionRegion() {
+    if (L)
+      L->passFinished(P, M, F);
+  }
+};
+// HLSL Change Ends
+
 }
 
 #endif
@@ -404,6 +404,22 @@ protected:
 /// @brief This is the storage for the -time-passes option.
 extern bool TimePassesIsEnabled;
 
+// HLSL Change Starts
+/// Times the passes run on the current thread for the lifetime of the scope,
+/// as -time-passes does for every thread. Compiles running concurrently on
+/// other threads are unaffected.
+class TimePassesScope {
+  bool Prior;
+public:
+  explicit TimePassesScope(bool Enable);
+  ~TimePassesScope();
+};
+
+/// Returns true if passes run on the current thread are timed, either by
+/// -time-passes or by a TimePassesScope.
+bool areTimePassesEnabled();
+// HLSL Change Ends
+
 } // End llvm namespace
 
 // Include support files that contain important APIs commonly used by Passes,
@@ -158,7 +158,7 @@ static Constant *ConstantFoldUnaryFPIntrinsic(OP::OpCode opcode, Type *Ty, Const
   case OP::OpCode::Htan: return DxilConstantFoldFP(tanh, Op, Ty);
   case OP::OpCode::Exp:  return DxilConstantFoldFP(exp2, Op, Ty);
   case OP::OpCode::Frc: {
-    NativeFPUnaryOp f = [](double x) { double unused; return fabs(modf(x, &unused)); };
+    NativeFPUnaryOp f = [](double x) { return x - floor(x); };
     return DxilConstantFoldFP(f, Op, Ty);
   }
   case OP::OpCode::Log: return DxilConstantFoldFP(log2, Op, Ty);
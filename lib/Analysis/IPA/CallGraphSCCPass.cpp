@@ -123,6 +123,7 @@ bool CGPassManager::RunPassOnSCC(Pass *P, CallGraphSCC &CurSCC,
 
     {
       TimeRegion PassTimer(getPassTimer(CGSP));
+      PassExecutionRegion PassListener(CGSP, nullptr, nullptr); // HLSL Change
       Changed = CGSP->runOnSCC(CurSCC);
     }
     
@@ -247,6 +247,7 @@ bool LPPassManager::runOnFunction(Function &F) {
       {
         PassManagerPrettyStackEntry X(P, *CurrentLoop->getHeader());
         TimeRegion PassTimer(getPassTimer(P));
+        PassExecutionRegion PassListener(P, nullptr, nullptr); // HLSL Change
 
         Changed |= P->runOnLoop(CurrentLoop, *this);
       }
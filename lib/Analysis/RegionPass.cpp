@@ -96,6 +96,7 @@ bool RGPassManager::runOnFunction(Function &F) {
         PassManagerPrettyStackEntry X(P, *CurrentRegion->getEntry());
 
         TimeRegion PassTimer(getPassTimer(P));
+        PassExecutionRegion PassListener(P, nullptr, nullptr); // HLSL Change
         Changed |= P->runOnRegion(CurrentRegion, *this);
       }
 
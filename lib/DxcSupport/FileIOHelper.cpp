@@ -344,6 +344,92 @@ HRESULT DxcCreateBlobFromFile(LPCWSTR pFileName, UINT32 *pCodePage,
   return hr;
 }
 
+// A read-only view of a file mapped into memory, unmapped when the blob is
+// released.
+class MappedFileBlobEncoding : public IDxcBlobEncoding {
+private:
+  DXC_MICROCOM_REF_FIELD(m_dwRef)
+  LPVOID m_pView;
+  SIZE_T m_ViewSize;
+  bool m_EncodingKnown;
+  UINT32 m_CodePage;
+public:
+  DXC_MICROCOM_ADDREF_RELEASE_IMPL(m_dwRef)
+  MappedFileBlobEncoding(LPVOID pView, SIZE_T viewSize, bool encodingKnown,
+                         UINT32 codePage)
+      : m_dwRef(0), m_pView(pView), m_ViewSize(viewSize),
+        m_EncodingKnown(encodingKnown), m_CodePage(codePage) {}
+  ~MappedFileBlobEncoding() {
+    UnmapViewOfFile(m_pView);
+  }
+  HRESULT STDMETHODCALLTYPE QueryInterface(REFIID iid, void **ppvObject) {
+    return DoBasicQueryInterface2<IDxcBlob, IDxcBlobEncoding>(this, iid, ppvObject);
+  }
+
+  virtual LPVOID STDMETHODCALLTYPE GetBufferPointer(void) override {
+    return m_pView;
+  }
+  virtual SIZE_T STDMETHODCALLTYPE GetBufferSize(void) override {
+    return m_ViewSize;
+  }
+  virtual HRESULT STDMETHODCALLTYPE GetEncoding(_Out_ BOOL *pKnown, _Out_ UINT32 *pCodePage) {
+    *pKnown = m_EncodingKnown ? TRUE : FALSE;
+    *pCodePage = m_CodePage;
+    return S_OK;
+  }
+};
+
+_Use_decl_annotations_
+HRESULT DxcCreateBlobFromFileMapping(LPCWSTR pFileName, UINT32 *pCodePage,
+                                     IDxcBlobEncoding **ppBlobEncoding) {
+  if (pFileName == nullptr || ppBlobEncoding == nullptr) {
+    return E_POINTER;
+  }
+  *ppBlobEncoding = nullptr;
+
+  HANDLE hFile = CreateFileW(pFileName, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (hFile == INVALID_HANDLE_VALUE) {
+    return HRESULT_FROM_WIN32(GetLastError());
+  }
+  CHandle h(hFile);
+
+  LARGE_INTEGER FileSize;
+  if (!GetFileSizeEx(hFile, &FileSize)) {
+    return HRESULT_FROM_WIN32(GetLastError());
+  }
+  if (FileSize.HighPart != 0) {
+    return DXC_E_INPUT_FILE_TOO_LARGE;
+  }
+  // Small files aren't worth a mapping, and empty files can't be mapped.
+  if (FileSize.LowPart < DxcMinMappedFileSize) {
+    h.Close();
+    return DxcCreateBlobFromFile(pFileName, pCodePage, ppBlobEncoding);
+  }
+
+  HANDLE hMapping = CreateFileMappingW(hFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  if (hMapping == nullptr) {
+    return HRESULT_FROM_WIN32(GetLastError());
+  }
+  // The view keeps the mapping alive once the handles are closed.
+  CHandle m(hMapping);
+  LPVOID pView = MapViewOfFile(hMapping, FILE_MAP_READ, 0, 0, 0);
+  if (pView == nullptr) {
+    return HRESULT_FROM_WIN32(GetLastError());
+  }
+
+  bool known = (pCodePage != nullptr);
+  UINT32 codePage = (pCodePage != nullptr) ? *pCodePage : 0;
+  MappedFileBlobEncoding *pBlob = new (std::nothrow)
+      MappedFileBlobEncoding(pView, FileSize.LowPart, known, codePage);
+  if (pBlob == nullptr) {
+    UnmapViewOfFile(pView);
+    return E_OUTOFMEMORY;
+  }
+  pBlob->AddRef();
+  *ppBlobEncoding = pBlob;
+  return S_OK;
+}
+
 _Use_decl_annotations_
 HRESULT
 DxcCreateBlobWithEncodingSet(IDxcBlob *pBlob, UINT32 codePage,
@@ -456,6 +542,14 @@ DxcCreateBlobWithEncodingOnMalloc(LPCVOID pText, IMalloc *pIMalloc, UINT32 size,
 }
 
 
+static bool IsAsciiBuffer(const char *pText, SIZE_T size) {
+  for (SIZE_T i = 0; i < size; ++i) {
+    if ((unsigned char)pText[i] >= 0x80)
+      return false;
+  }
+  return true;
+}
+
 _Use_decl_annotations_
 HRESULT DxcGetBlobAsUtf8(IDxcBlob *pBlob, IDxcBlobEncoding **pBlobEncoding) {
   *pBlobEncoding = nullptr;
@@ -485,6 +579,13 @@ HRESULT DxcGetBlobAsUtf8(IDxcBlob *pBlob, IDxcBlobEncoding **pBlobEncoding) {
     codePage = DxcCodePageFromBytes((char *)pBlob->GetBufferPointer(), blobLen);
   }
 
+  // ASCII text reads the same in the ANSI code page as in UTF-8, which is the
+  // common case for shader sources; skip the round trip through UTF-16.
+  if (codePage == CP_ACP &&
+      IsAsciiBuffer((const char *)pBlob->GetBufferPointer(), blobLen)) {
+    codePage = CP_UTF8;
+  }
+
   if (codePage == CP_UTF8) {
     // Reuse the underlying blob but create an object with the encoding known.
     InternalDxcBlobEncoding* internalEncoding;
@@ -715,6 +816,10 @@ public:
   }
 
   __override HRESULT Reserve(ULONG targetSize) {
+    // Reserving never shrinks the buffer.
+    if (targetSize <= m_allocSize) {
+      return S_OK;
+    }
     if (m_pMemory == nullptr) {
       m_pMemory = (LPBYTE)m_pMalloc->Alloc(targetSize);
       if (m_pMemory == nullptr) {
@@ -765,10 +870,10 @@ public:
     if (cb + m_offset > m_allocSize) {
       HRESULT hr = Grow(cb + m_offset);
       if (FAILED(hr)) return hr;
-      // Implicitly extend as needed with zeroes.
-      if (m_offset > m_size) {
-        memset(m_pMemory + m_size, 0, m_offset - m_size);
-      }
+    }
+    // Implicitly extend as needed with zeroes.
+    if (m_offset > m_size) {
+      memset(m_pMemory + m_size, 0, m_offset - m_size);
     }
     *pcbWritten = cb;
     memcpy(m_pMemory + m_offset, pv, cb);
@@ -783,7 +888,8 @@ public:
       return E_OUTOFMEMORY;
     }
     if (val.LowPart > m_allocSize) {
-      return Grow(m_allocSize);
+      HRESULT hr = Grow(val.LowPart);
+      if (FAILED(hr)) return hr;
     }
     if (val.LowPart < m_size) {
       m_size = val.LowPart;
@@ -141,6 +141,8 @@ MainArgs::MainArgs(llvm::ArrayRef<llvm::StringRef> args) {
 MainArgs& MainArgs::operator=(const MainArgs &other) {
   Utf8StringVector.clear();
   Utf8CharPtrVector.clear();
+  Utf8StringVector.reserve(other.Utf8StringVector.size());
+  Utf8CharPtrVector.reserve(other.Utf8StringVector.size());
   for (const std::string &str : other.Utf8StringVector) {
     Utf8StringVector.emplace_back(str);
     Utf8CharPtrVector.push_back(Utf8StringVector.back().data());
@@ -238,6 +240,7 @@ int ReadDxcOpts(const OptTable *optionTable, unsigned flagsToInclude,
   // AssemblyCodeHex not supported (Fx)
   // OutputLibrary not supported (Fl)
   opts.AssemblyCode = Args.getLastArgValue(OPT_Fc);
+  opts.CostReport = Args.getLastArgValue(OPT_cost_report);
   opts.DebugFile = Args.getLastArgValue(OPT_Fd);
   opts.ExtractPrivateFile = Args.getLastArgValue(OPT_getprivate);
   opts.OutputObject = Args.getLastArgValue(OPT_Fo);
@@ -258,6 +261,41 @@ int ReadDxcOpts(const OptTable *optionTable, unsigned flagsToInclude,
   opts.RootSignatureSource = Args.getLastArgValue(OPT_setrootsignature);
   opts.VerifyRootSignatureSource = Args.getLastArgValue(OPT_verifyrootsignature);
   opts.RootSignatureDefine = Args.getLastArgValue(OPT_rootsig_define);
+  opts.CompileCacheDirectory = Args.getLastArgValue(OPT_compile_cache);
+  opts.TimeReportFile = Args.getLastArgValue(OPT_time_report_file);
+  opts.TimeReport = Args.hasFlag(OPT_time_report, OPT_INVALID, false);
+  opts.ShaderHash = Args.hasFlag(OPT_shader_hash, OPT_INVALID, false);
+
+  opts.CompileCacheMaxSizeMB = 256;
+  llvm::StringRef cacheSize = Args.getLastArgValue(OPT_compile_cache_size);
+  if (!cacheSize.empty() &&
+      (cacheSize.getAsInteger(10, opts.CompileCacheMaxSizeMB) ||
+       opts.CompileCacheMaxSizeMB == 0)) {
+    errors << "Invalid compile cache size '" << cacheSize << "'.";
+    return 1;
+  }
+  if (!cacheSize.empty() && opts.CompileCacheDirectory.empty()) {
+    errors << "Cannot specify a compile cache size without a cache directory.";
+    return 1;
+  }
+
+  opts.BatchFile = Args.getLastArgValue(OPT_batch);
+  opts.BatchThreads = 0;
+  llvm::StringRef batchThreads = Args.getLastArgValue(OPT_batch_threads);
+  if (!batchThreads.empty() &&
+      (batchThreads.getAsInteger(10, opts.BatchThreads) ||
+       opts.BatchThreads == 0)) {
+    errors << "Invalid batch thread count '" << batchThreads << "'.";
+    return 1;
+  }
+  if (!batchThreads.empty() && opts.BatchFile.empty()) {
+    errors << "Cannot specify a batch thread count without a batch file.";
+    return 1;
+  }
+  if (!opts.BatchFile.empty() && !opts.InputFile.empty()) {
+    errors << "Cannot specify an input file with a batch file; list inputs in the batch file instead.";
+    return 1;
+  }
 
   if (!opts.ForceRootSigVer.empty() && opts.ForceRootSigVer != "rootsig_1_0" &&
       opts.ForceRootSigVer != "rootsig_1_1") {
@@ -296,6 +334,7 @@ int ReadDxcOpts(const OptTable *optionTable, unsigned flagsToInclude,
   opts.NotUseLegacyCBufLoad = Args.hasFlag(OPT_not_use_legacy_cbuf_load, OPT_INVALID, false);
   opts.PackPrefixStable = Args.hasFlag(OPT_pack_prefix_stable, OPT_INVALID, false);
   opts.PackOptimized = Args.hasFlag(OPT_pack_optimized, OPT_INVALID, false);
+  opts.PackMinimal = Args.hasFlag(OPT_pack_minimal, OPT_INVALID, false);
   opts.DisplayIncludeProcess = Args.hasFlag(OPT_H, OPT_INVALID, false);
   opts.WarningAsError = Args.hasFlag(OPT__SLASH_WX, OPT_INVALID, false);
   opts.AvoidFlowControl = Args.hasFlag(OPT_Gfa, OPT_INVALID, false);
@@ -323,6 +362,10 @@ int ReadDxcOpts(const OptTable *optionTable, unsigned flagsToInclude,
     errors << "Cannot specify /pack_prefix_stable and /pack_optimized together, use /? to get usage information";
     return 1;
   }
+  if (opts.PackMinimal && (opts.PackPrefixStable || opts.PackOptimized)) {
+    errors << "Cannot specify /pack_minimal with /pack_prefix_stable or /pack_optimized, use /? to get usage information";
+    return 1;
+  }
   // TODO: more fxc option check.
   // ERR_RES_MAY_ALIAS_ONLY_IN_CS_5
   // ERR_NOT_ABLE_TO_FLATTEN on if that contain side effects
@@ -333,7 +376,8 @@ int ReadDxcOpts(const OptTable *optionTable, unsigned flagsToInclude,
   // ERR_TEMPLATE_VAR_CONFLICT
   // ERR_ATTRIBUTE_PARAM_SIDE_EFFECT
 
-  if ((flagsToInclude & hlsl::options::DriverOption) && opts.InputFile.empty()) {
+  if ((flagsToInclude & hlsl::options::DriverOption) && opts.InputFile.empty() &&
+      opts.BatchFile.empty()) {
     // Input file is required in arguments only for drivers; APIs take this through an argument.
     errors << "Required input file argument is missing. use -help to get more information.";
     return 1;
@@ -343,6 +387,34 @@ int ReadDxcOpts(const OptTable *optionTable, unsigned flagsToInclude,
     return 1;
   }
 
+  opts.ScanDependencies = Args.hasFlag(OPT_M, OPT_INVALID, false);
+  opts.DependencyFile = Args.getLastArgValue(OPT_MF);
+  opts.DependencyTarget = Args.getLastArgValue(OPT_MT);
+  opts.DependenciesAsJson = Args.hasFlag(OPT_Mjson, OPT_INVALID, false);
+  if (!opts.ScanDependencies &&
+      (!opts.DependencyFile.empty() || !opts.DependencyTarget.empty() ||
+       opts.DependenciesAsJson)) {
+    errors << "Cannot specify /MF, /MT or /Mjson without /M.";
+    return 1;
+  }
+  if (opts.ScanDependencies &&
+      (!opts.Preprocess.empty() || !opts.BatchFile.empty() || opts.DumpBin)) {
+    errors << "Cannot specify /M with /P, /batch or /dumpbin.";
+    return 1;
+  }
+
+  opts.CreatePch = Args.hasFlag(OPT_Yc, OPT_INVALID, false);
+  opts.UsePch = Args.getLastArgValue(OPT_Yu);
+  if (opts.CreatePch && !opts.UsePch.empty()) {
+    errors << "Cannot specify /Yc with /Yu.";
+    return 1;
+  }
+  if ((flagsToInclude & hlsl::options::DriverOption) && opts.CreatePch &&
+      opts.Preprocess.empty()) {
+    errors << "Cannot specify /Yc without /P.";
+    return 1;
+  }
+
   if (!opts.Preprocess.empty() &&
       (!opts.OutputHeader.empty() || !opts.OutputObject.empty() ||
        !opts.OutputWarnings || !opts.OutputWarningsFile.empty())) {
@@ -367,7 +439,8 @@ int ReadDxcOpts(const OptTable *optionTable, unsigned flagsToInclude,
   }
 
   if ((flagsToInclude & hlsl::options::DriverOption) &&
-      opts.TargetProfile.empty() && !opts.DumpBin && opts.Preprocess.empty() && !opts.RecompileFromBinary) {
+      opts.TargetProfile.empty() && !opts.DumpBin && opts.Preprocess.empty() && !opts.RecompileFromBinary &&
+      opts.BatchFile.empty() && !opts.ScanDependencies) {
     // Target profile is required in arguments only for drivers when compiling;
     // APIs take this through an argument.
     errors << "Target profile argument is missing";
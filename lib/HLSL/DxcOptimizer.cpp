@@ -35,7 +35,8 @@
 #include "llvm/Transforms/IPO/PassManagerBuilder.h"
 
 #include <algorithm>
-#include <list>   // should change this for string_table
+#include <atomic>
+#include <thread>
 #include <vector>
 
 // This is pretty ugly; should be refactored to a proper library
@@ -80,6 +81,7 @@ HRESULT SetupRegistryPassForHLSL() {
     initializeDCEPass(Registry);
     initializeDSEPass(Registry);
     initializeDeadInstEliminationPass(Registry);
+    initializeDxilCoalesceBufferLoadsPass(Registry);
     initializeDxilCondenseResourcesPass(Registry);
     initializeDxilEmitMetadataPass(Registry);
     initializeDxilGenerationPassPass(Registry);
@@ -88,6 +90,7 @@ HRESULT SetupRegistryPassForHLSL() {
     initializeDxilLegalizeStaticResourceUsePassPass(Registry);
     initializeDxilLoadMetadataPass(Registry);
     initializeDxilPrecisePropagatePassPass(Registry);
+    initializeDxilRedundantLoadEliminationPass(Registry);
     initializeDynamicIndexingVectorToArrayPass(Registry);
     initializeEarlyCSELegacyPassPass(Registry);
     initializeEliminateAvailableExternallyPass(Registry);
@@ -420,200 +423,80 @@ public:
   }
 };
 
-class DxcOptimizer : public IDxcOptimizer {
-private:
-  DXC_MICROCOM_REF_FIELD(m_dwRef)
-  PassRegistry *m_registry;
-  std::vector<const PassInfo *> m_passes;
-public:
-  DXC_MICROCOM_ADDREF_RELEASE_IMPL(m_dwRef)
-
-  HRESULT STDMETHODCALLTYPE QueryInterface(REFIID iid, void **ppvObject) {
-    return DoBasicQueryInterface<IDxcOptimizer>(this, iid, ppvObject);
-  }
-
-  DxcOptimizer() : m_dwRef(0) { }
-  HRESULT Initialize();
-  const PassInfo *getPassByID(llvm::AnalysisID PassID);
-  const PassInfo *getPassByName(const char *pName);
-  __override HRESULT STDMETHODCALLTYPE GetAvailablePassCount(_Out_ UINT32 *pCount) {
-    return AssignToOut<UINT32>(m_passes.size(), pCount);
-  }
-  __override HRESULT STDMETHODCALLTYPE GetAvailablePass(UINT32 index, _COM_Outptr_ IDxcOptimizerPass** ppResult);
-  __override HRESULT STDMETHODCALLTYPE RunOptimizer(IDxcBlob *pBlob,
-    _In_count_(optionCount) LPCWSTR *ppOptions, UINT32 optionCount,
-    _COM_Outptr_ IDxcBlob **ppOutputModule,
-    _COM_Outptr_opt_ IDxcBlobEncoding **ppOutputText);
+namespace {
+// One entry of a RunOptimizer option list.
+struct OptimizerPipelineStep {
+  enum StepKind { PrintModule, UseFunctionPasses, UseModulePasses, AddPass };
+  StepKind Kind;
+  std::string Banner;       // PrintModule
+  const PassInfo *PassInf;  // AddPass
+  std::vector<std::pair<std::string, std::string> > Options; // AddPass, sorted
 };
 
-class CapturePassManager : public llvm::legacy::PassManagerBase {
-private:
-  SmallVector<Pass *, 64> Passes;
-public:
-  ~CapturePassManager() {
-    for (auto P : Passes) delete P;
-  }
-
-  __override void add(Pass *P) {
-    Passes.push_back(P);
-  }
-
-  size_t size() const { return Passes.size(); }
-  const char *getPassNameAt(size_t index) const {
-    return Passes[index]->getPassName();
-  }
-  llvm::AnalysisID getPassIDAt(size_t index) const {
-    return Passes[index]->getPassID();
-  }
+// A RunOptimizer option list, parsed and resolved against the pass registry.
+// Pass instances belong to the module they run on, so they are created again
+// for each run; only the option handling is done once.
+struct OptimizerPipelineDesc {
+  bool OutputAssembly = false;
+  bool AnalyzeOnly = false;
+  std::vector<OptimizerPipelineStep> Steps;
 };
-
-HRESULT DxcOptimizer::Initialize() {
-  try {
-    m_registry = PassRegistry::getPassRegistry();
-
-    struct PRL : public PassRegistrationListener {
-      std::vector<const PassInfo *> *Passes;
-      __override void passEnumerate(const PassInfo * PI) {
-        DXASSERT(nullptr != PI->getNormalCtor(), "else cannot construct");
-        Passes->push_back(PI);
-      }
-    };
-    PRL prl;
-    prl.Passes = &this->m_passes;
-    m_registry->enumerateWith(&prl);
-  }
-  CATCH_CPP_RETURN_HRESULT();
-  return S_OK;
-}
-
-const PassInfo *DxcOptimizer::getPassByID(llvm::AnalysisID PassID) {
-  return m_registry->getPassInfo(PassID);
 }
 
-const PassInfo *DxcOptimizer::getPassByName(const char *pName) {
-  return m_registry->getPassInfo(StringRef(pName));
-}
-
-HRESULT STDMETHODCALLTYPE DxcOptimizer::GetAvailablePass(
-    UINT32 index, _COM_Outptr_ IDxcOptimizerPass **ppResult) {
-  IFR(AssignToOut(nullptr, ppResult));
-  if (index >= m_passes.size())
-    return E_INVALIDARG;
-  return DxcOptimizerPass::Create(
-      m_passes[index]->getPassArgument(), m_passes[index]->getPassName(),
-      GetPassArgNames(m_passes[index]->getPassArgument()),
-      GetPassArgDescriptions(m_passes[index]->getPassArgument()), ppResult);
-}
-
-HRESULT STDMETHODCALLTYPE DxcOptimizer::RunOptimizer(
-    IDxcBlob *pBlob, _In_count_(optionCount) LPCWSTR *ppOptions,
-    UINT32 optionCount, _COM_Outptr_ IDxcBlob **ppOutputModule,
-    _COM_Outptr_opt_ IDxcBlobEncoding **ppOutputText) {
-  AssignToOutOpt(nullptr, ppOutputModule);
-  AssignToOutOpt(nullptr, ppOutputText);
-  if (pBlob == nullptr)
-    return E_POINTER;
-  if (optionCount > 0 && ppOptions == nullptr)
-    return E_POINTER;
-
-  // Setup input buffer.
-  // The ir parsing requires the buffer to be null terminated. We deal with
-  // both source and bitcode input, so the input buffer may not be null
-  // terminated.
-  // Create a new membuf that copies the buffer and adds a null terminator.
-  StringRef bufStrRef(reinterpret_cast<const char *>(pBlob->GetBufferPointer()),
-                      pBlob->GetBufferSize());
-  std::unique_ptr<MemoryBuffer> memBuf =
-      MemoryBuffer::getMemBufferCopy(bufStrRef);
-
-  // Parse IR
-  LLVMContext Context;
-  SMDiagnostic Err;
-  std::unique_ptr<Module> M = parseIR(memBuf->getMemBufferRef(), Err, Context);
-  if (!M) {
-    //Err.print(argv[0], errs());
-    return E_INVALIDARG;
-  }
-
-  legacy::PassManager ModulePasses;
-  legacy::FunctionPassManager FunctionPasses(M.get());
-  legacy::PassManagerBase *pPassManager = &ModulePasses;
-
+static HRESULT ParseOptimizerPipeline(PassRegistry *registry,
+                                      _In_count_(optionCount) LPCWSTR *ppOptions,
+                                      UINT32 optionCount,
+                                      OptimizerPipelineDesc &desc) {
   try {
-    CComPtr<IMalloc> pMalloc;
-    CComPtr<AbstractMemoryStream> pOutputStream;
-    CComPtr<IDxcBlob> pOutputBlob;
-
-    IFT(CoGetMalloc(1, &pMalloc));
-    IFT(CreateMemoryStream(pMalloc, &pOutputStream));
-    IFT(pOutputStream.QueryInterface(&pOutputBlob));
-
-    raw_stream_ostream outStream(pOutputStream.p);
-
-    //
-    // Consider some differences from opt.exe:
-    //
-    // Create a new optimization pass for each one specified on the command line
-    // as in StandardLinkOpts, OptLevelO1, etc.
-    // No target machine, and so no passes get their target machine ctor called.
-    // No print-after-each-pass option.
-    // No printing of the pass options.
-    // No StripDebug support.
-    // No verifyModule before starting.
-    // Use of PassPipeline for new manager.
-    // No TargetInfo.
-    // No DataLayout.
-    //
-    bool OutputAssembly = false;
-    bool AnalyzeOnly = false;
-
     // First gather flags, wherever they may be.
     SmallVector<UINT32, 2> handled;
     for (UINT32 i = 0; i < optionCount; ++i) {
       if (wcseq(L"-S", ppOptions[i])) {
-        OutputAssembly = true;
+        desc.OutputAssembly = true;
         handled.push_back(i);
         continue;
       }
       if (wcseq(L"-analyze", ppOptions[i])) {
-        AnalyzeOnly = true;
+        desc.AnalyzeOnly = true;
         handled.push_back(i);
         continue;
       }
     }
 
-    // TODO: should really use string_table for this once that's available
-    std::list<std::string> optionsAnsi;
     SmallVector<PassOption, 2> options;
     for (UINT32 i = 0; i < optionCount; ++i) {
       if (std::find(handled.begin(), handled.end(), i) != handled.end()) {
         continue;
       }
 
+      OptimizerPipelineStep step;
+      step.PassInf = nullptr;
+
       // Handle some special cases where we can inject a redirected output stream.
       if (wcsstartswith(ppOptions[i], L"-print-module")) {
         LPCWSTR pName = ppOptions[i] + _countof(L"-print-module") - 1;
-        std::string Banner;
         if (*pName) {
           IFTARG(*pName != L':' || *pName != L'=');
           ++pName;
           CW2A name8(pName);
-          Banner = "MODULE-PRINT ";
-          Banner += name8.m_psz;
-          Banner += "\n";
+          step.Banner = "MODULE-PRINT ";
+          step.Banner += name8.m_psz;
+          step.Banner += "\n";
         }
-        if (pPassManager == &ModulePasses)
-          pPassManager->add(llvm::createPrintModulePass(outStream, Banner));
+        step.Kind = OptimizerPipelineStep::PrintModule;
+        desc.Steps.push_back(std::move(step));
         continue;
       }
 
       // Handle special switches to toggle per-function prepasses vs. module passes.
       if (wcseq(ppOptions[i], L"-opt-fn-passes")) {
-        pPassManager = &FunctionPasses;
+        step.Kind = OptimizerPipelineStep::UseFunctionPasses;
+        desc.Steps.push_back(std::move(step));
         continue;
       }
       if (wcseq(ppOptions[i], L"-opt-mod-passes")) {
-        pPassManager = &ModulePasses;
+        step.Kind = OptimizerPipelineStep::UseModulePasses;
+        desc.Steps.push_back(std::move(step));
         continue;
       }
 
@@ -632,7 +515,7 @@ HRESULT STDMETHODCALLTYPE DxcOptimizer::RunOptimizer(
         ++pCursor;
       }
       *pCursor = '\0';
-      const llvm::PassInfo *PassInf = getPassByName(pOptionNameStart);
+      const llvm::PassInfo *PassInf = registry->getPassInfo(StringRef(pOptionNameStart));
       if (!PassInf) {
         return E_INVALIDARG;
       }
@@ -670,12 +553,108 @@ HRESULT STDMETHODCALLTYPE DxcOptimizer::RunOptimizer(
       }
 
       DXASSERT(PassInf->getNormalCtor(), "else pass with no default .ctor was added");
+      step.Kind = OptimizerPipelineStep::AddPass;
+      step.PassInf = PassInf;
+      for (const PassOption &option : options) {
+        step.Options.emplace_back(option.first.str(), option.second.str());
+      }
+      options.clear();
+      desc.Steps.push_back(std::move(step));
+    }
+  }
+  CATCH_CPP_RETURN_HRESULT();
+  return S_OK;
+}
+
+static HRESULT RunOptimizerPipeline(const OptimizerPipelineDesc &desc,
+                                    IDxcBlob *pBlob,
+                                    _COM_Outptr_ IDxcBlob **ppOutputModule,
+                                    _COM_Outptr_opt_ IDxcBlobEncoding **ppOutputText) {
+  AssignToOutOpt(nullptr, ppOutputModule);
+  AssignToOutOpt(nullptr, ppOutputText);
+  if (pBlob == nullptr)
+    return E_POINTER;
+
+  // Setup input buffer.
+  // Bitcode is read in place. Textual IR parsing requires the buffer to be
+  // null terminated, which the blob may not be, so it is copied into a new
+  // membuf that adds a null terminator.
+  StringRef bufStrRef(reinterpret_cast<const char *>(pBlob->GetBufferPointer()),
+                      pBlob->GetBufferSize());
+  std::unique_ptr<MemoryBuffer> memBufCopy;
+  MemoryBufferRef memBufRef(bufStrRef, "");
+  if (!isBitcode(reinterpret_cast<const unsigned char *>(bufStrRef.begin()),
+                 reinterpret_cast<const unsigned char *>(bufStrRef.end()))) {
+    memBufCopy = MemoryBuffer::getMemBufferCopy(bufStrRef);
+    memBufRef = memBufCopy->getMemBufferRef();
+  }
+
+  // Parse IR
+  LLVMContext Context;
+  SMDiagnostic Err;
+  std::unique_ptr<Module> M = parseIR(memBufRef, Err, Context);
+  if (!M) {
+    //Err.print(argv[0], errs());
+    return E_INVALIDARG;
+  }
+
+  legacy::PassManager ModulePasses;
+  legacy::FunctionPassManager FunctionPasses(M.get());
+  legacy::PassManagerBase *pPassManager = &ModulePasses;
+
+  HRESULT hr = S_OK;
+  try {
+    CComPtr<IMalloc> pMalloc;
+    CComPtr<AbstractMemoryStream> pOutputStream;
+    CComPtr<IDxcBlob> pOutputBlob;
+
+    IFT(CoGetMalloc(1, &pMalloc));
+    IFT(CreateMemoryStream(pMalloc, &pOutputStream));
+    IFT(pOutputStream.QueryInterface(&pOutputBlob));
+
+    raw_stream_ostream outStream(pOutputStream.p);
+
+    //
+    // Consider some differences from opt.exe:
+    //
+    // Create a new optimization pass for each one specified on the command line
+    // as in StandardLinkOpts, OptLevelO1, etc.
+    // No target machine, and so no passes get their target machine ctor called.
+    // No print-after-each-pass option.
+    // No printing of the pass options.
+    // No StripDebug support.
+    // No verifyModule before starting.
+    // Use of PassPipeline for new manager.
+    // No TargetInfo.
+    // No DataLayout.
+    //
+    SmallVector<PassOption, 2> options;
+    for (const OptimizerPipelineStep &step : desc.Steps) {
+      switch (step.Kind) {
+      case OptimizerPipelineStep::PrintModule:
+        if (pPassManager == &ModulePasses)
+          pPassManager->add(llvm::createPrintModulePass(outStream, step.Banner));
+        continue;
+      case OptimizerPipelineStep::UseFunctionPasses:
+        pPassManager = &FunctionPasses;
+        continue;
+      case OptimizerPipelineStep::UseModulePasses:
+        pPassManager = &ModulePasses;
+        continue;
+      case OptimizerPipelineStep::AddPass:
+        break;
+      }
+
+      const llvm::PassInfo *PassInf = step.PassInf;
+      for (const auto &option : step.Options) {
+        options.push_back(PassOption(option.first, option.second));
+      }
       Pass *pass = PassInf->getNormalCtor()();
       pass->setOSOverride(&outStream);
       pass->applyOptions(options);
       options.clear();
       pPassManager->add(pass);
-      if (AnalyzeOnly) {
+      if (desc.AnalyzeOnly) {
         const bool Quiet = false;
         PassKind Kind = pass->getPassKind();
         switch (Kind) {
@@ -703,12 +682,15 @@ HRESULT STDMETHODCALLTYPE DxcOptimizer::RunOptimizer(
 
     ModulePasses.add(createVerifierPass());
 
-    if (OutputAssembly) {
+    if (desc.OutputAssembly) {
       ModulePasses.add(llvm::createPrintModulePass(outStream));
     }
 
     // Now that we have all of the passes ready, run them.
     {
+      // The fatal error handler is per thread, so pipelines running on other
+      // threads each report to their own output. It is only installed once
+      // parsing is done, since the bitcode reader installs its own.
       raw_ostream *err_ostream = &outStream;
       ScopedFatalErrorHandler errHandler(FatalErrorHandlerStreamWrite, err_ostream);
 
@@ -734,8 +716,202 @@ HRESULT STDMETHODCALLTYPE DxcOptimizer::RunOptimizer(
       IFT(pProgramStream.QueryInterface(ppOutputModule));
     }
   }
+  CATCH_CPP_ASSIGN_HRESULT();
+  return hr;
+}
+
+class DxcOptimizerPipeline : public IDxcOptimizerPipeline {
+private:
+  DXC_MICROCOM_REF_FIELD(m_dwRef)
+public:
+  OptimizerPipelineDesc m_desc;
+
+  DXC_MICROCOM_ADDREF_RELEASE_IMPL(m_dwRef)
+
+  HRESULT STDMETHODCALLTYPE QueryInterface(REFIID iid, void **ppvObject) {
+    return DoBasicQueryInterface<IDxcOptimizerPipeline>(this, iid, ppvObject);
+  }
+
+  DxcOptimizerPipeline() : m_dwRef(0) { }
+
+  __override HRESULT STDMETHODCALLTYPE RunOptimizer(IDxcBlob *pBlob,
+    _COM_Outptr_ IDxcBlob **ppOutputModule,
+    _COM_Outptr_opt_ IDxcBlobEncoding **ppOutputText) {
+    return RunOptimizerPipeline(m_desc, pBlob, ppOutputModule, ppOutputText);
+  }
+
+  __override HRESULT STDMETHODCALLTYPE RunOptimizerParallel(UINT32 blobCount,
+    _In_count_(blobCount) IDxcBlob **ppBlobs, UINT32 threadCount,
+    _Out_writes_opt_(blobCount) IDxcBlob **ppOutputModules,
+    _Out_writes_opt_(blobCount) IDxcBlobEncoding **ppOutputTexts,
+    _Out_writes_(blobCount) HRESULT *pResults);
+};
+
+HRESULT STDMETHODCALLTYPE DxcOptimizerPipeline::RunOptimizerParallel(
+    UINT32 blobCount, _In_count_(blobCount) IDxcBlob **ppBlobs,
+    UINT32 threadCount, _Out_writes_opt_(blobCount) IDxcBlob **ppOutputModules,
+    _Out_writes_opt_(blobCount) IDxcBlobEncoding **ppOutputTexts,
+    _Out_writes_(blobCount) HRESULT *pResults) {
+  if (blobCount > 0 && (ppBlobs == nullptr || pResults == nullptr))
+    return E_POINTER;
+  for (UINT32 i = 0; i < blobCount; ++i) {
+    if (ppOutputModules != nullptr)
+      ppOutputModules[i] = nullptr;
+    if (ppOutputTexts != nullptr)
+      ppOutputTexts[i] = nullptr;
+    pResults[i] = E_FAIL;
+  }
+
+  if (threadCount == 0)
+    threadCount = std::max(1u, std::thread::hardware_concurrency());
+  threadCount = std::min(threadCount, blobCount);
+
+  try {
+    // Modules are claimed in order by whichever thread is free, and each has
+    // its own context and pass managers, so the results are the same as
+    // running them one at a time.
+    std::atomic<UINT32> nextBlob(0);
+    auto worker = [&]() {
+      for (UINT32 i = nextBlob++; i < blobCount; i = nextBlob++) {
+        HRESULT hr;
+        try {
+          hr = RunOptimizerPipeline(
+              m_desc, ppBlobs[i],
+              ppOutputModules ? &ppOutputModules[i] : nullptr,
+              ppOutputTexts ? &ppOutputTexts[i] : nullptr);
+        }
+        CATCH_CPP_ASSIGN_HRESULT();
+        pResults[i] = hr;
+      }
+    };
+    std::vector<std::thread> threads;
+    for (UINT32 i = 1; i < threadCount; ++i)
+      threads.emplace_back(worker);
+    worker();
+    for (std::thread &t : threads)
+      t.join();
+  }
   CATCH_CPP_RETURN_HRESULT();
+  return S_OK;
+}
+
+class DxcOptimizer : public IDxcOptimizer, public IDxcOptimizerPipelineBuilder {
+private:
+  DXC_MICROCOM_REF_FIELD(m_dwRef)
+  PassRegistry *m_registry;
+  std::vector<const PassInfo *> m_passes;
+public:
+  DXC_MICROCOM_ADDREF_RELEASE_IMPL(m_dwRef)
+
+  HRESULT STDMETHODCALLTYPE QueryInterface(REFIID iid, void **ppvObject) {
+    return DoBasicQueryInterface2<IDxcOptimizer, IDxcOptimizerPipelineBuilder>(this, iid, ppvObject);
+  }
+
+  DxcOptimizer() : m_dwRef(0) { }
+  HRESULT Initialize();
+  const PassInfo *getPassByID(llvm::AnalysisID PassID);
+  const PassInfo *getPassByName(const char *pName);
+  __override HRESULT STDMETHODCALLTYPE GetAvailablePassCount(_Out_ UINT32 *pCount) {
+    return AssignToOut<UINT32>(m_passes.size(), pCount);
+  }
+  __override HRESULT STDMETHODCALLTYPE GetAvailablePass(UINT32 index, _COM_Outptr_ IDxcOptimizerPass** ppResult);
+  __override HRESULT STDMETHODCALLTYPE RunOptimizer(IDxcBlob *pBlob,
+    _In_count_(optionCount) LPCWSTR *ppOptions, UINT32 optionCount,
+    _COM_Outptr_ IDxcBlob **ppOutputModule,
+    _COM_Outptr_opt_ IDxcBlobEncoding **ppOutputText);
+  __override HRESULT STDMETHODCALLTYPE CreatePipeline(
+    _In_count_(optionCount) LPCWSTR *ppOptions, UINT32 optionCount,
+    _COM_Outptr_ IDxcOptimizerPipeline **ppPipeline);
+};
+
+class CapturePassManager : public llvm::legacy::PassManagerBase {
+private:
+  SmallVector<Pass *, 64> Passes;
+public:
+  ~CapturePassManager() {
+    for (auto P : Passes) delete P;
+  }
+
+  __override void add(Pass *P) {
+    Passes.push_back(P);
+  }
+
+  size_t size() const { return Passes.size(); }
+  const char *getPassNameAt(size_t index) const {
+    return Passes[index]->getPassName();
+  }
+  llvm::AnalysisID getPassIDAt(size_t index) const {
+    return Passes[index]->getPassID();
+  }
+};
+
+HRESULT DxcOptimizer::Initialize() {
+  try {
+    m_registry = PassRegistry::getPassRegistry();
+
+    struct PRL : public PassRegistrationListener {
+      std::vector<const PassInfo *> *Passes;
+      __override void passEnumerate(const PassInfo * PI) {
+        DXASSERT(nullptr != PI->getNormalCtor(), "else cannot construct");
+        Passes->push_back(PI);
+      }
+    };
+    PRL prl;
+    prl.Passes = &this->m_passes;
+    m_registry->enumerateWith(&prl);
+  }
+  CATCH_CPP_RETURN_HRESULT();
+  return S_OK;
+}
+
+const PassInfo *DxcOptimizer::getPassByID(llvm::AnalysisID PassID) {
+  return m_registry->getPassInfo(PassID);
+}
+
+const PassInfo *DxcOptimizer::getPassByName(const char *pName) {
+  return m_registry->getPassInfo(StringRef(pName));
+}
+
+HRESULT STDMETHODCALLTYPE DxcOptimizer::GetAvailablePass(
+    UINT32 index, _COM_Outptr_ IDxcOptimizerPass **ppResult) {
+  IFR(AssignToOut(nullptr, ppResult));
+  if (index >= m_passes.size())
+    return E_INVALIDARG;
+  return DxcOptimizerPass::Create(
+      m_passes[index]->getPassArgument(), m_passes[index]->getPassName(),
+      GetPassArgNames(m_passes[index]->getPassArgument()),
+      GetPassArgDescriptions(m_passes[index]->getPassArgument()), ppResult);
+}
+
+HRESULT STDMETHODCALLTYPE DxcOptimizer::RunOptimizer(
+    IDxcBlob *pBlob, _In_count_(optionCount) LPCWSTR *ppOptions,
+    UINT32 optionCount, _COM_Outptr_ IDxcBlob **ppOutputModule,
+    _COM_Outptr_opt_ IDxcBlobEncoding **ppOutputText) {
+  AssignToOutOpt(nullptr, ppOutputModule);
+  AssignToOutOpt(nullptr, ppOutputText);
+  if (pBlob == nullptr)
+    return E_POINTER;
+  if (optionCount > 0 && ppOptions == nullptr)
+    return E_POINTER;
+
+  OptimizerPipelineDesc desc;
+  IFR(ParseOptimizerPipeline(m_registry, ppOptions, optionCount, desc));
+  return RunOptimizerPipeline(desc, pBlob, ppOutputModule, ppOutputText);
+}
+
+HRESULT STDMETHODCALLTYPE DxcOptimizer::CreatePipeline(
+    _In_count_(optionCount) LPCWSTR *ppOptions, UINT32 optionCount,
+    _COM_Outptr_ IDxcOptimizerPipeline **ppPipeline) {
+  if (ppPipeline == nullptr)
+    return E_POINTER;
+  *ppPipeline = nullptr;
+  if (optionCount > 0 && ppOptions == nullptr)
+    return E_POINTER;
 
+  CComPtr<DxcOptimizerPipeline> result = new (std::nothrow) DxcOptimizerPipeline();
+  IFROOM(result.p);
+  IFR(ParseOptimizerPipeline(m_registry, ppOptions, optionCount, result->m_desc));
+  *ppPipeline = result.Detach();
   return S_OK;
 }
 
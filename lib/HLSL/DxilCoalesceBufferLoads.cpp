@@ -0,0 +1,318 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// DxilCoalesceBufferLoads.cpp                                               //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Merges adjacent raw and structured buffer loads into wide loads.          //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#include "dxc/HLSL/DxilGenerationPass.h"
+#include "dxc/HLSL/DxilModule.h"
+#include "dxc/HLSL/DxilOperations.h"
+#include "dxc/HLSL/DxilResource.h"
+
+#include "llvm/Analysis/ValueTracking.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Pass.h"
+
+#include <algorithm>
+#include <map>
+#include <vector>
+
+using namespace llvm;
+using namespace hlsl;
+
+///////////////////////////////////////////////////////////////////////////////
+// Coalesce buffer loads.
+//
+// ByteAddressBuffer Load and field-by-field structured buffer reads become one
+// bufferLoad per scalar or vector, each of which only uses some components of
+// its ResRet. When several loads in a block read the same buffer (and, for
+// structured buffers, the same element) at byte offsets that differ by a
+// constant, they are replaced with one load at the lowest offset and their
+// extractvalues are shifted to the matching components. The components used
+// after the merge are exactly the ones used before, so no new bytes are read.
+//
+// Loads whose status is checked are left alone, since a merged load can only
+// report one status. UAV loads are not merged across anything that may write
+// memory.
+
+namespace {
+
+struct BufferLoadInfo {
+  CallInst *CI;
+  int64_t Offset;    // Constant byte offset relative to the group base.
+  unsigned Order;    // Position in the block.
+  unsigned MaxComp;  // Highest component index used.
+};
+
+class DxilCoalesceBufferLoads : public FunctionPass {
+public:
+  static char ID; // Pass identification, replacement for typeid
+  explicit DxilCoalesceBufferLoads() : FunctionPass(ID) {}
+
+  const char *getPassName() const override {
+    return "DXIL coalesce buffer loads";
+  }
+
+  void getAnalysisUsage(AnalysisUsage &AU) const override {
+    AU.setPreservesCFG();
+  }
+
+  bool runOnFunction(Function &F) override {
+    Module *M = F.getParent();
+    if (!M->HasDxilModule())
+      return false;
+
+    bool bChanged = false;
+    for (BasicBlock &BB : F)
+      bChanged |= CoalesceBlock(BB, M->GetDxilModule());
+    return bChanged;
+  }
+
+private:
+  static bool GetBufferKind(Value *Handle, DxilModule &DM, bool &bRaw,
+                            bool &bUAV);
+  static Value *GetBaseAndOffset(Value *V, const DataLayout &DL,
+                                 int64_t &Offset);
+  static bool GetMaxUsedComponent(CallInst *CI, unsigned &MaxComp);
+
+  bool CoalesceBlock(BasicBlock &BB, DxilModule &DM);
+  void MergeLoads(ArrayRef<BufferLoadInfo> Loads, unsigned CoordIdx);
+};
+
+char DxilCoalesceBufferLoads::ID = 0;
+
+}
+
+bool DxilCoalesceBufferLoads::GetBufferKind(Value *Handle, DxilModule &DM,
+                                            bool &bRaw, bool &bUAV) {
+  CallInst *CI = dyn_cast<CallInst>(Handle);
+  if (!CI || !OP::IsDxilOpFuncCallInst(CI, DXIL::OpCode::CreateHandle))
+    return false;
+
+  ConstantInt *ResClass = dyn_cast<ConstantInt>(
+      CI->getArgOperand(DXIL::OperandIndex::kCreateHandleResClassOpIdx));
+  ConstantInt *ResID = dyn_cast<ConstantInt>(
+      CI->getArgOperand(DXIL::OperandIndex::kCreateHandleResIDOpIdx));
+  if (!ResClass || !ResID)
+    return false;
+
+  unsigned ID = ResID->getLimitedValue();
+  const DxilResource *Res = nullptr;
+  switch ((DXIL::ResourceClass)ResClass->getLimitedValue()) {
+  case DXIL::ResourceClass::SRV:
+    if (ID < DM.GetSRVs().size())
+      Res = &DM.GetSRV(ID);
+    bUAV = false;
+    break;
+  case DXIL::ResourceClass::UAV:
+    if (ID < DM.GetUAVs().size())
+      Res = &DM.GetUAV(ID);
+    bUAV = true;
+    break;
+  default:
+    break;
+  }
+  // Typed buffers address whole elements, and other threads' writes to a
+  // globallycoherent UAV may land between the original loads.
+  if (!Res || Res->IsGloballyCoherent())
+    return false;
+  if (Res->IsRawBuffer()) {
+    bRaw = true;
+    return true;
+  }
+  if (Res->IsStructuredBuffer()) {
+    bRaw = false;
+    return true;
+  }
+  return false;
+}
+
+Value *DxilCoalesceBufferLoads::GetBaseAndOffset(Value *V,
+                                                 const DataLayout &DL,
+                                                 int64_t &Offset) {
+  // Peel constant adds, including adds instcombine turned into ors.
+  Offset = 0;
+  while (true) {
+    if (ConstantInt *C = dyn_cast<ConstantInt>(V)) {
+      Offset += C->getSExtValue();
+      return nullptr;
+    }
+    BinaryOperator *BO = dyn_cast<BinaryOperator>(V);
+    if (!BO)
+      return V;
+    ConstantInt *C = dyn_cast<ConstantInt>(BO->getOperand(1));
+    if (!C)
+      return V;
+    if (BO->getOpcode() != Instruction::Add &&
+        !(BO->getOpcode() == Instruction::Or &&
+          haveNoCommonBitsSet(BO->getOperand(0), C, DL)))
+      return V;
+    Offset += C->getSExtValue();
+    V = BO->getOperand(0);
+  }
+}
+
+bool DxilCoalesceBufferLoads::GetMaxUsedComponent(CallInst *CI,
+                                                  unsigned &MaxComp) {
+  if (CI->user_empty())
+    return false;
+
+  MaxComp = 0;
+  for (User *U : CI->users()) {
+    ExtractValueInst *EV = dyn_cast<ExtractValueInst>(U);
+    if (!EV || EV->getNumIndices() != 1)
+      return false;
+    unsigned Comp = EV->getIndices()[0];
+    // Component 4 is the status.
+    if (Comp >= 4)
+      return false;
+    MaxComp = std::max(MaxComp, Comp);
+  }
+  return true;
+}
+
+bool DxilCoalesceBufferLoads::CoalesceBlock(BasicBlock &BB, DxilModule &DM) {
+  const DataLayout &DL = BB.getModule()->getDataLayout();
+
+  // Group by callee, handle, the coordinate that has to match, the base of
+  // the byte offset and, for UAVs, the stretch of code without writes.
+  typedef std::pair<std::vector<Value *>, unsigned> GroupKey;
+  std::map<GroupKey, unsigned> GroupIndex;
+  std::vector<std::vector<BufferLoadInfo>> Groups;
+  std::vector<bool> GroupIsRaw;
+
+  unsigned Order = 0;
+  unsigned WriteEpoch = 0;
+  for (Instruction &I : BB) {
+    ++Order;
+    if (I.mayWriteToMemory()) {
+      ++WriteEpoch;
+      continue;
+    }
+    CallInst *CI = dyn_cast<CallInst>(&I);
+    if (!CI || !OP::IsDxilOpFuncCallInst(CI, DXIL::OpCode::BufferLoad))
+      continue;
+    // Only 32-bit components are packed four to a 16-byte load.
+    StructType *RetTy = cast<StructType>(CI->getType());
+    if (RetTy->getElementType(0)->getPrimitiveSizeInBits() != 32)
+      continue;
+
+    bool bRaw, bUAV;
+    Value *Handle =
+        CI->getArgOperand(DXIL::OperandIndex::kBufferLoadHandleOpIdx);
+    if (!GetBufferKind(Handle, DM, bRaw, bUAV))
+      continue;
+
+    BufferLoadInfo Info;
+    Info.CI = CI;
+    Info.Order = Order;
+    if (!GetMaxUsedComponent(CI, Info.MaxComp))
+      continue;
+
+    // Raw buffers take the byte offset in coord0; structured buffers take
+    // the element index in coord0 and the byte offset in coord1.
+    unsigned CoordIdx = bRaw ? DXIL::OperandIndex::kBufferLoadCoord0OpIdx
+                             : DXIL::OperandIndex::kBufferLoadCoord1OpIdx;
+    unsigned OtherIdx = bRaw ? DXIL::OperandIndex::kBufferLoadCoord1OpIdx
+                             : DXIL::OperandIndex::kBufferLoadCoord0OpIdx;
+    Value *Base =
+        GetBaseAndOffset(CI->getArgOperand(CoordIdx), DL, Info.Offset);
+
+    GroupKey Key;
+    Key.first = {CI->getCalledValue(), Handle, CI->getArgOperand(OtherIdx),
+                 Base};
+    Key.second = bUAV ? WriteEpoch : 0;
+    auto It = GroupIndex.insert(std::make_pair(Key, (unsigned)Groups.size()));
+    if (It.second) {
+      Groups.emplace_back();
+      GroupIsRaw.emplace_back(bRaw);
+    }
+    Groups[It.first->second].emplace_back(Info);
+  }
+
+  bool bChanged = false;
+  for (unsigned i = 0; i < Groups.size(); ++i) {
+    std::vector<BufferLoadInfo> &Loads = Groups[i];
+    if (Loads.size() < 2)
+      continue;
+    std::sort(Loads.begin(), Loads.end(),
+              [](const BufferLoadInfo &A, const BufferLoadInfo &B) {
+                return A.Offset < B.Offset ||
+                       (A.Offset == B.Offset && A.Order < B.Order);
+              });
+
+    unsigned CoordIdx = GroupIsRaw[i]
+                            ? DXIL::OperandIndex::kBufferLoadCoord0OpIdx
+                            : DXIL::OperandIndex::kBufferLoadCoord1OpIdx;
+    // Greedily grow a window from the lowest offset while every used
+    // component still fits in the four a single load returns.
+    unsigned Start = 0;
+    for (unsigned j = 1; j <= Loads.size(); ++j) {
+      if (j < Loads.size()) {
+        int64_t Delta = Loads[j].Offset - Loads[Start].Offset;
+        if (Delta % 4 == 0 && Delta / 4 + Loads[j].MaxComp < 4)
+          continue;
+      }
+      if (j - Start > 1) {
+        MergeLoads(ArrayRef<BufferLoadInfo>(Loads).slice(Start, j - Start),
+                   CoordIdx);
+        bChanged = true;
+      }
+      Start = j;
+    }
+  }
+  return bChanged;
+}
+
+void DxilCoalesceBufferLoads::MergeLoads(ArrayRef<BufferLoadInfo> Loads,
+                                         unsigned CoordIdx) {
+  // Loads is sorted by offset; the merged load goes where the first of them
+  // in program order was, and addresses the lowest offset.
+  const BufferLoadInfo *First = &Loads[0];
+  for (const BufferLoadInfo &Info : Loads)
+    if (Info.Order < First->Order)
+      First = &Info;
+  int64_t MinOffset = Loads[0].Offset;
+
+  CallInst *FirstCI = First->CI;
+  IRBuilder<> Builder(FirstCI);
+  SmallVector<Value *, 4> Args(FirstCI->arg_operands().begin(),
+                               FirstCI->arg_operands().end());
+  if (First->Offset != MinOffset) {
+    uint32_t Adjust = (uint32_t)(MinOffset - First->Offset);
+    Args[CoordIdx] =
+        Builder.CreateAdd(Args[CoordIdx], Builder.getInt32(Adjust));
+  }
+  Value *WideLd =
+      Builder.CreateCall(FirstCI->getCalledValue(), Args,
+                         OP::GetOpCodeName(DXIL::OpCode::BufferLoad));
+
+  for (const BufferLoadInfo &Info : Loads) {
+    unsigned Shift = (unsigned)((Info.Offset - MinOffset) / 4);
+    SmallVector<User *, 4> Users(Info.CI->user_begin(), Info.CI->user_end());
+    for (User *U : Users) {
+      ExtractValueInst *EV = cast<ExtractValueInst>(U);
+      IRBuilder<> EVBuilder(EV);
+      Value *NewEV =
+          EVBuilder.CreateExtractValue(WideLd, EV->getIndices()[0] + Shift);
+      EV->replaceAllUsesWith(NewEV);
+      EV->eraseFromParent();
+    }
+    Info.CI->eraseFromParent();
+  }
+}
+
+FunctionPass *llvm::createDxilCoalesceBufferLoadsPass() {
+  return new DxilCoalesceBufferLoads();
+}
+
+INITIALIZE_PASS(DxilCoalesceBufferLoads, "dxil-coalesce-buffer-loads",
+                "DXIL coalesce buffer loads", false, false)
@@ -0,0 +1,248 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// DxilCompileTimeReport.cpp                                                 //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Time and memory used by each phase and pass of a compile.                 //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#include "dxc/HLSL/DxilCompileTimeReport.h"
+#include "dxc/Support/Global.h"
+#include "dxc/Support/WinIncludes.h"
+
+#include "llvm/IR/Function.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Pass.h"
+#include "llvm/PassRegistry.h"
+#include "llvm/PassInfo.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/Process.h"
+#include "llvm/Support/raw_ostream.h"
+#include <algorithm>
+#include <chrono>
+
+using namespace llvm;
+using namespace hlsl;
+
+namespace {
+
+double GetThreadCpuMs() {
+  FILETIME creation, exit, kernel, user;
+  if (!GetThreadTimes(GetCurrentThread(), &creation, &exit, &kernel, &user))
+    return 0;
+  ULARGE_INTEGER k, u;
+  k.LowPart = kernel.dwLowDateTime;
+  k.HighPart = kernel.dwHighDateTime;
+  u.LowPart = user.dwLowDateTime;
+  u.HighPart = user.dwHighDateTime;
+  // FILETIME is in units of 100ns.
+  return (double)(k.QuadPart + u.QuadPart) / 10000.0;
+}
+
+double GetWallMs() {
+  return std::chrono::duration<double, std::milli>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+uint64_t CountInstructions(const Function &F) {
+  uint64_t count = 0;
+  for (const BasicBlock &BB : F)
+    count += BB.size();
+  return count;
+}
+
+uint64_t CountInstructions(const Module &M) {
+  uint64_t count = 0;
+  for (const Function &F : M)
+    count += CountInstructions(F);
+  return count;
+}
+
+void WriteJsonString(raw_ostream &OS, StringRef value) {
+  OS << '"';
+  for (unsigned char c : value) {
+    switch (c) {
+    case '"':  OS << "\\\""; break;
+    case '\\': OS << "\\\\"; break;
+    case '\n': OS << "\\n"; break;
+    case '\r': OS << "\\r"; break;
+    case '\t': OS << "\\t"; break;
+    default:
+      if (c < 0x20)
+        OS << format("\\u%04x", c);
+      else
+        OS << c;
+    }
+  }
+  OS << '"';
+}
+
+} // namespace
+
+DxilCompileTimeReport::DxilCompileTimeReport() {
+  m_start = m_last = TakeSample(true);
+  m_lastHeapBytes = m_last.HeapBytes;
+}
+
+DxilCompileTimeReport::Sample
+DxilCompileTimeReport::TakeSample(bool withHeap) const {
+  Sample S;
+  S.WallMs = GetWallMs();
+  S.CpuMs = GetThreadCpuMs();
+  S.HasHeap = withHeap;
+  S.HeapBytes = withHeap ? sys::Process::GetMallocUsage() : 0;
+  return S;
+}
+
+void DxilCompileTimeReport::Charge(const Sample &now) {
+  double wall = now.WallMs - m_last.WallMs;
+  double cpu = now.CpuMs - m_last.CpuMs;
+  if (!m_phaseStack.empty()) {
+    Measurement &phase = m_phases[m_phaseStack.back()].Measure;
+    phase.WallMs += wall;
+    phase.CpuMs += cpu;
+    if (now.HasHeap) {
+      phase.AllocatedBytes += (int64_t)now.HeapBytes - (int64_t)m_lastHeapBytes;
+      phase.PeakBytes = std::max(phase.PeakBytes, now.HeapBytes);
+    }
+  }
+  if (!m_passStack.empty()) {
+    Measurement &pass = m_passes[m_passStack.back().Index].Measure;
+    pass.WallMs += wall;
+    pass.CpuMs += cpu;
+  }
+  if (now.HasHeap)
+    m_lastHeapBytes = now.HeapBytes;
+  m_last = now;
+}
+
+void DxilCompileTimeReport::StartPhase(StringRef Name) {
+  Sample now = TakeSample(true);
+  Charge(now);
+  auto it = std::find_if(m_phases.begin(), m_phases.end(),
+                         [&](const PhaseEntry &E) { return E.Name == Name; });
+  unsigned index = it - m_phases.begin();
+  if (it == m_phases.end()) {
+    m_phases.emplace_back();
+    m_phases.back().Name = Name;
+  }
+  Measurement &phase = m_phases[index].Measure;
+  phase.PeakBytes = std::max(phase.PeakBytes, now.HeapBytes);
+  m_phaseStack.push_back(index);
+}
+
+void DxilCompileTimeReport::StopPhase() {
+  DXASSERT(!m_phaseStack.empty(), "else phase stopped without being started");
+  Charge(TakeSample(true));
+  m_phaseStack.pop_back();
+}
+
+unsigned DxilCompileTimeReport::GetPassIndex(Pass *P) {
+  // Pass objects may be freed and their storage reused by a later pass, so
+  // the name is checked as well.
+  auto it = m_passIndex.find(P);
+  if (it != m_passIndex.end() && m_passes[it->second].Name == P->getPassName())
+    return it->second;
+
+  unsigned index = m_passes.size();
+  m_passes.emplace_back();
+  PassEntry &entry = m_passes.back();
+  entry.P = P;
+  entry.Name = P->getPassName();
+  if (const PassInfo *PI =
+          PassRegistry::getPassRegistry()->getPassInfo(P->getPassID()))
+    entry.Argument = PI->getPassArgument();
+  m_passIndex[P] = index;
+  return index;
+}
+
+void DxilCompileTimeReport::passStarted(Pass *P, Module *M, Function *F) {
+  // Heap usage is sampled around module passes only, as sampling walks the
+  // heap; instructions are counted outside of the measured time.
+  Charge(TakeSample(M != nullptr));
+
+  ActivePass active;
+  active.Index = GetPassIndex(P);
+  active.HasInstructionCounts = M != nullptr || F != nullptr;
+  active.InstructionsBefore =
+      M ? CountInstructions(*M) : F ? CountInstructions(*F) : 0;
+  m_passStack.push_back(active);
+
+  m_last = TakeSample(false);
+}
+
+void DxilCompileTimeReport::passFinished(Pass *P, Module *M, Function *F) {
+  DXASSERT(!m_passStack.empty() && m_passes[m_passStack.back().Index].P == P,
+           "else pass finished without being started");
+  Charge(TakeSample(M != nullptr));
+
+  ActivePass active = m_passStack.back();
+  m_passStack.pop_back();
+  PassEntry &entry = m_passes[active.Index];
+  ++entry.Runs;
+  if (active.HasInstructionCounts) {
+    entry.HasInstructionCounts = true;
+    entry.InstructionsBefore += active.InstructionsBefore;
+    entry.InstructionsAfter +=
+        M ? CountInstructions(*M) : F ? CountInstructions(*F) : 0;
+  }
+
+  m_last = TakeSample(false);
+}
+
+void DxilCompileTimeReport::passStatistic(Pass *P, StringRef Name,
+                                          uint64_t Value) {
+  PassEntry &entry = m_passes[GetPassIndex(P)];
+  auto it = std::find_if(
+      entry.Statistics.begin(), entry.Statistics.end(),
+      [&](const std::pair<std::string, uint64_t> &S) { return S.first == Name; });
+  if (it == entry.Statistics.end())
+    entry.Statistics.emplace_back(Name, Value);
+  else
+    it->second += Value;
+}
+
+void DxilCompileTimeReport::WriteJson(raw_ostream &OS) const {
+  OS << "{\n  \"phases\": [";
+  for (unsigned i = 0; i < m_phases.size(); ++i) {
+    const PhaseEntry &E = m_phases[i];
+    OS << (i ? ",\n" : "\n") << "    { \"name\": ";
+    WriteJsonString(OS, E.Name);
+    OS << format(", \"wallMs\": %.3f, \"cpuMs\": %.3f", E.Measure.WallMs,
+                 E.Measure.CpuMs)
+       << ", \"allocatedBytes\": " << E.Measure.AllocatedBytes
+       << ", \"peakBytes\": " << E.Measure.PeakBytes << " }";
+  }
+  OS << "\n  ],\n  \"passes\": [";
+  for (unsigned i = 0; i < m_passes.size(); ++i) {
+    const PassEntry &E = m_passes[i];
+    OS << (i ? ",\n" : "\n") << "    { \"name\": ";
+    WriteJsonString(OS, E.Name);
+    if (!E.Argument.empty()) {
+      OS << ", \"argument\": ";
+      WriteJsonString(OS, E.Argument);
+    }
+    OS << ", \"runs\": " << E.Runs
+       << format(", \"wallMs\": %.3f, \"cpuMs\": %.3f", E.Measure.WallMs,
+                 E.Measure.CpuMs);
+    if (E.HasInstructionCounts) {
+      OS << ", \"instructionsBefore\": " << E.InstructionsBefore
+         << ", \"instructionsAfter\": " << E.InstructionsAfter;
+    }
+    if (!E.Statistics.empty()) {
+      OS << ", \"statistics\": {";
+      for (unsigned j = 0; j < E.Statistics.size(); ++j) {
+        OS << (j ? ", " : " ");
+        WriteJsonString(OS, E.Statistics[j].first);
+        OS << ": " << E.Statistics[j].second;
+      }
+      OS << " }";
+    }
+    OS << " }";
+  }
+  OS << "\n  ]\n}\n";
+}
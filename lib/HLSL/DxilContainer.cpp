@@ -10,6 +10,7 @@
 ///////////////////////////////////////////////////////////////////////////////
 
 #include "dxc/HLSL/DxilContainer.h"
+#include "llvm/Support/MD5.h"
 #include <algorithm>
 
 namespace hlsl {
@@ -83,6 +84,64 @@ bool IsValidDxilContainer(const DxilContainerHeader *pHeader, size_t length) {
   return true;
 }
 
+static bool IsDxilPartHashed(uint32_t fourCC) {
+  switch (fourCC) {
+  case DFCC_ShaderDebugInfoDXIL:
+  case DFCC_ShaderStatistics:
+  case DFCC_PrivateData:
+  case DFCC_ShaderHash:
+    return false;
+  default:
+    return true;
+  }
+}
+
+void ComputeDxilContainerHash(const DxilContainerHeader *pHeader,
+                              _Out_ DxilContainerHash *pHash) {
+  llvm::MD5 md5;
+  md5.update(llvm::ArrayRef<uint8_t>(
+      reinterpret_cast<const uint8_t *>(&pHeader->Version),
+      sizeof(pHeader->Version)));
+  for (auto it = begin(pHeader), e = end(pHeader); it != e; ++it) {
+    const DxilPartHeader *pPart = *it;
+    if (!IsDxilPartHashed(pPart->PartFourCC))
+      continue;
+    md5.update(llvm::ArrayRef<uint8_t>(
+        reinterpret_cast<const uint8_t *>(pPart), sizeof(DxilPartHeader)));
+    md5.update(llvm::ArrayRef<uint8_t>(
+        reinterpret_cast<const uint8_t *>(GetDxilPartData(pPart)),
+        pPart->PartSize));
+  }
+  llvm::MD5::MD5Result result;
+  md5.final(result);
+  static_assert(sizeof(result) == DxilContainerHashSize,
+                "else digest doesn't fit the container hash");
+  memcpy(pHash->Digest, result, DxilContainerHashSize);
+}
+
+void UpdateDxilContainerHash(DxilContainerHeader *pHeader) {
+  DxilPartHeader *pPart = GetDxilPartByType(pHeader, DFCC_ShaderHash);
+  if (pPart == nullptr || pPart->PartSize != sizeof(DxilShaderHash))
+    return;
+  DxilContainerHash hash;
+  ComputeDxilContainerHash(pHeader, &hash);
+  DxilShaderHash *pShaderHash = (DxilShaderHash *)GetDxilPartData(pPart);
+  memcpy(pShaderHash->Digest, hash.Digest, DxilContainerHashSize);
+}
+
+bool VerifyDxilContainerHash(const DxilContainerHeader *pHeader, size_t length) {
+  if (!IsValidDxilContainer(pHeader, length))
+    return false;
+  const DxilPartHeader *pPart = GetDxilPartByType(pHeader, DFCC_ShaderHash);
+  if (pPart == nullptr || pPart->PartSize != sizeof(DxilShaderHash))
+    return false;
+  DxilContainerHash hash;
+  ComputeDxilContainerHash(pHeader, &hash);
+  const DxilShaderHash *pShaderHash =
+      (const DxilShaderHash *)GetDxilPartData(pPart);
+  return 0 == memcmp(hash.Digest, pShaderHash->Digest, DxilContainerHashSize);
+}
+
 const DxilPartHeader *GetDxilPartByType(const DxilContainerHeader *pHeader, DxilFourCC fourCC) {
   if (!IsDxilContainerLike(pHeader, pHeader->ContainerSizeInBytes)) {
     return nullptr;
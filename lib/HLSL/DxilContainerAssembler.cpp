@@ -17,6 +17,7 @@
 #include "dxc/HLSL/DxilModule.h"
 #include "dxc/HLSL/DxilShaderModel.h"
 #include "dxc/HLSL/DxilRootSignature.h"
+#include "dxc/HLSL/DxilShaderCost.h"
 #include "dxc/Support/Global.h"
 #include "dxc/Support/Unicode.h"
 #include "dxc/Support/WinIncludes.h"
@@ -524,12 +525,23 @@ private:
   };
 
   llvm::SmallVector<DxilPart, 8> m_Parts;
+  bool m_HasUnsizedLastPart = false;
 
 public:
   __override void AddPart(uint32_t FourCC, uint32_t Size, WriteFn Write) {
+    DXASSERT(!m_HasUnsizedLastPart, "else a part was added after the last one");
     m_Parts.emplace_back(FourCC, Size, Write);
   }
 
+  // Adds a last part whose size is only known once it has been written. It is
+  // written in place, after the container is reserved with the size of the
+  // other parts, and the part and container sizes are patched afterwards; its
+  // contents aren't included in size().
+  void AddUnsizedLastPart(uint32_t FourCC, WriteFn Write) {
+    AddPart(FourCC, 0, Write);
+    m_HasUnsizedLastPart = true;
+  }
+
   __override uint32_t size() const {
     uint32_t partSize = 0;
     for (auto &part : m_Parts) {
@@ -551,12 +563,24 @@ public:
       offset += sizeof(DxilPartHeader) + part.Header.PartSize;
     }
     for (auto &&part : m_Parts) {
+      size_t headerOffset = pStream->GetPosition();
       IFT(WriteStreamValue(pStream, part.Header));
       size_t start = pStream->GetPosition();
       part.Write(pStream);
+      if (m_HasUnsizedLastPart && &part == &m_Parts.back()) {
+        uint32_t partSize = (uint32_t)(pStream->GetPosition() - start);
+        DxilPartHeader *pPartHeader =
+            (DxilPartHeader *)(pStream->GetPtr() + headerOffset);
+        pPartHeader->PartSize = partSize;
+        ((DxilContainerHeader *)pStream->GetPtr())->ContainerSizeInBytes +=
+            partSize;
+        containerSizeInBytes += partSize;
+        continue;
+      }
       DXASSERT_LOCALVAR(start, pStream->GetPosition() - start == (size_t)part.Header.PartSize, "out of bound");
     }
     DXASSERT(containerSizeInBytes == (uint32_t)pStream->GetPosition(), "else stream size is incorrect");
+    UpdateDxilContainerHash((DxilContainerHeader *)pStream->GetPtr());
   }
 };
 
@@ -606,14 +630,49 @@ static void WriteProgramPart(const ShaderModel *pModel,
   }
 }
 
+static void WriteModuleBitcode(Module *pModule, IMalloc *pMalloc,
+                               CComPtr<AbstractMemoryStream> &pStream) {
+  pStream.Release();
+  IFT(CreateMemoryStream(pMalloc, &pStream));
+  raw_stream_ostream outStream(pStream.p);
+  WriteBitcodeToFile(pModule, outStream, true);
+}
+
+// Writes the program part for pModule, serializing the bitcode straight into
+// pStream and filling in the sizes once they are known.
+static void WriteProgramPartInPlace(const ShaderModel *pModel, Module *pModule,
+                                    AbstractMemoryStream *pStream) {
+  DXASSERT(pModel != nullptr, "else generation should have failed");
+  uint32_t ver =
+      EncodeVersion(pModel->GetKind(), pModel->GetMajor(), pModel->GetMinor());
+  size_t headerOffset = pStream->GetPosition();
+  DxilProgramHeader programHeader;
+  InitProgramHeader(programHeader, ver, 0);
+  IFT(WriteStreamValue(pStream, programHeader));
+  {
+    raw_stream_ostream outStream(pStream);
+    WriteBitcodeToFile(pModule, outStream, true);
+  }
+  uint32_t bitcodeSize = (uint32_t)(pStream->GetPosition() - headerOffset -
+                                    sizeof(DxilProgramHeader));
+  if (uint32_t paddingBytes = bitcodeSize % 4) {
+    uint32_t paddingValue = 0;
+    ULONG cbWritten;
+    IFT(pStream->Write(&paddingValue, 4 - paddingBytes, &cbWritten));
+  }
+  InitProgramHeader(programHeader, ver, bitcodeSize);
+  memcpy(pStream->GetPtr() + headerOffset, &programHeader,
+         sizeof(programHeader));
+}
+
 void hlsl::SerializeDxilContainerForModule(DxilModule *pModule,
                                            AbstractMemoryStream *pModuleBitcode,
-                                           AbstractMemoryStream *pFinalStream) {
+                                           AbstractMemoryStream *pFinalStream,
+                                           bool bIncludeShaderHash) {
   // TODO: add a flag to update the module and remove information that is not part
   // of DXIL proper and is used only to assemble the container.
 
   DXASSERT_NOMSG(pModule != nullptr);
-  DXASSERT_NOMSG(pModuleBitcode != nullptr);
   DXASSERT_NOMSG(pFinalStream != nullptr);
 
   DxilProgramSignatureWriter inputSigWriter(pModule->GetInputSignature(),
@@ -655,51 +714,73 @@ void hlsl::SerializeDxilContainerForModule(DxilModule *pModule,
     PSVWriter.write(pStream);
   });
 
+  // Write the instruction statistics (STAT) part, so reflection can report
+  // them without loading the function bodies.
+  DxilShaderStatistics statistics;
+  {
+    DxilShaderCost cost;
+    AnalyzeDxilShaderCost(*pModule->GetModule(), cost);
+    GetDxilShaderStatistics(cost, statistics);
+  }
+  writer.AddPart(DFCC_ShaderStatistics, sizeof(statistics), [&](AbstractMemoryStream *pStream) {
+    IFT(WriteStreamValue(pStream, statistics));
+  });
+
+  // Write the shader hash (HASH) part if requested. The digest is filled in
+  // once the rest of the container is written; the header hash is left to
+  // the validator.
+  if (bIncludeShaderHash) {
+    writer.AddPart(DFCC_ShaderHash, sizeof(DxilShaderHash), [&](AbstractMemoryStream *pStream) {
+      DxilShaderHash shaderHash = {};
+      IFT(WriteStreamValue(pStream, shaderHash));
+    });
+  }
+
   // Write the root signature (RTS0) part.
+  // The caller's bitcode, if any, still carries the root signature; the
+  // module is serialized again only once it has been stripped.
   DxilProgramRootSignatureWriter rootSigWriter(pModule->GetRootSignature());
   CComPtr<AbstractMemoryStream> pInputProgramStream = pModuleBitcode;
+  bool bitcodeIsCurrent = pModuleBitcode != nullptr;
   if (!pModule->GetRootSignature().IsEmpty()) {
     writer.AddPart(
         DFCC_RootSignature, rootSigWriter.size(),
         [&](AbstractMemoryStream *pStream) { rootSigWriter.write(pStream); });
     pModule->StripRootSignatureFromMetadata();
-    pInputProgramStream.Release();
-    CComPtr<IMalloc> pMalloc;
-    IFT(CoGetMalloc(1, &pMalloc));
-    IFT(CreateMemoryStream(pMalloc, &pInputProgramStream));
-    raw_stream_ostream outStream(pInputProgramStream.p);
-    WriteBitcodeToFile(pModule->GetModule(), outStream, true);
+    bitcodeIsCurrent = false;
   }
 
   // If we have debug information present, serialize it to a debug part, then use the stripped version as the canonical program version.
-  CComPtr<AbstractMemoryStream> pProgramStream = pInputProgramStream;
   if (HasDebugInfo(*pModule->GetModule())) {
+    if (!bitcodeIsCurrent) {
+      CComPtr<IMalloc> pMalloc;
+      IFT(CoGetMalloc(1, &pMalloc));
+      WriteModuleBitcode(pModule->GetModule(), pMalloc, pInputProgramStream);
+    }
     uint32_t debugInUInt32, debugPaddingBytes;
     GetPaddedProgramPartSize(pInputProgramStream, debugInUInt32, debugPaddingBytes);
     writer.AddPart(DFCC_ShaderDebugInfoDXIL, debugInUInt32 * sizeof(uint32_t) + sizeof(DxilProgramHeader), [&](AbstractMemoryStream *pStream) {
       WriteProgramPart(pModule->GetShaderModel(), pInputProgramStream, pStream);
     });
 
-    pProgramStream.Release();
-
     llvm::StripDebugInfo(*pModule->GetModule());
     pModule->StripDebugRelatedCode();
-
-    CComPtr<IMalloc> pMalloc;
-    IFT(CoGetMalloc(1, &pMalloc));
-    IFT(CreateMemoryStream(pMalloc, &pProgramStream));
-    raw_stream_ostream outStream(pProgramStream.p);
-    WriteBitcodeToFile(pModule->GetModule(), outStream, true);
+    bitcodeIsCurrent = false;
   }
 
-  // Compute padded bitcode size.
-  uint32_t programInUInt32, programPaddingBytes;
-  GetPaddedProgramPartSize(pProgramStream, programInUInt32, programPaddingBytes);
-
-  // Write the program part.
-  writer.AddPart(DFCC_DXIL, programInUInt32 * sizeof(uint32_t) + sizeof(DxilProgramHeader), [&](AbstractMemoryStream *pStream) {
-    WriteProgramPart(pModule->GetShaderModel(), pProgramStream, pStream);
-  });
+  // Write the program part. Unless the caller's bitcode can be used as is,
+  // the module is serialized straight into the container.
+  if (bitcodeIsCurrent) {
+    uint32_t programInUInt32, programPaddingBytes;
+    GetPaddedProgramPartSize(pInputProgramStream, programInUInt32, programPaddingBytes);
+    writer.AddPart(DFCC_DXIL, programInUInt32 * sizeof(uint32_t) + sizeof(DxilProgramHeader), [&](AbstractMemoryStream *pStream) {
+      WriteProgramPart(pModule->GetShaderModel(), pInputProgramStream, pStream);
+    });
+  } else {
+    writer.AddUnsizedLastPart(DFCC_DXIL, [&](AbstractMemoryStream *pStream) {
+      WriteProgramPartInPlace(pModule->GetShaderModel(), pModule->GetModule(), pStream);
+    });
+  }
 
   writer.write(pFinalStream);
 }
@@ -17,6 +17,7 @@
 #include "dxc/HLSL/DxilShaderModel.h"
 #include "dxc/HLSL/DxilOperations.h"
 #include "dxc/HLSL/DxilInstructions.h"
+#include "dxc/HLSL/DxilShaderCost.h"
 #include "dxc/Support/Global.h"
 #include "dxc/Support/Unicode.h"
 #include "dxc/Support/WinIncludes.h"
@@ -27,6 +28,7 @@
 #include <unordered_set>
 
 #include "dxc/dxcapi.h"
+#include "dxc/dxcapi.internal.h"
 
 #include "d3d12shader.h" // for compatibility
 #include "d3d11shader.h" // for compatibility
@@ -68,7 +70,8 @@ public:
 
 class CShaderReflectionConstantBuffer;
 class CShaderReflectionType;
-class DxilShaderReflection : public ID3D12ShaderReflection {
+class DxilShaderReflection : public ID3D12ShaderReflection,
+                             public IDxcShaderCostReflection {
 private:
   DXC_MICROCOM_REF_FIELD(m_dwRef)
   CComPtr<IDxcBlob> m_pContainer;
@@ -82,8 +85,20 @@ private:
   std::vector<D3D12_SIGNATURE_PARAMETER_DESC>     m_PatchConstantSignature;
   std::vector<std::unique_ptr<char[]>>            m_UpperCaseNames;
   std::vector<std::unique_ptr<CShaderReflectionType>> m_Types;
+  // Function bodies are only materialized for queries that walk instructions.
+  bool m_bCBufferUsageSet;
+  bool m_bSignatureUsageMarked;
+  bool m_bCostComputed;
+  DxilShaderCost m_Cost;
+  // Instruction statistics, from the STAT part if the container has one.
+  bool m_bStatisticsLoaded;
+  DxilShaderStatistics m_Statistics;
   void CreateReflectionObjects();
   void SetCBufferUsage();
+  HRESULT EnsureCBufferUsage();
+  HRESULT EnsureSignatureUsage();
+  HRESULT EnsureCost();
+  HRESULT EnsureStatistics();
   void CreateReflectionObjectForResource(DxilResourceBase *R);
   void CreateReflectionObjectsForSignature(
       const DxilSignature &Sig,
@@ -105,7 +120,9 @@ public:
   }
   DXC_MICROCOM_ADDREF_RELEASE_IMPL(m_dwRef)
   HRESULT STDMETHODCALLTYPE QueryInterface(REFIID iid, void **ppvObject) {
-    HRESULT hr = DoBasicQueryInterface<ID3D12ShaderReflection>(this, iid, ppvObject);
+    HRESULT hr = DoBasicQueryInterface2<ID3D12ShaderReflection,
+                                        IDxcShaderCostReflection>(
+        this, iid, ppvObject);
     if (hr == E_NOINTERFACE) {
       // ID3D11ShaderReflection is identical to ID3D12ShaderReflection, except
       // for some shorter data structures in some out parameters.
@@ -119,7 +136,10 @@ public:
     return hr;
   }
 
-  DxilShaderReflection() : m_dwRef(0), m_pDxilModule(nullptr) { }
+  DxilShaderReflection()
+      : m_dwRef(0), m_pDxilModule(nullptr), m_bCBufferUsageSet(false),
+        m_bSignatureUsageMarked(false), m_bCostComputed(false),
+        m_bStatisticsLoaded(false) {}
   HRESULT Load(IDxcBlob *pBlob, const DxilPartHeader *pPart);
 
   // ID3D12ShaderReflection
@@ -160,6 +180,12 @@ public:
     _Out_opt_ UINT* pSizeZ);
 
   STDMETHODIMP_(UINT64) GetRequiresFlags(THIS);
+
+  // IDxcShaderCostReflection
+  __override HRESULT STDMETHODCALLTYPE GetEstimatedCost(_Out_ UINT64 *pCost);
+  __override HRESULT STDMETHODCALLTYPE GetBlockCount(_Out_ UINT32 *pCount);
+  __override HRESULT STDMETHODCALLTYPE GetBlockCost(
+      UINT32 index, _Out_ DxcShaderBlockCost *pBlockCost);
 };
 
 _Use_decl_annotations_
@@ -1417,8 +1443,7 @@ void DxilShaderReflection::CreateReflectionObjects() {
     rcb.Initialize(*m_pDxilModule, *(cb.get()), m_Types);
     m_CBs.push_back(std::move(rcb));
   }
-  // Set cbuf usage.
-  SetCBufferUsage();
+  // Cbuf usage is set on first access, see EnsureCBufferUsage.
 
   // TODO: add tbuffers into m_CBs
   for (auto && uav : m_pDxilModule->GetUAVs()) {
@@ -1456,7 +1481,58 @@ void DxilShaderReflection::CreateReflectionObjects() {
   CreateReflectionObjectsForSignature(m_pDxilModule->GetInputSignature(), m_InputSignature);
   CreateReflectionObjectsForSignature(m_pDxilModule->GetOutputSignature(), m_OutputSignature);
   CreateReflectionObjectsForSignature(m_pDxilModule->GetPatchConstantSignature(), m_PatchConstantSignature);
-  MarkUsedSignatureElements();
+  // Signature usage is marked on first access, see EnsureSignatureUsage.
+}
+
+HRESULT DxilShaderReflection::EnsureCBufferUsage() {
+  if (m_bCBufferUsageSet)
+    return S_OK;
+  try {
+    // Handles may be created in any function, not just the entry.
+    if (m_pModule->materializeAll())
+      return E_INVALIDARG;
+    SetCBufferUsage();
+    m_bCBufferUsageSet = true;
+    return S_OK;
+  }
+  CATCH_CPP_RETURN_HRESULT();
+}
+
+HRESULT DxilShaderReflection::EnsureCost() {
+  if (m_bCostComputed)
+    return S_OK;
+  try {
+    if (m_pModule->materializeAll())
+      return E_INVALIDARG;
+    AnalyzeDxilShaderCost(*m_pModule, m_Cost);
+    m_bCostComputed = true;
+    return S_OK;
+  }
+  CATCH_CPP_RETURN_HRESULT();
+}
+
+HRESULT DxilShaderReflection::EnsureStatistics() {
+  if (m_bStatisticsLoaded)
+    return S_OK;
+  IFR(EnsureCost());
+  GetDxilShaderStatistics(m_Cost, m_Statistics);
+  m_bStatisticsLoaded = true;
+  return S_OK;
+}
+
+HRESULT DxilShaderReflection::EnsureSignatureUsage() {
+  if (m_bSignatureUsageMarked)
+    return S_OK;
+  try {
+    Function *F = m_pDxilModule->GetEntryFunction();
+    DXASSERT(F != nullptr, "else module load should have failed");
+    if (F->materialize())
+      return E_INVALIDARG;
+    MarkUsedSignatureElements();
+    m_bSignatureUsageMarked = true;
+    return S_OK;
+  }
+  CATCH_CPP_RETURN_HRESULT();
 }
 
 static D3D_REGISTER_COMPONENT_TYPE CompTypeToRegisterComponentType(CompType CT) {
@@ -1641,21 +1717,32 @@ HRESULT DxilShaderReflection::Load(IDxcBlob *pBlob,
     const char *pBitcode;
     uint32_t bitcodeLength;
     GetDxilProgramBitcode((DxilProgramHeader *)pData, &pBitcode, &bitcodeLength);
-    std::unique_ptr<MemoryBuffer> pMemBuffer =
-        MemoryBuffer::getMemBufferCopy(StringRef(pBitcode, bitcodeLength));
-#if 0 // We materialize eagerly, because we'll need to walk instructions to look for usage information.
+    // The bitcode is read in place; m_pContainer keeps it alive for as long
+    // as the module. Only metadata is loaded here, function bodies are
+    // materialized by the queries that walk instructions.
+    std::unique_ptr<MemoryBuffer> pMemBuffer = MemoryBuffer::getMemBuffer(
+        StringRef(pBitcode, bitcodeLength), "", false);
     ErrorOr<std::unique_ptr<Module>> module =
         getLazyBitcodeModule(std::move(pMemBuffer), Context);
-#else
-    ErrorOr<std::unique_ptr<Module>> module =
-      parseBitcodeFile(pMemBuffer->getMemBufferRef(), Context, nullptr);
-#endif
     if (!module) {
       return E_INVALIDARG;
     }
     std::swap(m_pModule, module.get());
     m_pDxilModule = &m_pModule->GetOrCreateDxilModule();
     CreateReflectionObjects();
+
+    // Statistics precomputed by the compiler keep GetDesc from having to
+    // materialize the function bodies.
+    const DxilContainerHeader *pHeader =
+        IsDxilContainerLike(pBlob->GetBufferPointer(), pBlob->GetBufferSize());
+    const DxilPartHeader *pStatisticsPart =
+        pHeader ? GetDxilPartByType(pHeader, DFCC_ShaderStatistics) : nullptr;
+    if (pStatisticsPart != nullptr &&
+        pStatisticsPart->PartSize == sizeof(DxilShaderStatistics)) {
+      memcpy(&m_Statistics, GetDxilPartData(pStatisticsPart),
+             sizeof(m_Statistics));
+      m_bStatisticsLoaded = true;
+    }
     return S_OK;
   }
   CATCH_CPP_RETURN_HRESULT();
@@ -1677,37 +1764,47 @@ HRESULT DxilShaderReflection::GetDesc(D3D12_SHADER_DESC *pDesc) {
   pDesc->OutputParameters = m_OutputSignature.size();
   pDesc->PatchConstantParameters = m_PatchConstantSignature.size();
 
-  // Unset:  UINT                    InstructionCount;            // Number of emitted instructions
+  // Containers without a STAT part fall back to walking the function bodies.
+  IFR(EnsureStatistics());
+  pDesc->InstructionCount = m_Statistics.InstructionCount;
   // Unset:  UINT                    TempRegisterCount;           // Number of temporary registers used 
-  // Unset:  UINT                    TempArrayCount;              // Number of temporary arrays used
+  pDesc->TempArrayCount = m_Statistics.TempArrayCount;
   // Unset:  UINT                    DefCount;                    // Number of constant defines 
   // Unset:  UINT                    DclCount;                    // Number of declarations (input + output)
-  // Unset:  UINT                    TextureNormalInstructions;   // Number of non-categorized texture instructions
-  // Unset:  UINT                    TextureLoadInstructions;     // Number of texture load instructions
-  // Unset:  UINT                    TextureCompInstructions;     // Number of texture comparison instructions
-  // Unset:  UINT                    TextureBiasInstructions;     // Number of texture bias instructions
-  // Unset:  UINT                    TextureGradientInstructions; // Number of texture gradient instructions
-  // Unset:  UINT                    FloatInstructionCount;       // Number of floating point arithmetic instructions used
-  // Unset:  UINT                    IntInstructionCount;         // Number of signed integer arithmetic instructions used
-  // Unset:  UINT                    UintInstructionCount;        // Number of unsigned integer arithmetic instructions used
-  // Unset:  UINT                    StaticFlowControlCount;      // Number of static flow control instructions used
-  // Unset:  UINT                    DynamicFlowControlCount;     // Number of dynamic flow control instructions used
+  pDesc->TextureNormalInstructions = m_Statistics.TextureNormalInstructions;
+  pDesc->TextureLoadInstructions = m_Statistics.TextureLoadInstructions;
+  pDesc->TextureCompInstructions = m_Statistics.TextureCompInstructions;
+  pDesc->TextureBiasInstructions = m_Statistics.TextureBiasInstructions;
+  pDesc->TextureGradientInstructions = m_Statistics.TextureGradientInstructions;
+  pDesc->FloatInstructionCount = m_Statistics.FloatInstructionCount;
+  pDesc->IntInstructionCount = m_Statistics.IntInstructionCount;
+  pDesc->UintInstructionCount = m_Statistics.UintInstructionCount;
+  pDesc->StaticFlowControlCount = m_Statistics.StaticFlowControlCount;
+  pDesc->DynamicFlowControlCount = m_Statistics.DynamicFlowControlCount;
   // Unset:  UINT                    MacroInstructionCount;       // Number of macro instructions used
-  // Unset:  UINT                    ArrayInstructionCount;       // Number of array instructions used
-  // Unset:  UINT                    CutInstructionCount;         // Number of cut instructions used
-  // Unset:  UINT                    EmitInstructionCount;        // Number of emit instructions used
-  // Unset:  D3D_PRIMITIVE_TOPOLOGY  GSOutputTopology;            // Geometry shader output topology
-  // Unset:  UINT                    GSMaxOutputVertexCount;      // Geometry shader maximum output vertex count
-  // Unset:  D3D_PRIMITIVE           InputPrimitive;              // GS/HS input primitive
-  // Unset:  UINT                    cGSInstanceCount;            // Number of Geometry shader instances
-  // Unset:  UINT                    cControlPoints;              // Number of control points in the HS->DS stage
-  // Unset:  D3D_TESSELLATOR_OUTPUT_PRIMITIVE HSOutputPrimitive;  // Primitive output by the tessellator
-  // Unset:  D3D_TESSELLATOR_PARTITIONING HSPartitioning;         // Partitioning mode of the tessellator
-  // Unset:  D3D_TESSELLATOR_DOMAIN  TessellatorDomain;           // Domain of the tessellator (quad, tri, isoline)
+  pDesc->ArrayInstructionCount = m_Statistics.ArrayInstructionCount;
+  pDesc->CutInstructionCount = m_Statistics.CutInstructionCount;
+  pDesc->EmitInstructionCount = m_Statistics.EmitInstructionCount;
+  if (pSM->IsGS()) {
+    pDesc->GSOutputTopology = (D3D_PRIMITIVE_TOPOLOGY)M.GetStreamPrimitiveTopology();
+    pDesc->GSMaxOutputVertexCount = M.GetMaxVertexCount();
+    pDesc->InputPrimitive = (D3D_PRIMITIVE)M.GetInputPrimitive();
+    pDesc->cGSInstanceCount = M.GetGSInstanceCount();
+  }
+  if (pSM->IsHS()) {
+    pDesc->cControlPoints = M.GetOutputControlPointCount();
+    pDesc->HSOutputPrimitive = (D3D_TESSELLATOR_OUTPUT_PRIMITIVE)M.GetTessellatorOutputPrimitive();
+    pDesc->HSPartitioning = (D3D_TESSELLATOR_PARTITIONING)M.GetTessellatorPartitioning();
+  }
+  if (pSM->IsHS() || pSM->IsDS()) {
+    if (pSM->IsDS())
+      pDesc->cControlPoints = M.GetInputControlPointCount();
+    pDesc->TessellatorDomain = (D3D_TESSELLATOR_DOMAIN)M.GetTessellatorDomain();
+  }
   // instruction counts
-  // Unset:  UINT cBarrierInstructions;                           // Number of barrier instructions in a compute shader
-  // Unset:  UINT cInterlockedInstructions;                       // Number of interlocked instructions
-  // Unset:  UINT cTextureStoreInstructions;                      // Number of texture writes
+  pDesc->cBarrierInstructions = m_Statistics.BarrierInstructions;
+  pDesc->cInterlockedInstructions = m_Statistics.InterlockedInstructions;
+  pDesc->cTextureStoreInstructions = m_Statistics.TextureStoreInstructions;
   return S_OK;
 }
 
@@ -1788,6 +1885,8 @@ ID3D12ShaderReflectionConstantBuffer* DxilShaderReflection::GetConstantBufferByI
   if (Index >= m_CBs.size()) {
     return &g_InvalidSRConstantBuffer;
   }
+  // On failure, variables keep the usage they were declared with.
+  (void)EnsureCBufferUsage();
   return &m_CBs[Index];
 }
 
@@ -1796,6 +1895,7 @@ ID3D12ShaderReflectionConstantBuffer* DxilShaderReflection::GetConstantBufferByN
   if (!Name) {
     return &g_InvalidSRConstantBuffer;
   }
+  (void)EnsureCBufferUsage();
   for (UINT index = 0; index < m_CBs.size(); ++index) {
     if (0 == strcmp(m_CBs[index].GetName(), Name)) {
       return &m_CBs[index];
@@ -1823,6 +1923,7 @@ HRESULT DxilShaderReflection::GetInputParameterDesc(UINT ParameterIndex,
   _Out_ D3D12_SIGNATURE_PARAMETER_DESC *pDesc) {
   IFRBOOL(pDesc != nullptr, E_INVALIDARG);
   IFRBOOL(ParameterIndex < m_InputSignature.size(), E_INVALIDARG);
+  IFR(EnsureSignatureUsage());
   if (m_PublicAPI != PublicAPI::D3D11_43)
     *pDesc = m_InputSignature[ParameterIndex];
   else
@@ -1838,6 +1939,7 @@ HRESULT DxilShaderReflection::GetOutputParameterDesc(UINT ParameterIndex,
   D3D12_SIGNATURE_PARAMETER_DESC *pDesc) {
   IFRBOOL(pDesc != nullptr, E_INVALIDARG);
   IFRBOOL(ParameterIndex < m_OutputSignature.size(), E_INVALIDARG);
+  IFR(EnsureSignatureUsage());
   if (m_PublicAPI != PublicAPI::D3D11_43)
     *pDesc = m_OutputSignature[ParameterIndex];
   else
@@ -1853,6 +1955,7 @@ HRESULT DxilShaderReflection::GetPatchConstantParameterDesc(UINT ParameterIndex,
   D3D12_SIGNATURE_PARAMETER_DESC *pDesc) {
   IFRBOOL(pDesc != nullptr, E_INVALIDARG);
   IFRBOOL(ParameterIndex < m_PatchConstantSignature.size(), E_INVALIDARG);
+  IFR(EnsureSignatureUsage());
   if (m_PublicAPI != PublicAPI::D3D11_43)
     *pDesc = m_PatchConstantSignature[ParameterIndex];
   else
@@ -1866,6 +1969,7 @@ HRESULT DxilShaderReflection::GetPatchConstantParameterDesc(UINT ParameterIndex,
 _Use_decl_annotations_
 ID3D12ShaderReflectionVariable* DxilShaderReflection::GetVariableByName(LPCSTR Name) {
   if (Name != nullptr) {
+    (void)EnsureCBufferUsage();
     // Iterate through all cbuffers to find the variable.
     for (UINT i = 0; i < m_CBs.size(); i++) {
       ID3D12ShaderReflectionVariable *pVar = m_CBs[i].GetVariableByName(Name);
@@ -1899,10 +2003,17 @@ HRESULT DxilShaderReflection::GetResourceBindingDescByName(LPCSTR Name,
   return HRESULT_FROM_WIN32(ERROR_NOT_FOUND);
 }
 
+// SSA form has no moves; the other counts are zero if the bodies fail to load.
 UINT DxilShaderReflection::GetMovInstructionCount() { return 0; }
-UINT DxilShaderReflection::GetMovcInstructionCount() { return 0; }
-UINT DxilShaderReflection::GetConversionInstructionCount() { return 0; }
-UINT DxilShaderReflection::GetBitwiseInstructionCount() { return 0; }
+UINT DxilShaderReflection::GetMovcInstructionCount() {
+  return SUCCEEDED(EnsureStatistics()) ? m_Statistics.MovcInstructionCount : 0;
+}
+UINT DxilShaderReflection::GetConversionInstructionCount() {
+  return SUCCEEDED(EnsureStatistics()) ? m_Statistics.ConversionInstructionCount : 0;
+}
+UINT DxilShaderReflection::GetBitwiseInstructionCount() {
+  return SUCCEEDED(EnsureStatistics()) ? m_Statistics.BitwiseInstructionCount : 0;
+}
 
 D3D_PRIMITIVE DxilShaderReflection::GetGSInputPrimitive() {
   return (D3D_PRIMITIVE)m_pDxilModule->GetInputPrimitive();
@@ -1948,3 +2059,30 @@ UINT64 DxilShaderReflection::GetRequiresFlags() {
   if (features & ShaderFeatureInfo_ViewportAndRTArrayIndexFromAnyShaderFeedingRasterizer) result |= D3D_SHADER_REQUIRES_VIEWPORT_AND_RT_ARRAY_INDEX_FROM_ANY_SHADER_FEEDING_RASTERIZER;
   return result;
 }
+
+_Use_decl_annotations_
+HRESULT DxilShaderReflection::GetEstimatedCost(UINT64 *pCost) {
+  IFR(EnsureCost());
+  return AssignToOut<UINT64>(m_Cost.EstimatedCost, pCost);
+}
+
+_Use_decl_annotations_
+HRESULT DxilShaderReflection::GetBlockCount(UINT32 *pCount) {
+  IFR(EnsureCost());
+  return AssignToOut<UINT32>(m_Cost.Blocks.size(), pCount);
+}
+
+_Use_decl_annotations_
+HRESULT DxilShaderReflection::GetBlockCost(UINT32 index,
+                                           DxcShaderBlockCost *pBlockCost) {
+  IFRBOOL(pBlockCost != nullptr, E_POINTER);
+  IFR(EnsureCost());
+  IFRBOOL(index < m_Cost.Blocks.size(), E_INVALIDARG);
+  const DxilBlockCost &Block = m_Cost.Blocks[index];
+  pBlockCost->FunctionName = Block.F->getName().data();
+  pBlockCost->InstructionCount = Block.InstructionCount;
+  pBlockCost->LoopDepth = Block.LoopDepth;
+  pBlockCost->ExecutionCount = Block.ExecutionCount;
+  pBlockCost->Cost = Block.Cost;
+  return S_OK;
+}
@@ -30,6 +30,7 @@
 #include "llvm/IR/Module.h"
 #include "llvm/IR/DebugInfo.h"
 #include "llvm/IR/PassManager.h"
+#include "llvm/IR/LegacyPassManagers.h"
 #include "llvm/ADT/BitVector.h"
 #include "llvm/Pass.h"
 #include "llvm/Transforms/Utils/Local.h"
@@ -722,23 +723,33 @@ void DxilGenerationPass::AllocateDxilInputOutputs() {
   if (packing == DXIL::PackingStrategy::Default)
     packing = m_pHLModule->GetShaderModel()->GetDefaultPackingStrategy();
 
-  m_pHLModule->GetInputSignature().PackElements(packing);
+  unsigned rowsSaved = 0, sigRowsSaved = 0;
+  m_pHLModule->GetInputSignature().PackElements(packing, &sigRowsSaved);
+  rowsSaved += sigRowsSaved;
   if (!m_pHLModule->GetInputSignature().IsFullyAllocated()) {
     m_pHLModule->GetCtx().emitError("Failed to allocate all input signature elements in available space.");
   }
 
-  m_pHLModule->GetOutputSignature().PackElements(packing);
+  m_pHLModule->GetOutputSignature().PackElements(packing, &sigRowsSaved);
+  rowsSaved += sigRowsSaved;
   if (!m_pHLModule->GetOutputSignature().IsFullyAllocated()) {
     m_pHLModule->GetCtx().emitError("Failed to allocate all output signature elements in available space.");
   }
 
   if (m_pHLModule->GetShaderModel()->IsHS() ||
       m_pHLModule->GetShaderModel()->IsDS()) {
-    m_pHLModule->GetPatchConstantSignature().PackElements(packing);
+    m_pHLModule->GetPatchConstantSignature().PackElements(packing, &sigRowsSaved);
+    rowsSaved += sigRowsSaved;
     if (!m_pHLModule->GetPatchConstantSignature().IsFullyAllocated()) {
       m_pHLModule->GetCtx().emitError("Failed to allocate all patch constant signature elements in available space.");
     }
   }
+
+  // Let the compile-time report show what minimal packing bought.
+  if (packing == DXIL::PackingStrategy::Minimal) {
+    if (PassExecutionListener *L = getPassExecutionListener())
+      L->passStatistic(this, "signatureRowsSaved", rowsSaved);
+  }
 }
 
 void DxilGenerationPass::GenerateDxilInputs() {
@@ -0,0 +1,275 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// DxilRedundantLoadElimination.cpp                                          //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Removes redundant resource handle, cbuffer and resource loads.            //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#include "dxc/HLSL/DxilGenerationPass.h"
+#include "dxc/HLSL/DxilModule.h"
+#include "dxc/HLSL/DxilOperations.h"
+#include "dxc/HLSL/DxilResource.h"
+
+#include "llvm/ADT/DepthFirstIterator.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/Dominators.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Pass.h"
+
+#include <map>
+#include <vector>
+
+using namespace llvm;
+using namespace hlsl;
+
+///////////////////////////////////////////////////////////////////////////////
+// Redundant load elimination.
+//
+// GVN treats every dx.op call that is not readnone/readonly as a clobber, so
+// a storeOutput or barrier between two identical cbufferLoadLegacy calls
+// keeps both alive, and EarlyCSE is not part of the HLSL pipeline. This pass
+// uses knowledge of the dx.op classes instead:
+//  - createHandle, cbuffer loads and loads from SRVs read memory that cannot
+//    change during the invocation. Identical calls are replaced by a
+//    dominating one, or hoisted to their nearest common dominator.
+//  - loads from UAVs are only reused within a block, and only until the next
+//    instruction that may write memory (stores, atomics, barriers).
+
+namespace {
+
+typedef std::vector<Value *> LoadKey;
+
+class DxilRedundantLoadElimination : public FunctionPass {
+public:
+  static char ID; // Pass identification, replacement for typeid
+  explicit DxilRedundantLoadElimination() : FunctionPass(ID) {}
+
+  const char *getPassName() const override {
+    return "DXIL redundant load elimination";
+  }
+
+  void getAnalysisUsage(AnalysisUsage &AU) const override {
+    AU.addRequired<DominatorTreeWrapperPass>();
+    AU.setPreservesCFG();
+  }
+
+  bool runOnFunction(Function &F) override {
+    DominatorTree &DT = getAnalysis<DominatorTreeWrapperPass>().getDomTree();
+    DxilModule *pDM = F.getParent()->HasDxilModule()
+                          ? &F.getParent()->GetDxilModule()
+                          : nullptr;
+
+    bool bChanged = false;
+    // Handles first, so loads through equivalent handles get equal keys.
+    bChanged |= EliminateImmutable(F, DT, pDM, /*bHandles*/ true);
+    bChanged |= EliminateImmutable(F, DT, pDM, /*bHandles*/ false);
+    bChanged |= EliminateMutableInBlock(F, pDM);
+    return bChanged;
+  }
+
+private:
+  enum class LoadKind { None, Immutable, Mutable };
+
+  static LoadKind GetLoadKind(CallInst *CI, DxilModule *pDM);
+  static LoadKind GetHandleKind(Value *Handle, DxilModule *pDM);
+  static LoadKey GetKey(CallInst *CI);
+  static bool IsAvailableAt(CallInst *CI, Instruction *InsertPt,
+                            DominatorTree &DT);
+
+  bool EliminateImmutable(Function &F, DominatorTree &DT, DxilModule *pDM,
+                          bool bHandles);
+  bool EliminateMutableInBlock(Function &F, DxilModule *pDM);
+};
+
+char DxilRedundantLoadElimination::ID = 0;
+
+}
+
+DxilRedundantLoadElimination::LoadKind
+DxilRedundantLoadElimination::GetHandleKind(Value *Handle, DxilModule *pDM) {
+  CallInst *CI = dyn_cast<CallInst>(Handle);
+  if (!CI || !OP::IsDxilOpFuncCallInst(CI, DXIL::OpCode::CreateHandle))
+    return LoadKind::None;
+
+  ConstantInt *ResClass = dyn_cast<ConstantInt>(
+      CI->getArgOperand(DXIL::OperandIndex::kCreateHandleResClassOpIdx));
+  if (!ResClass)
+    return LoadKind::None;
+
+  switch ((DXIL::ResourceClass)ResClass->getLimitedValue()) {
+  case DXIL::ResourceClass::SRV:
+  case DXIL::ResourceClass::CBuffer:
+    return LoadKind::Immutable;
+  case DXIL::ResourceClass::UAV: {
+    // Writes from other threads to a globallycoherent UAV are meant to be
+    // observed, so don't reuse loads from it at all.
+    ConstantInt *ResID = dyn_cast<ConstantInt>(
+        CI->getArgOperand(DXIL::OperandIndex::kCreateHandleResIDOpIdx));
+    if (!pDM || !ResID || ResID->getLimitedValue() >= pDM->GetUAVs().size())
+      return LoadKind::None;
+    if (pDM->GetUAV(ResID->getLimitedValue()).IsGloballyCoherent())
+      return LoadKind::None;
+    return LoadKind::Mutable;
+  }
+  default:
+    return LoadKind::None;
+  }
+}
+
+DxilRedundantLoadElimination::LoadKind
+DxilRedundantLoadElimination::GetLoadKind(CallInst *CI, DxilModule *pDM) {
+  if (!OP::IsDxilOpFuncCallInst(CI))
+    return LoadKind::None;
+
+  switch (OP::GetDxilOpFuncCallInst(CI)) {
+  case DXIL::OpCode::CreateHandle:
+  case DXIL::OpCode::CBufferLoad:
+  case DXIL::OpCode::CBufferLoadLegacy:
+    return LoadKind::Immutable;
+  case DXIL::OpCode::BufferLoad:
+  case DXIL::OpCode::TextureLoad:
+    // Both take the resource handle as their first argument.
+    return GetHandleKind(
+        CI->getArgOperand(DXIL::OperandIndex::kBufferLoadHandleOpIdx), pDM);
+  default:
+    return LoadKind::None;
+  }
+}
+
+LoadKey DxilRedundantLoadElimination::GetKey(CallInst *CI) {
+  // The callee carries the overload, the arguments the opcode and address.
+  LoadKey Key;
+  Key.reserve(CI->getNumArgOperands() + 1);
+  Key.emplace_back(CI->getCalledValue());
+  for (Value *Arg : CI->arg_operands())
+    Key.emplace_back(Arg);
+  return Key;
+}
+
+bool DxilRedundantLoadElimination::IsAvailableAt(CallInst *CI,
+                                                 Instruction *InsertPt,
+                                                 DominatorTree &DT) {
+  for (Value *Arg : CI->arg_operands()) {
+    if (Instruction *ArgI = dyn_cast<Instruction>(Arg))
+      if (!DT.dominates(ArgI, InsertPt))
+        return false;
+  }
+  return true;
+}
+
+bool DxilRedundantLoadElimination::EliminateImmutable(Function &F,
+                                                      DominatorTree &DT,
+                                                      DxilModule *pDM,
+                                                      bool bHandles) {
+  bool bChanged = false;
+  // Leaders for each key, in the order the keys were first seen so hoisting
+  // doesn't depend on pointer values. No leader dominates another one.
+  std::map<LoadKey, unsigned> KeyIndex;
+  std::vector<std::vector<CallInst *>> Leaders;
+
+  // Dominator tree preorder visits every dominating leader before the calls
+  // it can replace.
+  for (auto *Node : depth_first(DT.getRootNode())) {
+    BasicBlock *BB = Node->getBlock();
+    for (auto It = BB->begin(), E = BB->end(); It != E;) {
+      Instruction *I = It++;
+      CallInst *CI = dyn_cast<CallInst>(I);
+      if (!CI)
+        continue;
+      bool bIsHandle =
+          OP::IsDxilOpFuncCallInst(CI, DXIL::OpCode::CreateHandle);
+      if (bIsHandle != bHandles || GetLoadKind(CI, pDM) != LoadKind::Immutable)
+        continue;
+
+      auto KeyIt =
+          KeyIndex.insert(std::make_pair(GetKey(CI), (unsigned)Leaders.size()));
+      if (KeyIt.second)
+        Leaders.emplace_back();
+      std::vector<CallInst *> &Calls = Leaders[KeyIt.first->second];
+      CallInst *Dominating = nullptr;
+      for (CallInst *Leader : Calls) {
+        if (DT.dominates(Leader, CI)) {
+          Dominating = Leader;
+          break;
+        }
+      }
+      if (Dominating) {
+        CI->replaceAllUsesWith(Dominating);
+        CI->eraseFromParent();
+        bChanged = true;
+      } else {
+        Calls.emplace_back(CI);
+      }
+    }
+  }
+
+  // Identical calls left in sibling blocks are hoisted to the nearest block
+  // that dominates all of them.
+  for (std::vector<CallInst *> &Calls : Leaders) {
+    if (Calls.size() < 2)
+      continue;
+
+    BasicBlock *CommonBB = Calls[0]->getParent();
+    for (unsigned i = 1; i < Calls.size() && CommonBB; ++i)
+      CommonBB =
+          DT.findNearestCommonDominator(CommonBB, Calls[i]->getParent());
+    if (!CommonBB)
+      continue;
+
+    CallInst *Hoisted = Calls[0];
+    Instruction *InsertPt = CommonBB->getTerminator();
+    if (!IsAvailableAt(Hoisted, InsertPt, DT))
+      continue;
+
+    Hoisted->moveBefore(InsertPt);
+    for (unsigned i = 1; i < Calls.size(); ++i) {
+      Calls[i]->replaceAllUsesWith(Hoisted);
+      Calls[i]->eraseFromParent();
+    }
+    bChanged = true;
+  }
+
+  return bChanged;
+}
+
+bool DxilRedundantLoadElimination::EliminateMutableInBlock(Function &F,
+                                                           DxilModule *pDM) {
+  bool bChanged = false;
+  for (BasicBlock &BB : F) {
+    std::map<LoadKey, CallInst *> Available;
+    for (auto It = BB.begin(), E = BB.end(); It != E;) {
+      Instruction *I = It++;
+      CallInst *CI = dyn_cast<CallInst>(I);
+      if (CI && GetLoadKind(CI, pDM) == LoadKind::Mutable) {
+        CallInst *&Prior = Available[GetKey(CI)];
+        if (Prior) {
+          CI->replaceAllUsesWith(Prior);
+          CI->eraseFromParent();
+          bChanged = true;
+        } else {
+          Prior = CI;
+        }
+        continue;
+      }
+      // bufferStore, textureStore, atomics and barriers.
+      if (I->mayWriteToMemory())
+        Available.clear();
+    }
+  }
+  return bChanged;
+}
+
+FunctionPass *llvm::createDxilRedundantLoadEliminationPass() {
+  return new DxilRedundantLoadElimination();
+}
+
+INITIALIZE_PASS_BEGIN(DxilRedundantLoadElimination, "dxil-redundant-load-elim",
+                      "DXIL redundant load elimination", false, false)
+INITIALIZE_PASS_DEPENDENCY(DominatorTreeWrapperPass)
+INITIALIZE_PASS_END(DxilRedundantLoadElimination, "dxil-redundant-load-elim",
+                    "DXIL redundant load elimination", false, false)
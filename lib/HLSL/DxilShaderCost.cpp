@@ -0,0 +1,418 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// DxilShaderCost.cpp                                                        //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Static instruction statistics and cost estimate for a DXIL module.        //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#include "dxc/HLSL/DxilShaderCost.h"
+#include "dxc/HLSL/DxilContainer.h"
+#include "dxc/HLSL/DxilOperations.h"
+#include "dxc/Support/Global.h"
+
+#include "llvm/Analysis/LoopInfo.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/Dominators.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/IntrinsicInst.h"
+#include "llvm/IR/Module.h"
+#include "llvm/IR/Operator.h"
+
+using namespace llvm;
+using namespace hlsl;
+
+namespace {
+
+typedef DXIL::OpCodeClass OpCodeClass;
+
+// Loops are simulated up to this many iterations when estimating trip counts.
+const unsigned kMaxSimulatedTripCount = 1 << 16;
+
+bool EvaluateICmp(CmpInst::Predicate Pred, const APInt &L, const APInt &R) {
+  switch (Pred) {
+  case CmpInst::ICMP_EQ:  return L.eq(R);
+  case CmpInst::ICMP_NE:  return L.ne(R);
+  case CmpInst::ICMP_UGT: return L.ugt(R);
+  case CmpInst::ICMP_UGE: return L.uge(R);
+  case CmpInst::ICMP_ULT: return L.ult(R);
+  case CmpInst::ICMP_ULE: return L.ule(R);
+  case CmpInst::ICMP_SGT: return L.sgt(R);
+  case CmpInst::ICMP_SGE: return L.sge(R);
+  case CmpInst::ICMP_SLT: return L.slt(R);
+  case CmpInst::ICMP_SLE: return L.sle(R);
+  default: return false;
+  }
+}
+
+// Returns the number of times the header of L executes, for loops with a
+// single exit controlled by an induction variable with constant start, step
+// and bound; returns 0 if the trip count is not known.
+unsigned GetConstantTripCount(const Loop *L) {
+  BasicBlock *Header = L->getHeader();
+  BasicBlock *Exiting = L->getExitingBlock();
+  BasicBlock *Latch = L->getLoopLatch();
+  if (!Exiting || !Latch)
+    return 0;
+  BranchInst *BI = dyn_cast<BranchInst>(Exiting->getTerminator());
+  if (!BI || !BI->isConditional())
+    return 0;
+  ICmpInst *Cmp = dyn_cast<ICmpInst>(BI->getCondition());
+  if (!Cmp)
+    return 0;
+
+  CmpInst::Predicate Pred = Cmp->getPredicate();
+  Value *Tested = Cmp->getOperand(0);
+  ConstantInt *Bound = dyn_cast<ConstantInt>(Cmp->getOperand(1));
+  if (!Bound) {
+    Tested = Cmp->getOperand(1);
+    Bound = dyn_cast<ConstantInt>(Cmp->getOperand(0));
+    Pred = CmpInst::getSwappedPredicate(Pred);
+  }
+  if (!Bound)
+    return 0;
+  // Express the condition as the one that stays in the loop.
+  if (!L->contains(BI->getSuccessor(0)))
+    Pred = CmpInst::getInversePredicate(Pred);
+
+  // The tested value is either the induction variable or its next value.
+  PHINode *IV = dyn_cast<PHINode>(Tested);
+  bool TestsNext = false;
+  if (!IV) {
+    BinaryOperator *Inc = dyn_cast<BinaryOperator>(Tested);
+    if (!Inc || Inc->getOpcode() != Instruction::Add)
+      return 0;
+    IV = dyn_cast<PHINode>(Inc->getOperand(0));
+    TestsNext = true;
+  }
+  if (!IV || IV->getParent() != Header || IV->getNumIncomingValues() != 2)
+    return 0;
+
+  ConstantInt *Start = nullptr;
+  ConstantInt *Step = nullptr;
+  for (unsigned i = 0; i < 2; ++i) {
+    Value *V = IV->getIncomingValue(i);
+    if (L->contains(IV->getIncomingBlock(i))) {
+      BinaryOperator *Inc = dyn_cast<BinaryOperator>(V);
+      if (!Inc || Inc->getOpcode() != Instruction::Add ||
+          Inc->getOperand(0) != IV)
+        return 0;
+      if (TestsNext && Inc != Tested)
+        return 0;
+      Step = dyn_cast<ConstantInt>(Inc->getOperand(1));
+    } else {
+      Start = dyn_cast<ConstantInt>(V);
+    }
+  }
+  if (!Start || !Step || Step->isZero())
+    return 0;
+
+  APInt Current = Start->getValue();
+  if (TestsNext)
+    Current += Step->getValue();
+  unsigned TripCount = 1;
+  while (EvaluateICmp(Pred, Current, Bound->getValue())) {
+    if (++TripCount > kMaxSimulatedTripCount)
+      return 0;
+    Current += Step->getValue();
+  }
+  return TripCount;
+}
+
+uint64_t SaturatingMultiply(uint64_t A, uint64_t B) {
+  if (A != 0 && B > UINT64_MAX / A)
+    return UINT64_MAX;
+  return A * B;
+}
+
+uint64_t SaturatingAdd(uint64_t A, uint64_t B) {
+  return A > UINT64_MAX - B ? UINT64_MAX : A + B;
+}
+
+bool IsUnsignedOp(OP::OpCode Op) {
+  switch (Op) {
+  case OP::OpCode::UMax:
+  case OP::OpCode::UMin:
+  case OP::OpCode::UMul:
+  case OP::OpCode::UDiv:
+  case OP::OpCode::UAddc:
+  case OP::OpCode::USubb:
+  case OP::OpCode::UMad:
+  case OP::OpCode::Ubfe:
+    return true;
+  default:
+    return false;
+  }
+}
+
+// Classifies a call to a DXIL operation and returns its weight.
+unsigned VisitDxilOp(CallInst *CI, DxilShaderCost &Cost) {
+  OP::OpCode Op = OP::GetDxilOpFuncCallInst(CI);
+  switch (OP::GetOpCodeClass(Op)) {
+  case OpCodeClass::Sample:
+  case OpCodeClass::SampleLevel:
+  case OpCodeClass::TextureGather:
+    ++Cost.TextureNormalInstructions;
+    return 8;
+  case OpCodeClass::SampleBias:
+    ++Cost.TextureBiasInstructions;
+    return 8;
+  case OpCodeClass::SampleGrad:
+    ++Cost.TextureGradientInstructions;
+    return 8;
+  case OpCodeClass::SampleCmp:
+  case OpCodeClass::SampleCmpLevelZero:
+  case OpCodeClass::TextureGatherCmp:
+    ++Cost.TextureCompInstructions;
+    return 8;
+  case OpCodeClass::TextureLoad:
+  case OpCodeClass::BufferLoad:
+    ++Cost.TextureLoadInstructions;
+    return 4;
+  case OpCodeClass::TextureStore:
+  case OpCodeClass::BufferStore:
+    ++Cost.TextureStoreInstructions;
+    return 4;
+  case OpCodeClass::AtomicBinOp:
+  case OpCodeClass::AtomicCompareExchange:
+  case OpCodeClass::BufferUpdateCounter:
+    ++Cost.InterlockedInstructions;
+    return 8;
+  case OpCodeClass::Barrier:
+    ++Cost.BarrierInstructions;
+    return 4;
+  case OpCodeClass::CutStream:
+    ++Cost.CutInstructionCount;
+    return 1;
+  case OpCodeClass::EmitStream:
+    ++Cost.EmitInstructionCount;
+    return 1;
+  case OpCodeClass::EmitThenCutStream:
+    ++Cost.EmitInstructionCount;
+    ++Cost.CutInstructionCount;
+    return 1;
+  case OpCodeClass::BitcastF16toI16:
+  case OpCodeClass::BitcastF32toI32:
+  case OpCodeClass::BitcastF64toI64:
+  case OpCodeClass::BitcastI16toF16:
+  case OpCodeClass::BitcastI32toF32:
+  case OpCodeClass::BitcastI64toF64:
+  case OpCodeClass::LegacyF16ToF32:
+  case OpCodeClass::LegacyF32ToF16:
+  case OpCodeClass::LegacyDoubleToFloat:
+  case OpCodeClass::LegacyDoubleToSInt32:
+  case OpCodeClass::LegacyDoubleToUInt32:
+    ++Cost.ConversionInstructionCount;
+    return 1;
+  case OpCodeClass::Unary:
+  case OpCodeClass::UnaryBits:
+  case OpCodeClass::IsSpecialFloat:
+  case OpCodeClass::Binary:
+  case OpCodeClass::BinaryWithCarryOrBorrow:
+  case OpCodeClass::BinaryWithTwoOuts:
+  case OpCodeClass::Tertiary:
+  case OpCodeClass::Quaternary:
+  case OpCodeClass::Dot2:
+  case OpCodeClass::Dot3:
+  case OpCodeClass::Dot4: {
+    Type *Ty = CI->getArgOperand(CI->getNumArgOperands() - 1)->getType();
+    if (Ty->isFloatingPointTy()) {
+      ++Cost.FloatInstructionCount;
+      // Transcendentals and other unary float operations are the slow ones.
+      return OP::GetOpCodeClass(Op) == OpCodeClass::Unary ? 4 : 1;
+    }
+    if (IsUnsignedOp(Op))
+      ++Cost.UintInstructionCount;
+    else
+      ++Cost.IntInstructionCount;
+    return 1;
+  }
+  default:
+    return 1;
+  }
+}
+
+bool IsLocalArrayAccess(Value *Ptr) {
+  GEPOperator *GEP = dyn_cast<GEPOperator>(Ptr);
+  return GEP && isa<AllocaInst>(GEP->getPointerOperand());
+}
+
+// Classifies an instruction and returns its weight; debug intrinsics and phi
+// nodes are not instructions that execute and are not counted.
+unsigned VisitInstruction(Instruction &I, DxilShaderCost &Cost) {
+  if (isa<PHINode>(I) || isa<DbgInfoIntrinsic>(I))
+    return 0;
+  ++Cost.InstructionCount;
+  switch (I.getOpcode()) {
+  case Instruction::Call: {
+    CallInst *CI = cast<CallInst>(&I);
+    if (OP::IsDxilOpFuncCallInst(CI))
+      return VisitDxilOp(CI, Cost);
+    return 1;
+  }
+  case Instruction::FAdd:
+  case Instruction::FSub:
+  case Instruction::FMul:
+  case Instruction::FCmp:
+    ++Cost.FloatInstructionCount;
+    return 1;
+  case Instruction::FDiv:
+  case Instruction::FRem:
+    ++Cost.FloatInstructionCount;
+    return 4;
+  case Instruction::Add:
+  case Instruction::Sub:
+  case Instruction::Mul:
+  case Instruction::AShr:
+    ++Cost.IntInstructionCount;
+    return 1;
+  case Instruction::SDiv:
+  case Instruction::SRem:
+    ++Cost.IntInstructionCount;
+    return 4;
+  case Instruction::LShr:
+    ++Cost.UintInstructionCount;
+    return 1;
+  case Instruction::UDiv:
+  case Instruction::URem:
+    ++Cost.UintInstructionCount;
+    return 4;
+  case Instruction::ICmp:
+    if (cast<ICmpInst>(I).isUnsigned())
+      ++Cost.UintInstructionCount;
+    else
+      ++Cost.IntInstructionCount;
+    return 1;
+  case Instruction::And:
+  case Instruction::Or:
+  case Instruction::Xor:
+  case Instruction::Shl:
+    ++Cost.BitwiseInstructionCount;
+    return 1;
+  case Instruction::Trunc:
+  case Instruction::ZExt:
+  case Instruction::SExt:
+  case Instruction::FPToUI:
+  case Instruction::FPToSI:
+  case Instruction::UIToFP:
+  case Instruction::SIToFP:
+  case Instruction::FPTrunc:
+  case Instruction::FPExt:
+    ++Cost.ConversionInstructionCount;
+    return 1;
+  case Instruction::Select:
+    ++Cost.MovcInstructionCount;
+    return 1;
+  case Instruction::Alloca:
+    if (cast<AllocaInst>(I).getAllocatedType()->isArrayTy())
+      ++Cost.TempArrayCount;
+    return 0;
+  case Instruction::Load:
+    if (IsLocalArrayAccess(cast<LoadInst>(I).getPointerOperand()))
+      ++Cost.ArrayInstructionCount;
+    return 1;
+  case Instruction::Store:
+    if (IsLocalArrayAccess(cast<StoreInst>(I).getPointerOperand()))
+      ++Cost.ArrayInstructionCount;
+    return 1;
+  case Instruction::Br:
+    if (cast<BranchInst>(I).isConditional())
+      ++Cost.DynamicFlowControlCount;
+    else
+      ++Cost.StaticFlowControlCount;
+    return 1;
+  case Instruction::Switch:
+    ++Cost.DynamicFlowControlCount;
+    return 1;
+  default:
+    return 1;
+  }
+}
+
+} // namespace
+
+namespace hlsl {
+
+void AnalyzeDxilShaderCost(Module &M, DxilShaderCost &Cost) {
+  Cost = DxilShaderCost();
+
+  for (Function &F : M.functions()) {
+    if (F.isDeclaration())
+      continue;
+    DXASSERT(!F.isMaterializable(), "else caller did not materialize bodies");
+
+    DominatorTree DT;
+    DT.recalculate(F);
+    LoopInfo LI;
+    LI.Analyze(DT);
+
+    // Trip counts are cached per loop; execution counts multiply out through
+    // the enclosing loops.
+    DenseMap<const Loop *, uint64_t> LoopExecutionCount;
+    for (BasicBlock &BB : F) {
+      uint64_t ExecutionCount = 1;
+      if (const Loop *L = LI.getLoopFor(&BB)) {
+        auto It = LoopExecutionCount.find(L);
+        if (It != LoopExecutionCount.end()) {
+          ExecutionCount = It->second;
+        } else {
+          SmallVector<const Loop *, 4> Nest;
+          for (const Loop *P = L; P != nullptr; P = P->getParentLoop())
+            Nest.push_back(P);
+          for (const Loop *P : Nest) {
+            unsigned TripCount = GetConstantTripCount(P);
+            if (TripCount == 0)
+              TripCount = DxilDefaultLoopTripCount;
+            ExecutionCount = SaturatingMultiply(ExecutionCount, TripCount);
+          }
+          LoopExecutionCount[L] = ExecutionCount;
+        }
+      }
+
+      DxilBlockCost Block;
+      Block.F = &F;
+      Block.BB = &BB;
+      Block.LoopDepth = LI.getLoopDepth(&BB);
+      Block.ExecutionCount = ExecutionCount;
+      unsigned InstructionCountBefore = Cost.InstructionCount;
+      uint64_t Weight = 0;
+      for (Instruction &I : BB)
+        Weight += VisitInstruction(I, Cost);
+      Block.InstructionCount = Cost.InstructionCount - InstructionCountBefore;
+      Block.Cost = SaturatingMultiply(Weight, ExecutionCount);
+      Cost.EstimatedCost = SaturatingAdd(Cost.EstimatedCost, Block.Cost);
+      Cost.Blocks.push_back(Block);
+    }
+  }
+}
+
+void GetDxilShaderStatistics(const DxilShaderCost &Cost,
+                             DxilShaderStatistics &Stats) {
+  Stats.InstructionCount = Cost.InstructionCount;
+  Stats.TempArrayCount = Cost.TempArrayCount;
+  Stats.TextureNormalInstructions = Cost.TextureNormalInstructions;
+  Stats.TextureLoadInstructions = Cost.TextureLoadInstructions;
+  Stats.TextureCompInstructions = Cost.TextureCompInstructions;
+  Stats.TextureBiasInstructions = Cost.TextureBiasInstructions;
+  Stats.TextureGradientInstructions = Cost.TextureGradientInstructions;
+  Stats.FloatInstructionCount = Cost.FloatInstructionCount;
+  Stats.IntInstructionCount = Cost.IntInstructionCount;
+  Stats.UintInstructionCount = Cost.UintInstructionCount;
+  Stats.StaticFlowControlCount = Cost.StaticFlowControlCount;
+  Stats.DynamicFlowControlCount = Cost.DynamicFlowControlCount;
+  Stats.ArrayInstructionCount = Cost.ArrayInstructionCount;
+  Stats.CutInstructionCount = Cost.CutInstructionCount;
+  Stats.EmitInstructionCount = Cost.EmitInstructionCount;
+  Stats.BarrierInstructions = Cost.BarrierInstructions;
+  Stats.InterlockedInstructions = Cost.InterlockedInstructions;
+  Stats.TextureStoreInstructions = Cost.TextureStoreInstructions;
+  Stats.MovcInstructionCount = Cost.MovcInstructionCount;
+  Stats.ConversionInstructionCount = Cost.ConversionInstructionCount;
+  Stats.BitwiseInstructionCount = Cost.BitwiseInstructionCount;
+}
+
+} // namespace hlsl
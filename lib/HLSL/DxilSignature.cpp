@@ -92,8 +92,9 @@ bool DxilSignature::IsFullyAllocated() {
   return true;
 }
 
-unsigned DxilSignature::PackElements(DXIL::PackingStrategy packing) {
+unsigned DxilSignature::PackElements(DXIL::PackingStrategy packing, unsigned *pRowsSaved) {
   unsigned rowsUsed = 0;
+  unsigned rowsSaved = 0;
 
   if (m_sigPointKind == DXIL::SigPointKind::GSOut) {
     // Special case due to support for multiple streams
@@ -114,6 +115,15 @@ unsigned DxilSignature::PackElements(DXIL::PackingStrategy packing) {
         case DXIL::PackingStrategy::Optimized:
           streamRowsUsed = alloc[i].PackOptimized(elements[i], 0, 32);
           break;
+        case DXIL::PackingStrategy::Minimal: {
+          unsigned optimizedRowsUsed = 0;
+          streamRowsUsed = alloc[i].PackMinimal(elements[i], 0, 32, &optimizedRowsUsed);
+          // Optimized packing may have failed to place everything, leaving
+          // Minimal to use more rows; that isn't a saving.
+          if (optimizedRowsUsed > streamRowsUsed)
+            rowsSaved += optimizedRowsUsed - streamRowsUsed;
+          break;
+        }
         default:
           DXASSERT(false, "otherwise, invalid packing strategy supplied");
         }
@@ -121,6 +131,8 @@ unsigned DxilSignature::PackElements(DXIL::PackingStrategy packing) {
           rowsUsed = streamRowsUsed;
       }
     }
+    if (pRowsSaved)
+      *pRowsSaved = rowsSaved;
     // rowsUsed isn't really meaningful in this case.
     return rowsUsed;
   }
@@ -161,6 +173,14 @@ unsigned DxilSignature::PackElements(DXIL::PackingStrategy packing) {
       case DXIL::PackingStrategy::Optimized:
         rowsUsed = alloc.PackOptimized(elements, 0, 32);
         break;
+      case DXIL::PackingStrategy::Minimal: {
+        unsigned optimizedRowsUsed = 0;
+        rowsUsed = alloc.PackMinimal(elements, 0, 32, &optimizedRowsUsed);
+        // As above, only count rows Minimal packing actually saved.
+        if (optimizedRowsUsed > rowsUsed)
+          rowsSaved = optimizedRowsUsed - rowsUsed;
+        break;
+      }
       default:
         DXASSERT(false, "otherwise, invalid packing strategy supplied");
       }
@@ -188,6 +208,8 @@ unsigned DxilSignature::PackElements(DXIL::PackingStrategy packing) {
     DXASSERT(false, "unexpected PackingKind.");
   }
 
+  if (pRowsSaved)
+    *pRowsSaved = rowsSaved;
   return rowsUsed;
 }
 
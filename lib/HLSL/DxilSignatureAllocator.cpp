@@ -487,4 +487,214 @@ unsigned DxilSignatureAllocator::PackPrefixStable(std::vector<DxilSignatureEleme
 }
 
 
+namespace {
+
+// Unit of placement for PackMinimal.  Clip/cull elements sharing a register
+// are placed together through a temporary element covering all of them.
+struct MinimalPackItem {
+  DxilSignatureElement *SE;
+  std::vector<DxilSignatureElement*> Members;
+  uint8_t Flags;
+};
+
+// Items are interchangeable when swapping their placements leaves every
+// register in the same state, so only one ordering of them needs a visit.
+bool IsInterchangeable(const MinimalPackItem &left, const MinimalPackItem &right) {
+  return left.Flags == right.Flags &&
+         left.SE->GetRows() == right.SE->GetRows() &&
+         left.SE->GetCols() == right.SE->GetCols() &&
+         left.SE->GetInterpolationMode()->GetKind() == right.SE->GetInterpolationMode()->GetKind();
+}
+
+class MinimalPackSearch {
+public:
+  MinimalPackSearch(DxilSignatureAllocator &alloc, std::vector<MinimalPackItem> &items,
+                    unsigned startRow, unsigned numRows, unsigned bestRowsUsed)
+    : m_Alloc(alloc), m_Items(items), m_StartRow(startRow), m_NumRows(numRows),
+      m_Placement(items.size()), m_BestRowsUsed(bestRowsUsed), m_Visited(0) {
+    unsigned components = 0;
+    for (auto &item : m_Items)
+      components += item.SE->GetRows() * item.SE->GetCols();
+    m_LowerBound = startRow + (components + 3) / 4;
+  }
+
+  // Returns true if a placement using fewer rows than the starting bound was found.
+  bool Run() {
+    if (m_BestRowsUsed <= m_LowerBound)
+      return false;
+    Search(0, m_StartRow);
+    return !m_BestPlacement.empty();
+  }
+
+  unsigned GetBestRowsUsed() const { return m_BestRowsUsed; }
+  unsigned GetRow(unsigned i) const { return m_BestPlacement[i].first; }
+  unsigned GetCol(unsigned i) const { return m_BestPlacement[i].second; }
+
+private:
+  DxilSignatureAllocator &m_Alloc;
+  std::vector<MinimalPackItem> &m_Items;
+  unsigned m_StartRow;
+  unsigned m_NumRows;
+  std::vector<std::pair<unsigned, unsigned> > m_Placement;
+  std::vector<std::pair<unsigned, unsigned> > m_BestPlacement;
+  unsigned m_BestRowsUsed;
+  unsigned m_LowerBound;
+  unsigned m_Visited;
+
+  bool Done() const {
+    return m_BestRowsUsed <= m_LowerBound ||
+           m_Visited >= DxilSignatureAllocator::kMinimalSearchBudget;
+  }
+
+  void Search(unsigned index, unsigned rowsUsed) {
+    if (index == m_Items.size()) {
+      DXASSERT_NOMSG(rowsUsed < m_BestRowsUsed);
+      m_BestRowsUsed = rowsUsed;
+      m_BestPlacement = m_Placement;
+      return;
+    }
+
+    const MinimalPackItem &item = m_Items[index];
+    unsigned rows = item.SE->GetRows();
+    unsigned cols = item.SE->GetCols();
+    if (rows > m_NumRows)
+      return;
+
+    // Interchangeable items are placed in increasing (row, col) order.
+    std::pair<unsigned, unsigned> first(m_StartRow, 0);
+    if (index > 0 && IsInterchangeable(m_Items[index - 1], item))
+      first = m_Placement[index - 1];
+
+    std::vector<DxilSignatureAllocator::PackedRegister> saved;
+    for (unsigned row = first.first; row <= (m_StartRow + m_NumRows - rows); ++row) {
+      // Rows only grow from here, so nothing below can beat the best placement.
+      if (row + rows >= m_BestRowsUsed)
+        break;
+      if (m_Alloc.DetectRowConflict(item.SE, row))
+        continue;
+      unsigned startCol = (row == first.first) ? first.second : 0;
+      for (unsigned col = startCol; col <= 4 - cols; ++col) {
+        if (m_Alloc.DetectColConflict(item.SE, row, col))
+          continue;
+        if (++m_Visited > DxilSignatureAllocator::kMinimalSearchBudget)
+          return;
+        saved.assign(m_Alloc.Registers.begin() + row, m_Alloc.Registers.begin() + row + rows);
+        m_Alloc.PlaceElement(item.SE, row, col);
+        m_Placement[index] = std::make_pair(row, col);
+        Search(index + 1, std::max(rowsUsed, row + rows));
+        std::copy(saved.begin(), saved.end(), m_Alloc.Registers.begin() + row);
+        if (Done())
+          return;
+      }
+    }
+  }
+};
+
+} // anonymous namespace
+
+unsigned DxilSignatureAllocator::PackMinimal(std::vector<DxilSignatureElement*> elements, unsigned startRow, unsigned numRows,
+                                             unsigned *pOptimizedRowsUsed) {
+  // Start from the optimized placement; the search only replaces it with a
+  // placement that allocates every element the optimized placement did,
+  // using strictly fewer rows.
+  std::vector<PackedRegister> initialRegisters = Registers;
+  unsigned optimizedRowsUsed = PackOptimized(elements, startRow, numRows);
+  if (pOptimizedRowsUsed)
+    *pOptimizedRowsUsed = optimizedRowsUsed;
+
+  bool bFullyAllocated = true;
+  for (auto &SE : elements) {
+    if (!SE->IsAllocated()) {
+      bFullyAllocated = false;
+      break;
+    }
+  }
+
+  // Clip/cull keeps the two register limit by placing the same per-register
+  // groups as PackOptimized, each group as a single item.
+  std::vector<DxilSignatureElement*> clipcullElements;
+  std::vector<MinimalPackItem> items;
+  for (auto &SE : elements) {
+    if (SE->GetKind() == DXIL::SemanticKind::ClipDistance || SE->GetKind() == DXIL::SemanticKind::CullDistance) {
+      clipcullElements.push_back(SE);
+      continue;
+    }
+    MinimalPackItem item;
+    item.SE = SE;
+    item.Members.push_back(SE);
+    item.Flags = GetElementFlags(SE);
+    items.push_back(item);
+  }
+
+  // PackGreedy below overwrites the clip/cull placement from PackOptimized.
+  std::vector<std::pair<int, int> > optimizedPlacement;
+  for (auto &SE : clipcullElements)
+    optimizedPlacement.push_back(std::make_pair(SE->GetStartRow(), SE->GetStartCol()));
+  std::vector<DxilSignatureElement*> clipcullElementsInOrder = clipcullElements;
+
+  std::sort(clipcullElements.begin(), clipcullElements.end(), CmpElementsLess);
+  DxilSignatureAllocator clipcullAllocator(2);
+  unsigned clipcullRegUsed = clipcullAllocator.PackGreedy(clipcullElements, 0, 2);
+  std::vector<DxilSignatureElement*> clipcullElementsByRow[2];
+  unsigned clipcullComponentsByRow[2] = {0, 0};
+  for (auto &SE : clipcullElements) {
+    if (!SE->IsAllocated())
+      continue;
+    unsigned row = SE->GetStartRow();
+    clipcullElementsByRow[row].push_back(SE);
+    clipcullComponentsByRow[row] += SE->GetCols();
+  }
+  DxilSignatureElement clipcullTempElements[2] = {DXIL::SigPointKind::VSOut, DXIL::SigPointKind::VSOut};
+  for (unsigned row = 0; row < clipcullRegUsed; ++row) {
+    DXASSERT_NOMSG(!clipcullElementsByRow[row].empty());
+    clipcullTempElements[row].Initialize( clipcullElementsByRow[row][0]->GetName(),
+                                          clipcullElementsByRow[row][0]->GetCompType(),
+                                          *clipcullElementsByRow[row][0]->GetInterpolationMode(),
+                                          1, clipcullComponentsByRow[row]);
+    MinimalPackItem item;
+    item.SE = &clipcullTempElements[row];
+    item.Members = clipcullElementsByRow[row];
+    item.Flags = GetElementFlags(item.SE);
+    items.push_back(item);
+  }
+
+  for (unsigned i = 0; i < clipcullElementsInOrder.size(); ++i) {
+    clipcullElementsInOrder[i]->SetStartRow(optimizedPlacement[i].first);
+    clipcullElementsInOrder[i]->SetStartCol(optimizedPlacement[i].second);
+  }
+
+  // Place large elements first so that bounds tighten early.
+  std::stable_sort(items.begin(), items.end(),
+    [](const MinimalPackItem &left, const MinimalPackItem &right) {
+      unsigned leftSize = left.SE->GetRows() * left.SE->GetCols();
+      unsigned rightSize = right.SE->GetRows() * right.SE->GetCols();
+      if (leftSize != rightSize)
+        return leftSize > rightSize;
+      if (left.Flags != right.Flags)
+        return left.Flags < right.Flags;
+      return CmpElements(left.SE, right.SE) < 0;
+    });
+
+  std::vector<PackedRegister> optimizedRegisters = Registers;
+  Registers = initialRegisters;
+  unsigned bestRowsUsed = bFullyAllocated ? optimizedRowsUsed : startRow + numRows + 1;
+  MinimalPackSearch search(*this, items, startRow, numRows, bestRowsUsed);
+  if (!search.Run()) {
+    Registers = optimizedRegisters;
+    return optimizedRowsUsed;
+  }
+
+  for (unsigned i = 0; i < items.size(); ++i) {
+    unsigned row = search.GetRow(i);
+    unsigned col = search.GetCol(i);
+    for (auto &SE : items[i].Members) {
+      PlaceElement(SE, row, col);
+      SE->SetStartRow((int)row);
+      SE->SetStartCol((int)col);
+      col += SE->GetCols();
+    }
+  }
+  return search.GetBestRowsUsed();
+}
+
 } // namespace hlsl
@@ -1952,6 +1952,10 @@ static bool IsLLVMInstructionAllowed(llvm::Instruction &I) {
 }
 
 static bool IsDxilBuiltinStructType(StructType *ST, hlsl::OP *hlslOP) {
+  // All builtin types are named in the dx.types namespace; checking that first
+  // keeps the lookups below from creating types for unrelated structs.
+  if (!ST->hasName() || !ST->getName().startswith("dx.types."))
+    return false;
   if (ST == hlslOP->GetBinaryWithCarryType())
     return true;
   if (ST == hlslOP->GetBinaryWithTwoOutputsType())
@@ -2059,7 +2063,7 @@ static bool GetNodeOperandAsInt(ValidationContext &ValCtx, MDNode *pMD, unsigned
 }
 
 static bool IsPrecise(Instruction &I, ValidationContext &ValCtx) {
-  MDNode *pMD = I.getMetadata(DxilMDHelper::kDxilPreciseAttributeMDName);
+  MDNode *pMD = I.getMetadata(ValCtx.kDxilPreciseMDKind);
   if (pMD == nullptr) {
     return false;
   }
@@ -2117,7 +2121,7 @@ static void ValidateControlFlowHint(BasicBlock &bb, ValidationContext &ValCtx) {
   if (!TI)
     return;
 
-  MDNode *pNode = TI->getMetadata(DxilMDHelper::kDxilControlFlowHintMDName);
+  MDNode *pNode = TI->getMetadata(ValCtx.kDxilControlFlowHintMDKind);
   if (!pNode)
     return;
 
@@ -4006,7 +4010,9 @@ ValidateDxilModule(llvm::Module *pModule, llvm::Module *pDebugModule) {
   // If has recursive call, call info collection will not finish.
   ValidateFlowControl(ValCtx);
 
-  // Validate functions.
+  // Validate functions. This stays serial: bodies record state that the
+  // checks below read, and validating them can create constants in the
+  // module's LLVMContext, which isn't thread-safe.
   for (Function &F : pModule->functions()) {
     ValidateFunction(F, ValCtx);
   }
@@ -4238,6 +4244,7 @@ HRESULT ValidateDxilContainerParts(llvm::Module *pModule,
     case DFCC_PrivateData:
     case DFCC_DXIL:
     case DFCC_ShaderDebugInfoDXIL:
+    case DFCC_ShaderHash:
       continue;
 
     case DFCC_Container:
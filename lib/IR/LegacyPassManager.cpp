@@ -1300,6 +1300,7 @@ bool BBPassManager::runOnFunction(Function &F) {
         // If the pass crashes, remember this.
         PassManagerPrettyStackEntry X(BP, *I);
         TimeRegion PassTimer(getPassTimer(BP));
+        PassExecutionRegion PassListener(BP, nullptr, nullptr); // HLSL Change
 
         LocalChanged |= BP->runOnBasicBlock(*I);
       }
@@ -1521,6 +1522,7 @@ bool FPPassManager::runOnFunction(Function &F) {
     {
       PassManagerPrettyStackEntry X(FP, F);
       TimeRegion PassTimer(getPassTimer(FP));
+      PassExecutionRegion PassListener(FP, nullptr, &F); // HLSL Change
 
       LocalChanged |= FP->runOnFunction(F);
     }
@@ -1597,6 +1599,7 @@ MPPassManager::runOnModule(Module &M) {
     {
       PassManagerPrettyStackEntry X(MP, M);
       TimeRegion PassTimer(getPassTimer(MP));
+      PassExecutionRegion PassListener(MP, &M, nullptr); // HLSL Change
 
       LocalChanged |= MP->runOnModule(M);
     }
@@ -1752,7 +1755,7 @@ EnableTiming("time-passes", cl::location(TimePassesIsEnabled),
 // a non-null value (if the -time-passes option is enabled) or it leaves it
 // null.  It may be called multiple times.
 void TimingInfo::createTheTimeInfo() {
-  if (!TimePassesIsEnabled || TheTimeInfo) return;
+  if (!areTimePassesEnabled() || TheTimeInfo) return; // HLSL Change
 
   // Constructed the first time this is called, iff -time-passes is enabled.
   // This guarantees that the object will be constructed before static globals,
@@ -1763,11 +1766,48 @@ void TimingInfo::createTheTimeInfo() {
 
 /// If TimingInfo is enabled then start pass timer.
 Timer *llvm::getPassTimer(Pass *P) {
-  if (TheTimeInfo)
+  if (TheTimeInfo && areTimePassesEnabled()) // HLSL Change
     return TheTimeInfo->getPassTimer(P);
   return nullptr;
 }
 
+// HLSL Change Starts
+// Set by a compile that asked for timing; TimePassesIsEnabled is only written
+// by command line parsing, so concurrent compiles don't race on it.
+static LLVM_THREAD_LOCAL bool TimePassesOnThread;
+
+TimePassesScope::TimePassesScope(bool Enable) : Prior(TimePassesOnThread) {
+  TimePassesOnThread = Prior || Enable;
+}
+
+TimePassesScope::~TimePassesScope() {
+  TimePassesOnThread = Prior;
+}
+
+bool llvm::areTimePassesEnabled() {
+  return TimePassesIsEnabled || TimePassesOnThread;
+}
+// HLSL Change Ends
+
+// HLSL Change Starts
+// Compiles run concurrently on many threads, so the listener is per thread.
+static LLVM_THREAD_LOCAL PassExecutionListener *ThePassExecutionListener;
+
+PassExecutionListener *llvm::getPassExecutionListener() {
+  return ThePassExecutionListener;
+}
+
+PassExecutionListenerScope::PassExecutionListenerScope(
+    PassExecutionListener *L)
+    : Prior(ThePassExecutionListener) {
+  ThePassExecutionListener = L;
+}
+
+PassExecutionListenerScope::~PassExecutionListenerScope() {
+  ThePassExecutionListener = Prior;
+}
+// HLSL Change Ends
+
 //===----------------------------------------------------------------------===//
 // PMStack implementation
 //
@@ -359,6 +359,9 @@ void PassManagerBuilder::populateModulePassManager(
   if (OptLevel > 1) {
     if (EnableMLSM)
       MPM.add(createMergedLoadStoreMotionPass()); // Merge ld/st in diamonds
+    // HLSL Change - remove redundant cbuffer/resource loads GVN can't see.
+    if (!HLSLHighLevel)
+      MPM.add(createDxilRedundantLoadEliminationPass());
     MPM.add(createGVNPass(DisableGVNLoadPRE));  // Remove redundancies
   }
   // HLSL Change Begins.
@@ -535,6 +538,7 @@ void PassManagerBuilder::populateModulePassManager(
   // HLSL Change Begins.
   if (!HLSLHighLevel) {
     MPM.add(createMultiDimArrayToOneDimArrayPass());// HLSL Change
+    MPM.add(createDxilCoalesceBufferLoadsPass()); // HLSL Change
     MPM.add(createDxilCondenseResourcesPass());
     if (DisableUnrollLoops)
       MPM.add(createDxilLegalizeSampleOffsetPass()); // HLSL Change
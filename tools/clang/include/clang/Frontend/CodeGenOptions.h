@@ -21,6 +21,10 @@
 #include <vector>
 #include "dxc/HLSL/HLSLExtensionsCodegenHelper.h" // HLSL change
 
+namespace hlsl {
+class DxilCompileTimeReport; // HLSL change
+}
+
 namespace clang {
 
 /// \brief Bitfields of CodeGenOptions, split out from CodeGenOptions to ensure
@@ -198,6 +202,8 @@ public:
   std::shared_ptr<hlsl::HLSLExtensionsCodegenHelper> HLSLExtensionsCodegen;
   /// Signature packing mode (0 == default for target)
   unsigned HLSLSignaturePackingStrategy = 0;
+  /// Collects time spent in code generation and optimization, if set.
+  std::shared_ptr<hlsl::DxilCompileTimeReport> HLSLTimeReport;
   // HLSL Change Ends
   /// Regular expression to select optimizations for which we should enable
   /// optimization remarks. Transformation passes whose name matches this
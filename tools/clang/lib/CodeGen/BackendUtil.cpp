@@ -641,7 +641,7 @@ bool EmitAssemblyHelper::AddEmitPasses(BackendAction Action,
 
 void EmitAssemblyHelper::EmitAssembly(BackendAction Action,
                                       raw_pwrite_stream *OS) {
-  TimeRegion Region(llvm::TimePassesIsEnabled ? &CodeGenerationTime : nullptr);
+  TimeRegion Region(llvm::areTimePassesEnabled() ? &CodeGenerationTime : nullptr); // HLSL Change
 
   bool UsesCodeGen = (Action != Backend_EmitNothing &&
                       Action != Backend_EmitBC &&
@@ -28,6 +28,7 @@
 #include "llvm/IR/Constants.h"
 #include "llvm/IR/IRBuilder.h"
 #include "llvm/IR/GetElementPtrTypeIterator.h"
+#include <cmath>
 #include <memory>
 #include <unordered_map>
 #include <unordered_set>
@@ -3466,203 +3467,545 @@ static void SimplifyBitCast(BitCastOperator *BC, std::vector<Instruction *> &dea
   }
 }
 
-typedef float(__cdecl *FloatUnaryEvalFuncType)(float);
-typedef double(__cdecl *DoubleUnaryEvalFuncType)(double);
+// Constant evaluation of intrinsic calls whose operands are all immediates.
+//
+// Element-wise intrinsics are described by IntrinsicEvalTable, which holds
+// scalar evaluators for float, double and integer lanes; vector calls are
+// evaluated lane by lane. Reductions and intrinsics whose result shape differs
+// from their operands are evaluated individually in TryEvalIntrinsic.
+//
+// Results follow the DXIL lowering in HLOperationLower.cpp: round is
+// round-to-nearest-even, frac is x - floor(x), min/max return the non-NaN
+// operand and saturate maps NaN to zero. Other intrinsics are only folded for
+// finite operands, leaving NaN and infinity handling to the target as the
+// DXIL constant folder does. Denormals are preserved, which the default 'any'
+// denorm mode allows.
 
-typedef float(__cdecl *FloatBinaryEvalFuncType)(float, float);
-typedef double(__cdecl *DoubleBinaryEvalFuncType)(double, double);
+typedef float (*FloatEvalFuncType)(const float *);
+typedef double (*DoubleEvalFuncType)(const double *);
+typedef APInt (*IntEvalFuncType)(const APInt *);
 
-static Value * EvalUnaryIntrinsic(CallInst *CI,
-                               FloatUnaryEvalFuncType floatEvalFunc,
-                               DoubleUnaryEvalFuncType doubleEvalFunc) {
-  Value *V = CI->getArgOperand(0);
-  ConstantFP *fpV = cast<ConstantFP>(V);
-  llvm::Type *Ty = CI->getType();
-  Value *Result = nullptr;
-  if (Ty->isDoubleTy()) {
-    double dV = fpV->getValueAPF().convertToDouble();
-    Value *dResult = ConstantFP::get(V->getType(), doubleEvalFunc(dV));
+namespace {
+struct IntrinsicEvalEntry {
+  IntrinsicOp Op;
+  unsigned NumArgs;
+  bool FiniteOnly; // Floating-point operands must be finite to fold.
+  FloatEvalFuncType FloatEval;
+  DoubleEvalFuncType DoubleEval;
+  IntEvalFuncType IntEval;
+};
+}
 
-    CI->replaceAllUsesWith(dResult);
-    Result = dResult;
-  } else {
-    DXASSERT_NOMSG(Ty->isFloatTy());
-    float fV = fpV->getValueAPF().convertToFloat();
-    Value *dResult = ConstantFP::get(V->getType(), floatEvalFunc(fV));
+static const double EvalPi = 3.14159265358979323846;
+
+template <typename T> static T EvalTan(const T *a) { return std::tan(a[0]); }
+template <typename T> static T EvalTanh(const T *a) { return std::tanh(a[0]); }
+template <typename T> static T EvalSin(const T *a) { return std::sin(a[0]); }
+template <typename T> static T EvalSinh(const T *a) { return std::sinh(a[0]); }
+template <typename T> static T EvalCos(const T *a) { return std::cos(a[0]); }
+template <typename T> static T EvalCosh(const T *a) { return std::cosh(a[0]); }
+template <typename T> static T EvalAsin(const T *a) { return std::asin(a[0]); }
+template <typename T> static T EvalAcos(const T *a) { return std::acos(a[0]); }
+template <typename T> static T EvalAtan(const T *a) { return std::atan(a[0]); }
+template <typename T> static T EvalAtan2(const T *a) { return std::atan2(a[0], a[1]); }
+template <typename T> static T EvalSqrt(const T *a) { return std::sqrt(a[0]); }
+template <typename T> static T EvalRsqrt(const T *a) { return T(1) / std::sqrt(a[0]); }
+template <typename T> static T EvalRcp(const T *a) { return T(1) / a[0]; }
+template <typename T> static T EvalExp(const T *a) { return std::exp(a[0]); }
+template <typename T> static T EvalExp2(const T *a) { return std::exp2(a[0]); }
+template <typename T> static T EvalLog(const T *a) { return std::log(a[0]); }
+template <typename T> static T EvalLog10(const T *a) { return std::log10(a[0]); }
+template <typename T> static T EvalLog2(const T *a) { return std::log2(a[0]); }
+template <typename T> static T EvalPow(const T *a) { return std::pow(a[0], a[1]); }
+template <typename T> static T EvalCeil(const T *a) { return std::ceil(a[0]); }
+template <typename T> static T EvalFloor(const T *a) { return std::floor(a[0]); }
+template <typename T> static T EvalTrunc(const T *a) { return std::trunc(a[0]); }
+// Round_ne; std::round would round halfway cases away from zero.
+template <typename T> static T EvalRound(const T *a) { return std::rint(a[0]); }
+template <typename T> static T EvalFrac(const T *a) { return a[0] - std::floor(a[0]); }
+template <typename T> static T EvalAbs(const T *a) { return std::fabs(a[0]); }
+template <typename T> static T EvalMax(const T *a) { return std::fmax(a[0], a[1]); }
+template <typename T> static T EvalMin(const T *a) { return std::fmin(a[0], a[1]); }
+template <typename T> static T EvalClamp(const T *a) {
+  return std::fmin(std::fmax(a[0], a[1]), a[2]);
+}
+template <typename T> static T EvalSaturate(const T *a) {
+  // Written so that NaN compares false and saturates to zero.
+  return a[0] > T(0) ? (a[0] < T(1) ? a[0] : T(1)) : T(0);
+}
+template <typename T> static T EvalDegrees(const T *a) {
+  return static_cast<T>(180 / EvalPi) * a[0];
+}
+template <typename T> static T EvalRadians(const T *a) {
+  return static_cast<T>(EvalPi / 180) * a[0];
+}
+template <typename T> static T EvalFMod(const T *a) {
+  T div = a[0] / a[1];
+  T frc = std::fabs(div) - std::floor(std::fabs(div));
+  return (div >= -div ? frc : -frc) * a[1];
+}
+template <typename T> static T EvalLdExp(const T *a) {
+  return std::exp2(a[1]) * a[0];
+}
+template <typename T> static T EvalStep(const T *a) {
+  return a[1] < a[0] ? T(0) : T(1);
+}
+template <typename T> static T EvalLerp(const T *a) {
+  return a[0] + a[2] * (a[1] - a[0]);
+}
+template <typename T> static T EvalMad(const T *a) { return a[0] * a[1] + a[2]; }
+template <typename T> static T EvalFma(const T *a) { return std::fma(a[0], a[1], a[2]); }
+template <typename T> static T EvalSmoothStep(const T *a) {
+  T minSat[1] = { (a[2] - a[0]) / (a[1] - a[0]) };
+  T s = EvalSaturate(minSat);
+  return s * (s * (T(3) - s * T(2)));
+}
+
+static APInt EvalIntMax(const APInt *a) { return a[0].sgt(a[1]) ? a[0] : a[1]; }
+static APInt EvalIntMin(const APInt *a) { return a[0].slt(a[1]) ? a[0] : a[1]; }
+static APInt EvalUIntMax(const APInt *a) { return a[0].ugt(a[1]) ? a[0] : a[1]; }
+static APInt EvalUIntMin(const APInt *a) { return a[0].ult(a[1]) ? a[0] : a[1]; }
+static APInt EvalIntClamp(const APInt *a) {
+  APInt lo = a[0].sgt(a[1]) ? a[0] : a[1];
+  return lo.slt(a[2]) ? lo : a[2];
+}
+static APInt EvalUIntClamp(const APInt *a) {
+  APInt lo = a[0].ugt(a[1]) ? a[0] : a[1];
+  return lo.ult(a[2]) ? lo : a[2];
+}
+static APInt EvalIntMad(const APInt *a) { return a[0] * a[1] + a[2]; }
+static APInt EvalCountBits(const APInt *a) {
+  return APInt(a[0].getBitWidth(), a[0].countPopulation());
+}
+static APInt EvalReverseBits(const APInt *a) {
+  unsigned width = a[0].getBitWidth();
+  APInt result(width, 0);
+  for (unsigned i = 0; i < width; ++i)
+    if (a[0][i])
+      result.setBit(width - 1 - i);
+  return result;
+}
+// The firstbit intrinsics return -1 when no bit is found.
+static APInt EvalFirstBitLow(const APInt *a) {
+  unsigned width = a[0].getBitWidth();
+  if (!a[0])
+    return APInt::getAllOnesValue(width);
+  return APInt(width, a[0].countTrailingZeros());
+}
+static APInt EvalUFirstBitHigh(const APInt *a) {
+  unsigned width = a[0].getBitWidth();
+  if (!a[0])
+    return APInt::getAllOnesValue(width);
+  return APInt(width, width - 1 - a[0].countLeadingZeros());
+}
+static APInt EvalFirstBitHigh(const APInt *a) {
+  // Negative values search for the first clear bit.
+  APInt v = a[0].isNegative() ? ~a[0] : a[0];
+  return EvalUFirstBitHigh(&v);
+}
+
+#define FP_EVAL(Fn) Fn<float>, Fn<double>
+
+static const IntrinsicEvalEntry IntrinsicEvalTable[] = {
+  // Op                        Args Finite  Float/double evaluators   Int evaluator
+  { IntrinsicOp::IOP_tan,       1, true,  FP_EVAL(EvalTan),        nullptr },
+  { IntrinsicOp::IOP_tanh,      1, true,  FP_EVAL(EvalTanh),       nullptr },
+  { IntrinsicOp::IOP_sin,       1, true,  FP_EVAL(EvalSin),        nullptr },
+  { IntrinsicOp::IOP_sinh,      1, true,  FP_EVAL(EvalSinh),       nullptr },
+  { IntrinsicOp::IOP_cos,       1, true,  FP_EVAL(EvalCos),        nullptr },
+  { IntrinsicOp::IOP_cosh,      1, true,  FP_EVAL(EvalCosh),       nullptr },
+  { IntrinsicOp::IOP_asin,      1, true,  FP_EVAL(EvalAsin),       nullptr },
+  { IntrinsicOp::IOP_acos,      1, true,  FP_EVAL(EvalAcos),       nullptr },
+  { IntrinsicOp::IOP_atan,      1, true,  FP_EVAL(EvalAtan),       nullptr },
+  { IntrinsicOp::IOP_atan2,     2, true,  FP_EVAL(EvalAtan2),      nullptr },
+  { IntrinsicOp::IOP_sqrt,      1, true,  FP_EVAL(EvalSqrt),       nullptr },
+  { IntrinsicOp::IOP_rsqrt,     1, true,  FP_EVAL(EvalRsqrt),      nullptr },
+  { IntrinsicOp::IOP_rcp,       1, true,  FP_EVAL(EvalRcp),        nullptr },
+  { IntrinsicOp::IOP_exp,       1, true,  FP_EVAL(EvalExp),        nullptr },
+  { IntrinsicOp::IOP_exp2,      1, true,  FP_EVAL(EvalExp2),       nullptr },
+  { IntrinsicOp::IOP_log,       1, true,  FP_EVAL(EvalLog),        nullptr },
+  { IntrinsicOp::IOP_log10,     1, true,  FP_EVAL(EvalLog10),      nullptr },
+  { IntrinsicOp::IOP_log2,      1, true,  FP_EVAL(EvalLog2),       nullptr },
+  { IntrinsicOp::IOP_pow,       2, true,  FP_EVAL(EvalPow),        nullptr },
+  { IntrinsicOp::IOP_ceil,      1, true,  FP_EVAL(EvalCeil),       nullptr },
+  { IntrinsicOp::IOP_floor,     1, true,  FP_EVAL(EvalFloor),      nullptr },
+  { IntrinsicOp::IOP_trunc,     1, true,  FP_EVAL(EvalTrunc),      nullptr },
+  { IntrinsicOp::IOP_round,     1, true,  FP_EVAL(EvalRound),      nullptr },
+  { IntrinsicOp::IOP_frac,      1, true,  FP_EVAL(EvalFrac),       nullptr },
+  { IntrinsicOp::IOP_degrees,   1, true,  FP_EVAL(EvalDegrees),    nullptr },
+  { IntrinsicOp::IOP_radians,   1, true,  FP_EVAL(EvalRadians),    nullptr },
+  { IntrinsicOp::IOP_fmod,      2, true,  FP_EVAL(EvalFMod),       nullptr },
+  { IntrinsicOp::IOP_ldexp,     2, true,  FP_EVAL(EvalLdExp),      nullptr },
+  { IntrinsicOp::IOP_step,      2, true,  FP_EVAL(EvalStep),       nullptr },
+  { IntrinsicOp::IOP_lerp,      3, true,  FP_EVAL(EvalLerp),       nullptr },
+  { IntrinsicOp::IOP_smoothstep,3, true,  FP_EVAL(EvalSmoothStep), nullptr },
+  { IntrinsicOp::IOP_fma,       3, true,  nullptr, EvalFma<double>, nullptr },
+  // Integer abs isn't evaluated; the signedness of its operand isn't known.
+  { IntrinsicOp::IOP_abs,       1, true,  FP_EVAL(EvalAbs),        nullptr },
+  { IntrinsicOp::IOP_mad,       3, true,  FP_EVAL(EvalMad),        EvalIntMad },
+  { IntrinsicOp::IOP_umad,      3, true,  nullptr, nullptr,        EvalIntMad },
+  { IntrinsicOp::IOP_max,       2, false, FP_EVAL(EvalMax),        EvalIntMax },
+  { IntrinsicOp::IOP_min,       2, false, FP_EVAL(EvalMin),        EvalIntMin },
+  { IntrinsicOp::IOP_umax,      2, false, nullptr, nullptr,        EvalUIntMax },
+  { IntrinsicOp::IOP_umin,      2, false, nullptr, nullptr,        EvalUIntMin },
+  { IntrinsicOp::IOP_clamp,     3, false, FP_EVAL(EvalClamp),      EvalIntClamp },
+  { IntrinsicOp::IOP_uclamp,    3, false, nullptr, nullptr,        EvalUIntClamp },
+  { IntrinsicOp::IOP_saturate,  1, false, FP_EVAL(EvalSaturate),   nullptr },
+  { IntrinsicOp::IOP_countbits, 1, false, nullptr, nullptr,        EvalCountBits },
+  { IntrinsicOp::IOP_reversebits, 1, false, nullptr, nullptr,      EvalReverseBits },
+  { IntrinsicOp::IOP_firstbitlow, 1, false, nullptr, nullptr,      EvalFirstBitLow },
+  { IntrinsicOp::IOP_firstbithigh, 1, false, nullptr, nullptr,     EvalFirstBitHigh },
+  { IntrinsicOp::IOP_ufirstbithigh, 1, false, nullptr, nullptr,    EvalUFirstBitHigh },
+};
+
+#undef FP_EVAL
 
-    CI->replaceAllUsesWith(dResult);
-    Result = dResult;
+static const IntrinsicEvalEntry *FindIntrinsicEvalEntry(IntrinsicOp intriOp) {
+  for (const IntrinsicEvalEntry &entry : IntrinsicEvalTable) {
+    if (entry.Op == intriOp)
+      return &entry;
   }
+  return nullptr;
+}
 
-  CI->eraseFromParent();
-  return Result;
+// Returns true for scalar and vector constants made only of int and
+// floating-point elements; undef and constant expressions aren't evaluated.
+static bool IsImmediateOperand(Value *V) {
+  if (isa<ConstantInt>(V) || isa<ConstantFP>(V))
+    return true;
+  Constant *C = dyn_cast<Constant>(V);
+  if (!C || !C->getType()->isVectorTy())
+    return false;
+  for (unsigned i = 0, e = C->getType()->getVectorNumElements(); i < e; ++i) {
+    Constant *Elt = C->getAggregateElement(i);
+    if (!Elt || !(isa<ConstantInt>(Elt) || isa<ConstantFP>(Elt)))
+      return false;
+  }
+  return true;
 }
 
-static Value * EvalBinaryIntrinsic(CallInst *CI,
-                               FloatBinaryEvalFuncType floatEvalFunc,
-                               DoubleBinaryEvalFuncType doubleEvalFunc) {
-  Value *V0 = CI->getArgOperand(0);
-  ConstantFP *fpV0 = cast<ConstantFP>(V0);
-  Value *V1 = CI->getArgOperand(1);
-  ConstantFP *fpV1 = cast<ConstantFP>(V1);
+static void GetImmediateLanes(Value *V, SmallVectorImpl<Constant *> &lanes) {
+  Constant *C = cast<Constant>(V);
+  if (!C->getType()->isVectorTy()) {
+    lanes.emplace_back(C);
+    return;
+  }
+  for (unsigned i = 0, e = C->getType()->getVectorNumElements(); i < e; ++i)
+    lanes.emplace_back(C->getAggregateElement(i));
+}
+
+static bool IsFiniteImmediate(Constant *C) {
+  ConstantFP *FP = dyn_cast<ConstantFP>(C);
+  return !FP || FP->getValueAPF().isFinite();
+}
+
+static Constant *GetFPConstant(llvm::Type *Ty, const APFloat &V) {
+  return ConstantFP::get(Ty->getContext(), V);
+}
+
+// Evaluates the call lane by lane; scalar operands are broadcast.
+static Constant *EvalLanes(
+    CallInst *CI,
+    function_ref<Constant *(llvm::Type *RetEltTy, ArrayRef<Constant *> Args)> EvalLane) {
+  const unsigned kMaxArgs = 4;
   llvm::Type *Ty = CI->getType();
-  Value *Result = nullptr;
-  if (Ty->isDoubleTy()) {
-    double dV0 = fpV0->getValueAPF().convertToDouble();
-    double dV1 = fpV1->getValueAPF().convertToDouble();
-    Value *dResult = ConstantFP::get(V0->getType(), doubleEvalFunc(dV0, dV1));
-    CI->replaceAllUsesWith(dResult);
-    Result = dResult;
-  } else {
-    DXASSERT_NOMSG(Ty->isFloatTy());
-    float fV0 = fpV0->getValueAPF().convertToFloat();
-    float fV1 = fpV1->getValueAPF().convertToFloat();
-    Value *dResult = ConstantFP::get(V0->getType(), floatEvalFunc(fV0, fV1));
+  unsigned numLanes = Ty->isVectorTy() ? Ty->getVectorNumElements() : 1;
+  unsigned numArgs = CI->getNumArgOperands();
+  if (numArgs > kMaxArgs)
+    return nullptr;
+  SmallVector<Constant *, 4> argLanes[kMaxArgs];
+  for (unsigned a = 0; a < numArgs; ++a) {
+    GetImmediateLanes(CI->getArgOperand(a), argLanes[a]);
+    if (argLanes[a].size() != 1 && argLanes[a].size() != numLanes)
+      return nullptr;
+  }
 
-    CI->replaceAllUsesWith(dResult);
-    Result = dResult;
+  SmallVector<Constant *, 4> results;
+  Constant *args[kMaxArgs];
+  for (unsigned i = 0; i < numLanes; ++i) {
+    for (unsigned a = 0; a < numArgs; ++a)
+      args[a] = argLanes[a].size() == 1 ? argLanes[a][0] : argLanes[a][i];
+    Constant *R = EvalLane(Ty->getScalarType(), makeArrayRef(args, numArgs));
+    if (!R)
+      return nullptr;
+    results.emplace_back(R);
   }
+  return Ty->isVectorTy() ? ConstantVector::get(results) : results[0];
+}
 
-  CI->eraseFromParent();
-  return Result;
+static Constant *EvalTableLane(const IntrinsicEvalEntry &entry, llvm::Type *RetEltTy,
+                               ArrayRef<Constant *> Args) {
+  if (Args.size() != entry.NumArgs)
+    return nullptr;
+  llvm::Type *ArgTy = Args[0]->getType();
+  for (Constant *Arg : Args) {
+    if (Arg->getType() != ArgTy)
+      return nullptr;
+  }
+
+  if (ArgTy->isFloatTy() || ArgTy->isDoubleTy()) {
+    if (RetEltTy != ArgTy)
+      return nullptr;
+    if (entry.FiniteOnly &&
+        !std::all_of(Args.begin(), Args.end(), IsFiniteImmediate))
+      return nullptr;
+    if (ArgTy->isFloatTy() && entry.FloatEval) {
+      float v[3];
+      for (unsigned i = 0; i < Args.size(); ++i)
+        v[i] = cast<ConstantFP>(Args[i])->getValueAPF().convertToFloat();
+      return ConstantFP::get(RetEltTy, entry.FloatEval(v));
+    }
+    if (ArgTy->isDoubleTy() && entry.DoubleEval) {
+      double v[3];
+      for (unsigned i = 0; i < Args.size(); ++i)
+        v[i] = cast<ConstantFP>(Args[i])->getValueAPF().convertToDouble();
+      return ConstantFP::get(RetEltTy, entry.DoubleEval(v));
+    }
+    return nullptr;
+  }
+
+  if (ArgTy->isIntegerTy() && RetEltTy->isIntegerTy() && entry.IntEval) {
+    APInt v[3];
+    for (unsigned i = 0; i < Args.size(); ++i)
+      v[i] = cast<ConstantInt>(Args[i])->getValue();
+    APInt R = entry.IntEval(v);
+    return ConstantInt::get(RetEltTy,
+                            R.sextOrTrunc(RetEltTy->getIntegerBitWidth()));
+  }
+  return nullptr;
 }
 
-static Value * TryEvalIntrinsic(CallInst *CI, IntrinsicOp intriOp) {
-  switch (intriOp) {
-  case IntrinsicOp::IOP_tan: {
-    return EvalUnaryIntrinsic(CI, tanf, tan);
-  } break;
-  case IntrinsicOp::IOP_tanh: {
-    return EvalUnaryIntrinsic(CI, tanhf, tanh);
-  } break;
-  case IntrinsicOp::IOP_sin: {
-    return EvalUnaryIntrinsic(CI, sinf, sin);
-  } break;
-  case IntrinsicOp::IOP_sinh: {
-    return EvalUnaryIntrinsic(CI, sinhf, sinh);
-  } break;
-  case IntrinsicOp::IOP_cos: {
-    return EvalUnaryIntrinsic(CI, cosf, cos);
-  } break;
-  case IntrinsicOp::IOP_cosh: {
-    return EvalUnaryIntrinsic(CI, coshf, cosh);
-  } break;
-  case IntrinsicOp::IOP_asin: {
-    return EvalUnaryIntrinsic(CI, asinf, asin);
-  } break;
-  case IntrinsicOp::IOP_acos: {
-    return EvalUnaryIntrinsic(CI, acosf, acos);
-  } break;
-  case IntrinsicOp::IOP_atan: {
-    return EvalUnaryIntrinsic(CI, atanf, atan);
-  } break;
-  case IntrinsicOp::IOP_atan2: {
-    Value *V0 = CI->getArgOperand(0);
-    ConstantFP *fpV0 = cast<ConstantFP>(V0);
-
-    Value *V1 = CI->getArgOperand(1);
-    ConstantFP *fpV1 = cast<ConstantFP>(V1);
-
-    llvm::Type *Ty = CI->getType();
-    Value *Result = nullptr;
-    if (Ty->isDoubleTy()) {
-      double dV0 = fpV0->getValueAPF().convertToDouble();
-      double dV1 = fpV1->getValueAPF().convertToDouble();
-      Value *atanV = ConstantFP::get(CI->getType(), atan(dV0 / dV1));
-      CI->replaceAllUsesWith(atanV);
-      Result = atanV;
-    } else {
-      DXASSERT_NOMSG(Ty->isFloatTy());
-      float fV0 = fpV0->getValueAPF().convertToFloat();
-      float fV1 = fpV1->getValueAPF().convertToFloat();
-      Value *atanV = ConstantFP::get(CI->getType(), atanf(fV0 / fV1));
-      CI->replaceAllUsesWith(atanV);
-      Result = atanV;
-    }
-    CI->eraseFromParent();
-    return Result;
-  } break;
-  case IntrinsicOp::IOP_sqrt: {
-    return EvalUnaryIntrinsic(CI, sqrtf, sqrt);
-  } break;
-  case IntrinsicOp::IOP_rsqrt: {
-    auto rsqrtF = [](float v) -> float { return 1.0 / sqrtf(v); };
-    auto rsqrtD = [](double v) -> double { return 1.0 / sqrt(v); };
+static APFloat EvalAPFloatSqrt(const APFloat &V) {
+  if (&V.getSemantics() == &APFloat::IEEEsingle)
+    return APFloat(std::sqrt(V.convertToFloat()));
+  return APFloat(std::sqrt(V.convertToDouble()));
+}
 
-    return EvalUnaryIntrinsic(CI, rsqrtF, rsqrtD);
-  } break;
-  case IntrinsicOp::IOP_exp: {
-    return EvalUnaryIntrinsic(CI, expf, exp);
-  } break;
-  case IntrinsicOp::IOP_exp2: {
-    return EvalUnaryIntrinsic(CI, exp2f, exp2);
-  } break;
-  case IntrinsicOp::IOP_log: {
-    return EvalUnaryIntrinsic(CI, logf, log);
-  } break;
-  case IntrinsicOp::IOP_log10: {
-    return EvalUnaryIntrinsic(CI, log10f, log10);
-  } break;
-  case IntrinsicOp::IOP_log2: {
-    return EvalUnaryIntrinsic(CI, log2f, log2);
-  } break;
-  case IntrinsicOp::IOP_pow: {
-    return EvalBinaryIntrinsic(CI, powf, pow);
-  } break;
-  case IntrinsicOp::IOP_max: {
-    auto maxF = [](float a, float b) -> float { return a > b ? a:b; };
-    auto maxD = [](double a, double b) -> double { return a > b ? a:b; };
-    return EvalBinaryIntrinsic(CI, maxF, maxD);
-  } break;
-  case IntrinsicOp::IOP_min: {
-    auto minF = [](float a, float b) -> float { return a < b ? a:b; };
-    auto minD = [](double a, double b) -> double { return a < b ? a:b; };
-    return EvalBinaryIntrinsic(CI, minF, minD);
-  } break;
-  case IntrinsicOp::IOP_rcp: {
-    auto rcpF = [](float v) -> float { return 1.0 / v; };
-    auto rcpD = [](double v) -> double { return 1.0 / v; };
+// Sum of products in lane order, as Dot2/Dot3/Dot4 and the length expansion
+// compute it.
+static APFloat EvalAPFloatDot(ArrayRef<Constant *> A, ArrayRef<Constant *> B) {
+  const APFloat::roundingMode RM = APFloat::rmNearestTiesToEven;
+  APFloat sum(cast<ConstantFP>(A[0])->getValueAPF());
+  sum.multiply(cast<ConstantFP>(B[0])->getValueAPF(), RM);
+  for (unsigned i = 1; i < A.size(); ++i) {
+    APFloat product(cast<ConstantFP>(A[i])->getValueAPF());
+    product.multiply(cast<ConstantFP>(B[i])->getValueAPF(), RM);
+    sum.add(product, RM);
+  }
+  return sum;
+}
 
-    return EvalUnaryIntrinsic(CI, rcpF, rcpD);
-  } break;
-  case IntrinsicOp::IOP_ceil: {
-    return EvalUnaryIntrinsic(CI, ceilf, ceil);
-  } break;
-  case IntrinsicOp::IOP_floor: {
-    return EvalUnaryIntrinsic(CI, floorf, floor);
-  } break;
-  case IntrinsicOp::IOP_round: {
-    return EvalUnaryIntrinsic(CI, roundf, round);
-  } break;
-  case IntrinsicOp::IOP_trunc: {
-    return EvalUnaryIntrinsic(CI, truncf, trunc);
-  } break;
-  case IntrinsicOp::IOP_frac: {
-    auto fracF = [](float v) -> float {
-      int exp = 0;
-      return frexpf(v, &exp);
-    };
-    auto fracD = [](double v) -> double {
-      int exp = 0;
-      return frexp(v, &exp);
+// length(v) is |v| for a single lane and sqrt(dot(v, v)) otherwise.
+static APFloat EvalAPFloatLength(ArrayRef<Constant *> V) {
+  if (V.size() == 1) {
+    APFloat abs(cast<ConstantFP>(V[0])->getValueAPF());
+    abs.clearSign();
+    return abs;
+  }
+  return EvalAPFloatSqrt(EvalAPFloatDot(V, V));
+}
+
+// Evaluates intrinsics that reduce or reshape their operands. Operand lanes
+// are all finite floating-point values of the same type.
+static Constant *EvalFPReduction(CallInst *CI, IntrinsicOp intriOp) {
+  const APFloat::roundingMode RM = APFloat::rmNearestTiesToEven;
+  llvm::Type *Ty = CI->getType();
+  SmallVector<Constant *, 4> A, B;
+  GetImmediateLanes(CI->getArgOperand(0), A);
+  if (CI->getNumArgOperands() > 1)
+    GetImmediateLanes(CI->getArgOperand(1), B);
+  switch (intriOp) {
+  case IntrinsicOp::IOP_dot:
+    if (A.size() != B.size())
+      return nullptr;
+    return GetFPConstant(Ty, EvalAPFloatDot(A, B));
+  case IntrinsicOp::IOP_length:
+    return GetFPConstant(Ty, EvalAPFloatLength(A));
+  case IntrinsicOp::IOP_distance: {
+    if (A.size() != B.size())
+      return nullptr;
+    SmallVector<Constant *, 4> diff;
+    for (unsigned i = 0; i < A.size(); ++i) {
+      APFloat d(cast<ConstantFP>(A[i])->getValueAPF());
+      d.subtract(cast<ConstantFP>(B[i])->getValueAPF(), RM);
+      diff.emplace_back(GetFPConstant(Ty, d));
+    }
+    return GetFPConstant(Ty, EvalAPFloatLength(diff));
+  }
+  case IntrinsicOp::IOP_normalize: {
+    if (!Ty->isVectorTy() || Ty->getVectorNumElements() != A.size())
+      return nullptr;
+    APFloat length = EvalAPFloatLength(A);
+    SmallVector<Constant *, 4> lanes;
+    for (Constant *C : A) {
+      APFloat q(cast<ConstantFP>(C)->getValueAPF());
+      q.divide(length, RM);
+      lanes.emplace_back(GetFPConstant(Ty, q));
+    }
+    return ConstantVector::get(lanes);
+  }
+  case IntrinsicOp::IOP_cross: {
+    if (A.size() != 3 || B.size() != 3)
+      return nullptr;
+    auto MulSub = [&](unsigned i, unsigned j) -> Constant * {
+      APFloat xy(cast<ConstantFP>(A[i])->getValueAPF());
+      xy.multiply(cast<ConstantFP>(B[j])->getValueAPF(), RM);
+      APFloat yx(cast<ConstantFP>(A[j])->getValueAPF());
+      yx.multiply(cast<ConstantFP>(B[i])->getValueAPF(), RM);
+      xy.subtract(yx, RM);
+      return GetFPConstant(Ty, xy);
     };
+    Constant *lanes[] = { MulSub(1, 2), MulSub(2, 0), MulSub(0, 1) };
+    return ConstantVector::get(lanes);
+  }
+  default:
+    return nullptr;
+  }
+}
 
-    return EvalUnaryIntrinsic(CI, fracF, fracD);
-  } break;
-  case IntrinsicOp::IOP_isnan: {
-    Value *V = CI->getArgOperand(0);
-    ConstantFP *fV = cast<ConstantFP>(V);
-    bool isNan = fV->getValueAPF().isNaN();
-    Constant *cNan = ConstantInt::get(CI->getType(), isNan ? 1 : 0);
-    CI->replaceAllUsesWith(cNan);
-    CI->eraseFromParent();
-    return cNan;
-  } break;
+static Constant *EvalIntrinsicToConstant(CallInst *CI, IntrinsicOp intriOp) {
+  if (const IntrinsicEvalEntry *entry = FindIntrinsicEvalEntry(intriOp)) {
+    return EvalLanes(CI, [entry](llvm::Type *RetEltTy, ArrayRef<Constant *> Args) {
+      return EvalTableLane(*entry, RetEltTy, Args);
+    });
+  }
+
+  switch (intriOp) {
+  case IntrinsicOp::IOP_isnan:
+  case IntrinsicOp::IOP_isinf:
+  case IntrinsicOp::IOP_isfinite:
+    return EvalLanes(CI, [intriOp](llvm::Type *RetEltTy, ArrayRef<Constant *> Args) -> Constant * {
+      ConstantFP *FP = dyn_cast<ConstantFP>(Args[0]);
+      if (!FP || !RetEltTy->isIntegerTy())
+        return nullptr;
+      const APFloat &V = FP->getValueAPF();
+      bool result = intriOp == IntrinsicOp::IOP_isnan ? V.isNaN()
+                  : intriOp == IntrinsicOp::IOP_isinf ? V.isInfinity()
+                  : V.isFinite();
+      return ConstantInt::get(RetEltTy, result ? 1 : 0);
+    });
+  case IntrinsicOp::IOP_sign:
+    // (0 < v) - (v < 0); NaN compares false both ways and yields 0.
+    return EvalLanes(CI, [](llvm::Type *RetEltTy, ArrayRef<Constant *> Args) -> Constant * {
+      if (!RetEltTy->isIntegerTy())
+        return nullptr;
+      int result = 0;
+      if (ConstantFP *FP = dyn_cast<ConstantFP>(Args[0])) {
+        const APFloat &V = FP->getValueAPF();
+        if (!V.isNaN() && !V.isZero())
+          result = V.isNegative() ? -1 : 1;
+      } else {
+        const APInt &V = cast<ConstantInt>(Args[0])->getValue();
+        if (!!V)
+          result = V.isNegative() ? -1 : 1;
+      }
+      return ConstantInt::get(RetEltTy, result, /*isSigned*/ true);
+    });
+  case IntrinsicOp::IOP_f32tof16:
+    return EvalLanes(CI, [](llvm::Type *RetEltTy, ArrayRef<Constant *> Args) -> Constant * {
+      ConstantFP *FP = dyn_cast<ConstantFP>(Args[0]);
+      if (!FP || !FP->getType()->isFloatTy() || !RetEltTy->isIntegerTy() ||
+          FP->getValueAPF().isNaN())
+        return nullptr;
+      APFloat half(FP->getValueAPF());
+      bool losesInfo;
+      half.convert(APFloat::IEEEhalf, APFloat::rmNearestTiesToEven, &losesInfo);
+      return ConstantInt::get(
+          RetEltTy, half.bitcastToAPInt().zext(RetEltTy->getIntegerBitWidth()));
+    });
+  case IntrinsicOp::IOP_f16tof32:
+    return EvalLanes(CI, [](llvm::Type *RetEltTy, ArrayRef<Constant *> Args) -> Constant * {
+      ConstantInt *Int = dyn_cast<ConstantInt>(Args[0]);
+      if (!Int || !RetEltTy->isFloatTy() || Int->getBitWidth() < 16)
+        return nullptr;
+      APFloat V(APFloat::IEEEhalf, Int->getValue().trunc(16));
+      if (V.isNaN())
+        return nullptr;
+      bool losesInfo;
+      V.convert(APFloat::IEEEsingle, APFloat::rmNearestTiesToEven, &losesInfo);
+      return GetFPConstant(RetEltTy, V);
+    });
+  case IntrinsicOp::IOP_asfloat:
+  case IntrinsicOp::IOP_asint:
+  case IntrinsicOp::IOP_asuint:
+    if (CI->getNumArgOperands() != 1)
+      return nullptr;
+    return EvalLanes(CI, [](llvm::Type *RetEltTy, ArrayRef<Constant *> Args) -> Constant * {
+      llvm::Type *ArgTy = Args[0]->getType();
+      if (ArgTy->getPrimitiveSizeInBits() != RetEltTy->getPrimitiveSizeInBits())
+        return nullptr;
+      APInt bits = isa<ConstantFP>(Args[0])
+                       ? cast<ConstantFP>(Args[0])->getValueAPF().bitcastToAPInt()
+                       : cast<ConstantInt>(Args[0])->getValue();
+      if (RetEltTy->isIntegerTy())
+        return ConstantInt::get(RetEltTy, bits);
+      if (RetEltTy->isFloatTy())
+        return GetFPConstant(RetEltTy, APFloat(APFloat::IEEEsingle, bits));
+      return nullptr;
+    });
+  case IntrinsicOp::IOP_any:
+  case IntrinsicOp::IOP_all: {
+    SmallVector<Constant *, 4> lanes;
+    GetImmediateLanes(CI->getArgOperand(0), lanes);
+    bool isAny = intriOp == IntrinsicOp::IOP_any;
+    bool result = !isAny;
+    for (Constant *C : lanes) {
+      // NaN is non-zero.
+      bool nonZero = isa<ConstantFP>(C) ? !cast<ConstantFP>(C)->isZero()
+                                        : !cast<ConstantInt>(C)->isZero();
+      if (nonZero == isAny) {
+        result = isAny;
+        break;
+      }
+    }
+    return ConstantInt::get(CI->getType(), result ? 1 : 0);
+  }
+  case IntrinsicOp::IOP_dot: {
+    SmallVector<Constant *, 4> A, B;
+    GetImmediateLanes(CI->getArgOperand(0), A);
+    GetImmediateLanes(CI->getArgOperand(1), B);
+    if (A.size() != B.size() || A[0]->getType() != B[0]->getType())
+      return nullptr;
+    if (ConstantInt *Int = dyn_cast<ConstantInt>(A[0])) {
+      APInt sum(Int->getBitWidth(), 0);
+      for (unsigned i = 0; i < A.size(); ++i)
+        sum += cast<ConstantInt>(A[i])->getValue() *
+               cast<ConstantInt>(B[i])->getValue();
+      return ConstantInt::get(CI->getType(), sum);
+    }
+  }
+  // Fall through for floating-point dot.
+  case IntrinsicOp::IOP_length:
+  case IntrinsicOp::IOP_distance:
+  case IntrinsicOp::IOP_normalize:
+  case IntrinsicOp::IOP_cross: {
+    llvm::Type *EltTy = CI->getType()->getScalarType();
+    if (!EltTy->isFloatTy() && !EltTy->isDoubleTy())
+      return nullptr;
+    for (unsigned a = 0; a < CI->getNumArgOperands(); ++a) {
+      SmallVector<Constant *, 4> lanes;
+      GetImmediateLanes(CI->getArgOperand(a), lanes);
+      for (Constant *C : lanes) {
+        if (C->getType() != EltTy || !IsFiniteImmediate(C))
+          return nullptr;
+      }
+    }
+    return EvalFPReduction(CI, intriOp);
+  }
   default:
     return nullptr;
   }
 }
 
+static Value * TryEvalIntrinsic(CallInst *CI, IntrinsicOp intriOp) {
+  Constant *Result = EvalIntrinsicToConstant(CI, intriOp);
+  if (!Result)
+    return nullptr;
+  CI->replaceAllUsesWith(Result);
+  CI->eraseFromParent();
+  return Result;
+}
+
 static void SimpleTransformForHLDXIR(Instruction *I,
                                      std::vector<Instruction *> &deadInsts) {
 
@@ -3932,7 +4275,7 @@ RValue CGMSHLSLRuntime::EmitHLSLBuiltinCallExpr(CodeGenFunction &CGF,
       if (group == HLOpcodeGroup::HLIntrinsic) {
         bool allOperandImm = true;
         for (auto &operand : CI->arg_operands()) {
-          bool isImm = isa<ConstantInt>(operand) || isa<ConstantFP>(operand);
+          bool isImm = IsImmediateOperand(operand);
           if (!isImm) {
             allOperandImm = false;
             break;
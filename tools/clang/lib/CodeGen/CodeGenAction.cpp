@@ -34,6 +34,7 @@
 #include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/SourceMgr.h"
 #include "llvm/Support/Timer.h"
+#include "dxc/HLSL/DxilCompileTimeReport.h" // HLSL Change
 #include <memory>
 using namespace clang;
 using namespace llvm;
@@ -50,6 +51,7 @@ namespace clang {
     ASTContext *Context;
 
     Timer LLVMIRGeneration;
+    bool TimePasses; // HLSL Change - per compile rather than global
 
     std::unique_ptr<CodeGenerator> Gen;
 
@@ -68,10 +70,12 @@ namespace clang {
         : Diags(Diags), Action(Action), CodeGenOpts(CodeGenOpts),
           TargetOpts(TargetOpts), LangOpts(LangOpts), AsmOutStream(OS),
           Context(nullptr), LLVMIRGeneration("LLVM IR Generation Time"),
+          TimePasses(TimePasses), // HLSL Change
           Gen(CreateLLVMCodeGen(Diags, InFile, HeaderSearchOpts, PPOpts,
                                 CodeGenOpts, C, CoverageInfo)),
           LinkModule(LinkModule) {
-      llvm::TimePassesIsEnabled = TimePasses;
+      // HLSL Change - don't write llvm::TimePassesIsEnabled; compiles run
+      // concurrently on many threads, and the setting would outlive this one.
     }
 
     std::unique_ptr<llvm::Module> takeModule() { return std::move(TheModule); }
@@ -89,14 +93,14 @@ namespace clang {
         
       Context = &Ctx;
 
-      if (llvm::TimePassesIsEnabled)
+      if (TimePasses) // HLSL Change
         LLVMIRGeneration.startTimer();
 
       Gen->Initialize(Ctx);
 
       TheModule.reset(Gen->GetModule());
 
-      if (llvm::TimePassesIsEnabled)
+      if (TimePasses) // HLSL Change
         LLVMIRGeneration.stopTimer();
     }
 
@@ -105,12 +109,12 @@ namespace clang {
                                      Context->getSourceManager(),
                                      "LLVM IR generation of declaration");
 
-      if (llvm::TimePassesIsEnabled)
+      if (TimePasses) // HLSL Change
         LLVMIRGeneration.startTimer();
 
       Gen->HandleTopLevelDecl(D);
 
-      if (llvm::TimePassesIsEnabled)
+      if (TimePasses) // HLSL Change
         LLVMIRGeneration.stopTimer();
 
       return true;
@@ -120,24 +124,29 @@ namespace clang {
       PrettyStackTraceDecl CrashInfo(D, SourceLocation(),
                                      Context->getSourceManager(),
                                      "LLVM IR generation of inline method");
-      if (llvm::TimePassesIsEnabled)
+      if (TimePasses) // HLSL Change
         LLVMIRGeneration.startTimer();
 
       Gen->HandleInlineMethodDefinition(D);
 
-      if (llvm::TimePassesIsEnabled)
+      if (TimePasses) // HLSL Change
         LLVMIRGeneration.stopTimer();
     }
 
     void HandleTranslationUnit(ASTContext &C) override {
       {
         PrettyStackTraceString CrashInfo("Per-file LLVM IR generation");
-        if (llvm::TimePassesIsEnabled)
+        if (TimePasses) // HLSL Change
           LLVMIRGeneration.startTimer();
 
-        Gen->HandleTranslationUnit(C);
+        {
+          // HLSL Change
+          hlsl::DxilCompileTimeReport::PhaseScope Phase(
+              CodeGenOpts.HLSLTimeReport.get(), "codegen");
+          Gen->HandleTranslationUnit(C);
+        }
 
-        if (llvm::TimePassesIsEnabled)
+        if (TimePasses) // HLSL Change
           LLVMIRGeneration.stopTimer();
       }
 
@@ -179,9 +188,15 @@ namespace clang {
       void *OldDiagnosticContext = Ctx.getDiagnosticContext();
       Ctx.setDiagnosticHandler(DiagnosticHandler, this);
 
-      EmitBackendOutput(Diags, CodeGenOpts, TargetOpts, LangOpts,
-                        C.getTargetInfo().getTargetDescription(),
-                        TheModule.get(), Action, AsmOutStream);
+      {
+        // HLSL Change
+        hlsl::DxilCompileTimeReport::PhaseScope Phase(
+            CodeGenOpts.HLSLTimeReport.get(), "optimize");
+        llvm::TimePassesScope TimePassesScope(TimePasses);
+        EmitBackendOutput(Diags, CodeGenOpts, TargetOpts, LangOpts,
+                          C.getTargetInfo().getTargetDescription(),
+                          TheModule.get(), Action, AsmOutStream);
+      }
 
       Ctx.setInlineAsmDiagnosticHandler(OldHandler, OldContext);
 
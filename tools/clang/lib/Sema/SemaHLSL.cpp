@@ -12,6 +12,7 @@
 
 #include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/StringMap.h"
 #include "clang/AST/ASTContext.h"
 #include "clang/AST/Attr.h"
 #include "clang/AST/DeclCXX.h"
@@ -36,7 +37,10 @@
 #include "dxc/HlslIntrinsicOp.h"
 #include "gen_intrin_main_tables_15.h"
 #include "dxc/HLSL/HLOperations.h"
+#include <algorithm>
 #include <array>
+#include <tuple>
+#include <unordered_map>
 
 enum ArBasicKind {
   AR_BASIC_BOOL,
@@ -1968,6 +1972,121 @@ void GetIntrinsicMethods(ArBasicKind kind, _Outptr_result_buffer_(*intrinsicCoun
   }
 }
 
+/// <summary>
+/// Index from name and argument count to the first matching entry in a
+/// builtin intrinsic table. Overloads with the same name and argument count
+/// are contiguous in the tables, so finding the first one is enough to
+/// iterate over all of them.
+/// </summary>
+class IntrinsicTableIndex
+{
+private:
+  // Name to (uNumArgs, first entry index) pairs; few names have more than two.
+  llvm::StringMap<llvm::SmallVector<std::pair<UINT, unsigned>, 2> > m_firstEntries;
+
+public:
+  IntrinsicTableIndex(_In_count_(count) const HLSL_INTRINSIC* table, size_t count)
+  {
+    for (unsigned i = 0; i < count; ++i) {
+      auto &entries = m_firstEntries[table[i].pArgs[0].pName];
+      auto found = std::find_if(entries.begin(), entries.end(),
+        [&](const std::pair<UINT, unsigned> &e) { return e.first == table[i].uNumArgs; });
+      if (found == entries.end()) {
+        entries.push_back(std::make_pair(table[i].uNumArgs, i));
+      }
+    }
+  }
+
+  /// <summary>Returns the index of the first entry with the given name and argument count (including the return value), or count if there is none.</summary>
+  size_t Find(StringRef name, UINT numArgs, size_t count) const
+  {
+    auto entries = m_firstEntries.find(name);
+    if (entries != m_firstEntries.end()) {
+      for (const std::pair<UINT, unsigned> &e : entries->second) {
+        if (e.first == numArgs) {
+          return e.second;
+        }
+      }
+    }
+    return count;
+  }
+};
+
+/// <summary>Gets the index for a builtin intrinsic table.</summary>
+/// <remarks>
+/// Indices for all builtin tables are built once per process, on first use,
+/// and are read-only afterwards, so lookups don't need to lock.
+/// </remarks>
+static
+const IntrinsicTableIndex& GetIntrinsicTableIndex(_In_ const HLSL_INTRINSIC* table)
+{
+  typedef std::unordered_map<const HLSL_INTRINSIC*, IntrinsicTableIndex> IndexMap;
+  static const IndexMap indices = []() {
+    IndexMap result;
+    result.emplace(std::piecewise_construct, std::forward_as_tuple(g_Intrinsics),
+                   std::forward_as_tuple(g_Intrinsics, _countof(g_Intrinsics)));
+    for (unsigned kind = 0; kind < AR_BASIC_MAXIMUM_COUNT; ++kind) {
+      const HLSL_INTRINSIC* intrinsics;
+      size_t intrinsicCount;
+      GetIntrinsicMethods((ArBasicKind)kind, &intrinsics, &intrinsicCount);
+      if (intrinsics != nullptr && result.count(intrinsics) == 0) {
+        result.emplace(std::piecewise_construct, std::forward_as_tuple(intrinsics),
+                       std::forward_as_tuple(intrinsics, intrinsicCount));
+      }
+    }
+    return result;
+  }();
+
+  auto found = indices.find(table);
+  DXASSERT(found != indices.end(), "otherwise table is not a builtin intrinsic table");
+  return found->second;
+}
+
+/// <summary>
+/// Process-wide lookup data for the built-in object types, which are
+/// declared in each translation unit on first use.
+/// </summary>
+struct BuiltinObjectIndex
+{
+  /// <summary>Index in Names of the 'sampler' alias.</summary>
+  static const unsigned SamplerAliasIndex = _countof(g_ArBasicKindsAsTypes) + _countof(g_DeprecatedEffectObjectNames);
+  /// <summary>Sentinel in KindIndices for kinds that aren't object types.</summary>
+  static const unsigned NoIndex = ~0U;
+
+  /// <summary>
+  /// Name to index: an index into g_ArBasicKindsAsTypes, followed by
+  /// g_DeprecatedEffectObjectNames, followed by SamplerAliasIndex.
+  /// </summary>
+  llvm::StringMap<unsigned> Names;
+  /// <summary>Basic kind to index into g_ArBasicKindsAsTypes, or NoIndex.</summary>
+  unsigned KindIndices[AR_BASIC_MAXIMUM_COUNT];
+
+  BuiltinObjectIndex()
+  {
+    std::fill(std::begin(KindIndices), std::end(KindIndices), NoIndex);
+    for (unsigned i = 0; i < _countof(g_ArBasicKindsAsTypes); ++i) {
+      ArBasicKind kind = g_ArBasicKindsAsTypes[i];
+      KindIndices[kind] = i;
+      if (kind == AR_OBJECT_WAVE) { // wave objects are currently unused
+        continue;
+      }
+      Names[g_ArBasicTypeNames[kind]] = i;
+    }
+    for (unsigned i = 0; i < _countof(g_DeprecatedEffectObjectNames); ++i) {
+      Names[g_DeprecatedEffectObjectNames[i]] = _countof(g_ArBasicKindsAsTypes) + i;
+    }
+    Names["sampler"] = SamplerAliasIndex;
+  }
+};
+
+/// <summary>Gets the built-in object lookup data, built once per process.</summary>
+static
+const BuiltinObjectIndex& GetBuiltinObjectIndex()
+{
+  static const BuiltinObjectIndex index;
+  return index;
+}
+
 static
 bool IsRowOrColumnVariable(size_t value)
 {
@@ -2061,6 +2180,11 @@ private:
   unsigned _tableIndex;
   unsigned _argCount;
   bool _firstChecked;
+  // Wide names for LookupIntrinsic, converted on first use and reused for
+  // every table and every overload.
+  std::wstring _typeNameW;
+  std::wstring _functionNameW;
+  bool _namesConverted;
 
   IntrinsicTableDefIter(
     llvm::SmallVector<CComPtr<IDxcIntrinsicTable>, 2>& tables,
@@ -2069,7 +2193,7 @@ private:
     unsigned argCount) :
     _typeName(typeName), _functionName(functionName), _tables(tables),
     _tableIntrinsic(nullptr), _tableLookupCookie(0), _tableIndex(0),
-    _argCount(argCount), _firstChecked(false)
+    _argCount(argCount), _firstChecked(false), _namesConverted(false)
   {
   }
 
@@ -2080,12 +2204,14 @@ private:
 
     _firstChecked = true;
 
-    // TODO: review this - this will allocate at least once per string
-    CA2WEX<> typeName(_typeName.str().c_str(), CP_UTF8);
-    CA2WEX<> functionName(_functionName.str().c_str(), CP_UTF8);
+    if (!_namesConverted) {
+      _typeNameW = CA2WEX<>(_typeName.str().c_str(), CP_UTF8);
+      _functionNameW = CA2WEX<>(_functionName.str().c_str(), CP_UTF8);
+      _namesConverted = true;
+    }
 
     if (FAILED(_tables[_tableIndex]->LookupIntrinsic(
-            typeName, functionName, &_tableIntrinsic, &_tableLookupCookie))) {
+            _typeNameW.c_str(), _functionNameW.c_str(), &_tableIntrinsic, &_tableLookupCookie))) {
       _tableLookupCookie = 0;
       _tableIntrinsic = nullptr;
     }
@@ -2405,11 +2531,15 @@ private:
   QualType m_vectorTypes[HLSLScalarTypeCount][4];
   TypedefDecl* m_vectorTypedefs[HLSLScalarTypeCount][4];
 
-  // Built-in object types declarations, indexed by basic kind constant.
+  // Built-in object types declarations, indexed by basic kind constant;
+  // created on first use.
   CXXRecordDecl* m_objectTypeDecls[_countof(g_ArBasicKindsAsTypes)];
-  // Map from object decl to the object index.
-  using ObjectTypeDeclMapType = std::array<std::pair<CXXRecordDecl*,unsigned>, _countof(g_ArBasicKindsAsTypes)+_countof(g_DeprecatedEffectObjectNames)>;
-  ObjectTypeDeclMapType m_objectTypeDeclsMap;
+  // Deprecated effect object declarations, indexed as g_DeprecatedEffectObjectNames; created on first use.
+  CXXRecordDecl* m_deprecatedEffectObjectDecls[_countof(g_DeprecatedEffectObjectNames)];
+  // Alias for SamplerState; created on first use.
+  TypedefDecl* m_samplerTypedef;
+  // Map from object decl to the object index, for the objects created so far.
+  llvm::DenseMap<const CXXRecordDecl*, unsigned> m_objectTypeDeclsMap;
   // Mask for object which not has methods created.
   uint64_t m_objectTypeLazyInitMask;
 
@@ -2775,93 +2905,113 @@ private:
     }
   }
 
-  static bool ObjectTypeDeclMapTypeCmp(const std::pair<CXXRecordDecl*,unsigned> &a,
-                           const std::pair<CXXRecordDecl*,unsigned> &b) {
-    return a.first < b.first;
-  };
-
   int FindObjectBasicKindIndex(const CXXRecordDecl* recordDecl) {
-    auto begin = m_objectTypeDeclsMap.begin();
-    auto end = m_objectTypeDeclsMap.end();
-    auto val = std::make_pair(const_cast<CXXRecordDecl*>(recordDecl), 0);
-    auto low = std::lower_bound(begin, end, val, ObjectTypeDeclMapTypeCmp);
-    if (low == end)
-      return -1;
-    if (recordDecl == low->first)
-      return low->second;
-    else
+    auto found = m_objectTypeDeclsMap.find(recordDecl);
+    if (found == m_objectTypeDeclsMap.end())
       return -1;
+    return found->second;
   }
 
-  // Adds all built-in HLSL object types.
-  void AddObjectTypes()
+  /// <summary>Gets the declaration for a built-in HLSL object type, creating it on first use.</summary>
+  CXXRecordDecl* GetOrCreateObjectTypeDecl(unsigned index)
   {
     DXASSERT(m_context != nullptr, "otherwise caller hasn't initialized context yet");
-
-    QualType float4Type = LookupVectorType(HLSLScalarType_float, 4);
-    TypeSourceInfo *float4TypeSourceInfo = m_context->getTrivialTypeSourceInfo(float4Type, NoLoc);
-    m_objectTypeLazyInitMask = 0;
-    unsigned effectKindIndex = 0;
-    for (int i = 0; i < _countof(g_ArBasicKindsAsTypes); i++)
+    DXASSERT_NOMSG(index < _countof(g_ArBasicKindsAsTypes));
+    if (m_objectTypeDecls[index] != nullptr)
+      return m_objectTypeDecls[index];
+
+    ArBasicKind kind = g_ArBasicKindsAsTypes[index];
+    DXASSERT(kind != AR_OBJECT_WAVE, "wave objects are currently unused");
+    DXASSERT(kind < _countof(g_ArBasicTypeNames), "g_ArBasicTypeNames has the wrong number of entries");
+    _Analysis_assume_(kind < _countof(g_ArBasicTypeNames));
+    const char* typeName = g_ArBasicTypeNames[kind];
+    uint8_t templateArgCount = g_ArBasicKindsTemplateCount[index];
+    CXXRecordDecl* recordDecl = nullptr;
+    if (templateArgCount == 0)
     {
-      ArBasicKind kind = g_ArBasicKindsAsTypes[i];
-      if (kind == AR_OBJECT_WAVE) { // wave objects are currently unused
-        continue;
-      }
-      if (kind == AR_OBJECT_LEGACY_EFFECT)
-        effectKindIndex = i;
+      AddRecordTypeWithHandle(*m_context, &recordDecl, typeName);
+      DXASSERT(recordDecl != nullptr, "AddRecordTypeWithHandle failed to return the object declaration");
+      recordDecl->setImplicit(true);
+    }
+    else
+    {
+      DXASSERT(templateArgCount == 1 || templateArgCount == 2, "otherwise a new case has been added");
 
-      DXASSERT(kind < _countof(g_ArBasicTypeNames), "g_ArBasicTypeNames has the wrong number of entries");
-      _Analysis_assume_(kind < _countof(g_ArBasicTypeNames));
-      const char* typeName = g_ArBasicTypeNames[kind];
-      uint8_t templateArgCount = g_ArBasicKindsTemplateCount[i];
-      CXXRecordDecl* recordDecl = nullptr;
-      if (templateArgCount == 0)
-      {
-        AddRecordTypeWithHandle(*m_context, &recordDecl, typeName);
-        DXASSERT(recordDecl != nullptr, "AddRecordTypeWithHandle failed to return the object declaration");
-        recordDecl->setImplicit(true);
+      ClassTemplateDecl* typeDecl = nullptr;
+      TypeSourceInfo* typeDefault = nullptr;
+      if (TemplateHasDefaultType(kind)) {
+        QualType float4Type = LookupVectorType(HLSLScalarType_float, 4);
+        typeDefault = m_context->getTrivialTypeSourceInfo(float4Type, NoLoc);
       }
-      else
-      {
-        DXASSERT(templateArgCount == 1 || templateArgCount == 2, "otherwise a new case has been added");
+      AddTemplateTypeWithHandle(*m_context, &typeDecl, &recordDecl, typeName, templateArgCount, typeDefault);
+      DXASSERT(typeDecl != nullptr, "AddTemplateTypeWithHandle failed to return the object declaration");
+      typeDecl->setImplicit(true);
+      recordDecl->setImplicit(true);
+    }
+    m_objectTypeDecls[index] = recordDecl;
+    m_objectTypeDeclsMap[recordDecl] = index;
+    m_objectTypeLazyInitMask |= ((uint64_t)1)<<index;
 
-        ClassTemplateDecl* typeDecl = nullptr;
-        TypeSourceInfo* typeDefault = TemplateHasDefaultType(kind) ? float4TypeSourceInfo : nullptr;
-        AddTemplateTypeWithHandle(*m_context, &typeDecl, &recordDecl, typeName, templateArgCount, typeDefault);
-        DXASSERT(typeDecl != nullptr, "AddTemplateTypeWithHandle failed to return the object declaration");
-        typeDecl->setImplicit(true);
-        recordDecl->setImplicit(true);
-      }
-      m_objectTypeDecls[i] = recordDecl;
-      m_objectTypeDeclsMap[i] = std::make_pair(recordDecl, i);
-      m_objectTypeLazyInitMask |= ((uint64_t)1)<<i;
+    // Methods from extension tables are added along with the type, as
+    // builtin methods are added on first use.
+    for (auto && intrinsic : m_intrinsicTables) {
+      AddIntrinsicTableMethods(intrinsic, index);
+    }
+    return recordDecl;
+  }
+
+  /// <summary>Gets the declaration for a deprecated effect object type, creating it on first use.</summary>
+  CXXRecordDecl* GetOrCreateDeprecatedEffectObjectDecl(unsigned index)
+  {
+    DXASSERT_NOMSG(index < _countof(g_DeprecatedEffectObjectNames));
+    CXXRecordDecl* effectObjDecl = m_deprecatedEffectObjectDecls[index];
+    if (effectObjDecl == nullptr) {
+      DeclContext* currentDeclContext = m_context->getTranslationUnitDecl();
+      IdentifierInfo& idInfo = m_context->Idents.get(StringRef(g_DeprecatedEffectObjectNames[index]), tok::TokenKind::identifier);
+      effectObjDecl = CXXRecordDecl::Create(*m_context, TagTypeKind::TTK_Struct, currentDeclContext, NoLoc, NoLoc, &idInfo);
+      currentDeclContext->addDecl(effectObjDecl);
+      effectObjDecl->setImplicit(true);
+      m_deprecatedEffectObjectDecls[index] = effectObjDecl;
+      m_objectTypeDeclsMap[effectObjDecl] = GetBuiltinObjectIndex().KindIndices[AR_OBJECT_LEGACY_EFFECT];
     }
+    return effectObjDecl;
+  }
 
-    // Create an alias for SamplerState. 'sampler' is very commonly used.
-    {
+  /// <summary>Gets the 'sampler' alias for SamplerState, creating it on first use.</summary>
+  TypedefDecl* GetOrCreateSamplerTypedef()
+  {
+    if (m_samplerTypedef == nullptr) {
+      // 'sampler' is very commonly used.
       DeclContext* currentDeclContext = m_context->getTranslationUnitDecl();
       IdentifierInfo& samplerId = m_context->Idents.get(StringRef("sampler"), tok::TokenKind::identifier);
       TypeSourceInfo* samplerTypeSource = m_context->getTrivialTypeSourceInfo(GetBasicKindType(AR_OBJECT_SAMPLER));
-      TypedefDecl* samplerDecl = TypedefDecl::Create(*m_context, currentDeclContext, NoLoc, NoLoc, &samplerId, samplerTypeSource);
-      currentDeclContext->addDecl(samplerDecl);
-      samplerDecl->setImplicit(true);
-
-      // Create decls for each deprecated effect object type:
-      unsigned effectObjBase = _countof(g_ArBasicKindsAsTypes);
-      // TypeSourceInfo* effectObjTypeSource = m_context->getTrivialTypeSourceInfo(GetBasicKindType(AR_OBJECT_LEGACY_EFFECT));
-      for (int i = 0; i < _countof(g_DeprecatedEffectObjectNames); i++) {
-        IdentifierInfo& idInfo = m_context->Idents.get(StringRef(g_DeprecatedEffectObjectNames[i]), tok::TokenKind::identifier);
-        //TypedefDecl* effectObjDecl = TypedefDecl::Create(*m_context, currentDeclContext, NoLoc, NoLoc, &idInfo, effectObjTypeSource);
-        CXXRecordDecl *effectObjDecl = CXXRecordDecl::Create(*m_context, TagTypeKind::TTK_Struct, currentDeclContext, NoLoc, NoLoc, &idInfo);
-        currentDeclContext->addDecl(effectObjDecl);
-        effectObjDecl->setImplicit(true);
-        m_objectTypeDeclsMap[i+effectObjBase] = std::make_pair(effectObjDecl, effectKindIndex);
-      }
+      m_samplerTypedef = TypedefDecl::Create(*m_context, currentDeclContext, NoLoc, NoLoc, &samplerId, samplerTypeSource);
+      currentDeclContext->addDecl(m_samplerTypedef);
+      m_samplerTypedef->setImplicit(true);
     }
+    return m_samplerTypedef;
+  }
 
-    // Make sure it's in order.
-    std::sort(m_objectTypeDeclsMap.begin(), m_objectTypeDeclsMap.end(), ObjectTypeDeclMapTypeCmp);
+  /// <summary>Creates the built-in object type declared with the given name, if any.</summary>
+  /// <returns>true if name is a built-in object type, which has been declared in the translation unit.</returns>
+  bool DeclareBuiltinObjectTypeByName(StringRef name)
+  {
+    const BuiltinObjectIndex& objectIndex = GetBuiltinObjectIndex();
+    auto found = objectIndex.Names.find(name);
+    if (found == objectIndex.Names.end())
+      return false;
+
+    unsigned index = found->second;
+    if (index < _countof(g_ArBasicKindsAsTypes)) {
+      GetOrCreateObjectTypeDecl(index);
+    }
+    else if (index < BuiltinObjectIndex::SamplerAliasIndex) {
+      GetOrCreateDeprecatedEffectObjectDecl(index - _countof(g_ArBasicKindsAsTypes));
+    }
+    else {
+      GetOrCreateSamplerTypedef();
+    }
+    return true;
   }
 
   FunctionDecl* AddSubscriptSpecialization(
@@ -2918,6 +3068,10 @@ public:
     memset(m_matrixShorthandTypes, 0, sizeof(m_matrixShorthandTypes));
     memset(m_vectorTypes, 0, sizeof(m_vectorTypes));
     memset(m_vectorTypedefs, 0, sizeof(m_vectorTypedefs));
+    memset(m_objectTypeDecls, 0, sizeof(m_objectTypeDecls));
+    memset(m_deprecatedEffectObjectDecls, 0, sizeof(m_deprecatedEffectObjectDecls));
+    m_samplerTypedef = nullptr;
+    m_objectTypeLazyInitMask = 0;
   }
 
   ~HLSLExternalSource() { }
@@ -2938,11 +3092,9 @@ public:
     m_sema = &S;
     S.addExternalSource(this);
 
-    AddObjectTypes();
+    // Object types are declared on first lookup (see LookupUnqualified), and
+    // get their extension table methods then.
     AddStdIsEqualImplementation(S.getASTContext(), S);
-    for (auto && intrinsic : m_intrinsicTables) {
-      AddIntrinsicTableMethods(intrinsic);
-    }
   }
 
   void ForgetSema() override
@@ -2983,6 +3135,11 @@ public:
     }
 
     StringRef nameIdentifier = idInfo->getName();
+    if (DeclareBuiltinObjectTypeByName(nameIdentifier)) {
+      // Now declared; look it up as if it had always been there.
+      return m_sema->LookupQualifiedName(R, m_context->getTranslationUnitDecl());
+    }
+
     HLSLScalarType parsedType;
     int rowCount;
     int colCount;
@@ -3214,38 +3371,44 @@ public:
     return AR_BASIC_UNKNOWN;
   }
 
-  void AddIntrinsicTableMethods(_In_ IDxcIntrinsicTable *table) {
+  void AddIntrinsicTableMethods(_In_ IDxcIntrinsicTable *table, unsigned index) {
     DXASSERT_NOMSG(table != nullptr);
 
-    // Function intrinsics are added on-demand, objects get template methods.
-    for (int i = 0; i < _countof(g_ArBasicKindsAsTypes); i++) {
-      // Grab information already processed by AddObjectTypes.
-      ArBasicKind kind = g_ArBasicKindsAsTypes[i];
-      const char *typeName = g_ArBasicTypeNames[kind];
-      uint8_t templateArgCount = g_ArBasicKindsTemplateCount[i];
-      DXASSERT(0 <= templateArgCount && templateArgCount <= 2,
-        "otherwise a new case has been added");
-      int startDepth = (templateArgCount == 0) ? 0 : 1;
-      CXXRecordDecl *recordDecl = m_objectTypeDecls[i];
-      if (recordDecl == nullptr) {
-        DXASSERT(kind == AR_OBJECT_WAVE, "else objects other than reserved not initialized");
-        continue;
-      }
+    // Grab information already processed by GetOrCreateObjectTypeDecl.
+    ArBasicKind kind = g_ArBasicKindsAsTypes[index];
+    const char *typeName = g_ArBasicTypeNames[kind];
+    uint8_t templateArgCount = g_ArBasicKindsTemplateCount[index];
+    DXASSERT(0 <= templateArgCount && templateArgCount <= 2,
+      "otherwise a new case has been added");
+    int startDepth = (templateArgCount == 0) ? 0 : 1;
+    CXXRecordDecl *recordDecl = m_objectTypeDecls[index];
+    DXASSERT(recordDecl != nullptr, "otherwise object type is not declared yet");
+
+    // This is a variation of AddObjectMethods using the new table.
+    const HLSL_INTRINSIC *pIntrinsic = nullptr;
+    const HLSL_INTRINSIC *pPrior = nullptr;
+    UINT64 lookupCookie = 0;
+    CA2W wideTypeName(typeName);
+    HRESULT found = table->LookupIntrinsic(wideTypeName, L"*", &pIntrinsic, &lookupCookie);
+    while (pIntrinsic != nullptr && SUCCEEDED(found)) {
+      if (!AreIntrinsicTemplatesEquivalent(pIntrinsic, pPrior)) {
+        AddObjectIntrinsicTemplate(recordDecl, startDepth, pIntrinsic);
+        // NOTE: this only works with the current implementation because
+        // intrinsics are alive as long as the table is alive.
+        pPrior = pIntrinsic;
+      }
+      found = table->LookupIntrinsic(wideTypeName, L"*", &pIntrinsic, &lookupCookie);
+    }
+  }
 
-      // This is a variation of AddObjectMethods using the new table.
-      const HLSL_INTRINSIC *pIntrinsic = nullptr;
-      const HLSL_INTRINSIC *pPrior = nullptr;
-      UINT64 lookupCookie = 0;
-      CA2W wideTypeName(typeName);
-      HRESULT found = table->LookupIntrinsic(wideTypeName, L"*", &pIntrinsic, &lookupCookie);
-      while (pIntrinsic != nullptr && SUCCEEDED(found)) {
-        if (!AreIntrinsicTemplatesEquivalent(pIntrinsic, pPrior)) {
-          AddObjectIntrinsicTemplate(recordDecl, startDepth, pIntrinsic);
-          // NOTE: this only works with the current implementation because
-          // intrinsics are alive as long as the table is alive.
-          pPrior = pIntrinsic;
-        }
-        found = table->LookupIntrinsic(wideTypeName, L"*", &pIntrinsic, &lookupCookie);
+  void AddIntrinsicTableMethods(_In_ IDxcIntrinsicTable *table) {
+    DXASSERT_NOMSG(table != nullptr);
+
+    // Function intrinsics are added on-demand, objects get template methods
+    // when they are declared; catch up on objects declared already.
+    for (unsigned i = 0; i < _countof(g_ArBasicKindsAsTypes); i++) {
+      if (m_objectTypeDecls[i] != nullptr) {
+        AddIntrinsicTableMethods(table, i);
       }
     }
   }
@@ -3253,10 +3416,9 @@ public:
   void RegisterIntrinsicTable(_In_ IDxcIntrinsicTable *table) {
     DXASSERT_NOMSG(table != nullptr);
     m_intrinsicTables.push_back(table);
-    // If already initialized, add methods immediately.
-    if (m_sema != nullptr) {
-      AddIntrinsicTableMethods(table);
-    }
+    // Add methods to object types already declared; others get them when
+    // they are declared.
+    AddIntrinsicTableMethods(table);
   }
 
   HLSLScalarType ScalarTypeForBasic(ArBasicKind kind)
@@ -3358,10 +3520,9 @@ public:
     case AR_OBJECT_CONSUME_STRUCTURED_BUFFER:
     case AR_OBJECT_WAVE:
     {
-        const ArBasicKind* match = std::find(g_ArBasicKindsAsTypes, &g_ArBasicKindsAsTypes[_countof(g_ArBasicKindsAsTypes)], kind);
-        DXASSERT(match != &g_ArBasicKindsAsTypes[_countof(g_ArBasicKindsAsTypes)], "otherwise can't find constant in basic kinds");
-        size_t index = match - g_ArBasicKindsAsTypes;
-        return m_context->getTagDeclType(this->m_objectTypeDecls[index]);
+        unsigned index = GetBuiltinObjectIndex().KindIndices[kind];
+        DXASSERT(index != BuiltinObjectIndex::NoIndex, "otherwise can't find constant in basic kinds");
+        return m_context->getTagDeclType(GetOrCreateObjectTypeDecl(index));
     }
 
     case AR_OBJECT_SAMPLER1D:
@@ -3479,23 +3640,9 @@ public:
     StringRef nameIdentifier,
     size_t argumentCount)
   {
-    // TODO: avoid linear scan
-    for (unsigned int i = 0; i < tableSize; i++) {
-      const HLSL_INTRINSIC* pIntrinsic = &table[i];
-
-      // Do some quick checks to verify size and name.
-      if (pIntrinsic->uNumArgs != 1 + argumentCount) {
-        continue;
-      }
-      if (!nameIdentifier.equals(StringRef(pIntrinsic->pArgs[0].pName))) {
-        continue;
-      }
-
-      return IntrinsicDefIter::CreateStart(table, tableSize, pIntrinsic,
-        IntrinsicTableDefIter::CreateStart(m_intrinsicTables, typeName, nameIdentifier, argumentCount));
-    }
-
-    return IntrinsicDefIter::CreateStart(table, tableSize, table + tableSize,
+    size_t first = GetIntrinsicTableIndex(table).Find(
+      nameIdentifier, 1 + argumentCount, tableSize);
+    return IntrinsicDefIter::CreateStart(table, tableSize, table + first,
       IntrinsicTableDefIter::CreateStart(m_intrinsicTables, typeName, nameIdentifier, argumentCount));
   }
 
@@ -0,0 +1,26 @@
+// RUN: %dxc -E main -T ps_6_0 %s | FileCheck %s
+
+// Adjacent raw buffer loads and structured buffer field loads are merged
+// into one bufferLoad each.
+
+// CHECK: call %dx.types.ResRet.i32 @dx.op.bufferLoad.i32(i32 68
+// CHECK-NOT: @dx.op.bufferLoad.i32(i32 68
+// CHECK: call %dx.types.ResRet.f32 @dx.op.bufferLoad.f32(i32 68
+// CHECK-NOT: @dx.op.bufferLoad
+// CHECK: ret void
+
+struct S {
+  float a;
+  float b;
+  float2 c;
+};
+
+ByteAddressBuffer raw;
+StructuredBuffer<S> sb;
+
+float4 main(uint i : IDX) : SV_Target {
+  uint base = i * 16;
+  uint x = raw.Load(base) + raw.Load(base + 4) + raw.Load2(base + 8).y;
+  float y = sb[i].a * sb[i].b + sb[i].c.y;
+  return float4(x, y, 0, 0);
+}
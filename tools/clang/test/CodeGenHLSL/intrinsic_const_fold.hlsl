@@ -0,0 +1,21 @@
+// RUN: %dxc -E main -T ps_6_0 %s | FileCheck %s
+
+// Intrinsics with immediate operands are evaluated during code generation.
+
+// CHECK-NOT: @dx.op.legacyF32ToF16
+// CHECK-NOT: @dx.op.dot
+// CHECK: dx.op.storeOutput.f32(i32 5, i32 0, i32 0, i8 0, float 3.700000e+01)
+// CHECK: dx.op.storeOutput.f32(i32 5, i32 0, i32 0, i8 1, float 2.750000e+00)
+// CHECK: dx.op.storeOutput.f32(i32 5, i32 0, i32 0, i8 2, float 2.500000e+00)
+// CHECK: dx.op.storeOutput.f32(i32 5, i32 0, i32 0, i8 3, float 1.536700e+04)
+
+float4 main() : SV_Target {
+  // 32 + 5
+  float x = dot(float3(1, 2, 3), float3(4, 5, 6)) + length(float2(3, 4));
+  // frac is x - floor(x); round is to nearest even.
+  float y = frac(-0.25f) + round(2.5f);
+  float z = saturate(-1.5f) + lerp(2.0f, 4.0f, 0.25f);
+  // 0x3c00 + 4 + 3
+  uint w = f32tof16(1.0f) + countbits(0xF0u) + firstbitlow(8u);
+  return float4(x, y, z, w);
+}
@@ -0,0 +1,27 @@
+// RUN: %dxc -E main -T cs_6_0 %s | FileCheck %s
+
+// The cbuffer row and the SRV element are read once, even though the barrier
+// and UAV stores in between keep GVN from reusing them. Only the UAV is read
+// again after the barrier.
+
+// CHECK: call %dx.types.CBufRet.f32 @dx.op.cbufferLoadLegacy.f32(i32 59
+// CHECK-NOT: @dx.op.cbufferLoadLegacy.f32(i32 59
+// CHECK: call void @dx.op.barrier
+// CHECK: call %dx.types.ResRet.f32 @dx.op.bufferLoad.f32(i32 68
+// CHECK-NOT: @dx.op.bufferLoad.f32(i32 68
+// CHECK: ret void
+
+cbuffer C {
+  uint idx;
+  float scale;
+};
+
+Buffer<float> src;
+RWBuffer<float> dst;
+
+[numthreads(8, 1, 1)]
+void main(uint id : SV_DispatchThreadID) {
+  dst[id] = src[id] * scale + dst[idx];
+  GroupMemoryBarrierWithGroupSync();
+  dst[id + idx] = src[id] * scale + dst[idx];
+}
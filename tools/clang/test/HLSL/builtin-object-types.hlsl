@@ -0,0 +1,58 @@
+// RUN: %clang_cc1 -fsyntax-only -ffreestanding -verify %s
+
+// __decltype is the GCC way of saying 'decltype', but doesn't require C++11
+// _Static_assert is the C11 way of saying 'static_assert', but doesn't require C++11
+#ifdef VERIFY_FXC
+#define _Static_assert(a,b,c) ;
+#endif
+
+// Built-in object types are declared in the translation unit the first time
+// their name is looked up, or the first time the compiler needs the type.
+// Every use must bind to that one declaration, and user types declared in
+// a namespace may shadow a built-in name whether or not it is declared yet.
+
+// expected-no-diagnostics
+
+// Shadows Buffer before anything has looked it up.
+namespace before_lookup {
+  struct Buffer { float4 value; };
+  float4 get(Buffer b) { return b.value; }
+}
+
+// 'sampler' declares SamplerState as its target type, before SamplerState
+// itself is looked up by name.
+sampler g_sampler;
+SamplerState g_samplerState;
+Texture2D<float4> g_texture;
+Buffer<float4> g_buffer;
+RWStructuredBuffer<float4> g_output;
+
+// Shadows Texture2D and RWStructuredBuffer after they have been looked up.
+namespace after_lookup {
+  struct Texture2D { float4 value; };
+  struct RWStructuredBuffer { float4 value; };
+  float4 get(Texture2D t, RWStructuredBuffer b) { return t.value + b.value; }
+}
+
+// Looked up again after being shadowed.
+Texture2D g_texture_default;
+
+float4 sample_with(SamplerState s, float2 uv) {
+  return g_texture.Sample(s, uv);
+}
+
+float4 main(float2 uv : TEXCOORD0) : SV_Target {
+  _Static_assert(std::is_same<sampler, SamplerState>::value, "");
+  _Static_assert(std::is_same<SamplerState, __decltype(g_sampler)>::value, "");
+  _Static_assert(!std::is_same<before_lookup::Buffer, __decltype(g_buffer)>::value, "");
+  _Static_assert(!std::is_same<after_lookup::Texture2D, __decltype(g_texture)>::value, "");
+
+  before_lookup::Buffer b;
+  b.value = g_buffer[0];
+  after_lookup::Texture2D t;
+  t.value = g_texture_default.Sample(g_samplerState, uv);
+  after_lookup::RWStructuredBuffer rw;
+  rw.value = g_output[0];
+  g_output[0] = before_lookup::get(b);
+  return after_lookup::get(t, rw) + sample_with(g_sampler, uv);
+}
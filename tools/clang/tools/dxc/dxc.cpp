@@ -57,9 +57,17 @@
 #include "llvm/Option/ArgList.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/StringSaver.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/Path.h"
 #include <dia2.h>
+#include <d3d12shader.h>
 #include <comdef.h>
 #include <algorithm>
+#include <atomic>
+#include <memory>
+#include <thread>
 #include <unordered_map>
 
 inline bool wcseq(LPCWSTR a, LPCWSTR b) {
@@ -76,8 +84,10 @@ class DxcContext {
 private:
   DxcOpts &m_Opts;
   DxcDllSupport &m_dxcSupport;
+  std::string *m_pDiagnostics; // When set, diagnostics are captured here rather than written to the console.
 
   int ActOnBlob(IDxcBlob *pBlob);
+  void WriteOperationErrors(IDxcOperationResult *pResult);
   void UpdatePart(IDxcBlob *pBlob, IDxcBlob **ppResult);
   bool UpdatePartRequired();
   void WriteHeader(IDxcBlobEncoding *pDisassembly, IDxcBlob *pCode,
@@ -89,10 +99,12 @@ private:
   HRESULT FindModuleBlob(hlsl::DxilFourCC fourCC, IDxcBlob *pSource, IDxcLibrary *pLibrary, IDxcBlob **ppTargetBlob);
   void ExtractRootSignature(IDxcBlob *pBlob, IDxcBlob **ppResult);
   int VerifyRootSignature();
+  void WriteCostReport(IDxcBlob *pBlob);
 
 public:
-  DxcContext(DxcOpts &Opts, DxcDllSupport &dxcSupport)
-      : m_Opts(Opts), m_dxcSupport(dxcSupport) {}
+  DxcContext(DxcOpts &Opts, DxcDllSupport &dxcSupport,
+             std::string *pDiagnostics = nullptr)
+      : m_Opts(Opts), m_dxcSupport(dxcSupport), m_pDiagnostics(pDiagnostics) {}
 
   int  Compile();
   void Recompile(IDxcBlob *pSource, IDxcLibrary *pLibrary, IDxcCompiler *pCompiler, std::vector<LPCWSTR> &args, IDxcOperationResult **pCompileResult);
@@ -179,11 +191,16 @@ int DxcContext::ActOnBlob(IDxcBlob *pBlob) {
     WritePartToFile(pBlob, hlsl::DFCC_PrivateData, m_Opts.ExtractPrivateFile);
   }
 
+  // Write instruction statistics and cost estimate.
+  if (!m_Opts.CostReport.empty() && !m_Opts.IsRootSignatureProfile()) {
+    WriteCostReport(pBlob);
+  }
+
   // OutputObject suppresses console dump.
   bool needDisassembly =
       !m_Opts.OutputHeader.empty() || !m_Opts.AssemblyCode.empty() ||
       (m_Opts.OutputObject.empty() && m_Opts.DebugFile.empty() &&
-       m_Opts.ExtractPrivateFile.empty() &&
+       m_Opts.ExtractPrivateFile.empty() && m_Opts.CostReport.empty() &&
        m_Opts.VerifyRootSignatureSource.empty() && !m_Opts.ExtractRootSignature);
 
   bool isRootSigProfile = m_Opts.IsRootSignatureProfile();
@@ -272,7 +289,7 @@ void DxcContext::UpdatePart(IDxcBlob *pSource, IDxcBlob **ppResult) {
     }
   }
   else {
-    WriteOperationErrorsToConsole(pBuilderResult, m_Opts.OutputWarnings);
+    WriteOperationErrors(pBuilderResult);
   }
   HRESULT status;
   IFT(pBuilderResult->GetStatus(&status));
@@ -280,6 +297,24 @@ void DxcContext::UpdatePart(IDxcBlob *pSource, IDxcBlob **ppResult) {
   IFT(pBuilderResult->GetResult(ppResult));
 }
 
+void DxcContext::WriteOperationErrors(IDxcOperationResult *pResult) {
+  if (m_pDiagnostics == nullptr) {
+    WriteOperationErrorsToConsole(pResult, m_Opts.OutputWarnings);
+    return;
+  }
+
+  HRESULT status;
+  IFT(pResult->GetStatus(&status));
+  if (FAILED(status) || m_Opts.OutputWarnings) {
+    CComPtr<IDxcBlobEncoding> pErrors;
+    IFT(pResult->GetErrorBuffer(&pErrors));
+    if (pErrors.p != nullptr) {
+      m_pDiagnostics->append((const char *)pErrors->GetBufferPointer(),
+                             pErrors->GetBufferSize());
+    }
+  }
+}
+
 bool DxcContext::UpdatePartRequired() {
   return m_Opts.StripDebug || m_Opts.StripPrivate ||
     m_Opts.StripRootSignature || !m_Opts.PrivateSource.empty() ||
@@ -408,6 +443,66 @@ int DxcContext::VerifyRootSignature() {
   }
 }
 
+// Writes the instruction statistics from shader reflection, followed by the
+// estimated cost of each basic block.
+void DxcContext::WriteCostReport(IDxcBlob *pBlob) {
+  CComPtr<IDxcContainerReflection> pReflection;
+  CComPtr<ID3D12ShaderReflection> pShaderReflection;
+  CComPtr<IDxcShaderCostReflection> pCostReflection;
+  UINT32 partIndex;
+  IFT(m_dxcSupport.CreateInstance(CLSID_DxcContainerReflection, &pReflection));
+  IFT(pReflection->Load(pBlob));
+  IFT(pReflection->FindFirstPartKind(hlsl::DFCC_DXIL, &partIndex));
+  IFT(pReflection->GetPartReflection(partIndex, __uuidof(ID3D12ShaderReflection),
+                                     (void **)&pShaderReflection));
+  IFT(pShaderReflection.QueryInterface(&pCostReflection));
+
+  D3D12_SHADER_DESC desc;
+  IFT(pShaderReflection->GetDesc(&desc));
+  std::string report;
+  llvm::raw_string_ostream OS(report);
+  OS << "; Instruction statistics\n"
+     << "InstructionCount            " << desc.InstructionCount << "\n"
+     << "FloatInstructionCount       " << desc.FloatInstructionCount << "\n"
+     << "IntInstructionCount         " << desc.IntInstructionCount << "\n"
+     << "UintInstructionCount        " << desc.UintInstructionCount << "\n"
+     << "BitwiseInstructionCount     " << pShaderReflection->GetBitwiseInstructionCount() << "\n"
+     << "ConversionInstructionCount  " << pShaderReflection->GetConversionInstructionCount() << "\n"
+     << "MovcInstructionCount        " << pShaderReflection->GetMovcInstructionCount() << "\n"
+     << "TextureNormalInstructions   " << desc.TextureNormalInstructions << "\n"
+     << "TextureLoadInstructions     " << desc.TextureLoadInstructions << "\n"
+     << "TextureCompInstructions     " << desc.TextureCompInstructions << "\n"
+     << "TextureBiasInstructions     " << desc.TextureBiasInstructions << "\n"
+     << "TextureGradientInstructions " << desc.TextureGradientInstructions << "\n"
+     << "TextureStoreInstructions    " << desc.cTextureStoreInstructions << "\n"
+     << "InterlockedInstructions     " << desc.cInterlockedInstructions << "\n"
+     << "BarrierInstructions         " << desc.cBarrierInstructions << "\n"
+     << "StaticFlowControlCount      " << desc.StaticFlowControlCount << "\n"
+     << "DynamicFlowControlCount     " << desc.DynamicFlowControlCount << "\n"
+     << "TempArrayCount              " << desc.TempArrayCount << "\n"
+     << "ArrayInstructionCount       " << desc.ArrayInstructionCount << "\n"
+     << "EmitInstructionCount        " << desc.EmitInstructionCount << "\n"
+     << "CutInstructionCount         " << desc.CutInstructionCount << "\n";
+
+  UINT64 estimatedCost;
+  UINT32 blockCount;
+  IFT(pCostReflection->GetEstimatedCost(&estimatedCost));
+  IFT(pCostReflection->GetBlockCount(&blockCount));
+  OS << "\n; Estimated cost " << estimatedCost << "\n"
+     << "; function, block, instructions, loop depth, executions, cost\n";
+  for (UINT32 i = 0; i < blockCount; ++i) {
+    DxcShaderBlockCost block;
+    IFT(pCostReflection->GetBlockCost(i, &block));
+    OS << block.FunctionName << ", " << i << ", " << block.InstructionCount
+       << ", " << block.LoopDepth << ", " << block.ExecutionCount << ", "
+       << block.Cost << "\n";
+  }
+  OS.flush();
+
+  hlsl::WriteBinaryFile(StringRefUtf16(m_Opts.CostReport), report.data(),
+                        report.size());
+}
+
 class DxcIncludeHandlerForInjectedSources : public IDxcIncludeHandler {
 private:
   DXC_MICROCOM_REF_FIELD(m_dwRef)
@@ -611,6 +706,8 @@ int DxcContext::Compile() {
 
     if (m_Opts.AstDump)
       args.push_back(L"-ast-dump");
+    if (!m_Opts.TimeReportFile.empty() && !m_Opts.TimeReport)
+      args.push_back(L"-time_report");
 
     CComPtr<IDxcLibrary> pLibrary;
     IFT(m_dxcSupport.CreateInstance(CLSID_DxcLibrary, &pLibrary));
@@ -646,7 +743,18 @@ int DxcContext::Compile() {
     WriteBlobToFile(pErrors, m_Opts.OutputWarningsFile);
   }
   else {
-    WriteOperationErrorsToConsole(pCompileResult, m_Opts.OutputWarnings);
+    WriteOperationErrors(pCompileResult);
+  }
+
+  // The report is written for failed compiles too, as they may be slow.
+  if (!m_Opts.TimeReportFile.empty()) {
+    CComPtr<IDxcCompileTimeReport> pTimeReport;
+    CComPtr<IDxcBlobEncoding> pReport;
+    if (SUCCEEDED(pCompileResult.QueryInterface(&pTimeReport)))
+      IFT(pTimeReport->GetTimeReport(&pReport));
+    IFTBOOLMSG(pReport != nullptr, E_FAIL,
+               "no time report was produced for this compile");
+    WriteBlobToFile(pReport, m_Opts.TimeReportFile);
   }
 
   HRESULT status;
@@ -676,6 +784,13 @@ void DxcContext::Preprocess() {
   CComPtr<IDxcBlobEncoding> pSource;
   std::vector<LPCWSTR> args;
 
+  // Forward core options such as /I, /Yc and /Yu.
+  std::vector<std::wstring> argStrings;
+  CopyArgsToWStrings(m_Opts.Args, CoreOption, argStrings);
+  args.reserve(argStrings.size());
+  for (const std::wstring &a : argStrings)
+    args.push_back(a.data());
+
   CComPtr<IDxcLibrary> pLibrary;
   CComPtr<IDxcIncludeHandler> pIncludeHandler;
   IFT(m_dxcSupport.CreateInstance(CLSID_DxcLibrary, &pLibrary));
@@ -812,6 +927,413 @@ HRESULT DxcContext::GetDxcDiaTable(IDxcLibrary *pLibrary, IDxcBlob *pTargetBlob,
   return S_OK;
 }
 
+// A single compilation read from a /batch file.
+struct DxcBatchJob {
+  unsigned Line;           // Line in the batch file, for diagnostics.
+  MainArgs ArgStrings;     // Backing storage for Opts.
+  DxcOpts Opts;
+  std::string Diagnostics; // Errors and warnings, reported in job order.
+  int Result = 0;
+};
+
+// Reads the jobs in a /batch file. Each line holds the arguments for one
+// compilation, as they would be given to dxc; blank lines and lines starting
+// with '#' are skipped. A job whose arguments don't parse records the error
+// and is not run.
+static void ReadBatchJobs(llvm::StringRef batchFile,
+                          std::vector<std::unique_ptr<DxcBatchJob>> &jobs) {
+  CComHeapPtr<BYTE> pData;
+  DWORD dataSize;
+  hlsl::ReadBinaryFile(StringRefUtf16(batchFile), (void **)&pData, &dataSize);
+  llvm::StringRef text((const char *)pData.m_pData, dataSize);
+  if (text.startswith("\xEF\xBB\xBF"))
+    text = text.drop_front(3);
+
+  llvm::BumpPtrAllocator alloc;
+  llvm::BumpPtrStringSaver saver(alloc);
+  llvm::SmallVector<const char *, 64> tokens;
+  llvm::cl::TokenizeWindowsCommandLine(text, saver, tokens, /*MarkEOLs*/ true);
+  tokens.push_back(nullptr);
+
+  const OptTable *optionTable = getHlslOptTable();
+  unsigned line = 1;
+  std::vector<llvm::StringRef> lineArgs;
+  for (const char *token : tokens) {
+    if (token != nullptr) {
+      lineArgs.push_back(token);
+      continue;
+    }
+    if (!lineArgs.empty() && !lineArgs.front().startswith("#")) {
+      std::unique_ptr<DxcBatchJob> job(new DxcBatchJob());
+      job->Line = line;
+      job->ArgStrings = MainArgs(lineArgs);
+
+      DxcOpts &opts = job->Opts;
+      llvm::raw_string_ostream errorStream(job->Diagnostics);
+      job->Result = ReadDxcOpts(optionTable, DxcFlags, job->ArgStrings, opts,
+                                errorStream);
+      if (job->Result == 0) {
+        // Each job writes its own files; console output from concurrent jobs
+        // would interleave, so only compilation to files is supported.
+        if (!opts.BatchFile.empty()) {
+          errorStream << "Batch files cannot be nested.";
+          job->Result = 1;
+        } else if (!opts.Preprocess.empty() || opts.DumpBin ||
+                   opts.AstDump || opts.OptDump ||
+                   !opts.VerifyRootSignatureSource.empty()) {
+          errorStream << "Only compilation is supported in a batch file.";
+          job->Result = 1;
+        } else if (opts.OutputObject.empty() && opts.OutputHeader.empty() &&
+                   opts.AssemblyCode.empty()) {
+          errorStream << "Batch jobs must write their output with /Fo, /Fh or /Fc.";
+          job->Result = 1;
+        }
+      }
+      if (opts.EntryPoint.empty() && !opts.RecompileFromBinary) {
+        opts.EntryPoint = "main";
+      }
+      errorStream.flush();
+      jobs.push_back(std::move(job));
+    }
+    lineArgs.clear();
+    ++line;
+  }
+}
+
+static void RunBatchJob(DxcBatchJob &job, DxcDllSupport &dxcSupport) {
+  if (job.Result != 0)
+    return;
+
+  try {
+    DxcContext context(job.Opts, dxcSupport, &job.Diagnostics);
+    job.Result = context.Compile();
+    return;
+  } catch (const ::hlsl::Exception &hlslException) {
+    const char *msg = hlslException.what();
+    if (msg != nullptr && *msg != '\0') {
+      job.Diagnostics += msg;
+    } else {
+      char printBuffer[64];
+      sprintf_s(printBuffer, _countof(printBuffer),
+                "Compilation failed : error code 0x%08x.", hlslException.hr);
+      job.Diagnostics += printBuffer;
+    }
+  } catch (std::bad_alloc &) {
+    job.Diagnostics += "Compilation failed - out of memory.";
+  } catch (...) {
+    job.Diagnostics += "Compilation failed - unknown error.";
+  }
+  job.Result = 1;
+}
+
+// Compiles every job in a /batch file with one loaded compiler library.
+// Threads take the next unstarted job as they finish, so long compilations
+// don't hold up short ones. Diagnostics are written in job order once all
+// jobs are done, so the output doesn't depend on scheduling.
+static int CompileBatch(const DxcOpts &batchOpts, DxcDllSupport &dxcSupport) {
+  std::vector<std::unique_ptr<DxcBatchJob>> jobs;
+  ReadBatchJobs(batchOpts.BatchFile, jobs);
+
+  unsigned threadCount = batchOpts.BatchThreads;
+  if (threadCount == 0)
+    threadCount = std::max(1u, std::thread::hardware_concurrency());
+  if (threadCount > jobs.size())
+    threadCount = std::max<unsigned>(1, jobs.size());
+
+  std::atomic<size_t> nextJob(0);
+  auto worker = [&]() {
+    for (;;) {
+      size_t i = nextJob.fetch_add(1);
+      if (i >= jobs.size())
+        return;
+      RunBatchJob(*jobs[i], dxcSupport);
+    }
+  };
+  std::vector<std::thread> threads;
+  for (unsigned i = 1; i < threadCount; ++i)
+    threads.emplace_back(worker);
+  worker();
+  for (std::thread &t : threads)
+    t.join();
+
+  unsigned failed = 0;
+  for (const std::unique_ptr<DxcBatchJob> &job : jobs) {
+    if (!job->Diagnostics.empty()) {
+      std::string header;
+      llvm::raw_string_ostream headerStream(header);
+      headerStream << batchOpts.BatchFile << "(" << job->Line << "): "
+                   << job->Opts.InputFile << "\n";
+      headerStream.flush();
+      WriteUtf8ToConsoleSizeT(header.data(), header.size(), STD_ERROR_HANDLE);
+      WriteUtf8ToConsoleSizeT(job->Diagnostics.data(), job->Diagnostics.size(),
+                              STD_ERROR_HANDLE);
+      if (job->Diagnostics.back() != '\n')
+        WriteUtf8ToConsoleSizeT("\n", 1, STD_ERROR_HANDLE);
+    }
+    if (job->Result != 0)
+      ++failed;
+  }
+  printf("Batch compilation: %u succeeded, %u failed.\n",
+         (unsigned)(jobs.size() - failed), failed);
+  return failed == 0 ? 0 : 1;
+}
+
+// A source file scanned by /M.
+struct DxcDependencyScanJob {
+  std::wstring InputFile;
+  std::vector<std::string> Files; // The source, then each file it includes.
+  std::string Diagnostics;        // Errors and warnings, reported in job order.
+  int Result = 0;
+};
+
+// Collects the .hlsl files under a directory and its subdirectories.
+static void FindSourceFiles(const std::wstring &dir,
+                            std::vector<std::wstring> &files) {
+  WIN32_FIND_DATAW findData;
+  HANDLE hFind = FindFirstFileW((dir + L"\\*").c_str(), &findData);
+  if (hFind == INVALID_HANDLE_VALUE)
+    return;
+  do {
+    std::wstring name(findData.cFileName);
+    if (findData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) {
+      if (name != L"." && name != L"..")
+        FindSourceFiles(dir + L"\\" + name, files);
+      continue;
+    }
+    if (name.size() > 5 &&
+        0 == _wcsicmp(name.c_str() + name.size() - 5, L".hlsl"))
+      files.push_back(dir + L"\\" + name);
+  } while (FindNextFileW(hFind, &findData));
+  FindClose(hFind);
+}
+
+static void RunDependencyScanJob(DxcDependencyScanJob &job,
+                                 const DxcOpts &opts,
+                                 const std::vector<LPCWSTR> &args,
+                                 DxcDllSupport &dxcSupport) {
+  try {
+    CComPtr<IDxcLibrary> pLibrary;
+    CComPtr<IDxcIncludeHandler> pIncludeHandler;
+    CComPtr<IDxcCompiler> pCompiler;
+    CComPtr<IDxcDependencyScanner> pScanner;
+    CComPtr<IDxcBlobEncoding> pSource;
+    CComPtr<IDxcOperationResult> pResult;
+    IFT(dxcSupport.CreateInstance(CLSID_DxcLibrary, &pLibrary));
+    IFT(pLibrary->CreateIncludeHandler(&pIncludeHandler));
+    IFT(dxcSupport.CreateInstance(CLSID_DxcCompiler, &pCompiler));
+    IFT(pCompiler.QueryInterface(&pScanner));
+    ReadFileIntoBlob(dxcSupport, job.InputFile.c_str(), &pSource);
+    IFT(pScanner->ScanDependencies(pSource, job.InputFile.c_str(),
+                                   const_cast<LPCWSTR *>(args.data()),
+                                   args.size(), opts.Defines.data(),
+                                   opts.Defines.size(), pIncludeHandler,
+                                   &pResult));
+
+    HRESULT status;
+    IFT(pResult->GetStatus(&status));
+    CComPtr<IDxcBlobEncoding> pErrors;
+    IFT(pResult->GetErrorBuffer(&pErrors));
+    if (pErrors.p != nullptr && (FAILED(status) || opts.OutputWarnings)) {
+      job.Diagnostics.append((const char *)pErrors->GetBufferPointer(),
+                             pErrors->GetBufferSize());
+    }
+    if (FAILED(status)) {
+      job.Result = 1;
+      return;
+    }
+
+    CComPtr<IDxcBlob> pList;
+    IFT(pResult->GetResult(&pList));
+    llvm::StringRef list((const char *)pList->GetBufferPointer(),
+                         pList->GetBufferSize());
+    llvm::SmallVector<llvm::StringRef, 16> lines;
+    list.split(lines, "\n", -1, /*KeepEmpty*/ false);
+    for (llvm::StringRef line : lines)
+      job.Files.push_back(line.str());
+    return;
+  } catch (const ::hlsl::Exception &hlslException) {
+    const char *msg = hlslException.what();
+    if (msg != nullptr && *msg != '\0') {
+      job.Diagnostics += msg;
+    } else {
+      char printBuffer[64];
+      sprintf_s(printBuffer, _countof(printBuffer),
+                "Dependency scan failed : error code 0x%08x.", hlslException.hr);
+      job.Diagnostics += printBuffer;
+    }
+  } catch (std::bad_alloc &) {
+    job.Diagnostics += "Dependency scan failed - out of memory.";
+  } catch (...) {
+    job.Diagnostics += "Dependency scan failed - unknown error.";
+  }
+  job.Result = 1;
+}
+
+static void WriteMakeFileName(llvm::raw_ostream &OS, llvm::StringRef name) {
+  for (char c : name) {
+    if (c == ' ' || c == '#')
+      OS << '\\';
+    else if (c == '$')
+      OS << '$';
+    OS << c;
+  }
+}
+
+static void WriteJsonString(llvm::raw_ostream &OS, llvm::StringRef value) {
+  OS << '"';
+  for (unsigned char c : value) {
+    if (c == '"' || c == '\\')
+      OS << '\\' << c;
+    else if (c < 0x20)
+      OS << llvm::format("\\u%04x", c);
+    else
+      OS << c;
+  }
+  OS << '"';
+}
+
+// Names the rule target for a scanned source: /MT or /Fo for a single input,
+// otherwise the source renamed to .cso, placed under the /Fo directory for a
+// directory input. The source itself is never the target, as make can't use
+// a rule whose target is also its own prerequisite.
+static std::string GetDependencyTarget(const DxcOpts &opts, bool bDirectory,
+                                       llvm::StringRef inputDir,
+                                       llvm::StringRef source) {
+  if (!bDirectory && !opts.DependencyTarget.empty())
+    return opts.DependencyTarget.str();
+  if (!bDirectory && !opts.OutputObject.empty())
+    return opts.OutputObject.str();
+
+  llvm::SmallString<128> target;
+  if (bDirectory && !opts.OutputObject.empty() && source.startswith(inputDir)) {
+    target = opts.OutputObject;
+    llvm::sys::path::append(target,
+                            source.substr(inputDir.size()).ltrim("\\/"));
+  } else {
+    target = source;
+  }
+  llvm::sys::path::replace_extension(target, ".cso");
+  return target.str();
+}
+
+// Lists the files included by the input without compiling it. When the input
+// is a directory, every .hlsl file under it is scanned, on one thread per
+// processor. Output is written in file name order, so it doesn't depend on
+// scheduling.
+static int ScanDependencies(const DxcOpts &opts, DxcDllSupport &dxcSupport) {
+  std::wstring input(StringRefUtf16(opts.InputFile));
+  std::vector<std::wstring> inputFiles;
+  DWORD attributes = GetFileAttributesW(input.c_str());
+  bool bDirectory = attributes != INVALID_FILE_ATTRIBUTES &&
+                    (attributes & FILE_ATTRIBUTE_DIRECTORY);
+  if (bDirectory) {
+    while (!input.empty() && (input.back() == L'\\' || input.back() == L'/'))
+      input.pop_back();
+    FindSourceFiles(input, inputFiles);
+    std::sort(inputFiles.begin(), inputFiles.end());
+  } else {
+    inputFiles.push_back(input);
+  }
+
+  std::string inputDir;
+  if (bDirectory)
+    inputDir = Unicode::UTF16ToUTF8StringOrThrow(input.c_str());
+
+  std::vector<std::unique_ptr<DxcDependencyScanJob>> jobs;
+  for (const std::wstring &inputFile : inputFiles) {
+    std::unique_ptr<DxcDependencyScanJob> job(new DxcDependencyScanJob());
+    job->InputFile = inputFile;
+    jobs.push_back(std::move(job));
+  }
+
+  // Include paths and other preprocessor options are passed through.
+  std::vector<std::wstring> argStrings;
+  CopyArgsToWStrings(opts.Args, CoreOption, argStrings);
+  std::vector<LPCWSTR> args;
+  args.reserve(argStrings.size());
+  for (const std::wstring &a : argStrings)
+    args.push_back(a.data());
+
+  unsigned threadCount = std::max(1u, std::thread::hardware_concurrency());
+  if (threadCount > jobs.size())
+    threadCount = std::max<unsigned>(1, jobs.size());
+  std::atomic<size_t> nextJob(0);
+  auto worker = [&]() {
+    for (;;) {
+      size_t i = nextJob.fetch_add(1);
+      if (i >= jobs.size())
+        return;
+      RunDependencyScanJob(*jobs[i], opts, args, dxcSupport);
+    }
+  };
+  std::vector<std::thread> threads;
+  for (unsigned i = 1; i < threadCount; ++i)
+    threads.emplace_back(worker);
+  worker();
+  for (std::thread &t : threads)
+    t.join();
+
+  std::string output;
+  llvm::raw_string_ostream OS(output);
+  unsigned failed = 0;
+  bool bFirst = true;
+  if (opts.DependenciesAsJson)
+    OS << "[\n";
+  for (const std::unique_ptr<DxcDependencyScanJob> &job : jobs) {
+    if (!job->Diagnostics.empty()) {
+      WriteUtf8ToConsoleSizeT(job->Diagnostics.data(), job->Diagnostics.size(),
+                              STD_ERROR_HANDLE);
+      if (job->Diagnostics.back() != '\n')
+        WriteUtf8ToConsoleSizeT("\n", 1, STD_ERROR_HANDLE);
+    }
+    if (job->Result != 0) {
+      ++failed;
+      continue;
+    }
+
+    // The target names the compiled output.
+    llvm::StringRef source(job->Files.front());
+    std::string target =
+        GetDependencyTarget(opts, bDirectory, inputDir, source);
+
+    if (opts.DependenciesAsJson) {
+      if (!bFirst)
+        OS << ",\n";
+      OS << "  { \"target\": ";
+      WriteJsonString(OS, target);
+      OS << ", \"source\": ";
+      WriteJsonString(OS, source);
+      OS << ", \"includes\": [";
+      for (size_t i = 1; i < job->Files.size(); ++i) {
+        if (i > 1)
+          OS << ", ";
+        WriteJsonString(OS, job->Files[i]);
+      }
+      OS << "] }";
+    } else {
+      WriteMakeFileName(OS, target);
+      OS << ":";
+      for (const std::string &file : job->Files) {
+        OS << " \\\n  ";
+        WriteMakeFileName(OS, file);
+      }
+      OS << "\n";
+    }
+    bFirst = false;
+  }
+  if (opts.DependenciesAsJson)
+    OS << "\n]\n";
+  OS.flush();
+
+  if (opts.DependencyFile.empty()) {
+    WriteUtf8ToConsoleSizeT(output.data(), output.size());
+  } else {
+    hlsl::WriteBinaryFile(StringRefUtf16(opts.DependencyFile), output.data(),
+                          output.size());
+  }
+  return failed == 0 ? 0 : 1;
+}
+
 int __cdecl wmain(int argc, const wchar_t **argv_) {
   const char *pStage = "Operation";
   int retVal = 0;
@@ -870,7 +1392,15 @@ int __cdecl wmain(int argc, const wchar_t **argv_) {
     EnsureEnabled(dxcSupport);
     DxcContext context(dxcOpts, dxcSupport);
     // TODO: implement all other actions.
-    if (!dxcOpts.Preprocess.empty()) {
+    if (!dxcOpts.BatchFile.empty()) {
+      pStage = "Batch compilation";
+      retVal = CompileBatch(dxcOpts, dxcSupport);
+    }
+    else if (dxcOpts.ScanDependencies) {
+      pStage = "Dependency scan";
+      retVal = ScanDependencies(dxcOpts, dxcSupport);
+    }
+    else if (!dxcOpts.Preprocess.empty()) {
       pStage = "Preprocessing";
       context.Preprocess();
     }
@@ -0,0 +1,451 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// dxccompilecache.cpp                                                       //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Implements a persistent, content-addressed cache for compile results.     //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#include "dxccompilecache.h"
+#include "dxc/Support/Global.h"
+#include "dxc/Support/Unicode.h"
+#include "dxc/Support/FileIOHelper.h"
+#include "dxc/dxcapi.h"
+#include "llvm/ADT/SmallString.h"
+#include <algorithm>
+#include <atomic>
+
+using namespace llvm;
+using namespace hlsl;
+
+// Bump whenever the entry layout or the key composition changes.
+static const UINT32 CompileCacheFormatVersion = 2;
+static const UINT32 CompileCacheMagic = 0x43435844; // 'DXCC'
+static const wchar_t CompileCacheEntryExt[] = L".dxcc";
+static const wchar_t CompileCacheTempExt[] = L".tmp";
+
+// Trimming walks the whole directory, so only do it every so often.
+static const UINT32 CompileCacheTrimInterval = 64;
+// Temporary files older than this were left behind by a process that died.
+static const UINT64 CompileCacheStaleTempAge = 60ULL * 60ULL * 10000000ULL;
+// Entries larger than this are never produced by a compile; treat as corrupt.
+static const UINT32 CompileCacheMaxEntrySize = 256 * 1024 * 1024;
+
+static std::atomic<UINT64> g_CacheHits;
+static std::atomic<UINT64> g_CacheMisses;
+static std::atomic<UINT64> g_CacheStores;
+static std::atomic<UINT64> g_CacheEvictions;
+
+struct CompileCacheEntryHeader {
+  UINT32 Magic;
+  UINT32 Version;
+  BYTE Key[16];
+  BYTE PayloadDigest[16];
+  UINT32 PayloadSize;
+  UINT32 DependencyCount;
+  UINT32 OutputSize;
+  UINT32 WarningsSize;
+};
+
+struct CompileCacheDependencyHeader {
+  UINT32 NameLength; // In wide characters, without a terminator.
+  UINT32 Present;
+  BYTE Hash[16];
+};
+
+static UINT64 FileTimeToUInt64(const FILETIME &ft) {
+  return ((UINT64)ft.dwHighDateTime << 32) | ft.dwLowDateTime;
+}
+
+static void DigestBytes(const void *pData, size_t size, MD5::MD5Result &result) {
+  MD5 hash;
+  hash.update(ArrayRef<uint8_t>((const uint8_t *)pData, size));
+  hash.final(result);
+}
+
+template <typename T>
+static void AppendValue(std::vector<char> &buffer, const T &value) {
+  const char *p = reinterpret_cast<const char *>(&value);
+  buffer.insert(buffer.end(), p, p + sizeof(T));
+}
+
+static void AppendBytes(std::vector<char> &buffer, const void *pData, size_t size) {
+  const char *p = reinterpret_cast<const char *>(pData);
+  buffer.insert(buffer.end(), p, p + size);
+}
+
+// Reads a whole entry file; returns false if it doesn't exist or can't be read.
+static bool ReadEntryFile(LPCWSTR pPath, std::vector<char> &contents) {
+  // Allow concurrent writers to rename over the entry and trimmers to delete
+  // it while it is open; the open handle keeps the old contents alive.
+  CHandle h(CreateFileW(pPath, GENERIC_READ | FILE_WRITE_ATTRIBUTES,
+                        FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                        nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL,
+                        nullptr));
+  if (h.m_h == INVALID_HANDLE_VALUE) {
+    h.Detach();
+    return false;
+  }
+  LARGE_INTEGER fileSize;
+  if (!GetFileSizeEx(h, &fileSize) || fileSize.HighPart != 0 ||
+      fileSize.LowPart > CompileCacheMaxEntrySize ||
+      fileSize.LowPart < sizeof(CompileCacheEntryHeader)) {
+    return false;
+  }
+  contents.resize(fileSize.LowPart);
+  DWORD bytesRead;
+  if (!ReadFile(h, contents.data(), fileSize.LowPart, &bytesRead, nullptr) ||
+      bytesRead != fileSize.LowPart) {
+    return false;
+  }
+
+  // Refresh the timestamp so trimming evicts the least recently used entries.
+  FILETIME now;
+  GetSystemTimeAsFileTime(&now);
+  SetFileTime(h, nullptr, nullptr, &now);
+  return true;
+}
+
+DxcCompileCacheKeyBuilder::DxcCompileCacheKeyBuilder() {
+  AddUInt32(CompileCacheFormatVersion);
+
+  // Results are only reusable with the exact compiler that produced them, so
+  // fold in the identity of this module's image on disk.
+  static const std::wstring s_moduleIdentity = []() -> std::wstring {
+    HMODULE hModule = nullptr;
+    wchar_t modulePath[MAX_PATH];
+    WIN32_FILE_ATTRIBUTE_DATA attributes;
+    std::wstring identity;
+    if (GetModuleHandleExW(GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS |
+                               GET_MODULE_HANDLE_EX_FLAG_UNCHANGED_REFCOUNT,
+                           (LPCWSTR)&CompileCacheMagic, &hModule) &&
+        GetModuleFileNameW(hModule, modulePath, _countof(modulePath)) != 0 &&
+        GetFileAttributesExW(modulePath, GetFileExInfoStandard, &attributes)) {
+      identity = modulePath;
+      identity.append((const wchar_t *)&attributes.ftLastWriteTime,
+                      sizeof(FILETIME) / sizeof(wchar_t));
+      identity.append((const wchar_t *)&attributes.nFileSizeLow,
+                      sizeof(DWORD) / sizeof(wchar_t));
+    }
+    return identity;
+  }();
+  AddBytes(s_moduleIdentity.data(), s_moduleIdentity.size() * sizeof(wchar_t));
+}
+
+void DxcCompileCacheKeyBuilder::AddString(StringRef value) {
+  // Length-prefix values so adjacent fields can't alias one another.
+  AddUInt32(value.size());
+  m_hash.update(value);
+}
+
+void DxcCompileCacheKeyBuilder::AddBytes(const void *pData, size_t size) {
+  AddUInt32(size);
+  m_hash.update(ArrayRef<uint8_t>((const uint8_t *)pData, size));
+}
+
+void DxcCompileCacheKeyBuilder::AddUInt32(UINT32 value) {
+  m_hash.update(ArrayRef<uint8_t>((const uint8_t *)&value, sizeof(value)));
+}
+
+void DxcCompileCacheKeyBuilder::Final(MD5::MD5Result &result) {
+  m_hash.final(result);
+}
+
+_Use_decl_annotations_
+HRESULT hlsl::DxcCompileCacheHashBlob(IDxcBlob *pBlob, MD5::MD5Result &result) throw() {
+  CComPtr<IDxcBlobEncoding> pUtf8;
+  HRESULT hr = DxcGetBlobAsUtf8(pBlob, &pUtf8);
+  if (FAILED(hr))
+    return hr;
+  DigestBytes(pUtf8->GetBufferPointer(), pUtf8->GetBufferSize(), result);
+  return S_OK;
+}
+
+static bool DigestModuleImage(MD5::MD5Result &result) {
+  HMODULE hModule = nullptr;
+  wchar_t modulePath[MAX_PATH];
+  if (!GetModuleHandleExW(GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS |
+                              GET_MODULE_HANDLE_EX_FLAG_UNCHANGED_REFCOUNT,
+                          (LPCWSTR)&CompileCacheMagic, &hModule) ||
+      GetModuleFileNameW(hModule, modulePath, _countof(modulePath)) == 0) {
+    return false;
+  }
+  CHandle h(CreateFileW(modulePath, GENERIC_READ,
+                        FILE_SHARE_READ | FILE_SHARE_DELETE, nullptr,
+                        OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr));
+  if (h.m_h == INVALID_HANDLE_VALUE) {
+    h.Detach();
+    return false;
+  }
+  MD5 hash;
+  std::vector<uint8_t> buffer(64 * 1024);
+  for (;;) {
+    DWORD bytesRead;
+    if (!ReadFile(h, buffer.data(), (DWORD)buffer.size(), &bytesRead, nullptr))
+      return false;
+    if (bytesRead == 0)
+      break;
+    hash.update(ArrayRef<uint8_t>(buffer.data(), bytesRead));
+  }
+  hash.final(result);
+  return true;
+}
+
+_Use_decl_annotations_
+bool hlsl::DxcCompileCacheGetModuleDigest(MD5::MD5Result &result) throw() {
+  // A loaded image can't be replaced on disk, so hashing it once is enough.
+  static const struct ModuleDigest {
+    bool Valid;
+    MD5::MD5Result Digest;
+    ModuleDigest() : Valid(false) {
+      try {
+        Valid = DigestModuleImage(Digest);
+      } catch (...) {
+      }
+    }
+  } s_moduleDigest;
+  if (!s_moduleDigest.Valid)
+    return false;
+  memcpy(result, s_moduleDigest.Digest, sizeof(MD5::MD5Result));
+  return true;
+}
+
+DxcCompileCache::DxcCompileCache(StringRef directory, UINT32 maxSizeInMB)
+    : m_directory(Unicode::UTF8ToUTF16StringOrThrow(directory.str().c_str())),
+      m_maxSizeInBytes((UINT64)maxSizeInMB * 1024 * 1024) {
+  if (!m_directory.empty() && m_directory.back() != L'\\' &&
+      m_directory.back() != L'/') {
+    m_directory.push_back(L'\\');
+  }
+}
+
+std::wstring DxcCompileCache::GetEntryPath(const MD5::MD5Result &key) const {
+  SmallString<32> keyText;
+  MD5::stringifyResult(const_cast<MD5::MD5Result &>(key), keyText);
+  std::wstring path(m_directory);
+  path.append(keyText.begin(), keyText.end());
+  path.append(CompileCacheEntryExt);
+  return path;
+}
+
+_Use_decl_annotations_
+bool DxcCompileCache::Lookup(const MD5::MD5Result &key,
+                             IDxcIncludeHandler *pIncludeHandler,
+                             IDxcBlob **ppOutput, std::string &warnings) {
+  *ppOutput = nullptr;
+  std::vector<char> contents;
+  if (!ReadEntryFile(GetEntryPath(key).c_str(), contents)) {
+    ++g_CacheMisses;
+    return false;
+  }
+
+  // Check the entry is complete and belongs to this key.
+  CompileCacheEntryHeader header;
+  memcpy(&header, contents.data(), sizeof(header));
+  const char *pPayload = contents.data() + sizeof(header);
+  MD5::MD5Result payloadDigest;
+  if (header.Magic != CompileCacheMagic ||
+      header.Version != CompileCacheFormatVersion ||
+      0 != memcmp(header.Key, key, sizeof(header.Key)) ||
+      header.PayloadSize != contents.size() - sizeof(header)) {
+    ++g_CacheMisses;
+    return false;
+  }
+  DigestBytes(pPayload, header.PayloadSize, payloadDigest);
+  if (0 != memcmp(header.PayloadDigest, payloadDigest, sizeof(payloadDigest))) {
+    ++g_CacheMisses;
+    return false;
+  }
+
+  // Every dependency must resolve the same way it did when the entry was
+  // created: present files with identical contents, absent files still absent.
+  const char *pCursor = pPayload;
+  const char *pEnd = pPayload + header.PayloadSize;
+  for (UINT32 i = 0; i < header.DependencyCount; ++i) {
+    CompileCacheDependencyHeader depHeader;
+    if ((size_t)(pEnd - pCursor) < sizeof(depHeader)) {
+      ++g_CacheMisses;
+      return false;
+    }
+    memcpy(&depHeader, pCursor, sizeof(depHeader));
+    pCursor += sizeof(depHeader);
+    size_t nameBytes = depHeader.NameLength * sizeof(wchar_t);
+    if ((size_t)(pEnd - pCursor) < nameBytes) {
+      ++g_CacheMisses;
+      return false;
+    }
+    std::wstring name((const wchar_t *)pCursor, depHeader.NameLength);
+    pCursor += nameBytes;
+
+    CComPtr<IDxcBlob> pDepBlob;
+    bool present = pIncludeHandler != nullptr &&
+                   SUCCEEDED(pIncludeHandler->LoadSource(name.c_str(), &pDepBlob)) &&
+                   pDepBlob != nullptr;
+    if (present != (depHeader.Present != 0)) {
+      ++g_CacheMisses;
+      return false;
+    }
+    if (present) {
+      MD5::MD5Result depHash;
+      if (FAILED(DxcCompileCacheHashBlob(pDepBlob, depHash)) ||
+          0 != memcmp(depHash, depHeader.Hash, sizeof(depHash))) {
+        ++g_CacheMisses;
+        return false;
+      }
+    }
+  }
+
+  if ((size_t)(pEnd - pCursor) != (size_t)header.OutputSize + header.WarningsSize) {
+    ++g_CacheMisses;
+    return false;
+  }
+  CComPtr<IDxcBlob> pOutput;
+  if (FAILED(DxcCreateBlobOnHeapCopy(pCursor, header.OutputSize, &pOutput))) {
+    ++g_CacheMisses;
+    return false;
+  }
+  pCursor += header.OutputSize;
+  warnings.assign(pCursor, header.WarningsSize);
+  *ppOutput = pOutput.Detach();
+  ++g_CacheHits;
+  return true;
+}
+
+_Use_decl_annotations_
+void DxcCompileCache::Store(const MD5::MD5Result &key,
+                            const std::vector<DxcCompileCacheDependency> &dependencies,
+                            IDxcBlob *pOutput, StringRef warnings) {
+  if (pOutput->GetBufferSize() + warnings.size() > CompileCacheMaxEntrySize / 2)
+    return;
+
+  std::vector<char> payload;
+  for (const DxcCompileCacheDependency &dep : dependencies) {
+    CompileCacheDependencyHeader depHeader;
+    depHeader.NameLength = dep.Name.size();
+    depHeader.Present = dep.Present ? 1 : 0;
+    memcpy(depHeader.Hash, dep.Hash, sizeof(depHeader.Hash));
+    AppendValue(payload, depHeader);
+    AppendBytes(payload, dep.Name.data(), dep.Name.size() * sizeof(wchar_t));
+  }
+  AppendBytes(payload, pOutput->GetBufferPointer(), pOutput->GetBufferSize());
+  AppendBytes(payload, warnings.data(), warnings.size());
+
+  CompileCacheEntryHeader header;
+  header.Magic = CompileCacheMagic;
+  header.Version = CompileCacheFormatVersion;
+  memcpy(header.Key, key, sizeof(header.Key));
+  DigestBytes(payload.data(), payload.size(), header.PayloadDigest);
+  header.PayloadSize = payload.size();
+  header.DependencyCount = dependencies.size();
+  header.OutputSize = pOutput->GetBufferSize();
+  header.WarningsSize = warnings.size();
+
+  if (!CreateDirectoryW(m_directory.c_str(), nullptr) &&
+      GetLastError() != ERROR_ALREADY_EXISTS) {
+    return;
+  }
+
+  // Write to a name no other writer can use, then publish atomically.
+  std::wstring entryPath = GetEntryPath(key);
+  wchar_t suffix[32];
+  swprintf_s(suffix, L".%u.%u", GetCurrentProcessId(), GetCurrentThreadId());
+  std::wstring tempPath = entryPath + suffix + CompileCacheTempExt;
+  {
+    CHandle h(CreateFileW(tempPath.c_str(), GENERIC_WRITE, 0, nullptr,
+                          CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr));
+    if (h.m_h == INVALID_HANDLE_VALUE) {
+      h.Detach();
+      return;
+    }
+    DWORD written;
+    bool ok = WriteFile(h, &header, sizeof(header), &written, nullptr) &&
+              written == sizeof(header) &&
+              WriteFile(h, payload.data(), payload.size(), &written, nullptr) &&
+              written == payload.size();
+    if (!ok) {
+      h.Close();
+      DeleteFileW(tempPath.c_str());
+      return;
+    }
+  }
+  if (!MoveFileExW(tempPath.c_str(), entryPath.c_str(),
+                   MOVEFILE_REPLACE_EXISTING)) {
+    DeleteFileW(tempPath.c_str());
+    return;
+  }
+
+  if ((g_CacheStores++ % CompileCacheTrimInterval) == 0) {
+    TrimToSize();
+  }
+}
+
+void DxcCompileCache::TrimToSize() {
+  struct EntryInfo {
+    UINT64 LastWrite;
+    UINT64 Size;
+    std::wstring Name;
+  };
+  std::vector<EntryInfo> entries;
+  UINT64 totalSize = 0;
+  FILETIME nowTime;
+  GetSystemTimeAsFileTime(&nowTime);
+  UINT64 now = FileTimeToUInt64(nowTime);
+
+  std::wstring pattern = m_directory + L"*";
+  WIN32_FIND_DATAW findData;
+  HANDLE hFind = FindFirstFileW(pattern.c_str(), &findData);
+  if (hFind == INVALID_HANDLE_VALUE)
+    return;
+  do {
+    if (findData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
+      continue;
+    size_t nameLen = wcslen(findData.cFileName);
+    UINT64 lastWrite = FileTimeToUInt64(findData.ftLastWriteTime);
+    if (nameLen > _countof(CompileCacheTempExt) - 1 &&
+        0 == wcscmp(findData.cFileName + nameLen - (_countof(CompileCacheTempExt) - 1),
+                    CompileCacheTempExt)) {
+      if (now > lastWrite && now - lastWrite > CompileCacheStaleTempAge) {
+        DeleteFileW((m_directory + findData.cFileName).c_str());
+      }
+      continue;
+    }
+    if (nameLen <= _countof(CompileCacheEntryExt) - 1 ||
+        0 != wcscmp(findData.cFileName + nameLen - (_countof(CompileCacheEntryExt) - 1),
+                    CompileCacheEntryExt)) {
+      continue;
+    }
+    UINT64 size = ((UINT64)findData.nFileSizeHigh << 32) | findData.nFileSizeLow;
+    totalSize += size;
+    entries.push_back(EntryInfo{lastWrite, size, findData.cFileName});
+  } while (FindNextFileW(hFind, &findData));
+  FindClose(hFind);
+
+  if (totalSize <= m_maxSizeInBytes)
+    return;
+
+  // Evict down to 90% of the limit so the next few stores don't trim again.
+  UINT64 targetSize = m_maxSizeInBytes - m_maxSizeInBytes / 10;
+  std::sort(entries.begin(), entries.end(),
+            [](const EntryInfo &a, const EntryInfo &b) {
+              return a.LastWrite < b.LastWrite;
+            });
+  for (const EntryInfo &entry : entries) {
+    if (totalSize <= targetSize)
+      break;
+    // Another process may have evicted or replaced this already.
+    if (DeleteFileW((m_directory + entry.Name).c_str())) {
+      ++g_CacheEvictions;
+    }
+    totalSize -= entry.Size;
+  }
+}
+
+void DxcCompileCache::GetStats(DxcCompileCacheStats *pStats) {
+  pStats->Hits = g_CacheHits;
+  pStats->Misses = g_CacheMisses;
+  pStats->Stores = g_CacheStores;
+  pStats->Evictions = g_CacheEvictions;
+}
@@ -0,0 +1,105 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// dxccompilecache.h                                                         //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Provides a persistent, content-addressed cache for compile results.       //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+#ifndef __DXC_COMPILECACHE__
+#define __DXC_COMPILECACHE__
+
+#include "dxc/Support/WinIncludes.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/MD5.h"
+#include <string>
+#include <vector>
+
+struct IDxcBlob;
+struct IDxcIncludeHandler;
+
+namespace hlsl {
+
+/// Statistics for the compile cache, accumulated across the process.
+struct DxcCompileCacheStats {
+  UINT64 Hits;
+  UINT64 Misses;
+  UINT64 Stores;
+  UINT64 Evictions;
+};
+
+/// A file pulled in through the include handler while compiling. Probes that
+/// were not satisfied by the handler are recorded as well (with Present set to
+/// false), so that a file appearing earlier on the search path invalidates
+/// the entry.
+struct DxcCompileCacheDependency {
+  std::wstring Name;
+  bool Present;
+  llvm::MD5::MD5Result Hash;
+};
+
+/// Builds the key that identifies a compile request, excluding the contents
+/// of included files (which are only known after compilation and are verified
+/// on lookup instead).
+class DxcCompileCacheKeyBuilder {
+private:
+  llvm::MD5 m_hash;
+
+public:
+  DxcCompileCacheKeyBuilder();
+  void AddString(llvm::StringRef value);
+  void AddBytes(const void *pData, size_t size);
+  void AddUInt32(UINT32 value);
+  void Final(llvm::MD5::MD5Result &result);
+};
+
+/// Hashes the contents of an included file as the compiler would see it.
+HRESULT DxcCompileCacheHashBlob(_In_ IDxcBlob *pBlob,
+                                llvm::MD5::MD5Result &result) throw();
+
+/// Gets the digest of this module's image on disk, computed once per process.
+/// Returns false if the image can't be read.
+bool DxcCompileCacheGetModuleDigest(llvm::MD5::MD5Result &result) throw();
+
+/// Persistent on-disk store of compile results.
+///
+/// Entries are written to a unique temporary file and renamed into place, so
+/// concurrent processes sharing a directory either see a complete entry or no
+/// entry at all. Entries are self-checking (magic, version, key and payload
+/// digest), and any entry that fails to check is treated as a miss.
+///
+/// The directory is trimmed to the configured size by evicting the least
+/// recently used entries; hits refresh the last-write time of the entry.
+class DxcCompileCache {
+private:
+  std::wstring m_directory;
+  UINT64 m_maxSizeInBytes;
+
+  std::wstring GetEntryPath(const llvm::MD5::MD5Result &key) const;
+  void TrimToSize();
+
+public:
+  DxcCompileCache(llvm::StringRef directory, UINT32 maxSizeInMB);
+
+  /// Looks up a compile result. Dependencies recorded with the entry are
+  /// reloaded through pIncludeHandler and must match byte for byte.
+  bool Lookup(const llvm::MD5::MD5Result &key,
+              _In_opt_ IDxcIncludeHandler *pIncludeHandler,
+              _COM_Outptr_ IDxcBlob **ppOutput, std::string &warnings);
+
+  /// Stores a compile result along with the dependencies it was built from.
+  /// Failures are not reported; the cache is best-effort.
+  void Store(const llvm::MD5::MD5Result &key,
+             const std::vector<DxcCompileCacheDependency> &dependencies,
+             _In_ IDxcBlob *pOutput, llvm::StringRef warnings);
+
+  static void GetStats(DxcCompileCacheStats *pStats);
+};
+
+} // namespace hlsl
+
+#endif // __DXC_COMPILECACHE__
@@ -11,6 +11,7 @@
 
 #include "clang/AST/ASTConsumer.h"
 #include "clang/AST/RecursiveASTVisitor.h"
+#include "llvm/ADT/StringMap.h"
 #include "llvm/Bitcode/ReaderWriter.h"
 #include "clang/Sema/SemaHLSL.h"
 #include "llvm/IR/LLVMContext.h"
@@ -134,6 +135,20 @@ static HRESULT CreateDxcDiaEnumTables(DxcDiaSession *, IDiaEnumTables **);
 static HRESULT CreateDxcDiaTable(DxcDiaSession *, DiaTableKind kind, IDiaTable **ppTable);
 
 class DxcDiaSession : public IDiaSession {
+public:
+  // Entry in the index of line records by source location.
+  struct LineIndexEntry {
+    DWORD FileId;
+    DWORD Line;
+    DWORD LineIndex; // Index into m_instructionLines.
+    bool operator<(const LineIndexEntry &other) const {
+      if (FileId != other.FileId) return FileId < other.FileId;
+      if (Line != other.Line) return Line < other.Line;
+      return LineIndex < other.LineIndex;
+    }
+  };
+  static const DWORD NoSourceFileId = (DWORD)-1;
+
 private:
   DXC_MICROCOM_REF_FIELD(m_dwRef)
   std::shared_ptr<llvm::LLVMContext> m_context;
@@ -146,6 +161,22 @@ private:
   llvm::NamedMDNode *m_arguments;
   std::vector<const Instruction *> m_instructions;
   std::vector<const Instruction *> m_instructionLines; // Instructions with line info.
+  // The following indices are built once at load so that lookups don't need
+  // to walk the module or compare file names.
+  std::vector<DWORD> m_instructionLineRVAs;  // RVA of each line record; ascending.
+  std::vector<DWORD> m_instructionLineFiles; // Source file id of each line record.
+  std::vector<LineIndexEntry> m_linesBySource; // Sorted by file, line.
+  llvm::StringMap<DWORD> m_fileIds;            // File name to source file id.
+  llvm::StringMap<DWORD> m_fileIdsLower;       // Lowercase file name to id.
+
+  DWORD LookupSourceFileId(const llvm::DebugLoc &DL) {
+    DIScope *pScope = dyn_cast_or_null<DIScope>(DL.getScope());
+    if (pScope == nullptr)
+      return NoSourceFileId;
+    auto it = m_fileIds.find(pScope->getFilename());
+    return it == m_fileIds.end() ? NoSourceFileId : it->second;
+  }
+
 public:
   DXC_MICROCOM_ADDREF_RELEASE_IMPL(m_dwRef)
 
@@ -161,6 +192,17 @@ public:
     m_defines = m_module->getNamedMetadata("llvm.dbg.defines");
     m_mainFileName = m_module->getNamedMetadata("llvm.dbg.mainFileName");
     m_arguments = m_module->getNamedMetadata("llvm.dbg.args");
+    if (m_contents != nullptr) {
+      for (unsigned i = 0; i < m_contents->getNumOperands(); ++i) {
+        StringRef fn =
+            dyn_cast<MDString>(m_contents->getOperand(i)->getOperand(0))
+                ->getString();
+        // Keep the first entry if a name is repeated, as the linear scan did.
+        m_fileIds.insert(std::make_pair(fn, (DWORD)i));
+        m_fileIdsLower.insert(std::make_pair(fn.lower(), (DWORD)i));
+      }
+    }
+
     // Build up a linear list of instructions. The index will be used as the
     // RVA. Debug instructions are ommitted from this enumeration.
     for (const Function &fn : m_module->functions()) {
@@ -173,13 +215,27 @@ public:
             }
           }
 
-          m_instructions.push_back(&i);
           if (i.getDebugLoc()) {
             m_instructionLines.push_back(&i);
+            m_instructionLineRVAs.push_back((DWORD)m_instructions.size());
+            m_instructionLineFiles.push_back(LookupSourceFileId(i.getDebugLoc()));
           }
+          m_instructions.push_back(&i);
         }
       }
     }
+
+    // Index line records by source location.
+    m_linesBySource.reserve(m_instructionLines.size());
+    for (unsigned i = 0; i < m_instructionLines.size(); ++i) {
+      if (m_instructionLineFiles[i] == NoSourceFileId)
+        continue;
+      LineIndexEntry entry = { m_instructionLineFiles[i],
+                               m_instructionLines[i]->getDebugLoc().getLine(),
+                               i };
+      m_linesBySource.push_back(entry);
+    }
+    std::sort(m_linesBySource.begin(), m_linesBySource.end());
   }
   llvm::NamedMDNode *Contents() { return m_contents; }
   llvm::NamedMDNode *Defines() { return m_defines; }
@@ -190,23 +246,25 @@ public:
   llvm::DebugInfoFinder &InfoRef() { return *m_finder.get(); }
   std::vector<const Instruction *> &InstructionsRef() { return m_instructions; }
   std::vector<const Instruction *> &InstructionLinesRef() { return m_instructionLines; }
+  DWORD InstructionLineRVA(DWORD lineIndex) { return m_instructionLineRVAs[lineIndex]; }
+  DWORD InstructionLineFileId(DWORD lineIndex) { return m_instructionLineFiles[lineIndex]; }
+  DWORD SourceFileCount() {
+    return m_contents == nullptr ? 0 : m_contents->getNumOperands();
+  }
 
   HRESULT getSourceFileIdByName(StringRef fileName, DWORD *pRetVal) {
-    if (Contents() != nullptr) {
-      for (unsigned i = 0; i < Contents()->getNumOperands(); ++i) {
-        StringRef fn =
-            dyn_cast<MDString>(Contents()->getOperand(i)->getOperand(0))
-                ->getString();
-        if (fn.equals(fileName)) {
-          *pRetVal = i;
-          return S_OK;
-        }
-      }
+    auto it = m_fileIds.find(fileName);
+    if (it != m_fileIds.end()) {
+      *pRetVal = it->second;
+      return S_OK;
     }
     *pRetVal = 0;
     return S_FALSE;
   }
 
+  HRESULT getSourceFileIdByName(LPCOLESTR name, DWORD compareFlags,
+                                DWORD *pRetVal);
+
   HRESULT STDMETHODCALLTYPE QueryInterface(REFIID iid, void **ppvObject) {
     return DoBasicQueryInterface<IDiaSession>(this, iid, ppvObject);
   }
@@ -315,11 +373,11 @@ public:
     /* [in] */ IDiaSymbol *pCompiland,
     /* [in] */ LPCOLESTR name,
     /* [in] */ DWORD compareFlags,
-    /* [out] */ IDiaEnumSourceFiles **ppResult) { return E_NOTIMPL; }
+    /* [out] */ IDiaEnumSourceFiles **ppResult);
 
   __override STDMETHODIMP findFileById(
     /* [in] */ DWORD uniqueId,
-    /* [out] */ IDiaSourceFile **ppResult) { return E_NOTIMPL; }
+    /* [out] */ IDiaSourceFile **ppResult);
 
   __override STDMETHODIMP findLines(
     /* [in] */ IDiaSymbol *compiland,
@@ -330,12 +388,12 @@ public:
     /* [in] */ DWORD seg,
     /* [in] */ DWORD offset,
     /* [in] */ DWORD length,
-    /* [out] */ IDiaEnumLineNumbers **ppResult) { return E_NOTIMPL; }
+    /* [out] */ IDiaEnumLineNumbers **ppResult);
 
   __override STDMETHODIMP findLinesByRVA(
     /* [in] */ DWORD rva,
     /* [in] */ DWORD length,
-    /* [out] */ IDiaEnumLineNumbers **ppResult) { return E_NOTIMPL; }
+    /* [out] */ IDiaEnumLineNumbers **ppResult);
 
   __override STDMETHODIMP findLinesByVA(
     /* [in] */ ULONGLONG va,
@@ -347,11 +405,11 @@ public:
     /* [in] */ IDiaSourceFile *file,
     /* [in] */ DWORD linenum,
     /* [in] */ DWORD column,
-    /* [out] */ IDiaEnumLineNumbers **ppResult) { return E_NOTIMPL; }
+    /* [out] */ IDiaEnumLineNumbers **ppResult);
 
   __override STDMETHODIMP findInjectedSource(
     /* [in] */ LPCOLESTR srcFile,
-    /* [out] */ IDiaEnumInjectedSources **ppResult) { return E_NOTIMPL; }
+    /* [out] */ IDiaEnumInjectedSources **ppResult);
 
   __override STDMETHODIMP getEnumDebugStreams(
     /* [out] */ IDiaEnumDebugStreams **ppEnumDebugStreams) { return E_NOTIMPL; }
@@ -678,8 +736,8 @@ public:
     /* [in] */ DWORD index,
     /* [retval][out] */ TItem **ppItem) {
     if (index >= m_count)
-      return GetItem(index, ppItem);
-    return E_INVALIDARG;
+      return E_INVALIDARG;
+    return GetItem(index, ppItem);
   }
 
   virtual HRESULT GetItem(DWORD index, TItem **ppItem) {
@@ -1675,7 +1733,17 @@ public:
     /* [retval][out] */ IDiaSymbol **pRetVal) { return E_NOTIMPL; }
 
   __override STDMETHODIMP get_sourceFile(
-    /* [retval][out] */ IDiaSourceFile **pRetVal) { return E_NOTIMPL; }
+    /* [retval][out] */ IDiaSourceFile **pRetVal) {
+    *pRetVal = nullptr;
+    DWORD fileId = m_pSession->InstructionLineFileId(m_index);
+    if (fileId == DxcDiaSession::NoSourceFileId)
+      return S_FALSE;
+    *pRetVal = new (std::nothrow)DxcDiaSourceFile(m_pSession, fileId);
+    if (*pRetVal == nullptr)
+      return E_OUTOFMEMORY;
+    (*pRetVal)->AddRef();
+    return S_OK;
+  }
 
   __override STDMETHODIMP get_lineNumber(
     /* [retval][out] */ DWORD *pRetVal) {
@@ -1709,7 +1777,7 @@ public:
 
   __override STDMETHODIMP get_relativeVirtualAddress(
     /* [retval][out] */ DWORD *pRetVal) { 
-    *pRetVal = m_index;
+    *pRetVal = m_pSession->InstructionLineRVA(m_index);
     return S_OK;
   }
 
@@ -1717,21 +1785,21 @@ public:
     /* [retval][out] */ ULONGLONG *pRetVal) { return E_NOTIMPL; }
 
   __override STDMETHODIMP get_length(
-    /* [retval][out] */ DWORD *pRetVal) { return E_NOTIMPL; }
+    /* [retval][out] */ DWORD *pRetVal) {
+    // Each line record covers a single instruction.
+    *pRetVal = 1;
+    return S_OK;
+  }
 
   __override STDMETHODIMP get_sourceFileId(
     /* [retval][out] */ DWORD *pRetVal) {
-    MDNode *pScope = DL().getScope();
-    DILexicalBlock *pBlock = dyn_cast_or_null<DILexicalBlock>(pScope);
-    if (pBlock != nullptr) {
-      return m_pSession->getSourceFileIdByName(pBlock->getFile()->getFilename(), pRetVal);
+    DWORD fileId = m_pSession->InstructionLineFileId(m_index);
+    if (fileId == DxcDiaSession::NoSourceFileId) {
+      *pRetVal = 0;
+      return S_FALSE;
     }
-    DISubprogram *pSubProgram= dyn_cast_or_null<DISubprogram>(pScope);
-    if (pSubProgram != nullptr) {
-      return m_pSession->getSourceFileIdByName(pSubProgram->getFile()->getFilename(), pRetVal);
-    }
-    *pRetVal = 0;
-    return S_FALSE;
+    *pRetVal = fileId;
+    return S_OK;
   }
 
   __override STDMETHODIMP get_statement(
@@ -1864,6 +1932,208 @@ public:
   }
 };
 
+// Enumerates a subset of the rows of a table, as returned by the find* methods
+// of the session.
+template<typename T, typename TItem, typename TItemImpl>
+class DxcDiaEnumRows : public DxcDiaTableBase<T, TItem> {
+private:
+  std::vector<DWORD> m_rows;
+public:
+  DxcDiaEnumRows(DxcDiaSession *pSession, DiaTableKind kind,
+                 std::vector<DWORD> &&rows)
+      : DxcDiaTableBase<T, TItem>(pSession, kind), m_rows(std::move(rows)) {
+    this->m_count = m_rows.size();
+  }
+
+  __override HRESULT GetItem(DWORD index, TItem **ppItem) {
+    *ppItem = new (std::nothrow)TItemImpl(this->m_pSession, m_rows[index]);
+    if (*ppItem == nullptr)
+      return E_OUTOFMEMORY;
+    (*ppItem)->AddRef();
+    return S_OK;
+  }
+};
+
+typedef DxcDiaEnumRows<IDiaEnumLineNumbers, IDiaLineNumber, DxcDiaLineNumber>
+    DxcDiaEnumLineNumbers;
+typedef DxcDiaEnumRows<IDiaEnumSourceFiles, IDiaSourceFile, DxcDiaSourceFile>
+    DxcDiaEnumSourceFiles;
+typedef DxcDiaEnumRows<IDiaEnumInjectedSources, IDiaInjectedSource,
+                       DxcDiaInjectedSource> DxcDiaEnumInjectedSources;
+
+template<typename TEnum, typename TEnumIface>
+static HRESULT CreateDxcDiaEnumRows(DxcDiaSession *pSession, DiaTableKind kind,
+                                    std::vector<DWORD> &&rows,
+                                    TEnumIface **ppResult) {
+  TEnum *pEnum = new (std::nothrow)TEnum(pSession, kind, std::move(rows));
+  if (pEnum == nullptr) {
+    *ppResult = nullptr;
+    return E_OUTOFMEMORY;
+  }
+  pEnum->AddRef();
+  *ppResult = pEnum;
+  return S_OK;
+}
+
+HRESULT DxcDiaSession::getSourceFileIdByName(LPCOLESTR name, DWORD compareFlags,
+                                             DWORD *pRetVal) {
+  *pRetVal = 0;
+  if (compareFlags & ~(nsfCaseSensitive | nsfCaseInsensitive))
+    return E_NOTIMPL;
+  std::string nameUtf8;
+  if (!Unicode::UTF16ToUTF8String(name, &nameUtf8))
+    return E_INVALIDARG;
+  if (compareFlags & nsfCaseInsensitive) {
+    auto it = m_fileIdsLower.find(StringRef(nameUtf8).lower());
+    if (it == m_fileIdsLower.end())
+      return S_FALSE;
+    *pRetVal = it->second;
+    return S_OK;
+  }
+  return getSourceFileIdByName(StringRef(nameUtf8), pRetVal);
+}
+
+STDMETHODIMP DxcDiaSession::findFile(
+    /* [in] */ IDiaSymbol *pCompiland,
+    /* [in] */ LPCOLESTR name,
+    /* [in] */ DWORD compareFlags,
+    /* [out] */ IDiaEnumSourceFiles **ppResult) {
+  if (ppResult == nullptr)
+    return E_POINTER;
+  *ppResult = nullptr;
+  // Single compiland, so pCompiland doesn't narrow the search.
+  std::vector<DWORD> rows;
+  try {
+    if (name == nullptr) {
+      for (DWORD i = 0; i < SourceFileCount(); ++i)
+        rows.push_back(i);
+    }
+    else {
+      DWORD fileId;
+      HRESULT hr = getSourceFileIdByName(name, compareFlags, &fileId);
+      if (FAILED(hr))
+        return hr;
+      if (hr == S_OK)
+        rows.push_back(fileId);
+    }
+    return CreateDxcDiaEnumRows<DxcDiaEnumSourceFiles>(
+        this, DiaTableKind::SourceFiles, std::move(rows), ppResult);
+  }
+  CATCH_CPP_RETURN_HRESULT();
+}
+
+STDMETHODIMP DxcDiaSession::findFileById(
+    /* [in] */ DWORD uniqueId,
+    /* [out] */ IDiaSourceFile **ppResult) {
+  if (ppResult == nullptr)
+    return E_POINTER;
+  *ppResult = nullptr;
+  if (uniqueId >= SourceFileCount())
+    return E_INVALIDARG;
+  *ppResult = new (std::nothrow)DxcDiaSourceFile(this, uniqueId);
+  if (*ppResult == nullptr)
+    return E_OUTOFMEMORY;
+  (*ppResult)->AddRef();
+  return S_OK;
+}
+
+STDMETHODIMP DxcDiaSession::findLinesByAddr(
+    /* [in] */ DWORD seg,
+    /* [in] */ DWORD offset,
+    /* [in] */ DWORD length,
+    /* [out] */ IDiaEnumLineNumbers **ppResult) {
+  // The program is a single section addressed by instruction index, so the
+  // offset is the RVA.
+  UNREFERENCED_PARAMETER(seg);
+  return findLinesByRVA(offset, length, ppResult);
+}
+
+STDMETHODIMP DxcDiaSession::findLinesByRVA(
+    /* [in] */ DWORD rva,
+    /* [in] */ DWORD length,
+    /* [out] */ IDiaEnumLineNumbers **ppResult) {
+  if (ppResult == nullptr)
+    return E_POINTER;
+  *ppResult = nullptr;
+  // Each instruction is one unit long; a zero length still finds the line
+  // record at rva, if any.
+  DWORD end = rva + std::max(length, (DWORD)1);
+  if (end < rva)
+    end = (DWORD)-1;
+  auto first = std::lower_bound(m_instructionLineRVAs.begin(),
+                                m_instructionLineRVAs.end(), rva);
+  auto last = std::lower_bound(first, m_instructionLineRVAs.end(), end);
+  try {
+    std::vector<DWORD> rows;
+    rows.reserve(last - first);
+    for (auto it = first; it != last; ++it)
+      rows.push_back((DWORD)(it - m_instructionLineRVAs.begin()));
+    return CreateDxcDiaEnumRows<DxcDiaEnumLineNumbers>(
+        this, DiaTableKind::LineNumbers, std::move(rows), ppResult);
+  }
+  CATCH_CPP_RETURN_HRESULT();
+}
+
+STDMETHODIMP DxcDiaSession::findLinesByLinenum(
+    /* [in] */ IDiaSymbol *compiland,
+    /* [in] */ IDiaSourceFile *file,
+    /* [in] */ DWORD linenum,
+    /* [in] */ DWORD column,
+    /* [out] */ IDiaEnumLineNumbers **ppResult) {
+  if (ppResult == nullptr)
+    return E_POINTER;
+  *ppResult = nullptr;
+  if (file == nullptr)
+    return E_INVALIDARG;
+  DWORD fileId;
+  IFR(file->get_uniqueId(&fileId));
+
+  // Find the first line at or after linenum in the file; a line without code
+  // maps to the next line that has some, as with native PDBs.
+  LineIndexEntry key = { fileId, linenum, 0 };
+  auto first = std::lower_bound(m_linesBySource.begin(), m_linesBySource.end(), key);
+  try {
+    std::vector<DWORD> rows;
+    if (first != m_linesBySource.end() && first->FileId == fileId) {
+      DWORD line = first->Line;
+      for (auto it = first; it != m_linesBySource.end() &&
+                            it->FileId == fileId && it->Line == line; ++it) {
+        if (column != 0 &&
+            m_instructionLines[it->LineIndex]->getDebugLoc().getCol() != column)
+          continue;
+        rows.push_back(it->LineIndex);
+      }
+    }
+    return CreateDxcDiaEnumRows<DxcDiaEnumLineNumbers>(
+        this, DiaTableKind::LineNumbers, std::move(rows), ppResult);
+  }
+  CATCH_CPP_RETURN_HRESULT();
+}
+
+STDMETHODIMP DxcDiaSession::findInjectedSource(
+    /* [in] */ LPCOLESTR srcFile,
+    /* [out] */ IDiaEnumInjectedSources **ppResult) {
+  if (ppResult == nullptr)
+    return E_POINTER;
+  *ppResult = nullptr;
+  if (srcFile == nullptr)
+    return E_INVALIDARG;
+  try {
+    // Injected source names are matched without regard to case, as file
+    // names are.
+    std::vector<DWORD> rows;
+    DWORD fileId;
+    HRESULT hr = getSourceFileIdByName(srcFile, nsfCaseInsensitive, &fileId);
+    if (FAILED(hr))
+      return hr;
+    if (hr == S_OK)
+      rows.push_back(fileId);
+    return CreateDxcDiaEnumRows<DxcDiaEnumInjectedSources>(
+        this, DiaTableKind::InjectedSource, std::move(rows), ppResult);
+  }
+  CATCH_CPP_RETURN_HRESULT();
+}
+
 class DxcDiaTableFrameData : public DxcDiaTableBase<IDiaEnumFrameData, IDiaFrameData> {
 public:
   DxcDiaTableFrameData(DxcDiaSession *pSession) : DxcDiaTableBase(pSession, DiaTableKind::FrameData) { }
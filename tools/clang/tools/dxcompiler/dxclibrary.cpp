@@ -39,8 +39,11 @@ public:
     _In_ LPCWSTR pFilename,                                   // Candidate filename.
     _COM_Outptr_result_maybenull_ IDxcBlob **ppIncludeSource  // Resultant source object for included file, nullptr if not found.
     ) {
+    // Included files are only needed while compiling, so large ones are
+    // mapped rather than copied; ASCII and UTF-8 contents are then used in
+    // place by the compiler.
     CComPtr<IDxcBlobEncoding> pEncoding;
-    HRESULT hr = ::hlsl::DxcCreateBlobFromFile(pFilename, nullptr, &pEncoding);
+    HRESULT hr = ::hlsl::DxcCreateBlobFromFileMapping(pFilename, nullptr, &pEncoding);
     if (SUCCEEDED(hr)) {
       *ppIncludeSource = pEncoding.Detach();
     }
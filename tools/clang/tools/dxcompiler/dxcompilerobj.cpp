@@ -12,12 +12,14 @@
 #include "clang/AST/ASTConsumer.h"
 #include "clang/AST/ASTContext.h"
 #include "clang/AST/RecursiveASTVisitor.h"
+#include "clang/Basic/CharInfo.h"
 #include "clang/Basic/Diagnostic.h"
 #include "clang/Basic/FileManager.h"
 #include "clang/Basic/SourceManager.h"
 #include "clang/Basic/TargetOptions.h"
 #include "clang/Basic/TargetInfo.h"
 #include "clang/Frontend/CompilerInstance.h"
+#include "clang/Lex/PPCallbacks.h"
 #include "clang/Lex/Preprocessor.h"
 #include "clang/Lex/HLSLMacroExpander.h"
 #include "clang/Parse/ParseAST.h"
@@ -40,6 +42,7 @@
 #include "dxc/HLSL/DxilPipelineStateValidation.h"
 #include "dxc/HLSL/HLSLExtensionsCodegenHelper.h"
 #include "dxc/HLSL/DxilRootSignature.h"
+#include "dxc/HLSL/DxilCompileTimeReport.h"
 
 #if defined(_MSC_VER)
 #include <io.h>
@@ -74,7 +77,12 @@
 #include "dxc/Support/HLSLOptions.h"
 #include "dxcetw.h"
 #include "dxillib.h"
+#include "dxccompilecache.h"
 #include <algorithm>
+#include <map>
+#include <set>
+#include <unordered_map>
+#include <unordered_set>
 
 #define CP_UTF16 1200
 
@@ -232,6 +240,147 @@ static bool IsAbsoluteOrCurDirRelative(const Twine &T) {
   return false;
 }
 
+// A precompiled header (/Yc) is the flattened preprocessor output of a header
+// and everything it includes, with macro definitions kept. It starts with a
+// banner, the configuration it was preprocessed with, and one line per file
+// it covers, so that a compile using it (/Yu) can skip those files when the
+// source includes them again.
+static const char PchBanner[] = "// DXC precompiled header\n";
+static const char PchTargetPrefix[] = "// target: ";
+static const char PchVersionPrefix[] = "// hlsl: ";
+static const char PchDefinePrefix[] = "// define: ";
+static const char PchUndefinedPrefix[] = "// undefined: ";
+static const char PchCoversPrefix[] = "// covers: ";
+
+// Conditionals in a precompiled header were resolved with the target profile
+// and language version it was created with, so only compiles with the same
+// ones can use it.
+static std::string
+GetPrecompiledHeaderConfig(StringRef targetProfile,
+                           const hlsl::options::DxcOpts &opts) {
+  std::string config;
+  raw_string_ostream OS(config);
+  OS << PchTargetPrefix << targetProfile << "\n";
+  OS << PchVersionPrefix
+     << (opts.HLSL2015 ? "2015" : opts.HLSL2017 ? "2017" : "2016") << "\n";
+  return OS.str();
+}
+
+// Maps each macro name to its define string; later defines win, as they do
+// in the preprocessor.
+static std::map<std::string, std::string>
+GetDefinesByName(const std::vector<std::string> &defines) {
+  std::map<std::string, std::string> definesByName;
+  for (const std::string &define : defines)
+    definesByName[StringRef(define).split('=').first.str()] = define;
+  return definesByName;
+}
+
+// Records the macros a precompiled header depends on: those it tests or
+// expands while they are undefined or defined outside its files, as on the
+// command line. Macros the header defines itself are part of its text, so
+// other defines don't keep a compile from using it.
+class PrecompiledHeaderMacroRecorder : public PPCallbacks {
+private:
+  Preprocessor &m_PP;
+  std::set<std::string> &m_defined;
+  std::set<std::string> &m_undefined;
+
+  void Record(const Token &MacroNameTok, const MacroDefinition &MD) {
+    IdentifierInfo *II = MacroNameTok.getIdentifierInfo();
+    if (II == nullptr)
+      return;
+    if (!MD) {
+      m_undefined.insert(II->getName().str());
+      return;
+    }
+    SourceLocation DefLoc = MD.getMacroInfo()->getDefinitionLoc();
+    SourceManager &SM = m_PP.getSourceManager();
+    if (DefLoc.isInvalid() ||
+        SM.getFileID(SM.getExpansionLoc(DefLoc)) == m_PP.getPredefinesFileID())
+      m_defined.insert(II->getName().str());
+  }
+
+  // Identifiers in a condition that aren't macros evaluate to zero without
+  // any callback, so they are picked out of the condition text.
+  void RecordUndefinedInCondition(SourceRange ConditionRange) {
+    StringRef text = Lexer::getSourceText(
+        CharSourceRange::getCharRange(ConditionRange),
+        m_PP.getSourceManager(), m_PP.getLangOpts());
+    size_t i = 0;
+    while (i < text.size()) {
+      if (!isIdentifierHead(text[i])) {
+        // Skip the rest of a number, so suffixes aren't read as names.
+        bool isNumber = isDigit(text[i]);
+        ++i;
+        while (isNumber && i < text.size() && isIdentifierBody(text[i]))
+          ++i;
+        continue;
+      }
+      size_t start = i;
+      while (i < text.size() && isIdentifierBody(text[i]))
+        ++i;
+      StringRef name = text.slice(start, i);
+      if (name != "defined" &&
+          !m_PP.isMacroDefined(name))
+        m_undefined.insert(name.str());
+    }
+  }
+
+public:
+  PrecompiledHeaderMacroRecorder(Preprocessor &PP,
+                                 std::set<std::string> &defined,
+                                 std::set<std::string> &undefined)
+      : m_PP(PP), m_defined(defined), m_undefined(undefined) {}
+
+  void MacroExpands(const Token &MacroNameTok, const MacroDefinition &MD,
+                    SourceRange Range, const MacroArgs *Args) override {
+    Record(MacroNameTok, MD);
+  }
+  void Defined(const Token &MacroNameTok, const MacroDefinition &MD,
+               SourceRange Range) override {
+    Record(MacroNameTok, MD);
+  }
+  void Ifdef(SourceLocation Loc, const Token &MacroNameTok,
+             const MacroDefinition &MD) override {
+    Record(MacroNameTok, MD);
+  }
+  void Ifndef(SourceLocation Loc, const Token &MacroNameTok,
+              const MacroDefinition &MD) override {
+    Record(MacroNameTok, MD);
+  }
+  void If(SourceLocation Loc, SourceRange ConditionRange,
+          ConditionValueKind ConditionValue) override {
+    RecordUndefinedInCondition(ConditionRange);
+  }
+  void Elif(SourceLocation Loc, SourceRange ConditionRange,
+            ConditionValueKind ConditionValue, SourceLocation IfLoc) override {
+    RecordUndefinedInCondition(ConditionRange);
+  }
+};
+
+// Lists the command-line defines the precompiled header depends on, and the
+// macros it expects to be undefined. Predefined macros it uses follow from
+// the target profile and language version, which are compared anyway.
+static std::string
+GetPrecompiledHeaderMacroConfig(const std::set<std::string> &defined,
+                                const std::set<std::string> &undefined,
+                                const std::vector<std::string> &defines) {
+  std::map<std::string, std::string> definesByName = GetDefinesByName(defines);
+  std::set<std::string> used(defined);
+  used.insert(undefined.begin(), undefined.end());
+  std::string config;
+  raw_string_ostream OS(config);
+  for (const std::string &name : used) {
+    auto it = definesByName.find(name);
+    if (it != definesByName.end())
+      OS << PchDefinePrefix << it->second << "\n";
+    else if (undefined.count(name) != 0)
+      OS << PchUndefinedPrefix << name << "\n";
+  }
+  return OS.str();
+}
+
 /// File system based on API arguments. Support being added incrementally.
 ///
 /// DxcArgsFileSystem emulates a file system to clang/llvm based on API
@@ -267,6 +416,14 @@ private:
   CComPtr<IDxcIncludeHandler> m_includeLoader;
   std::vector<std::wstring> m_searchEntries;
   bool m_bDisplayIncludeProcess;
+  bool m_bRecordDependencies;
+  bool m_bHashDependencies;
+  std::vector<DxcCompileCacheDependency> m_dependencies;
+  std::wstring m_pchName;
+  std::string m_pchConfig;
+  std::map<std::string, std::string> m_pchDefines;
+  bool m_bPchConfigMismatch;
+  std::unordered_set<std::wstring> m_pchCoveredFiles;
 
   // Some constraints of the current design: opening the same file twice
   // will return the same handle/structure, and thus the same file pointer.
@@ -313,6 +470,67 @@ private:
     }
     return INVALID_HANDLE_VALUE;
   }
+  void RecordDependency(LPCWSTR lpFileName, _In_opt_ IDxcBlob *pBlob) {
+    if (!m_bRecordDependencies)
+      return;
+    DxcCompileCacheDependency dep;
+    dep.Name = lpFileName;
+    dep.Present = pBlob != nullptr;
+    if (dep.Present && m_bHashDependencies) {
+      IFT(DxcCompileCacheHashBlob(pBlob, dep.Hash));
+    }
+    else {
+      memset(dep.Hash, 0, sizeof(dep.Hash));
+    }
+    m_dependencies.emplace_back(std::move(dep));
+  }
+  void ReadPrecompiledHeaderCoverage(IDxcBlob *pBlob) {
+    StringRef text((const char *)pBlob->GetBufferPointer(),
+                   pBlob->GetBufferSize());
+    if (!text.startswith(PchBanner))
+      return;
+    text = text.substr(strlen(PchBanner));
+    // Only the macros the header depends on have to match; other defines
+    // are free to differ.
+    std::string config;
+    bool macrosMatch = true;
+    while (text.startswith(PchTargetPrefix) ||
+           text.startswith(PchVersionPrefix) ||
+           text.startswith(PchDefinePrefix) ||
+           text.startswith(PchUndefinedPrefix)) {
+      std::pair<StringRef, StringRef> lineAndRest = text.split('\n');
+      StringRef line = lineAndRest.first.rtrim("\r");
+      text = lineAndRest.second;
+      if (line.startswith(PchDefinePrefix)) {
+        StringRef define = line.substr(strlen(PchDefinePrefix));
+        auto it = m_pchDefines.find(define.split('=').first.str());
+        if (it == m_pchDefines.end() || it->second != define)
+          macrosMatch = false;
+      }
+      else if (line.startswith(PchUndefinedPrefix)) {
+        if (m_pchDefines.count(line.substr(strlen(PchUndefinedPrefix)).str()))
+          macrosMatch = false;
+      }
+      else {
+        config += line;
+        config += "\n";
+      }
+    }
+    // A header made for another configuration covers nothing; the compile
+    // is rejected by CheckPrecompiledHeader.
+    if (!macrosMatch || config != m_pchConfig) {
+      m_bPchConfigMismatch = true;
+      return;
+    }
+    while (text.startswith(PchCoversPrefix)) {
+      std::pair<StringRef, StringRef> lineAndRest = text.split('\n');
+      std::string fileName =
+          lineAndRest.first.substr(strlen(PchCoversPrefix)).rtrim("\r").str();
+      m_pchCoveredFiles.insert(
+          Unicode::UTF8ToUTF16StringOrThrow(fileName.c_str()));
+      text = lineAndRest.second;
+    }
+  }
   DWORD TryFindOrOpen(LPCWSTR lpFileName, size_t &index) {
     for (size_t i = 0; i < m_includedFiles.size(); ++i) {
       if (0 == wcscmp(lpFileName, m_includedFiles[i].Name.data())) {
@@ -321,6 +539,25 @@ private:
       }
     }
 
+    // Files already flattened into the precompiled header read as empty, so
+    // they are neither loaded nor lexed again. They aren't recorded as
+    // dependencies; the precompiled header is, and its contents stand in for
+    // theirs.
+    if (m_pchCoveredFiles.count(lpFileName) != 0) {
+      if (m_includedFiles.size() == MaxIncludedFiles) {
+        return ERROR_OUT_OF_STRUCTURES;
+      }
+      CComPtr<IDxcBlobEncoding> emptyBlob;
+      CComPtr<IStream> emptyStream;
+      if (FAILED(DxcCreateBlobWithEncodingFromPinned("", 0, CP_UTF8, &emptyBlob)) ||
+          FAILED(hlsl::CreateReadOnlyBlobStream(emptyBlob, &emptyStream))) {
+        return ERROR_UNHANDLED_EXCEPTION;
+      }
+      m_includedFiles.emplace_back(std::wstring(lpFileName), emptyBlob, emptyStream);
+      index = m_includedFiles.size() - 1;
+      return ERROR_SUCCESS;
+    }
+
     if (m_includeLoader.p != nullptr) {
       if (m_includedFiles.size() == MaxIncludedFiles) {
         return ERROR_OUT_OF_STRUCTURES;
@@ -329,6 +566,7 @@ private:
       CComPtr<IDxcBlob> fileBlob;
       HRESULT hr = m_includeLoader->LoadSource(lpFileName, &fileBlob);
       if (FAILED(hr)) {
+        RecordDependency(lpFileName, nullptr);
         return ERROR_UNHANDLED_EXCEPTION;
       }
       if (fileBlob.p != nullptr) {
@@ -336,6 +574,10 @@ private:
         if (FAILED(hlsl::DxcGetBlobAsUtf8(fileBlob, &fileBlobEncoded))) {
           return ERROR_UNHANDLED_EXCEPTION;
         }
+        RecordDependency(lpFileName, fileBlobEncoded);
+        if (!m_pchName.empty() && m_pchName == lpFileName) {
+          ReadPrecompiledHeaderCoverage(fileBlobEncoded);
+        }
         CComPtr<IStream> fileStream;
         if (FAILED(hlsl::CreateReadOnlyBlobStream(fileBlobEncoded, &fileStream))) {
           return ERROR_UNHANDLED_EXCEPTION;
@@ -356,6 +598,7 @@ private:
         }
         return ERROR_SUCCESS;
       }
+      RecordDependency(lpFileName, nullptr);
     }
     return ERROR_NOT_FOUND;
   }
@@ -374,7 +617,8 @@ private:
 public:
   DxcArgsFileSystem(_In_ IDxcBlob *pSource, LPCWSTR pSourceName, _In_opt_ IDxcIncludeHandler* pHandler)
       : m_pSource(pSource), m_pSourceName(pSourceName), m_includeLoader(pHandler), m_bDisplayIncludeProcess(false),
-        m_pOutputStreamName(nullptr) {
+        m_bRecordDependencies(false), m_bHashDependencies(false),
+        m_bPchConfigMismatch(false), m_pOutputStreamName(nullptr) {
     MakeAbsoluteOrCurDirRelativeW(m_pSourceName, m_pAbsSourceName);
     IFT(CreateReadOnlyBlobStream(m_pSource, &m_pSourceStream));
     m_includedFiles.push_back(IncludedFile(std::wstring(m_pSourceName), m_pSource, m_pSourceStream));
@@ -382,6 +626,41 @@ public:
   void EnableDisplayIncludeProcess() {
     m_bDisplayIncludeProcess = true;
   }
+  void EnableDependencyRecording(bool bHashContents = true) {
+    m_bRecordDependencies = true;
+    m_bHashDependencies = bHashContents;
+  }
+  const std::vector<DxcCompileCacheDependency> &GetDependencies() const {
+    return m_dependencies;
+  }
+  void SetPrecompiledHeader(LPCWSTR pName, StringRef config,
+                            const std::vector<std::string> &defines) {
+    std::wstring nameStorage;
+    MakeAbsoluteOrCurDirRelativeW(pName, nameStorage);
+    m_pchName = pName;
+    m_pchConfig = config;
+    m_pchDefines = GetDefinesByName(defines);
+  }
+  // Loads the precompiled header set with SetPrecompiledHeader, and returns
+  // false if it was created with a different configuration. A missing file
+  // is left for the preprocessor to report.
+  bool CheckPrecompiledHeader() {
+    size_t index;
+    TryFindOrOpen(m_pchName.c_str(), index);
+    return !m_bPchConfigMismatch;
+  }
+  void WritePrecompiledHeaderBanner(raw_ostream &OS, StringRef config) {
+    // The source itself is covered under the name includers will use for it.
+    LPCWSTR pSourceName = m_pSourceName;
+    std::wstring sourceNameStorage;
+    MakeAbsoluteOrCurDirRelativeW(pSourceName, sourceNameStorage);
+    OS << PchBanner << config;
+    OS << PchCoversPrefix << Unicode::UTF16ToUTF8StringOrThrow(pSourceName) << "\n";
+    for (const DxcCompileCacheDependency &dep : m_dependencies) {
+      if (dep.Present)
+        OS << PchCoversPrefix << Unicode::UTF16ToUTF8StringOrThrow(dep.Name.c_str()) << "\n";
+    }
+  }
   void WriteStdErrToStream(raw_string_ostream &s) {
     s.write((char*)m_pStdErrStream->GetPtr(), m_pStdErrStream->GetPtrSize());
     s.flush();
@@ -781,6 +1060,114 @@ CreateDxcArgsFileSystem(_In_ IDxcBlob *pSource, _In_ LPCWSTR pSourceName,
   return S_OK;
 }
 
+/// Include handler that remembers what another handler returned.
+///
+/// Used for batch compiles, so that each included file is loaded and decoded
+/// to UTF-8 once for all permutations rather than once per permutation.
+/// Failed loads are remembered too, as the search path probes the same
+/// missing candidates for every permutation.
+class DxcSharedIncludeHandler : public IDxcIncludeHandler {
+private:
+  DXC_MICROCOM_REF_FIELD(m_dwRef)
+  CComPtr<IDxcIncludeHandler> m_pInner;
+  struct LoadResult {
+    HRESULT hr;
+    CComPtr<IDxcBlob> Blob;
+  };
+  std::unordered_map<std::wstring, LoadResult> m_loaded;
+
+public:
+  DXC_MICROCOM_ADDREF_RELEASE_IMPL(m_dwRef)
+  DxcSharedIncludeHandler(_In_ IDxcIncludeHandler *pInner)
+      : m_dwRef(0), m_pInner(pInner) {}
+
+  __override HRESULT STDMETHODCALLTYPE QueryInterface(REFIID iid, void **ppvObject) {
+    return DoBasicQueryInterface<IDxcIncludeHandler>(this, iid, ppvObject);
+  }
+
+  __override HRESULT STDMETHODCALLTYPE LoadSource(
+      _In_ LPCWSTR pFilename,
+      _COM_Outptr_result_maybenull_ IDxcBlob **ppIncludeSource) {
+    if (pFilename == nullptr || ppIncludeSource == nullptr)
+      return E_INVALIDARG;
+    *ppIncludeSource = nullptr;
+    try {
+      auto found = m_loaded.find(pFilename);
+      if (found == m_loaded.end()) {
+        LoadResult result;
+        CComPtr<IDxcBlob> pBlob;
+        result.hr = m_pInner->LoadSource(pFilename, &pBlob);
+        if (SUCCEEDED(result.hr) && pBlob != nullptr) {
+          CComPtr<IDxcBlobEncoding> pUtf8Blob;
+          result.hr = DxcGetBlobAsUtf8(pBlob, &pUtf8Blob);
+          result.Blob = pUtf8Blob;
+        }
+        found = m_loaded.emplace(pFilename, std::move(result)).first;
+      }
+      if (SUCCEEDED(found->second.hr) && found->second.Blob != nullptr) {
+        *ppIncludeSource = found->second.Blob;
+        (*ppIncludeSource)->AddRef();
+      }
+      return found->second.hr;
+    }
+    CATCH_CPP_RETURN_HRESULT();
+  }
+};
+
+/// Compile result that also carries the time report of the compile.
+class DxcTimeReportOperationResult : public IDxcOperationResult,
+                                     public IDxcCompileTimeReport {
+private:
+  DXC_MICROCOM_REF_FIELD(m_dwRef)
+  CComPtr<IDxcOperationResult> m_pInner;
+  CComPtr<IDxcBlobEncoding> m_pReport;
+
+public:
+  DXC_MICROCOM_ADDREF_RELEASE_IMPL(m_dwRef)
+  DxcTimeReportOperationResult(_In_ IDxcOperationResult *pInner,
+                               _In_ IDxcBlobEncoding *pReport)
+      : m_dwRef(0), m_pInner(pInner), m_pReport(pReport) {}
+
+  __override HRESULT STDMETHODCALLTYPE QueryInterface(REFIID iid, void **ppvObject) {
+    return DoBasicQueryInterface2<IDxcOperationResult, IDxcCompileTimeReport>(
+        this, iid, ppvObject);
+  }
+
+  __override HRESULT STDMETHODCALLTYPE GetStatus(_Out_ HRESULT *pStatus) {
+    return m_pInner->GetStatus(pStatus);
+  }
+  __override HRESULT STDMETHODCALLTYPE
+  GetResult(_COM_Outptr_result_maybenull_ IDxcBlob **pResult) {
+    return m_pInner->GetResult(pResult);
+  }
+  __override HRESULT STDMETHODCALLTYPE
+  GetErrorBuffer(_COM_Outptr_result_maybenull_ IDxcBlobEncoding **pErrors) {
+    return m_pInner->GetErrorBuffer(pErrors);
+  }
+  __override HRESULT STDMETHODCALLTYPE
+  GetTimeReport(_COM_Outptr_result_maybenull_ IDxcBlobEncoding **ppReport) {
+    if (ppReport == nullptr)
+      return E_INVALIDARG;
+    return m_pReport.CopyTo(ppReport);
+  }
+
+  static void Wrap(const hlsl::DxilCompileTimeReport &report,
+                   _Inout_ IDxcOperationResult **ppResult) {
+    std::string json;
+    raw_string_ostream OS(json);
+    report.WriteJson(OS);
+    OS.flush();
+    CComPtr<IDxcBlobEncoding> pReport;
+    IFT(DxcCreateBlobWithEncodingOnHeapCopy(json.data(), json.size(), CP_UTF8,
+                                            &pReport));
+    CComPtr<DxcTimeReportOperationResult> pWrapper =
+        new (std::nothrow) DxcTimeReportOperationResult(*ppResult, pReport);
+    IFTOOM(pWrapper.p);
+    (*ppResult)->Release();
+    *ppResult = pWrapper.Detach();
+  }
+};
+
 static void CreateOperationResultFromOutputs(
     IDxcBlob *pResultBlob, DxcArgsFileSystem *msfPtr,
     const std::string &warnings, clang::DiagnosticsEngine &diags,
@@ -1950,10 +2337,10 @@ public:
       m_llvmModuleWithDebugInfo.reset(llvm::CloneModule(m_llvmModule.get()));
   }
 
- void WrapModuleInDxilContainer(IMalloc *pMalloc,  AbstractMemoryStream *pModuleBitcode, CComPtr<IDxcBlob> &pDxilContainerBlob) {
+ void WrapModuleInDxilContainer(IMalloc *pMalloc,  AbstractMemoryStream *pModuleBitcode, CComPtr<IDxcBlob> &pDxilContainerBlob, bool bIncludeShaderHash) {
     CComPtr<AbstractMemoryStream> pContainerStream;
     IFT(CreateMemoryStream(pMalloc, &pContainerStream));
-    SerializeDxilContainerForModule(&m_llvmModule->GetOrCreateDxilModule(), pModuleBitcode, pContainerStream);
+    SerializeDxilContainerForModule(&m_llvmModule->GetOrCreateDxilModule(), pModuleBitcode, pContainerStream, bIncludeShaderHash);
 
     pDxilContainerBlob.Release();
     IFT(pContainerStream.QueryInterface(&pDxilContainerBlob));
@@ -1967,7 +2354,7 @@ private:
   std::unique_ptr<llvm::Module> m_llvmModuleWithDebugInfo;
 };
 
-class DxcCompiler : public IDxcCompiler, public IDxcLangExtensions, public IDxcContainerEvent {
+class DxcCompiler : public IDxcCompiler, public IDxcBatchCompiler, public IDxcDependencyScanner, public IDxcLangExtensions, public IDxcContainerEvent, public IDxcCompileCacheStats {
 private:
   DXC_MICROCOM_REF_FIELD(m_dwRef)
   DxcLangExtensionsHelper m_langExtensionsHelper;
@@ -1987,11 +2374,29 @@ private:
     }
   }
 
+  void CreatePrecompiledHeaderMismatchResult(StringRef pchName,
+                                             IDxcOperationResult **ppResult) {
+    std::string error;
+    raw_string_ostream OS(error);
+    OS << "error: precompiled header '" << pchName
+       << "' was created with different defines, target profile or HLSL "
+          "version; recreate it with /Yc\n";
+    OS.flush();
+    CComPtr<IDxcBlobEncoding> pErrorBlob;
+    IFT(DxcCreateBlobWithEncodingOnHeapCopy(error.c_str(), error.size(),
+                                            CP_UTF8, &pErrorBlob));
+    IFT(DxcOperationResult::CreateFromResultErrorStatus(nullptr, pErrorBlob,
+                                                        E_INVALIDARG, ppResult));
+  }
+
   void ReadOptsAndValidate(hlsl::options::MainArgs &mainArgs,
                            hlsl::options::DxcOpts &opts,
-                           AbstractMemoryStream *pOutputStream,
                            _COM_Outptr_ IDxcOperationResult **ppResult,
                            bool &finished) {
+    CComPtr<IMalloc> pMalloc;
+    CComPtr<AbstractMemoryStream> pOutputStream;
+    IFT(CoGetMalloc(1, &pMalloc));
+    IFT(CreateMemoryStream(pMalloc, &pOutputStream));
     const llvm::opt::OptTable *table = ::options::getHlslOptTable();
     raw_stream_ostream outStream(pOutputStream);
     if (0 != hlsl::options::ReadDxcOpts(table, hlsl::options::CompilerFlags,
@@ -2009,6 +2414,72 @@ private:
     DXASSERT(!opts.HLSL2015, "else ReadDxcOpts didn't fail for non-isense");
     finished = false;
   }
+
+  // Results can only be reused when everything that affects them is known
+  // up front; opaque callbacks and diagnostic-only modes are excluded.
+  bool CanUseCompileCache(const hlsl::options::DxcOpts &opts) {
+    return !opts.CompileCacheDirectory.empty() && !opts.AstDump &&
+           !opts.OptDump && !opts.DisplayIncludeProcess && !opts.TimeReport &&
+           m_langExtensionsHelper.GetIntrinsicTables().empty() &&
+           !m_langExtensionsHelper.HasSemanticDefineValidator();
+  }
+
+  void ComputeCompileCacheKey(IDxcBlob *pUtf8Source, LPCSTR pUtf8SourceName,
+                              LPCSTR pUtf8EntryPoint, LPCSTR pUtf8TargetProfile,
+                              const std::vector<std::string> &defines,
+                              const hlsl::options::DxcOpts &opts,
+                              bool internalValidator, UINT32 valMajor,
+                              UINT32 valMinor, llvm::MD5::MD5Result &key) {
+    DxcCompileCacheKeyBuilder builder;
+    builder.AddBytes(pUtf8Source->GetBufferPointer(), pUtf8Source->GetBufferSize());
+    builder.AddString(pUtf8SourceName);
+    builder.AddString(pUtf8EntryPoint);
+    builder.AddString(pUtf8TargetProfile);
+    builder.AddUInt32(defines.size());
+    for (const std::string &define : defines)
+      builder.AddString(define);
+
+    // Normalize arguments to option IDs and values so that spelling
+    // differences (-Zi vs /Zi) don't split the cache. Defines were already
+    // folded in above, and the cache settings don't affect the output.
+    for (const llvm::opt::Arg *A : opts.Args) {
+      unsigned id = A->getOption().getID();
+      if (id == hlsl::options::OPT_compile_cache ||
+          id == hlsl::options::OPT_compile_cache_size ||
+          id == hlsl::options::OPT_D)
+        continue;
+      builder.AddUInt32(id);
+      builder.AddUInt32(A->getNumValues());
+      for (const char *pValue : A->getValues())
+        builder.AddString(pValue);
+    }
+
+    for (const std::string &define : m_langExtensionsHelper.GetSemanticDefines())
+      builder.AddString(define);
+    builder.AddUInt32(0);
+    for (const std::string &define : m_langExtensionsHelper.GetSemanticDefineExclusions())
+      builder.AddString(define);
+    builder.AddUInt32(0);
+    for (const std::string &define : m_langExtensionsHelper.GetDefines())
+      builder.AddString(define);
+    builder.AddString(m_langExtensionsHelper.GetSemanticDefineMetadataName());
+
+    // dxil.dll signs the container, so results differ from the built-in one.
+    builder.AddUInt32(internalValidator ? 1 : 0);
+    builder.AddUInt32(valMajor);
+    builder.AddUInt32(valMinor);
+    builder.Final(key);
+  }
+
+  void OnDxilContainerBuilt(CComPtr<IDxcBlob> &pOutputBlob) {
+    CComPtr<IDxcBlob> pTargetBlob;
+    if (m_pDxcContainerEventsHandler != nullptr) {
+      HRESULT hr = m_pDxcContainerEventsHandler->OnDxilContainerBuilt(pOutputBlob, &pTargetBlob);
+      if (SUCCEEDED(hr) && pTargetBlob != nullptr) {
+        std::swap(pOutputBlob, pTargetBlob);
+      }
+    }
+  }
 public:
   DXC_MICROCOM_ADDREF_RELEASE_IMPL(m_dwRef)
   DXC_LANGEXTENSIONS_HELPER_IMPL(m_langExtensionsHelper)
@@ -2025,8 +2496,23 @@ public:
     return S_OK;
   }
 
+  __override HRESULT STDMETHODCALLTYPE GetCompileCacheStats(
+      _Out_ UINT64 *pHits, _Out_ UINT64 *pMisses, _Out_ UINT64 *pStores,
+      _Out_ UINT64 *pEvictions) {
+    if (pHits == nullptr || pMisses == nullptr || pStores == nullptr ||
+        pEvictions == nullptr)
+      return E_POINTER;
+    DxcCompileCacheStats stats;
+    DxcCompileCache::GetStats(&stats);
+    *pHits = stats.Hits;
+    *pMisses = stats.Misses;
+    *pStores = stats.Stores;
+    *pEvictions = stats.Evictions;
+    return S_OK;
+  }
+
   HRESULT STDMETHODCALLTYPE QueryInterface(REFIID iid, void **ppvObject) {
-    return DoBasicQueryInterface3<IDxcCompiler, IDxcLangExtensions, IDxcContainerEvent>(this, iid, ppvObject);
+    return DoBasicQueryInterface6<IDxcCompiler, IDxcBatchCompiler, IDxcDependencyScanner, IDxcLangExtensions, IDxcContainerEvent, IDxcCompileCacheStats>(this, iid, ppvObject);
   }
 
   // Compile a single entry point to the target shader model
@@ -2055,265 +2541,451 @@ public:
     IFC(hlsl::DxcGetBlobAsUtf8(pSource, &utf8Source));
 
     try {
-      CComPtr<IMalloc> pMalloc;
-      CComPtr<AbstractMemoryStream> pOutputStream;
-      CComPtr<IDxcBlob> pOutputBlob;
-      DxcArgsFileSystem *msfPtr;
-      IFT(CreateDxcArgsFileSystem(utf8Source, pSourceName, pIncludeHandler, &msfPtr));
-      std::unique_ptr<::llvm::sys::fs::MSFileSystem> msf(msfPtr);
+      int argCountInt;
+      IFT(UIntToInt(argCount, &argCountInt));
+      hlsl::options::MainArgs mainArgs(argCountInt, pArguments, 0);
+      hlsl::options::DxcOpts opts;
+      bool finished;
+      ReadOptsAndValidate(mainArgs, opts, ppResult, finished);
+      if (finished) {
+        hr = S_OK;
+        goto Cleanup;
+      }
 
-      ::llvm::sys::fs::AutoPerThreadSystem pts(msf.get());
-      IFTLLVM(pts.error_code());
+      CompileWithOpts(utf8Source, pSourceName, pEntryPoint, pTargetProfile,
+                      pArguments, argCount, opts, pDefines, defineCount,
+                      pIncludeHandler, ppResult);
+      hr = S_OK;
+    }
+    CATCH_CPP_ASSIGN_HRESULT();
+  Cleanup:
+    DxcEtw_DXCompilerCompile_Stop(hr);
+    return hr;
+  }
 
-      IFT(CoGetMalloc(1, &pMalloc));
-      IFT(CreateMemoryStream(pMalloc, &pOutputStream));
-      IFT(pOutputStream.QueryInterface(&pOutputBlob));
+  // Compile a batch of entry point, profile and define permutations of one
+  // source. Options are parsed once, and each included file is loaded and
+  // decoded once for the whole batch.
+  __override HRESULT STDMETHODCALLTYPE CompileBatch(
+    _In_ IDxcBlob *pSource,                       // Source text to compile
+    _In_opt_ LPCWSTR pSourceName,                 // Optional file name for pSource. Used in errors and include handlers.
+    _In_count_(argCount) LPCWSTR *pArguments,     // Array of pointers to arguments shared by all permutations
+    _In_ UINT32 argCount,                         // Number of arguments
+    _In_count_(permutationCount) const DxcPermutation *pPermutations, // Array of permutations to compile
+    _In_ UINT32 permutationCount,                 // Number of permutations
+    _In_opt_ IDxcIncludeHandler *pIncludeHandler, // user-provided interface to handle #include directives (optional)
+    _Out_writes_(permutationCount) IDxcOperationResult **ppResults // One compiler output per permutation
+    ) {
+    if (pSource == nullptr || ppResults == nullptr ||
+        (argCount > 0 && pArguments == nullptr) ||
+        (permutationCount > 0 && pPermutations == nullptr))
+      return E_INVALIDARG;
+    for (UINT32 i = 0; i < permutationCount; ++i) {
+      const DxcPermutation &P = pPermutations[i];
+      if (P.pEntryPoint == nullptr || P.pTargetProfile == nullptr ||
+          (P.defineCount > 0 && P.pDefines == nullptr))
+        return E_INVALIDARG;
+    }
+    std::fill(ppResults, ppResults + permutationCount, nullptr);
+
+    HRESULT hr = S_OK;
+    CComPtr<IDxcBlobEncoding> utf8Source;
+    DxcEtw_DXCompilerCompile_Start();
+    IFC(hlsl::DxcGetBlobAsUtf8(pSource, &utf8Source));
 
+    try {
       int argCountInt;
       IFT(UIntToInt(argCount, &argCountInt));
       hlsl::options::MainArgs mainArgs(argCountInt, pArguments, 0);
       hlsl::options::DxcOpts opts;
       bool finished;
-      ReadOptsAndValidate(mainArgs, opts, pOutputStream, ppResult, finished);
+      CComPtr<IDxcOperationResult> pOptionsResult;
+      ReadOptsAndValidate(mainArgs, opts, &pOptionsResult, finished);
       if (finished) {
+        // The arguments are shared, so every permutation fails the same way.
+        for (UINT32 i = 0; i < permutationCount; ++i) {
+          ppResults[i] = pOptionsResult;
+          ppResults[i]->AddRef();
+        }
         hr = S_OK;
         goto Cleanup;
       }
-      if (opts.DisplayIncludeProcess)
-        msfPtr->EnableDisplayIncludeProcess();
 
-      // Prepare UTF8-encoded versions of API values.
-      CW2A pUtf8EntryPoint(pEntryPoint, CP_UTF8);
-      CW2A pUtf8TargetProfile(pTargetProfile, CP_UTF8);
-      CW2A utf8SourceName(pSourceName, CP_UTF8);
-      const char *pUtf8SourceName = utf8SourceName.m_psz;
-      if (pUtf8SourceName == nullptr) {
-        if (opts.InputFile.empty()) {
-          pUtf8SourceName = "input.hlsl";
-        }
-        else {
-          pUtf8SourceName = opts.InputFile.data();
-        }
+      CComPtr<IDxcIncludeHandler> pSharedIncludeHandler;
+      if (pIncludeHandler != nullptr) {
+        pSharedIncludeHandler = new DxcSharedIncludeHandler(pIncludeHandler);
       }
 
-      IFT(msfPtr->RegisterOutputStream(L"output.bc", pOutputStream));
-      IFT(msfPtr->CreateStdStreams(pMalloc));
+      for (UINT32 i = 0; i < permutationCount; ++i) {
+        const DxcPermutation &P = pPermutations[i];
+        CompileWithOpts(utf8Source, pSourceName, P.pEntryPoint,
+                        P.pTargetProfile, pArguments, argCount, opts,
+                        P.pDefines, P.defineCount, pSharedIncludeHandler,
+                        &ppResults[i]);
+      }
+      hr = S_OK;
+    }
+    CATCH_CPP_ASSIGN_HRESULT();
+    if (FAILED(hr)) {
+      for (UINT32 i = 0; i < permutationCount; ++i) {
+        if (ppResults[i] != nullptr) {
+          ppResults[i]->Release();
+          ppResults[i] = nullptr;
+        }
+      }
+    }
+  Cleanup:
+    DxcEtw_DXCompilerCompile_Stop(hr);
+    return hr;
+  }
 
-      StringRef Data((LPSTR)utf8Source->GetBufferPointer(),
-                     utf8Source->GetBufferSize());
-      std::unique_ptr<llvm::MemoryBuffer> pBuffer(
-          llvm::MemoryBuffer::getMemBufferCopy(Data, pUtf8SourceName));
+  // Compiles a single entry point with options that have already been read
+  // and validated. Throws on failure to produce a result.
+  void CompileWithOpts(_In_ IDxcBlobEncoding *utf8Source,
+                       _In_opt_ LPCWSTR pSourceName, _In_ LPCWSTR pEntryPoint,
+                       _In_ LPCWSTR pTargetProfile,
+                       _In_count_(argCount) LPCWSTR *pArguments,
+                       _In_ UINT32 argCount, hlsl::options::DxcOpts &opts,
+                       _In_count_(defineCount) const DxcDefine *pDefines,
+                       _In_ UINT32 defineCount,
+                       _In_opt_ IDxcIncludeHandler *pIncludeHandler,
+                       _COM_Outptr_ IDxcOperationResult **ppResult) {
+    CComPtr<IMalloc> pMalloc;
+    CComPtr<AbstractMemoryStream> pOutputStream;
+    CComPtr<IDxcBlob> pOutputBlob;
+    CComPtr<IDxcBlob> pCacheableBlob; // Output before the container event handler runs.
+    DxcArgsFileSystem *msfPtr;
+    IFT(CreateDxcArgsFileSystem(utf8Source, pSourceName, pIncludeHandler, &msfPtr));
+    std::unique_ptr<::llvm::sys::fs::MSFileSystem> msf(msfPtr);
+
+    ::llvm::sys::fs::AutoPerThreadSystem pts(msf.get());
+    IFTLLVM(pts.error_code());
+
+    IFT(CoGetMalloc(1, &pMalloc));
+    IFT(CreateMemoryStream(pMalloc, &pOutputStream));
+    IFT(pOutputStream.QueryInterface(&pOutputBlob));
+
+    if (opts.DisplayIncludeProcess)
+      msfPtr->EnableDisplayIncludeProcess();
+
+    // Prepare UTF8-encoded versions of API values.
+    CW2A pUtf8EntryPoint(pEntryPoint, CP_UTF8);
+    CW2A pUtf8TargetProfile(pTargetProfile, CP_UTF8);
+    CW2A utf8SourceName(pSourceName, CP_UTF8);
+    const char *pUtf8SourceName = utf8SourceName.m_psz;
+    if (pUtf8SourceName == nullptr) {
+      if (opts.InputFile.empty()) {
+        pUtf8SourceName = "input.hlsl";
+      }
+      else {
+        pUtf8SourceName = opts.InputFile.data();
+      }
+    }
 
-      // Not very efficient but also not very important.
-      std::vector<std::string> defines;
-      CreateDefineStrings(pDefines, defineCount, defines);
-      CreateDefineStrings(opts.Defines.data(), opts.Defines.size(), defines);
+    IFT(msfPtr->RegisterOutputStream(L"output.bc", pOutputStream));
+    IFT(msfPtr->CreateStdStreams(pMalloc));
 
-      // Setup a compiler instance.
-      std::string warnings;
-      raw_string_ostream w(warnings);
-      raw_stream_ostream outStream(pOutputStream.p);
-      CompilerInstance compiler;
-      std::unique_ptr<TextDiagnosticPrinter> diagPrinter =
-          std::make_unique<TextDiagnosticPrinter>(w, &compiler.getDiagnosticOpts());
-      SetupCompilerForCompile(compiler, &m_langExtensionsHelper, utf8SourceName, diagPrinter.get(), defines, opts, pArguments, argCount);
-      msfPtr->SetupForCompilerInstance(compiler);
+    StringRef Data((LPSTR)utf8Source->GetBufferPointer(),
+                   utf8Source->GetBufferSize());
+    std::unique_ptr<llvm::MemoryBuffer> pBuffer(
+        llvm::MemoryBuffer::getMemBufferCopy(Data, pUtf8SourceName));
 
-      // The clang entry point (cc1_main) would now create a compiler invocation
-      // from arguments, but for this path we're exclusively trying to compile
-      // to LLVM bitcode and then package that into a DXBC blob.
-      //
-      // With the compiler invocation built from command line arguments, the
-      // next step is to call ExecuteCompilerInvocation, which creates a
-      // FrontendAction* of EmitBCAction, which is a CodeGenAction, which is an
-      // ASTFrontendAction. That sets up a BackendConsumer as the ASTConsumer.
-      compiler.getFrontendOpts().OutputFile = "output.bc";
-      compiler.WriteDefaultOutputDirectly = true;
-      compiler.setOutStream(&outStream);
-
-      compiler.getLangOpts().HLSLEntryFunction =
-      compiler.getCodeGenOpts().HLSLEntryFunction = pUtf8EntryPoint.m_psz;
-      compiler.getCodeGenOpts().HLSLProfile = pUtf8TargetProfile.m_psz;
-
-      unsigned rootSigMajor = 0;
-      unsigned rootSigMinor = 0;
-      if (compiler.getCodeGenOpts().HLSLProfile == "rootsig_1_1") {
-        rootSigMajor = 1;
-        rootSigMinor = 1;
-      } else if (compiler.getCodeGenOpts().HLSLProfile == "rootsig_1_0") {
-        rootSigMajor = 1;
-        rootSigMinor = 0;
-      }
+    // Not very efficient but also not very important.
+    std::vector<std::string> defines;
+    CreateDefineStrings(pDefines, defineCount, defines);
+    CreateDefineStrings(opts.Defines.data(), opts.Defines.size(), defines);
+
+    std::string warnings;
+    raw_string_ostream w(warnings);
+
+    unsigned rootSigMajor = 0;
+    unsigned rootSigMinor = 0;
+    StringRef targetProfile(pUtf8TargetProfile.m_psz);
+    if (targetProfile == "rootsig_1_1") {
+      rootSigMajor = 1;
+      rootSigMinor = 1;
+    } else if (targetProfile == "rootsig_1_0") {
+      rootSigMajor = 1;
+      rootSigMinor = 0;
+    }
 
-      // NOTE: this calls the validation component from dxil.dll; the built-in
-      // validator can be used as a fallback.
-      bool needsValidation = !opts.CodeGenHighLevel && !opts.DisableValidation;
-      bool internalValidator = false;
-      CComPtr<IDxcValidator> pValidator;
-      CComPtr<IDxcOperationResult> pValResult;
-      if (needsValidation) {
-        if (DxilLibIsEnabled()) {
-          if (FAILED(DxilLibCreateInstance(CLSID_DxcValidator, &pValidator))) {
-            w << "Unable to create validator from dxil.dll, fallback to built-in.";
-          }
-        }
-        if (pValidator == nullptr) {
-          IFT(CreateDxcValidator(IID_PPV_ARGS(&pValidator)));
-          internalValidator = true;
-        }
-        CComPtr<IDxcVersionInfo> pVersionInfo;
-        if (SUCCEEDED(pValidator.QueryInterface(&pVersionInfo))) {
-          UINT32 majorVer, minorVer;
-          IFT(pVersionInfo->GetVersion(&majorVer, &minorVer));
-          compiler.getCodeGenOpts().HLSLValidatorMajorVer = majorVer;
-          compiler.getCodeGenOpts().HLSLValidatorMinorVer = minorVer;
+    // NOTE: this calls the validation component from dxil.dll; the built-in
+    // validator can be used as a fallback.
+    bool needsValidation = !opts.CodeGenHighLevel && !opts.DisableValidation;
+    bool internalValidator = false;
+    bool hasValidatorVersion = false;
+    UINT32 valMajorVer = 0, valMinorVer = 0;
+    CComPtr<IDxcValidator> pValidator;
+    CComPtr<IDxcOperationResult> pValResult;
+    if (needsValidation) {
+      if (DxilLibIsEnabled()) {
+        if (FAILED(DxilLibCreateInstance(CLSID_DxcValidator, &pValidator))) {
+          w << "Unable to create validator from dxil.dll, fallback to built-in.";
         }
       }
+      if (pValidator == nullptr) {
+        IFT(CreateDxcValidator(IID_PPV_ARGS(&pValidator)));
+        internalValidator = true;
+      }
+      CComPtr<IDxcVersionInfo> pVersionInfo;
+      if (SUCCEEDED(pValidator.QueryInterface(&pVersionInfo))) {
+        IFT(pVersionInfo->GetVersion(&valMajorVer, &valMinorVer));
+        hasValidatorVersion = true;
+      }
+      // Share the compile cache directory with validators that can memoize
+      // their results, so validating unchanged output is a lookup.
+      CComPtr<IDxcValidatorCache> pValidatorCache;
+      if (!opts.CompileCacheDirectory.empty() &&
+          SUCCEEDED(pValidator.QueryInterface(&pValidatorCache))) {
+        std::wstring cacheDir = Unicode::UTF8ToUTF16StringOrThrow(
+            opts.CompileCacheDirectory.str().c_str());
+        IFT(pValidatorCache->SetValidationCache(cacheDir.c_str(),
+                                                opts.CompileCacheMaxSizeMB));
+      }
+    }
 
-      if (opts.AstDump) {
-        clang::ASTDumpAction dumpAction;
-        // Consider - ASTDumpFilter, ASTDumpLookups
-        compiler.getFrontendOpts().ASTDumpDecls = true;
-        FrontendInputFile file(utf8SourceName.m_psz, IK_HLSL);
-        dumpAction.BeginSourceFile(compiler, file);
-        dumpAction.Execute();
-        dumpAction.EndSourceFile();
-        outStream.flush();
+    // Serve the request from the compile cache if an identical compile
+    // (including every file pulled in through the include handler) has
+    // already been done.
+    std::unique_ptr<DxcCompileCache> pCache;
+    llvm::MD5::MD5Result cacheKey;
+    if (CanUseCompileCache(opts)) {
+      pCache.reset(new DxcCompileCache(opts.CompileCacheDirectory,
+                                       opts.CompileCacheMaxSizeMB));
+      ComputeCompileCacheKey(utf8Source, pUtf8SourceName, pUtf8EntryPoint,
+                             pUtf8TargetProfile, defines, opts,
+                             internalValidator, valMajorVer, valMinorVer,
+                             cacheKey);
+      CComPtr<IDxcBlob> pCachedBlob;
+      std::string cachedWarnings;
+      if (pCache->Lookup(cacheKey, pIncludeHandler, &pCachedBlob, cachedWarnings)) {
+        if (!rootSigMajor)
+          OnDxilContainerBuilt(pCachedBlob);
+        CComPtr<IDxcBlobEncoding> pCachedErrors;
+        IFT(DxcCreateBlobWithEncodingOnHeapCopy(cachedWarnings.data(),
+                                                cachedWarnings.size(),
+                                                CP_UTF8, &pCachedErrors));
+        IFT(DxcOperationResult::CreateFromResultErrorStatus(
+            pCachedBlob, pCachedErrors, S_OK, ppResult));
+        return;
       }
-      else if (opts.OptDump) {
-        llvm::LLVMContext llvmContext;
-        EmitOptDumpAction action(&llvmContext);
-        FrontendInputFile file(utf8SourceName.m_psz, IK_HLSL);
-        action.BeginSourceFile(compiler, file);
-        action.Execute();
-        action.EndSourceFile();
-        outStream.flush();
+      msfPtr->EnableDependencyRecording();
+    }
+
+    // Setup a compiler instance.
+    raw_stream_ostream outStream(pOutputStream.p);
+    CompilerInstance compiler;
+    std::unique_ptr<TextDiagnosticPrinter> diagPrinter =
+        std::make_unique<TextDiagnosticPrinter>(w, &compiler.getDiagnosticOpts());
+    SetupCompilerForCompile(compiler, &m_langExtensionsHelper, utf8SourceName, diagPrinter.get(), defines, opts, pArguments, argCount);
+    msfPtr->SetupForCompilerInstance(compiler);
+    if (!opts.UsePch.empty()) {
+      msfPtr->SetPrecompiledHeader(
+          Unicode::UTF8ToUTF16StringOrThrow(opts.UsePch.str().c_str()).c_str(),
+          GetPrecompiledHeaderConfig(targetProfile, opts), defines);
+      if (!msfPtr->CheckPrecompiledHeader()) {
+        CreatePrecompiledHeaderMismatchResult(opts.UsePch, ppResult);
+        return;
       }
-      else if (rootSigMajor) {
-        HLSLRootSignatureAction action(
-            compiler.getCodeGenOpts().HLSLEntryFunction, rootSigMajor,
-            rootSigMinor);
-        FrontendInputFile file(utf8SourceName.m_psz, IK_HLSL);
-        action.BeginSourceFile(compiler, file);
-        action.Execute();
-        action.EndSourceFile();
-        outStream.flush();
-        // Don't do work to put in a container if an error has occurred
-        bool compileOK = !compiler.getDiagnostics().hasErrorOccurred();
-        if (compileOK) {
-          auto rootSigHandle = action.takeRootSigHandle();
-
-          CComPtr<AbstractMemoryStream> pContainerStream;
-          IFT(CreateMemoryStream(pMalloc, &pContainerStream));
-          SerializeDxilContainerForRootSignature(rootSigHandle.get(),
-                                                 pContainerStream);
-
-          pOutputBlob.Release();
-          IFT(pContainerStream.QueryInterface(&pOutputBlob));
-        }
+    }
+
+    // The clang entry point (cc1_main) would now create a compiler invocation
+    // from arguments, but for this path we're exclusively trying to compile
+    // to LLVM bitcode and then package that into a DXBC blob.
+    //
+    // With the compiler invocation built from command line arguments, the
+    // next step is to call ExecuteCompilerInvocation, which creates a
+    // FrontendAction* of EmitBCAction, which is a CodeGenAction, which is an
+    // ASTFrontendAction. That sets up a BackendConsumer as the ASTConsumer.
+    compiler.getFrontendOpts().OutputFile = "output.bc";
+    compiler.WriteDefaultOutputDirectly = true;
+    compiler.setOutStream(&outStream);
+
+    compiler.getLangOpts().HLSLEntryFunction =
+    compiler.getCodeGenOpts().HLSLEntryFunction = pUtf8EntryPoint.m_psz;
+    compiler.getCodeGenOpts().HLSLProfile = pUtf8TargetProfile.m_psz;
+    if (hasValidatorVersion) {
+      compiler.getCodeGenOpts().HLSLValidatorMajorVer = valMajorVer;
+      compiler.getCodeGenOpts().HLSLValidatorMinorVer = valMinorVer;
+    }
+
+    // Passes report to the listener of the compiling thread, so the report
+    // only sees passes run for this compile.
+    std::shared_ptr<hlsl::DxilCompileTimeReport> pTimeReport;
+    std::unique_ptr<llvm::PassExecutionListenerScope> pTimeReportScope;
+    if (opts.TimeReport) {
+      pTimeReport = std::make_shared<hlsl::DxilCompileTimeReport>();
+      pTimeReportScope.reset(
+          new llvm::PassExecutionListenerScope(pTimeReport.get()));
+      compiler.getCodeGenOpts().HLSLTimeReport = pTimeReport;
+    }
+
+    if (opts.AstDump) {
+      clang::ASTDumpAction dumpAction;
+      // Consider - ASTDumpFilter, ASTDumpLookups
+      compiler.getFrontendOpts().ASTDumpDecls = true;
+      FrontendInputFile file(utf8SourceName.m_psz, IK_HLSL);
+      dumpAction.BeginSourceFile(compiler, file);
+      dumpAction.Execute();
+      dumpAction.EndSourceFile();
+      outStream.flush();
+    }
+    else if (opts.OptDump) {
+      llvm::LLVMContext llvmContext;
+      EmitOptDumpAction action(&llvmContext);
+      FrontendInputFile file(utf8SourceName.m_psz, IK_HLSL);
+      action.BeginSourceFile(compiler, file);
+      action.Execute();
+      action.EndSourceFile();
+      outStream.flush();
+    }
+    else if (rootSigMajor) {
+      HLSLRootSignatureAction action(
+          compiler.getCodeGenOpts().HLSLEntryFunction, rootSigMajor,
+          rootSigMinor);
+      FrontendInputFile file(utf8SourceName.m_psz, IK_HLSL);
+      action.BeginSourceFile(compiler, file);
+      action.Execute();
+      action.EndSourceFile();
+      outStream.flush();
+      // Don't do work to put in a container if an error has occurred
+      bool compileOK = !compiler.getDiagnostics().hasErrorOccurred();
+      if (compileOK) {
+        auto rootSigHandle = action.takeRootSigHandle();
+
+        CComPtr<AbstractMemoryStream> pContainerStream;
+        IFT(CreateMemoryStream(pMalloc, &pContainerStream));
+        SerializeDxilContainerForRootSignature(rootSigHandle.get(),
+                                               pContainerStream);
+
+        pOutputBlob.Release();
+        IFT(pContainerStream.QueryInterface(&pOutputBlob));
       }
-      else {
-        llvm::LLVMContext llvmContext;
-        EmitBCAction action(&llvmContext);
-        FrontendInputFile file(utf8SourceName.m_psz, IK_HLSL);
-        bool compileOK;
-        if (action.BeginSourceFile(compiler, file)) {
-          action.Execute();
-          action.EndSourceFile();
+    }
+    else {
+      llvm::LLVMContext llvmContext;
+      // Bitcode is only needed as output for high-level codegen; otherwise
+      // the container writer serializes the finished module itself.
+      std::unique_ptr<CodeGenAction> action;
+      if (opts.CodeGenHighLevel)
+        action.reset(new EmitBCAction(&llvmContext));
+      else
+        action.reset(new EmitLLVMOnlyAction(&llvmContext));
+      FrontendInputFile file(utf8SourceName.m_psz, IK_HLSL);
+      bool compileOK;
+      {
+        // Code generation and optimization are reported as nested phases.
+        hlsl::DxilCompileTimeReport::PhaseScope phase(pTimeReport.get(),
+                                                      "frontend");
+        if (action->BeginSourceFile(compiler, file)) {
+          action->Execute();
+          action->EndSourceFile();
           compileOK = !compiler.getDiagnostics().hasErrorOccurred();
         }
         else {
           compileOK = false;
         }
-        outStream.flush();
-
-        // Don't do work to put in a container if an error has occurred
-        if (compileOK) {
-          HRESULT valHR = S_OK;
-
-          // Take ownership of the module from the action.
-          DxilCompilerLLVMModuleOutput llvmModule(action.takeModule());
-
-          // If using the internal validator, we'll use the modules directly.
-          // In this case, we'll want to make a clone to avoid SerializeDxilContainerForModule
-          // stripping all the debug info. The debug info will be stripped from the orginal
-          // module, but preserved in the cloned module.
-          if (internalValidator && opts.DebugInfo)
-            llvmModule.CloneForDebugInfo();
-
-          // Do not create a container when there is only a a high-level representation in the module.
-          if (!opts.CodeGenHighLevel)
-            llvmModule.WrapModuleInDxilContainer(pMalloc, pOutputStream, pOutputBlob);
-
-          if (needsValidation) {
-            // Important: in-place edit is required so the blob is reused and thus
-            // dxil.dll can be released.
-            if (internalValidator) {
-              IFT(RunInternalValidator(
-                pValidator, llvmModule.get(), llvmModule.getWithDebugInfo(), pOutputBlob,
-                DxcValidatorFlags_InPlaceEdit, &pValResult));
-            }
-            else {
-              IFT(pValidator->Validate(
-                pOutputBlob, DxcValidatorFlags_InPlaceEdit, &pValResult));
-            }
-            IFT(pValResult->GetStatus(&valHR));
-            if (FAILED(valHR)) {
-              CComPtr<IDxcBlobEncoding> pErrors;
-              CComPtr<IDxcBlobEncoding> pErrorsUtf8;
-              IFT(pValResult->GetErrorBuffer(&pErrors));
-              IFT(hlsl::DxcGetBlobAsUtf8(pErrors, &pErrorsUtf8));
-              StringRef errRef((const char *)pErrorsUtf8->GetBufferPointer(),
-                pErrorsUtf8->GetBufferSize());
-              DiagnosticsEngine &D = compiler.getDiagnostics();
-              unsigned DiagID = D.getCustomDiagID(DiagnosticsEngine::Error,
-                "validation errors\r\n%0");
-              D.Report(DiagID) << errRef;
-            }
-            CComPtr<IDxcBlob> pValidatedBlob;
-            IFT(pValResult->GetResult(&pValidatedBlob));
-            if (pValidatedBlob != nullptr) {
-              std::swap(pOutputBlob, pValidatedBlob);
-            }
-            pValidator.Release();
+      }
+      outStream.flush();
+
+      // Don't do work to put in a container if an error has occurred
+      if (compileOK) {
+        HRESULT valHR = S_OK;
+
+        // Take ownership of the module from the action.
+        DxilCompilerLLVMModuleOutput llvmModule(action->takeModule());
+
+        // If using the internal validator, we'll use the modules directly.
+        // In this case, we'll want to make a clone to avoid SerializeDxilContainerForModule
+        // stripping all the debug info. The debug info will be stripped from the orginal
+        // module, but preserved in the cloned module.
+        if (internalValidator && opts.DebugInfo)
+          llvmModule.CloneForDebugInfo();
+
+        // Do not create a container when there is only a a high-level representation in the module.
+        if (!opts.CodeGenHighLevel) {
+          hlsl::DxilCompileTimeReport::PhaseScope phase(pTimeReport.get(),
+                                                        "container");
+          llvmModule.WrapModuleInDxilContainer(pMalloc, nullptr, pOutputBlob,
+                                               opts.ShaderHash);
+        }
+
+        if (needsValidation) {
+          hlsl::DxilCompileTimeReport::PhaseScope phase(pTimeReport.get(),
+                                                        "validation");
+          // Important: in-place edit is required so the blob is reused and thus
+          // dxil.dll can be released.
+          if (internalValidator) {
+            IFT(RunInternalValidator(
+              pValidator, llvmModule.get(), llvmModule.getWithDebugInfo(), pOutputBlob,
+              DxcValidatorFlags_InPlaceEdit, &pValResult));
+          }
+          else {
+            IFT(pValidator->Validate(
+              pOutputBlob, DxcValidatorFlags_InPlaceEdit, &pValResult));
           }
-          // Callback after valid DXIL is produced
-          if (SUCCEEDED(valHR)) {
-            CComPtr<IDxcBlob> pTargetBlob;
-            if (m_pDxcContainerEventsHandler != nullptr) {
-              HRESULT hr = m_pDxcContainerEventsHandler->OnDxilContainerBuilt(pOutputBlob, &pTargetBlob);
-              if (SUCCEEDED(hr) && pTargetBlob != nullptr) {
-                std::swap(pOutputBlob, pTargetBlob);
-              }
-            }
+          IFT(pValResult->GetStatus(&valHR));
+          if (FAILED(valHR)) {
+            CComPtr<IDxcBlobEncoding> pErrors;
+            CComPtr<IDxcBlobEncoding> pErrorsUtf8;
+            IFT(pValResult->GetErrorBuffer(&pErrors));
+            IFT(hlsl::DxcGetBlobAsUtf8(pErrors, &pErrorsUtf8));
+            StringRef errRef((const char *)pErrorsUtf8->GetBufferPointer(),
+              pErrorsUtf8->GetBufferSize());
+            DiagnosticsEngine &D = compiler.getDiagnostics();
+            unsigned DiagID = D.getCustomDiagID(DiagnosticsEngine::Error,
+              "validation errors\r\n%0");
+            D.Report(DiagID) << errRef;
           }
+          CComPtr<IDxcBlob> pValidatedBlob;
+          IFT(pValResult->GetResult(&pValidatedBlob));
+          if (pValidatedBlob != nullptr) {
+            std::swap(pOutputBlob, pValidatedBlob);
+          }
+          pValidator.Release();
+        }
+        // Callback after valid DXIL is produced
+        if (SUCCEEDED(valHR)) {
+          pCacheableBlob = pOutputBlob;
+          OnDxilContainerBuilt(pOutputBlob);
         }
       }
-
-      // Add std err to warnings.
-      msfPtr->WriteStdErrToStream(w);
-
-      CreateOperationResultFromOutputs(pOutputBlob, msfPtr, warnings,
-                                       compiler.getDiagnostics(), ppResult);
-      hr = S_OK;
     }
-    CATCH_CPP_ASSIGN_HRESULT();
-  Cleanup:
-    DxcEtw_DXCompilerCompile_Stop(hr);
-    return hr;
-  }
 
-  // Preprocess source text
-  __override HRESULT STDMETHODCALLTYPE Preprocess(
-    _In_ IDxcBlob *pSource,                       // Source text to preprocess
-    _In_opt_ LPCWSTR pSourceName,                 // Optional file name for pSource. Used in errors and include handlers.
-    _In_count_(argCount) LPCWSTR *pArguments,     // Array of pointers to arguments
-    _In_ UINT32 argCount,                         // Number of arguments
-    _In_count_(defineCount) const DxcDefine *pDefines,  // Array of defines
-    _In_ UINT32 defineCount,                      // Number of defines
-    _In_opt_ IDxcIncludeHandler *pIncludeHandler, // user-provided interface to handle #include directives (optional)
-    _COM_Outptr_ IDxcOperationResult **ppResult   // Preprocessor output status, buffer, and errors
-    ) {
+    // Add std err to warnings.
+    msfPtr->WriteStdErrToStream(w);
+
+    CreateOperationResultFromOutputs(pOutputBlob, msfPtr, warnings,
+                                     compiler.getDiagnostics(), ppResult);
+    if (pTimeReport)
+      DxcTimeReportOperationResult::Wrap(*pTimeReport, ppResult);
+
+    // Only successful results are worth keeping; failures are cheap to
+    // reproduce and usually get fixed before the next build.
+    if (pCache && !compiler.getDiagnostics().hasErrorOccurred()) {
+      if (pCacheableBlob == nullptr)
+        pCacheableBlob = pOutputBlob;
+      CComPtr<IDxcBlobEncoding> pErrors;
+      IFT((*ppResult)->GetErrorBuffer(&pErrors));
+      StringRef errors;
+      if (pErrors != nullptr)
+        errors = StringRef((const char *)pErrors->GetBufferPointer(),
+                           pErrors->GetBufferSize());
+      pCache->Store(cacheKey, msfPtr->GetDependencies(), pCacheableBlob,
+                    errors);
+    }
+  }
+
+  // Runs the preprocessor over the source. With bDependenciesOnly set, no
+  // preprocessed text is produced, and the result lists the source followed
+  // by each file it included, in the order they were first opened, one name
+  // per line.
+  HRESULT RunPreprocessor(
+    _In_ IDxcBlob *pSource, _In_opt_ LPCWSTR pSourceName,
+    _In_count_(argCount) LPCWSTR *pArguments, _In_ UINT32 argCount,
+    _In_count_(defineCount) const DxcDefine *pDefines, _In_ UINT32 defineCount,
+    _In_opt_ IDxcIncludeHandler *pIncludeHandler, bool bDependenciesOnly,
+    _COM_Outptr_ IDxcOperationResult **ppResult) {
     if (pSource == nullptr || ppResult == nullptr ||
         (defineCount > 0 && pDefines == nullptr) ||
         (argCount > 0 && pArguments == nullptr))
@@ -2321,7 +2993,6 @@ public:
     *ppResult = nullptr;
 
     HRESULT hr = S_OK;
-    DxcEtw_DXCompilerPreprocess_Start();
     CComPtr<IDxcBlobEncoding> utf8Source;
     IFC(hlsl::DxcGetBlobAsUtf8(pSource, &utf8Source));
 
@@ -2344,7 +3015,7 @@ public:
       hlsl::options::MainArgs mainArgs(argCountInt, pArguments, 0);
       hlsl::options::DxcOpts opts;
       bool finished;
-      ReadOptsAndValidate(mainArgs, opts, pOutputStream, ppResult, finished);
+      ReadOptsAndValidate(mainArgs, opts, ppResult, finished);
       if (finished) {
         hr = S_OK;
         goto Cleanup;
@@ -2364,6 +3035,8 @@ public:
 
       IFT(msfPtr->RegisterOutputStream(L"output.hlsl", pOutputStream));
       IFT(msfPtr->CreateStdStreams(pMalloc));
+      if (bDependenciesOnly || opts.CreatePch)
+        msfPtr->EnableDependencyRecording(/*bHashContents*/ false);
 
       StringRef Data((LPSTR)utf8Source->GetBufferPointer(),
         utf8Source->GetBufferSize());
@@ -2373,6 +3046,7 @@ public:
       // Not very efficient but also not very important.
       std::vector<std::string> defines;
       CreateDefineStrings(pDefines, defineCount, defines);
+      CreateDefineStrings(opts.Defines.data(), opts.Defines.size(), defines);
 
       // Setup a compiler instance.
       std::string warnings;
@@ -2383,30 +3057,84 @@ public:
           std::make_unique<TextDiagnosticPrinter>(w, &compiler.getDiagnosticOpts());
       SetupCompilerForCompile(compiler, &m_langExtensionsHelper, utf8SourceName, diagPrinter.get(), defines, opts, pArguments, argCount);
       msfPtr->SetupForCompilerInstance(compiler);
-
-      // The clang entry point (cc1_main) would now create a compiler invocation
-      // from arguments, but for this path we're exclusively trying to preproces
-      // to text.
-      compiler.getFrontendOpts().OutputFile = "output.hlsl";
-      compiler.WriteDefaultOutputDirectly = true;
-      compiler.setOutStream(&outStream);
-
-      // These settings are back-compatible with fxc.
-      clang::PreprocessorOutputOptions &PPOutOpts =
-          compiler.getPreprocessorOutputOpts();
-      PPOutOpts.ShowCPP = 1;            // Print normal preprocessed output.
-      PPOutOpts.ShowComments = 0;       // Show comments.
-      PPOutOpts.ShowLineMarkers = 1;    // Show \#line markers.
-      PPOutOpts.UseLineDirectives = 1;  // Use \#line instead of GCC-style \# N.
-      PPOutOpts.ShowMacroComments = 0;  // Show comments, even in macros.
-      PPOutOpts.ShowMacros = 0;         // Print macro definitions.
-      PPOutOpts.RewriteIncludes = 0;    // Preprocess include directives only.
+      std::string pchConfig;
+      if (!opts.UsePch.empty() || opts.CreatePch)
+        pchConfig = GetPrecompiledHeaderConfig(opts.TargetProfile, opts);
+      if (!opts.UsePch.empty()) {
+        msfPtr->SetPrecompiledHeader(
+            Unicode::UTF8ToUTF16StringOrThrow(opts.UsePch.str().c_str()).c_str(),
+            pchConfig, defines);
+        if (!msfPtr->CheckPrecompiledHeader()) {
+          CreatePrecompiledHeaderMismatchResult(opts.UsePch, ppResult);
+          hr = S_OK;
+          goto Cleanup;
+        }
+      }
 
       FrontendInputFile file(utf8SourceName.m_psz, IK_HLSL);
-      clang::PrintPreprocessedAction action;
-      if (action.BeginSourceFile(compiler, file)) {
-        action.Execute();
-        action.EndSourceFile();
+      if (bDependenciesOnly) {
+        // Only the lexer and preprocessor run; nothing is parsed, so function
+        // bodies are never visited.
+        clang::PreprocessOnlyAction action;
+        if (action.BeginSourceFile(compiler, file)) {
+          action.Execute();
+          action.EndSourceFile();
+        }
+        outStream << pUtf8SourceName << "\n";
+        for (const DxcCompileCacheDependency &dep : msfPtr->GetDependencies()) {
+          // Failed probes of include search paths are recorded too.
+          if (dep.Present)
+            outStream << Unicode::UTF16ToUTF8StringOrThrow(dep.Name.c_str()) << "\n";
+        }
+      }
+      else {
+        // The clang entry point (cc1_main) would now create a compiler invocation
+        // from arguments, but for this path we're exclusively trying to preproces
+        // to text.
+        compiler.getFrontendOpts().OutputFile = "output.hlsl";
+        compiler.WriteDefaultOutputDirectly = true;
+        // A precompiled header lists the files it covers ahead of the text,
+        // and those are only known once preprocessing is done.
+        std::string pchText;
+        raw_string_ostream pchStream(pchText);
+        compiler.setOutStream(opts.CreatePch ? (raw_ostream *)&pchStream
+                                             : (raw_ostream *)&outStream);
+
+        // These settings are back-compatible with fxc.
+        clang::PreprocessorOutputOptions &PPOutOpts =
+            compiler.getPreprocessorOutputOpts();
+        PPOutOpts.ShowCPP = 1;            // Print normal preprocessed output.
+        PPOutOpts.ShowComments = 0;       // Show comments.
+        PPOutOpts.ShowLineMarkers = 1;    // Show \#line markers.
+        PPOutOpts.UseLineDirectives = 1;  // Use \#line instead of GCC-style \# N.
+        PPOutOpts.ShowMacroComments = 0;  // Show comments, even in macros.
+        PPOutOpts.ShowMacros = 0;         // Print macro definitions.
+        PPOutOpts.RewriteIncludes = 0;    // Preprocess include directives only.
+        if (opts.CreatePch) {
+          // Keep the header's own macros, but not the target and command-line
+          // ones, which each compile using it sets up for itself.
+          PPOutOpts.ShowMacros = 1;
+          PPOutOpts.OmitPredefinedMacros = 1;
+        }
+
+        std::set<std::string> pchDefinedMacros, pchUndefinedMacros;
+        clang::PrintPreprocessedAction action;
+        if (action.BeginSourceFile(compiler, file)) {
+          if (opts.CreatePch) {
+            Preprocessor &PP = compiler.getPreprocessor();
+            PP.addPPCallbacks(std::make_unique<PrecompiledHeaderMacroRecorder>(
+                PP, pchDefinedMacros, pchUndefinedMacros));
+          }
+          action.Execute();
+          action.EndSourceFile();
+        }
+        if (opts.CreatePch) {
+          pchStream.flush();
+          pchConfig += GetPrecompiledHeaderMacroConfig(
+              pchDefinedMacros, pchUndefinedMacros, defines);
+          msfPtr->WritePrecompiledHeaderBanner(outStream, pchConfig);
+          outStream << pchText;
+        }
       }
       outStream.flush();
 
@@ -2419,6 +3147,43 @@ public:
     }
     CATCH_CPP_ASSIGN_HRESULT();
   Cleanup:
+    return hr;
+  }
+
+  // Preprocess source text
+  __override HRESULT STDMETHODCALLTYPE Preprocess(
+    _In_ IDxcBlob *pSource,                       // Source text to preprocess
+    _In_opt_ LPCWSTR pSourceName,                 // Optional file name for pSource. Used in errors and include handlers.
+    _In_count_(argCount) LPCWSTR *pArguments,     // Array of pointers to arguments
+    _In_ UINT32 argCount,                         // Number of arguments
+    _In_count_(defineCount) const DxcDefine *pDefines,  // Array of defines
+    _In_ UINT32 defineCount,                      // Number of defines
+    _In_opt_ IDxcIncludeHandler *pIncludeHandler, // user-provided interface to handle #include directives (optional)
+    _COM_Outptr_ IDxcOperationResult **ppResult   // Preprocessor output status, buffer, and errors
+    ) {
+    DxcEtw_DXCompilerPreprocess_Start();
+    HRESULT hr = RunPreprocessor(pSource, pSourceName, pArguments, argCount,
+                                 pDefines, defineCount, pIncludeHandler,
+                                 /*bDependenciesOnly*/ false, ppResult);
+    DxcEtw_DXCompilerPreprocess_Stop(hr);
+    return hr;
+  }
+
+  // List the files included by source text, without compiling it
+  __override HRESULT STDMETHODCALLTYPE ScanDependencies(
+    _In_ IDxcBlob *pSource,                       // Source text to scan
+    _In_opt_ LPCWSTR pSourceName,                 // Optional file name for pSource. Used in errors and include handlers.
+    _In_count_(argCount) LPCWSTR *pArguments,     // Array of pointers to arguments
+    _In_ UINT32 argCount,                         // Number of arguments
+    _In_count_(defineCount) const DxcDefine *pDefines,  // Array of defines
+    _In_ UINT32 defineCount,                      // Number of defines
+    _In_opt_ IDxcIncludeHandler *pIncludeHandler, // user-provided interface to handle #include directives (optional)
+    _COM_Outptr_ IDxcOperationResult **ppResult   // Dependency list, status, and errors
+    ) {
+    DxcEtw_DXCompilerPreprocess_Start();
+    HRESULT hr = RunPreprocessor(pSource, pSourceName, pArguments, argCount,
+                                 pDefines, defineCount, pIncludeHandler,
+                                 /*bDependenciesOnly*/ true, ppResult);
     DxcEtw_DXCompilerPreprocess_Stop(hr);
     return hr;
   }
@@ -2598,6 +3363,9 @@ public:
     for (size_t i = 0; i < defines.size(); ++i) {
       PPOpts.addMacroDef(defines[i]);
     }
+    if (!Opts.UsePch.empty()) {
+      PPOpts.Includes.push_back(Opts.UsePch);
+    }
 
     // Pick additional arguments.
     clang::HeaderSearchOptions &HSOpts = compiler.getHeaderSearchOpts();
@@ -2656,6 +3424,8 @@ public:
       compiler.getCodeGenOpts().HLSLSignaturePackingStrategy = (unsigned)DXIL::PackingStrategy::PrefixStable;
     else if (Opts.PackOptimized)
       compiler.getCodeGenOpts().HLSLSignaturePackingStrategy = (unsigned)DXIL::PackingStrategy::Optimized;
+    else if (Opts.PackMinimal)
+      compiler.getCodeGenOpts().HLSLSignaturePackingStrategy = (unsigned)DXIL::PackingStrategy::Minimal;
     else
       compiler.getCodeGenOpts().HLSLSignaturePackingStrategy = (unsigned)DXIL::PackingStrategy::Default;
 
@@ -143,6 +143,8 @@ HRESULT STDMETHODCALLTYPE DxcContainerBuilder::SerializeContainer(_Out_ IDxcOper
     
     // Update Parts
     IFT(UpdateParts(pMemoryStream));
+    // Parts may have been added or removed; refresh the shader hash part.
+    UpdateDxilContainerHash((DxilContainerHeader *)pMemoryStream->GetPtr());
 
     CComPtr<IDxcBlobEncoding> pErrorBlob;
     HRESULT valHR = S_OK;
@@ -22,9 +22,12 @@
 #include "llvm/Support/MSFileSystem.h"
 #include "dxc/Support/microcom.h"
 #include "dxc/Support/FileIOHelper.h"
+#include "dxc/Support/Unicode.h"
 #include "dxc/Support/dxcapi.impl.h"
 #include "dxc/HLSL/DxilRootSignature.h"
 #include "dxcetw.h"
+#include "dxccompilecache.h"
+#include <memory>
 
 using namespace llvm;
 using namespace hlsl;
@@ -78,9 +81,17 @@ struct DiagRestore {
   }
 };
 
-class DxcValidator : public IDxcValidator, public IDxcVersionInfo {
+class DxcValidator : public IDxcValidator, public IDxcVersionInfo, public IDxcValidatorCache {
 private:
   DXC_MICROCOM_REF_FIELD(m_dwRef)
+  std::unique_ptr<DxcCompileCache> m_pCache;
+  UINT64 m_cacheHits;
+  UINT64 m_cacheMisses;
+
+  bool ComputeValidationCacheKey(
+    _In_ IDxcBlob *pShader,
+    _In_ UINT32 Flags,
+    llvm::MD5::MD5Result &key);
 
   HRESULT RunValidation(
     _In_ IDxcBlob *pShader,                       // Shader to validate.
@@ -94,10 +105,10 @@ private:
 
 public:
   DXC_MICROCOM_ADDREF_RELEASE_IMPL(m_dwRef)
-  DxcValidator() : m_dwRef(0) {}
+  DxcValidator() : m_dwRef(0), m_cacheHits(0), m_cacheMisses(0) {}
 
   HRESULT STDMETHODCALLTYPE QueryInterface(REFIID iid, void **ppvObject) {
-    return DoBasicQueryInterface2<IDxcValidator, IDxcVersionInfo>(this, iid, ppvObject);
+    return DoBasicQueryInterface3<IDxcValidator, IDxcVersionInfo, IDxcValidatorCache>(this, iid, ppvObject);
   }
 
   // For internal use only.
@@ -119,6 +130,12 @@ public:
   // IDxcVersionInfo
   __override HRESULT STDMETHODCALLTYPE GetVersion(_Out_ UINT32 *pMajor, _Out_ UINT32 *pMinor);
   __override HRESULT STDMETHODCALLTYPE GetFlags(_Out_ UINT32 *pFlags);
+
+  // IDxcValidatorCache
+  __override HRESULT STDMETHODCALLTYPE SetValidationCache(
+    _In_opt_z_ LPCWSTR pDirectory, UINT32 maxSizeInMB);
+  __override HRESULT STDMETHODCALLTYPE GetValidationCacheStats(
+    _Out_ UINT64 *pHits, _Out_ UINT64 *pMisses);
 };
 
 // Compile a single entry point to the target shader model
@@ -149,12 +166,43 @@ HRESULT DxcValidator::ValidateWithOptModules(
     IFT(CoGetMalloc(1, &pMalloc));
     IFT(CreateMemoryStream(pMalloc, &pDiagStream));
 
-    // Run validation may throw, but that indicates an inability to validate,
-    // not that the validation failed (eg out of memory).
-    if (Flags & DxcValidatorFlags_RootSignatureOnly) {
-      validationStatus = RunRootSignatureValidation(pShader, pDiagStream);
-    } else {
-      validationStatus = RunValidation(pShader, pModule, pDebugModule, pDiagStream);
+    // A cached result stands in for a full validation of the same bytes. The
+    // modules, when provided, are the ones the shader was serialized from, so
+    // the shader bytes alone identify the result.
+    llvm::MD5::MD5Result cacheKey;
+    bool useCache = m_pCache && ComputeValidationCacheKey(pShader, Flags, cacheKey);
+    bool cacheHit = false;
+    if (useCache) {
+      CComPtr<IDxcBlob> pCachedStatus;
+      std::string cachedDiag;
+      if (m_pCache->Lookup(cacheKey, nullptr, &pCachedStatus, cachedDiag) &&
+          pCachedStatus->GetBufferSize() == sizeof(HRESULT)) {
+        memcpy(&validationStatus, pCachedStatus->GetBufferPointer(), sizeof(HRESULT));
+        ULONG cbWritten;
+        IFT(pDiagStream->Write(cachedDiag.data(), cachedDiag.size(), &cbWritten));
+        cacheHit = true;
+        ++m_cacheHits;
+      } else {
+        ++m_cacheMisses;
+      }
+    }
+
+    if (!cacheHit) {
+      // Run validation may throw, but that indicates an inability to validate,
+      // not that the validation failed (eg out of memory).
+      if (Flags & DxcValidatorFlags_RootSignatureOnly) {
+        validationStatus = RunRootSignatureValidation(pShader, pDiagStream);
+      } else {
+        validationStatus = RunValidation(pShader, pModule, pDebugModule, pDiagStream);
+      }
+      if (useCache) {
+        CComPtr<IDxcBlob> pStatus;
+        IFT(DxcCreateBlobOnHeapCopy(&validationStatus, sizeof(HRESULT), &pStatus));
+        m_pCache->Store(cacheKey, std::vector<DxcCompileCacheDependency>(),
+                        pStatus,
+                        StringRef((const char *)pDiagStream->GetPtr(),
+                                  pDiagStream->GetPtrSize()));
+      }
     }
     if (FAILED(validationStatus)) {
       std::string msg("Validation failed.\n");
@@ -192,6 +240,55 @@ HRESULT STDMETHODCALLTYPE DxcValidator::GetFlags(_Out_ UINT32 *pFlags) {
   return S_OK;
 }
 
+HRESULT STDMETHODCALLTYPE DxcValidator::SetValidationCache(
+    _In_opt_z_ LPCWSTR pDirectory, UINT32 maxSizeInMB) {
+  try {
+    if (pDirectory == nullptr || *pDirectory == L'\0') {
+      m_pCache.reset();
+    } else {
+      std::string directory = Unicode::UTF16ToUTF8StringOrThrow(pDirectory);
+      m_pCache.reset(new DxcCompileCache(directory, maxSizeInMB));
+    }
+    return S_OK;
+  }
+  CATCH_CPP_RETURN_HRESULT();
+}
+
+HRESULT STDMETHODCALLTYPE DxcValidator::GetValidationCacheStats(
+    _Out_ UINT64 *pHits, _Out_ UINT64 *pMisses) {
+  if (pHits == nullptr || pMisses == nullptr)
+    return E_POINTER;
+  *pHits = m_cacheHits;
+  *pMisses = m_cacheMisses;
+  return S_OK;
+}
+
+bool DxcValidator::ComputeValidationCacheKey(
+  _In_ IDxcBlob *pShader,
+  _In_ UINT32 Flags,
+  llvm::MD5::MD5Result &key) {
+  // Rules change between validator builds without a version bump, so a
+  // result is only reused by the exact validator binary that produced it.
+  // Without that identity, don't use the cache at all.
+  llvm::MD5::MD5Result validatorDigest;
+  if (!DxcCompileCacheGetModuleDigest(validatorDigest))
+    return false;
+
+  // Tag the key so validation entries never collide with compile results
+  // stored in the same directory.
+  DxcCompileCacheKeyBuilder builder;
+  builder.AddString("validation");
+  unsigned valMajor, valMinor;
+  GetValidationVersion(&valMajor, &valMinor);
+  builder.AddUInt32(valMajor);
+  builder.AddUInt32(valMinor);
+  builder.AddBytes(validatorDigest, sizeof(validatorDigest));
+  builder.AddUInt32(Flags);
+  builder.AddBytes(pShader->GetBufferPointer(), pShader->GetBufferSize());
+  builder.Final(key);
+  return true;
+}
+
 HRESULT DxcValidator::RunValidation(
   _In_ IDxcBlob *pShader,
   _In_ llvm::Module *pModule,                   // Module to validate, if available.
@@ -12,11 +12,13 @@
 #include "dxillib.h"
 #include "dxc/Support/Global.h" // For DXASSERT
 #include "dxc/Support/dxcapi.use.h"
+#include <atomic>
 
 using namespace dxc;
 
 static DxcDllSupport g_DllSupport;
 static HRESULT g_DllLibResult = S_OK;
+static std::atomic<bool> g_DllLibLoadAttempted(false);
 static CRITICAL_SECTION cs;
 
 // Check if we can successfully get IDxcValidator from dxil.dll
@@ -37,21 +39,25 @@ HRESULT DxilLibCleanup(DxilLibCleanUpType type) {
   else {
     hr = E_INVALIDARG;
   }
+  g_DllLibLoadAttempted.store(false, std::memory_order_relaxed);
   DeleteCriticalSection(&cs);
   return hr;
 }
 
-// g_DllLibResult is S_OK by default, check again to see if dxil.dll is loaded
-// If we fail to load dxil.dll, set g_DllLibResult to E_FAIL so that we don't
-// have multiple attempts to load dxil.dll
+// dxil.dll is loaded at most once, by the first caller; a failure is
+// remembered so that we don't have multiple attempts to load dxil.dll.
+// Once the attempt has been made, g_DllLibResult and g_DllSupport don't
+// change until the library is cleaned up, so callers after the first don't
+// take the lock.
 bool DxilLibIsEnabled() {
-  EnterCriticalSection(&cs);
-  if (SUCCEEDED(g_DllLibResult)) {
-    if (!g_DllSupport.IsEnabled()) {
+  if (!g_DllLibLoadAttempted.load(std::memory_order_acquire)) {
+    EnterCriticalSection(&cs);
+    if (!g_DllLibLoadAttempted.load(std::memory_order_relaxed)) {
       g_DllLibResult = g_DllSupport.InitializeForDll(L"dxil.dll", "DxcCreateInstance");
+      g_DllLibLoadAttempted.store(true, std::memory_order_release);
     }
+    LeaveCriticalSection(&cs);
   }
-  LeaveCriticalSection(&cs);
   return SUCCEEDED(g_DllLibResult);
 }
 
@@ -60,9 +66,7 @@ HRESULT DxilLibCreateInstance(_In_ REFCLSID rclsid, _In_ REFIID riid, _In_ IUnkn
   DXASSERT_NOMSG(ppInterface != nullptr);
   HRESULT hr = E_FAIL;
   if (DxilLibIsEnabled()) {
-    EnterCriticalSection(&cs);
     hr = g_DllSupport.CreateInstance(rclsid, riid, ppInterface);
-    LeaveCriticalSection(&cs);
   }
   return hr;
 }
\ No newline at end of file
@@ -33,7 +33,9 @@
 #include "dxc/Support/Global.h"
 #include "dxcisenseimpl.h"
 #include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MD5.h"
 #include "llvm/Support/MSFileSystem.h"
+#include <chrono>
 
 ///////////////////////////////////////////////////////////////////////////////
 
@@ -381,6 +383,23 @@ HRESULT SetupUnsavedFiles(
   return hr;
 }
 
+static
+UINT64 GetMicrosecondsSince(std::chrono::steady_clock::time_point start)
+{
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+    std::chrono::steady_clock::now() - start).count();
+}
+
+static
+std::string GetUnsavedFileDigest(const CXUnsavedFile& file)
+{
+  llvm::MD5 md5;
+  md5.update(llvm::ArrayRef<uint8_t>((const uint8_t*)file.Contents, file.Length));
+  llvm::MD5::MD5Result digest;
+  md5.final(digest);
+  return std::string((const char*)digest, sizeof(digest));
+}
+
 struct PagedCursorVisitorContext
 {
   unsigned skip;                // References to skip at the beginning.
@@ -1146,22 +1165,26 @@ HRESULT DxcIndex::ParseTranslationUnit(
 
     ::llvm::sys::fs::AutoPerThreadSystem pts(msf.get());
     IFTLLVM(pts.error_code());
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
     CXTranslationUnit tu = clang_parseTranslationUnit(m_index, source_filename,
       command_line_args, num_command_line_args,
       files, num_unsaved_files, options);
-    CleanupUnsavedFiles(files, num_unsaved_files);
+    UINT64 parseMicroseconds = GetMicrosecondsSince(start);
     if (tu == nullptr)
     {
+      CleanupUnsavedFiles(files, num_unsaved_files);
       return E_FAIL;
     }
 
     CComPtr<DxcTranslationUnit> localTU = new (std::nothrow) DxcTranslationUnit();
     if (localTU == nullptr)
     {
+      CleanupUnsavedFiles(files, num_unsaved_files);
       clang_disposeTranslationUnit(tu);
       return E_OUTOFMEMORY;
     }
-    localTU->Initialize(tu);
+    localTU->Initialize(tu, files, num_unsaved_files, parseMicroseconds);
+    CleanupUnsavedFiles(files, num_unsaved_files);
     *pTranslationUnit = localTU.Detach();
 
     return S_OK;
@@ -1443,8 +1466,9 @@ HRESULT DxcToken::GetSpelling(LPSTR* pValue)
 
 ///////////////////////////////////////////////////////////////////////////////
 
-DxcTranslationUnit::DxcTranslationUnit() : m_tu(nullptr), m_dwRef(0)
+DxcTranslationUnit::DxcTranslationUnit() : m_tu(nullptr), m_dwRef(0), m_parseInputsValid(false)
 {
+  ZeroMemory(&m_stats, sizeof(m_stats));
 }
 
 DxcTranslationUnit::~DxcTranslationUnit() {
@@ -1464,9 +1488,124 @@ DxcTranslationUnit::~DxcTranslationUnit() {
   }
 }
 
-void DxcTranslationUnit::Initialize(CXTranslationUnit tu)
+_Use_decl_annotations_
+void DxcTranslationUnit::Initialize(CXTranslationUnit tu,
+  CXUnsavedFile* unsaved_files, unsigned num_unsaved_files,
+  UINT64 parseMicroseconds)
 {
   m_tu = tu;
+  ++m_stats.ParseCount;
+  RecordParseInputs(unsaved_files, num_unsaved_files);
+  RecordParseTime(parseMicroseconds);
+}
+
+struct DiskFileStampData {
+  const std::map<std::string, std::string>* unsaved;
+  std::map<std::string, DxcDiskFileStamp>* stamps;
+  bool failed;
+};
+
+static
+void VisitDiskFileStamp(CXFile included_file,
+  CXSourceLocation* inclusion_stack,
+  unsigned include_len,
+  CXClientData client_data) {
+  DiskFileStampData* D = (DiskFileStampData *)client_data;
+  CXString fileName = clang_getFileName(included_file);
+  const char* fileNameStr = clang_getCString(fileName);
+  if (fileNameStr != nullptr && D->unsaved->count(fileNameStr) == 0) {
+    // clang_getFileTime only has a resolution of seconds, so an edit within
+    // the second of the parse would go unnoticed; stat the file instead.
+    llvm::sys::fs::file_status status;
+    if (llvm::sys::fs::status(fileNameStr, status)) {
+      D->failed = true;
+    }
+    else {
+      DxcDiskFileStamp& stamp = (*D->stamps)[fileNameStr];
+      stamp.ModificationTime = status.getLastModificationTime();
+      stamp.Size = status.getSize();
+    }
+  }
+  clang_disposeString(fileName);
+}
+
+_Use_decl_annotations_
+void DxcTranslationUnit::RecordParseInputs(
+  CXUnsavedFile* unsaved_files, unsigned num_unsaved_files)
+{
+  m_unsavedDigests.clear();
+  m_diskFileStamps.clear();
+  m_parseInputsValid = false;
+
+  // A missing include is fatal and leaves no inclusion to watch, so such an
+  // AST is never considered current.
+  unsigned numDiagnostics = clang_getNumDiagnostics(m_tu);
+  for (unsigned i = 0; i < numDiagnostics; ++i) {
+    CXDiagnostic diag = clang_getDiagnostic(m_tu, i);
+    bool fatal = clang_getDiagnosticSeverity(diag) == CXDiagnostic_Fatal;
+    clang_disposeDiagnostic(diag);
+    if (fatal) return;
+  }
+
+  for (unsigned i = 0; i < num_unsaved_files; ++i) {
+    m_unsavedDigests[unsaved_files[i].Filename] =
+      GetUnsavedFileDigest(unsaved_files[i]);
+  }
+
+  DiskFileStampData D;
+  D.unsaved = &m_unsavedDigests;
+  D.stamps = &m_diskFileStamps;
+  D.failed = false;
+  clang_getInclusions(m_tu, VisitDiskFileStamp, &D);
+  m_parseInputsValid = !D.failed;
+}
+
+_Use_decl_annotations_
+bool DxcTranslationUnit::AreParseInputsCurrent(
+  CXUnsavedFile* unsaved_files, unsigned num_unsaved_files,
+  unsigned* pChangedCount)
+{
+  // Every unsaved file must match by name and content; a file that is added
+  // to or dropped from the set changes what the preprocessor sees as well.
+  unsigned changedCount = 0;
+  unsigned matchedCount = 0;
+  *pChangedCount = 0;
+  if (!m_parseInputsValid) {
+    return false;
+  }
+  for (unsigned i = 0; i < num_unsaved_files; ++i) {
+    auto it = m_unsavedDigests.find(unsaved_files[i].Filename);
+    if (it != m_unsavedDigests.end() &&
+        it->second == GetUnsavedFileDigest(unsaved_files[i])) {
+      ++matchedCount;
+    }
+    else {
+      ++changedCount;
+    }
+  }
+  *pChangedCount = changedCount;
+  if (changedCount != 0 || matchedCount != m_unsavedDigests.size()) {
+    return false;
+  }
+
+  // Files read from disk are only trusted while their timestamps and sizes
+  // hold.
+  for (const auto& diskFile : m_diskFileStamps) {
+    llvm::sys::fs::file_status status;
+    if (llvm::sys::fs::status(diskFile.first, status) ||
+        status.getLastModificationTime() != diskFile.second.ModificationTime ||
+        status.getSize() != diskFile.second.Size) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+void DxcTranslationUnit::RecordParseTime(UINT64 microseconds)
+{
+  m_stats.LastParseMicroseconds = microseconds;
+  m_stats.TotalParseMicroseconds += microseconds;
 }
 
 _Use_decl_annotations_
@@ -1590,8 +1729,37 @@ HRESULT DxcTranslationUnit::Reparse(
   CXUnsavedFile* local_unsaved_files;
   hr = SetupUnsavedFiles(unsaved_files, num_unsaved_files, &local_unsaved_files);
   if (FAILED(hr)) return hr;
-  int reparseResult = clang_reparseTranslationUnit(
-    m_tu, num_unsaved_files, local_unsaved_files, clang_defaultReparseOptions(m_tu));
+
+  ::llvm::sys::fs::MSFileSystem* msfPtr;
+  hr = CreateMSFileSystemForDisk(&msfPtr);
+  if (FAILED(hr)) {
+    CleanupUnsavedFiles(local_unsaved_files, num_unsaved_files);
+    return hr;
+  }
+  std::auto_ptr<::llvm::sys::fs::MSFileSystem> msf(msfPtr);
+  ::llvm::sys::fs::AutoPerThreadSystem pts(msf.get());
+
+  // The AST already reflects these exact inputs when nothing changed since the
+  // last parse, as happens when an editor reparses on focus or cursor moves.
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  int reparseResult = 0;
+  ++m_stats.ReparseCount;
+  if (AreParseInputsCurrent(local_unsaved_files, num_unsaved_files,
+                            &m_stats.LastChangedFileCount)) {
+    ++m_stats.ReparseSkippedCount;
+  }
+  else {
+    reparseResult = clang_reparseTranslationUnit(
+      m_tu, num_unsaved_files, local_unsaved_files, clang_defaultReparseOptions(m_tu));
+    ++m_stats.ParseCount;
+    if (reparseResult == 0) {
+      RecordParseInputs(local_unsaved_files, num_unsaved_files);
+    }
+    else {
+      m_parseInputsValid = false;
+    }
+  }
+  RecordParseTime(GetMicrosecondsSince(start));
   CleanupUnsavedFiles(local_unsaved_files, num_unsaved_files);
   return reparseResult == 0 ? S_OK : E_FAIL;
 }
@@ -1760,6 +1928,14 @@ HRESULT DxcTranslationUnit::GetInclusionList(unsigned *pResultCount,
   return S_OK;
 }
 
+_Use_decl_annotations_
+HRESULT DxcTranslationUnit::GetStatistics(DxcTranslationUnitStatistics* pValue)
+{
+  if (pValue == nullptr) return E_POINTER;
+  *pValue = m_stats;
+  return S_OK;
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 
 DxcType::DxcType() : m_dwRef(0)
@@ -17,6 +17,9 @@
 #include "dxc/dxcapi.internal.h"
 #include "dxc/Support/microcom.h"
 #include "dxc/Support/DxcLangExtensionsHelper.h"
+#include "llvm/Support/TimeValue.h"
+#include <map>
+#include <string>
 
 // Forward declarations.
 class DxcCursor;
@@ -293,21 +296,43 @@ public:
   __override HRESULT STDMETHODCALLTYPE GetSpelling(_Outptr_result_maybenull_ LPSTR* pValue);
 };
 
-class DxcTranslationUnit : public IDxcTranslationUnit
+// Full-resolution modification time and size of a file read from disk.
+struct DxcDiskFileStamp {
+  llvm::sys::TimeValue ModificationTime;
+  uint64_t Size;
+};
+
+class DxcTranslationUnit : public IDxcTranslationUnit, public IDxcTranslationUnitStatistics
 {
 private:
     DXC_MICROCOM_REF_FIELD(m_dwRef)
     CXTranslationUnit m_tu;
+    DxcTranslationUnitStatistics m_stats;
+    // Content digests of the unsaved files the AST was last parsed with.
+    std::map<std::string, std::string> m_unsavedDigests;
+    // Stamps of the files read from disk for the AST.
+    std::map<std::string, DxcDiskFileStamp> m_diskFileStamps;
+    bool m_parseInputsValid;
+
+    void RecordParseInputs(
+      _In_count_(num_unsaved_files) CXUnsavedFile* unsaved_files,
+      unsigned num_unsaved_files);
+    bool AreParseInputsCurrent(
+      _In_count_(num_unsaved_files) CXUnsavedFile* unsaved_files,
+      unsigned num_unsaved_files, _Out_ unsigned* pChangedCount);
+    void RecordParseTime(UINT64 microseconds);
 public:
     DXC_MICROCOM_ADDREF_RELEASE_IMPL(m_dwRef)
     HRESULT STDMETHODCALLTYPE QueryInterface(REFIID iid, void** ppvObject)
     {
-      return DoBasicQueryInterface<IDxcTranslationUnit>(this, iid, ppvObject);
+      return DoBasicQueryInterface2<IDxcTranslationUnit, IDxcTranslationUnitStatistics>(this, iid, ppvObject);
     }
 
     DxcTranslationUnit();
     ~DxcTranslationUnit();
-    void Initialize(CXTranslationUnit tu);
+    void Initialize(CXTranslationUnit tu,
+      _In_count_(num_unsaved_files) CXUnsavedFile* unsaved_files,
+      unsigned num_unsaved_files, UINT64 parseMicroseconds);
 
     __override HRESULT STDMETHODCALLTYPE GetCursor(_Outptr_ IDxcCursor** pCursor);
     __override HRESULT STDMETHODCALLTYPE Tokenize(
@@ -337,6 +362,9 @@ public:
       _Out_ unsigned* errorLength,
       _Out_ BSTR* errorMessage);
     __override HRESULT STDMETHODCALLTYPE GetInclusionList(_Out_ unsigned* pResultCount, _Outptr_result_buffer_(*pResultCount) IDxcInclusion*** pResult);
+
+    // IDxcTranslationUnitStatistics
+    __override HRESULT STDMETHODCALLTYPE GetStatistics(_Out_ DxcTranslationUnitStatistics* pValue);
 };
 
 class DxcType : public IDxcType
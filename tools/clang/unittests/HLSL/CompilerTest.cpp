@@ -19,9 +19,13 @@
 #include <cassert>
 #include <sstream>
 #include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
 #include "dxc/HLSL/DxilContainer.h"
 #include "dxc/Support/WinIncludes.h"
 #include "dxc/dxcapi.h"
+#include "dxc/dxcapi.internal.h"
 #include <atlfile.h>
 
 #include "HLSLTestData.h"
@@ -91,6 +95,27 @@ void Utf16ToBlob(dxc::DxcDllSupport &dllSupport, const std::wstring &val, _Outpt
   Utf16ToBlob(dllSupport, val, (IDxcBlobEncoding**)ppBlob);
 }
 
+// Removes a flat temporary directory and its files when going out of scope,
+// so tests clean up after themselves even when a verification fails.
+class TempDirectoryRemover {
+  std::wstring m_path;
+public:
+  explicit TempDirectoryRemover(const std::wstring &path) : m_path(path) {}
+  ~TempDirectoryRemover() {
+    WIN32_FIND_DATAW findData;
+    std::wstring pattern = m_path + L"\\*";
+    HANDLE hFind = FindFirstFileW(pattern.c_str(), &findData);
+    if (hFind != INVALID_HANDLE_VALUE) {
+      do {
+        if ((findData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) == 0)
+          DeleteFileW((m_path + L"\\" + findData.cFileName).c_str());
+      } while (FindNextFileW(hFind, &findData));
+      FindClose(hFind);
+    }
+    RemoveDirectoryW(m_path.c_str());
+  }
+};
+
 // Aligned to SymTagEnum.
 const char *SymTagEnumText[] =
 {
@@ -268,6 +293,10 @@ public:
   TEST_CLASS_SETUP(InitSupport);
 
   TEST_METHOD(CompileWhenDebugThenDIPresent)
+  TEST_METHOD(CompileWhenDebugThenDiaLineLookupsRoundTrip)
+  BEGIN_TEST_METHOD(CompileWhenDebugLargeThenDiaLineLookupsFast)
+    TEST_METHOD_PROPERTY(L"Priority", L"2")
+  END_TEST_METHOD()
 
   TEST_METHOD(CompileWhenDefinesThenApplied)
   TEST_METHOD(CompileWhenDefinesManyThenApplied)
@@ -287,9 +316,21 @@ public:
   TEST_METHOD(CompileWhenIncludeFlagsThenIncludeUsed)
   TEST_METHOD(CompileWhenIncludeMissingThenFail)
   TEST_METHOD(CompileWhenIncludeHasPathThenOK)
+  TEST_METHOD(CompileWhenIncludeLargeOnDiskThenOK)
+
+  TEST_METHOD(CompileWhenCacheThenResultReused)
+  TEST_METHOD(ValidateWhenCacheThenResultReused)
+  TEST_METHOD(CompileBatchWhenPermutationsThenIncludeLoadedOnce)
+  BEGIN_TEST_METHOD(CompileWhenConcurrentThenOK)
+    TEST_METHOD_PROPERTY(L"Priority", L"2")
+  END_TEST_METHOD()
 
   TEST_METHOD(CompileWhenODumpThenPassConfig)
   TEST_METHOD(CompileWhenODumpThenOptimizerMatch)
+  TEST_METHOD(OptimizerPipelineWhenParallelThenMatchesRunOptimizer)
+  TEST_METHOD(OptimizerPipelineWhenParallelBadBitcodeThenOthersSucceed)
+  TEST_METHOD(CompileWhenTimeReportThenPhasesAndPassesReported)
+  TEST_METHOD(CompileWhenTimeReportAndPackMinimalThenRowsSavedReported)
   TEST_METHOD(CompileWhenVdThenProducesDxilContainer)
 
   TEST_METHOD(CompileWhenShaderModelMismatchAttributeThenFail)
@@ -345,6 +386,7 @@ public:
   TEST_METHOD(CodeGenClass)
   TEST_METHOD(CodeGenClip)
   TEST_METHOD(CodeGenClipPlanes)
+  TEST_METHOD(CodeGenCoalesceBufferLoads)
   TEST_METHOD(CodeGenConstoperand1)
   TEST_METHOD(CodeGenConstMat)
   TEST_METHOD(CodeGenConstMat2)
@@ -416,6 +458,7 @@ public:
   TEST_METHOD(CodeGenIntrinsic4)
   TEST_METHOD(CodeGenIntrinsic4_dbg)
   TEST_METHOD(CodeGenIntrinsic5)
+  TEST_METHOD(CodeGenIntrinsicConstFold)
   TEST_METHOD(CodeGenInvalidInputOutputTypes)
   TEST_METHOD(CodeGenLegacyStruct)
   TEST_METHOD(CodeGenLitInParen)
@@ -494,6 +537,7 @@ public:
   TEST_METHOD(CodeGenReadFromOutput2)
   TEST_METHOD(CodeGenReadFromOutput3)
   TEST_METHOD(CodeGenRedundantinput1)
+  TEST_METHOD(CodeGenRedundantLoadElim)
   TEST_METHOD(CodeGenRes64bit)
   TEST_METHOD(CodeGenRovs)
   TEST_METHOD(CodeGenRValSubscript)
@@ -674,6 +718,10 @@ public:
   TEST_METHOD(CodeGenRootSigDefine11)
   TEST_METHOD(CodeGenCBufferStructArray)
   TEST_METHOD(PreprocessWhenValidThenOK)
+  TEST_METHOD(PrecompiledHeaderWhenUsedThenHeadersNotLoaded)
+  TEST_METHOD(PrecompiledHeaderWhenDefinesDifferThenFail)
+  TEST_METHOD(PrecompiledHeaderWhenUnusedDefinesDifferThenReused)
+  TEST_METHOD(ScanDependenciesWhenIncludesThenListed)
   TEST_METHOD(WhenSigMismatchPCFunctionThenFail)
 
   // Dx11 Sample
@@ -947,6 +995,47 @@ public:
     }
   }
 
+  void CompileDebugToDiaSource(LPCSTR pText,
+                               _Outptr_ IDiaDataSource **ppDiaSource) {
+    CComPtr<IDxcCompiler> pCompiler;
+    CComPtr<IDxcOperationResult> pResult;
+    CComPtr<IDxcBlobEncoding> pSource;
+    CComPtr<IDxcBlob> pProgram;
+    CComPtr<IDxcLibrary> pLib;
+    CComPtr<IStream> pProgramStream;
+    CComPtr<IDiaDataSource> pDiaSource;
+
+    VERIFY_SUCCEEDED(CreateCompiler(&pCompiler));
+    CreateBlobFromText(pText, &pSource);
+    LPCWSTR args[] = { L"/Zi" };
+    VERIFY_SUCCEEDED(pCompiler->Compile(pSource, L"source.hlsl", L"main",
+      L"ps_6_0", args, _countof(args), nullptr, 0, nullptr, &pResult));
+    VERIFY_SUCCEEDED(pResult->GetResult(&pProgram));
+
+    VERIFY_SUCCEEDED(m_dllSupport.CreateInstance(CLSID_DxcLibrary, &pLib));
+    const hlsl::DxilContainerHeader *pContainer = hlsl::IsDxilContainerLike(
+        pProgram->GetBufferPointer(), pProgram->GetBufferSize());
+    VERIFY_IS_NOT_NULL(pContainer);
+    hlsl::DxilPartIterator partIter =
+        std::find_if(hlsl::begin(pContainer), hlsl::end(pContainer),
+                     hlsl::DxilPartIsType(hlsl::DFCC_ShaderDebugInfoDXIL));
+    VERIFY_IS_TRUE(partIter != hlsl::end(pContainer));
+    const hlsl::DxilProgramHeader *pProgramHeader =
+        (const hlsl::DxilProgramHeader *)hlsl::GetDxilPartData(*partIter);
+    uint32_t bitcodeLength;
+    const char *pBitcode;
+    CComPtr<IDxcBlob> pProgramPdb;
+    hlsl::GetDxilProgramBitcode(pProgramHeader, &pBitcode, &bitcodeLength);
+    VERIFY_SUCCEEDED(pLib->CreateBlobFromBlob(
+        pProgram, pBitcode - (char *)pProgram->GetBufferPointer(),
+        bitcodeLength, &pProgramPdb));
+
+    VERIFY_SUCCEEDED(pLib->CreateStreamFromBlobReadOnly(pProgramPdb, &pProgramStream));
+    VERIFY_SUCCEEDED(m_dllSupport.CreateInstance(CLSID_DxcDiaDataSource, &pDiaSource));
+    VERIFY_SUCCEEDED(pDiaSource->loadDataFromIStream(pProgramStream));
+    *ppDiaSource = pDiaSource.Detach();
+  }
+
   std::wstring GetDebugInfoAsText(_In_ IDiaDataSource* pDataSource) {
     CComPtr<IDiaSession> pSession;
     CComPtr<IDiaTable> pTable;
@@ -1377,6 +1466,154 @@ TEST_F(CompilerTest, CompileWhenDebugThenDIPresent) {
 #endif
 }
 
+TEST_F(CompilerTest, CompileWhenDebugThenDiaLineLookupsRoundTrip) {
+  CComPtr<IDiaDataSource> pDiaSource;
+  CComPtr<IDiaSession> pSession;
+  CompileDebugToDiaSource(
+    "float4 main(float4 pos : SV_Position) : SV_Target {\r\n"
+    "  float4 local = abs(pos);\r\n"
+    "  local = sin(local) * pos.x;\r\n"
+    "  return local;\r\n"
+    "}", &pDiaSource);
+  VERIFY_SUCCEEDED(pDiaSource->openSession(&pSession));
+
+  // Source files can be found by name and by id.
+  CComPtr<IDiaEnumSourceFiles> pFiles;
+  LONG fileCount;
+  VERIFY_SUCCEEDED(pSession->findFile(nullptr, L"source.hlsl", nsNone, &pFiles));
+  VERIFY_SUCCEEDED(pFiles->get_Count(&fileCount));
+  VERIFY_ARE_EQUAL(1, fileCount);
+  pFiles.Release();
+  VERIFY_SUCCEEDED(pSession->findFile(nullptr, L"SOURCE.HLSL", nsfCaseInsensitive, &pFiles));
+  VERIFY_SUCCEEDED(pFiles->get_Count(&fileCount));
+  VERIFY_ARE_EQUAL(1, fileCount);
+  pFiles.Release();
+  VERIFY_SUCCEEDED(pSession->findFile(nullptr, L"missing.hlsl", nsNone, &pFiles));
+  VERIFY_SUCCEEDED(pFiles->get_Count(&fileCount));
+  VERIFY_ARE_EQUAL(0, fileCount);
+
+  CComPtr<IDiaEnumInjectedSources> pInjected;
+  LONG injectedCount;
+  VERIFY_SUCCEEDED(pSession->findInjectedSource(L"source.hlsl", &pInjected));
+  VERIFY_SUCCEEDED(pInjected->get_Count(&injectedCount));
+  VERIFY_ARE_EQUAL(1, injectedCount);
+
+  // Every line record is found again by its RVA and by its source line.
+  CComPtr<IDiaEnumLineNumbers> pAllLines;
+  VERIFY_SUCCEEDED(pSession->findLinesByRVA(0, (DWORD)-1, &pAllLines));
+  LONG lineCount;
+  VERIFY_SUCCEEDED(pAllLines->get_Count(&lineCount));
+  VERIFY_IS_TRUE(lineCount > 0);
+  for (;;) {
+    CComPtr<IDiaLineNumber> pLine;
+    ULONG fetched;
+    if (pAllLines->Next(1, &pLine, &fetched) != S_OK)
+      break;
+    DWORD rva, lineNumber, fileId;
+    VERIFY_SUCCEEDED(pLine->get_relativeVirtualAddress(&rva));
+    VERIFY_SUCCEEDED(pLine->get_lineNumber(&lineNumber));
+    VERIFY_ARE_EQUAL(S_OK, pLine->get_sourceFileId(&fileId));
+
+    CComPtr<IDiaEnumLineNumbers> pByRVA;
+    CComPtr<IDiaLineNumber> pFound;
+    LONG count;
+    DWORD foundLine;
+    VERIFY_SUCCEEDED(pSession->findLinesByRVA(rva, 1, &pByRVA));
+    VERIFY_SUCCEEDED(pByRVA->get_Count(&count));
+    VERIFY_ARE_EQUAL(1, count);
+    VERIFY_SUCCEEDED(pByRVA->Item(0, &pFound));
+    VERIFY_SUCCEEDED(pFound->get_lineNumber(&foundLine));
+    VERIFY_ARE_EQUAL(lineNumber, foundLine);
+
+    CComPtr<IDiaSourceFile> pFile;
+    CComPtr<IDiaEnumLineNumbers> pByLine;
+    bool foundRVA = false;
+    VERIFY_SUCCEEDED(pSession->findFileById(fileId, &pFile));
+    VERIFY_SUCCEEDED(pSession->findLinesByLinenum(nullptr, pFile, lineNumber, 0, &pByLine));
+    for (;;) {
+      CComPtr<IDiaLineNumber> pOther;
+      DWORD otherRVA;
+      if (pByLine->Next(1, &pOther, &fetched) != S_OK)
+        break;
+      VERIFY_SUCCEEDED(pOther->get_lineNumber(&foundLine));
+      VERIFY_ARE_EQUAL(lineNumber, foundLine);
+      VERIFY_SUCCEEDED(pOther->get_relativeVirtualAddress(&otherRVA));
+      foundRVA = foundRVA || otherRVA == rva;
+    }
+    VERIFY_IS_TRUE(foundRVA);
+  }
+}
+
+TEST_F(CompilerTest, CompileWhenDebugLargeThenDiaLineLookupsFast) {
+  // Build a shader with a few thousand lines of code, each contributing
+  // instructions with their own line information.
+  const unsigned statementCount = 4000;
+  std::stringstream text;
+  text << "float4 main(float4 pos : SV_Position) : SV_Target {\r\n"
+          "  float4 local = pos;\r\n";
+  for (unsigned i = 0; i < statementCount; ++i) {
+    text << "  local = local * pos.wzyx + " << i << ".5;\r\n";
+  }
+  text << "  return local;\r\n"
+          "}";
+
+  CComPtr<IDiaDataSource> pDiaSource;
+  CComPtr<IDiaSession> pSession;
+  CompileDebugToDiaSource(text.str().c_str(), &pDiaSource);
+  auto start = std::chrono::steady_clock::now();
+  VERIFY_SUCCEEDED(pDiaSource->openSession(&pSession));
+  double openMs = std::chrono::duration<double, std::milli>(
+    std::chrono::steady_clock::now() - start).count();
+
+  CComPtr<IDiaEnumLineNumbers> pAllLines;
+  LONG lineCount;
+  VERIFY_SUCCEEDED(pSession->findLinesByRVA(0, (DWORD)-1, &pAllLines));
+  VERIFY_SUCCEEDED(pAllLines->get_Count(&lineCount));
+  VERIFY_IS_TRUE(lineCount >= (LONG)statementCount);
+  CComPtr<IDiaLineNumber> pLastLine;
+  DWORD maxRVA;
+  VERIFY_SUCCEEDED(pAllLines->Item(lineCount - 1, &pLastLine));
+  VERIFY_SUCCEEDED(pLastLine->get_relativeVirtualAddress(&maxRVA));
+
+  // Map sampled instruction indices back to source, the way a profiler would.
+  const unsigned sampleCount = 200000;
+  unsigned resolved = 0;
+  start = std::chrono::steady_clock::now();
+  for (unsigned i = 0; i < sampleCount; ++i) {
+    DWORD rva = (DWORD)(((UINT64)i * 2654435761u) % (maxRVA + 1));
+    CComPtr<IDiaEnumLineNumbers> pLines;
+    CComPtr<IDiaLineNumber> pLine;
+    ULONG fetched;
+    DWORD fileId;
+    VERIFY_SUCCEEDED(pSession->findLinesByRVA(rva, 1, &pLines));
+    if (pLines->Next(1, &pLine, &fetched) == S_OK &&
+        pLine->get_sourceFileId(&fileId) == S_OK) {
+      ++resolved;
+    }
+  }
+  double rvaMs = std::chrono::duration<double, std::milli>(
+    std::chrono::steady_clock::now() - start).count();
+
+  CComPtr<IDiaEnumSourceFiles> pFiles;
+  CComPtr<IDiaSourceFile> pFile;
+  VERIFY_SUCCEEDED(pSession->findFile(nullptr, L"source.hlsl", nsNone, &pFiles));
+  VERIFY_SUCCEEDED(pFiles->Item(0, &pFile));
+  start = std::chrono::steady_clock::now();
+  for (unsigned i = 0; i < sampleCount; ++i) {
+    CComPtr<IDiaEnumLineNumbers> pLines;
+    DWORD line = 3 + (i % statementCount);
+    VERIFY_SUCCEEDED(pSession->findLinesByLinenum(nullptr, pFile, line, 0, &pLines));
+  }
+  double lineMs = std::chrono::duration<double, std::milli>(
+    std::chrono::steady_clock::now() - start).count();
+
+  WEX::Logging::Log::Comment(WEX::Common::String().Format(
+    L"%d line records: session opened in %.1f ms; %u RVA lookups (%u "
+    L"resolved) in %.0f ms; %u line lookups in %.0f ms",
+    lineCount, openMs, sampleCount, resolved, rvaMs, sampleCount, lineMs));
+  VERIFY_IS_TRUE(resolved > 0);
+}
+
 TEST_F(CompilerTest, CompileWhenDefinesThenApplied) {
   CComPtr<IDxcCompiler> pCompiler;
   CComPtr<IDxcOperationResult> pResult;
@@ -1671,6 +1908,222 @@ TEST_F(CompilerTest, CompileWhenIncludeThenLoadUsed) {
   VERIFY_ARE_EQUAL_WSTR(L"./helper.h;", pInclude->GetAllFileNames().c_str());
 }
 
+TEST_F(CompilerTest, CompileWhenCacheThenResultReused) {
+  CComPtr<IDxcCompiler> pCompiler;
+  CComPtr<IDxcCompileCacheStats> pStats;
+  CComPtr<IDxcBlobEncoding> pSource;
+  UINT64 hits, misses, stores, evictions;
+
+  VERIFY_SUCCEEDED(CreateCompiler(&pCompiler));
+  VERIFY_SUCCEEDED(pCompiler.QueryInterface(&pStats));
+  CreateBlobFromText(
+    "#include \"helper.h\"\r\n"
+    "float4 main() : SV_Target { return ZERO; }", &pSource);
+
+  wchar_t tempPath[MAX_PATH];
+  VERIFY_ARE_NOT_EQUAL(0, GetTempPathW(_countof(tempPath), tempPath));
+  std::wstring cacheDir(tempPath);
+  cacheDir += L"dxc-cache-test-";
+  cacheDir += std::to_wstring(GetCurrentProcessId());
+  TempDirectoryRemover cacheDirRemover(cacheDir);
+  LPCWSTR args[] = { L"/cache", cacheDir.c_str() };
+
+  auto compile = [&](const char *pHelper, IDxcOperationResult **ppResult) {
+    CComPtr<TestIncludeHandler> pInclude = new TestIncludeHandler(m_dllSupport);
+    // A lookup reloads the header once before any compile would.
+    pInclude->CallResults.emplace_back(pHelper);
+    pInclude->CallResults.emplace_back(pHelper);
+    VERIFY_SUCCEEDED(pCompiler->Compile(pSource, L"source.hlsl", L"main",
+      L"ps_6_0", args, _countof(args), nullptr, 0, pInclude, ppResult));
+    VerifyOperationSucceeded(*ppResult);
+  };
+
+  // First compile populates the cache.
+  CComPtr<IDxcOperationResult> pFirst;
+  compile("#define ZERO 0", &pFirst);
+  VERIFY_SUCCEEDED(pStats->GetCompileCacheStats(&hits, &misses, &stores, &evictions));
+  UINT64 hitsBefore = hits;
+
+  // Identical inputs are served from the cache with identical output.
+  CComPtr<IDxcOperationResult> pSecond;
+  compile("#define ZERO 0", &pSecond);
+  VERIFY_SUCCEEDED(pStats->GetCompileCacheStats(&hits, &misses, &stores, &evictions));
+  VERIFY_ARE_EQUAL(hitsBefore + 1, hits);
+  CComPtr<IDxcBlob> pFirstBlob, pSecondBlob;
+  VERIFY_SUCCEEDED(pFirst->GetResult(&pFirstBlob));
+  VERIFY_SUCCEEDED(pSecond->GetResult(&pSecondBlob));
+  VERIFY_ARE_EQUAL(pFirstBlob->GetBufferSize(), pSecondBlob->GetBufferSize());
+  VERIFY_ARE_EQUAL(0, memcmp(pFirstBlob->GetBufferPointer(),
+                             pSecondBlob->GetBufferPointer(),
+                             pFirstBlob->GetBufferSize()));
+
+  // A changed header is a miss.
+  CComPtr<IDxcOperationResult> pThird;
+  compile("#define ZERO 1", &pThird);
+  VERIFY_SUCCEEDED(pStats->GetCompileCacheStats(&hits, &misses, &stores, &evictions));
+  VERIFY_ARE_EQUAL(hitsBefore + 1, hits);
+}
+
+TEST_F(CompilerTest, ValidateWhenCacheThenResultReused) {
+  CComPtr<IDxcCompiler> pCompiler;
+  CComPtr<IDxcValidator> pValidator;
+  CComPtr<IDxcValidatorCache> pValidatorCache;
+  CComPtr<IDxcBlobEncoding> pSource;
+  CComPtr<IDxcOperationResult> pResult;
+  CComPtr<IDxcBlob> pProgram;
+  UINT64 hits, misses;
+
+  VERIFY_SUCCEEDED(CreateCompiler(&pCompiler));
+  CreateBlobFromText("float4 main() : SV_Target { return 0; }", &pSource);
+  VERIFY_SUCCEEDED(pCompiler->Compile(pSource, L"source.hlsl", L"main",
+    L"ps_6_0", nullptr, 0, nullptr, 0, nullptr, &pResult));
+  VerifyOperationSucceeded(pResult);
+  VERIFY_SUCCEEDED(pResult->GetResult(&pProgram));
+
+  wchar_t tempPath[MAX_PATH];
+  VERIFY_ARE_NOT_EQUAL(0, GetTempPathW(_countof(tempPath), tempPath));
+  std::wstring cacheDir(tempPath);
+  cacheDir += L"dxc-valcache-test-";
+  cacheDir += std::to_wstring(GetCurrentProcessId());
+  TempDirectoryRemover cacheDirRemover(cacheDir);
+
+  VERIFY_SUCCEEDED(m_dllSupport.CreateInstance(CLSID_DxcValidator, &pValidator));
+  VERIFY_SUCCEEDED(pValidator.QueryInterface(&pValidatorCache));
+  VERIFY_SUCCEEDED(pValidatorCache->SetValidationCache(cacheDir.c_str(), 16));
+
+  HRESULT status[2];
+  for (int i = 0; i < 2; ++i) {
+    CComPtr<IDxcOperationResult> pValResult;
+    VERIFY_SUCCEEDED(pValidator->Validate(pProgram, DxcValidatorFlags_Default, &pValResult));
+    VERIFY_SUCCEEDED(pValResult->GetStatus(&status[i]));
+  }
+  VERIFY_SUCCEEDED(status[0]);
+  VERIFY_ARE_EQUAL(status[0], status[1]);
+
+  // The second validation of the same bytes is a lookup.
+  VERIFY_SUCCEEDED(pValidatorCache->GetValidationCacheStats(&hits, &misses));
+  VERIFY_ARE_EQUAL(2ULL, hits + misses);
+  VERIFY_IS_TRUE(hits >= 1);
+}
+
+TEST_F(CompilerTest, CompileBatchWhenPermutationsThenIncludeLoadedOnce) {
+  CComPtr<IDxcCompiler> pCompiler;
+  CComPtr<IDxcBatchCompiler> pBatchCompiler;
+  CComPtr<IDxcBlobEncoding> pSource;
+  CComPtr<TestIncludeHandler> pInclude;
+
+  VERIFY_SUCCEEDED(CreateCompiler(&pCompiler));
+  VERIFY_SUCCEEDED(pCompiler.QueryInterface(&pBatchCompiler));
+  CreateBlobFromText(
+    "#include \"helper.h\"\r\n"
+    "float4 main() : SV_Target { return VALUE; }\r\n"
+    "float4 alt() : SV_Target { return VALUE + 1; }", &pSource);
+
+  // Only one result is queued; a second load would fail the include.
+  pInclude = new TestIncludeHandler(m_dllSupport);
+  pInclude->CallResults.emplace_back("#ifndef VALUE\r\n#define VALUE 0\r\n#endif");
+
+  DxcDefine defines[] = { { L"VALUE", L"2" } };
+  DxcPermutation permutations[] = {
+    { L"main", L"ps_6_0", nullptr, 0 },
+    { L"alt", L"ps_6_0", defines, _countof(defines) },
+  };
+  IDxcOperationResult *results[_countof(permutations)];
+  VERIFY_SUCCEEDED(pBatchCompiler->CompileBatch(
+    pSource, L"source.hlsl", nullptr, 0, permutations, _countof(permutations),
+    pInclude, results));
+  for (IDxcOperationResult *pResult : results) {
+    CComPtr<IDxcOperationResult> pOwned;
+    pOwned.Attach(pResult);
+    VerifyOperationSucceeded(pOwned);
+  }
+  VERIFY_ARE_EQUAL_WSTR(L"./helper.h;", pInclude->GetAllFileNames().c_str());
+}
+
+// Stress test for the concurrency contract on IDxcCompiler: one compiler
+// instance is shared by every thread, each thread compiles different sources
+// with its own include handler, and every result is checked against a
+// single-threaded compile of the same source. Timings for each thread count
+// are logged so that scaling can be tracked.
+TEST_F(CompilerTest, CompileWhenConcurrentThenOK) {
+  const unsigned sourceCount = 64;
+  CComPtr<IDxcCompiler> pCompiler;
+  VERIFY_SUCCEEDED(CreateCompiler(&pCompiler));
+
+  std::vector<CComPtr<IDxcBlobEncoding>> sources(sourceCount);
+  std::vector<CComPtr<IDxcBlob>> expected(sourceCount);
+  for (unsigned i = 0; i < sourceCount; ++i) {
+    std::string text =
+      "#include \"helper.h\"\r\n"
+      "float4 main(float4 a : A) : SV_Target {\r\n"
+      "  float4 r = a;\r\n"
+      "  for (int j = 0; j < " + std::to_string(i % 8 + 1) + "; ++j)\r\n"
+      "    r = sin(r) * SCALE + " + std::to_string(i) + ";\r\n"
+      "  return r;\r\n"
+      "}";
+    CreateBlobFromText(text.c_str(), &sources[i]);
+  }
+
+  auto compileOne = [&](unsigned i, IDxcBlob **ppBlob) -> HRESULT {
+    CComPtr<TestIncludeHandler> pInclude = new TestIncludeHandler(m_dllSupport);
+    pInclude->CallResults.emplace_back("#define SCALE 2.0");
+    CComPtr<IDxcOperationResult> pResult;
+    HRESULT hr = pCompiler->Compile(sources[i], L"source.hlsl", L"main",
+      L"ps_6_0", nullptr, 0, nullptr, 0, pInclude, &pResult);
+    if (FAILED(hr))
+      return hr;
+    HRESULT status;
+    hr = pResult->GetStatus(&status);
+    if (FAILED(hr))
+      return hr;
+    if (FAILED(status))
+      return status;
+    return pResult->GetResult(ppBlob);
+  };
+
+  for (unsigned i = 0; i < sourceCount; ++i) {
+    VERIFY_SUCCEEDED(compileOne(i, &expected[i]));
+  }
+
+  unsigned maxThreads = std::max(4u, std::thread::hardware_concurrency());
+  double baselineMs = 0;
+  for (unsigned threadCount = 1; threadCount <= maxThreads; threadCount *= 2) {
+    std::atomic<unsigned> next(0);
+    std::atomic<unsigned> failures(0);
+    auto worker = [&]() {
+      for (;;) {
+        unsigned i = next.fetch_add(1);
+        if (i >= sourceCount)
+          return;
+        CComPtr<IDxcBlob> pBlob;
+        if (FAILED(compileOne(i, &pBlob)) ||
+            pBlob->GetBufferSize() != expected[i]->GetBufferSize() ||
+            0 != memcmp(pBlob->GetBufferPointer(),
+                        expected[i]->GetBufferPointer(),
+                        pBlob->GetBufferSize())) {
+          ++failures;
+        }
+      }
+    };
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (unsigned t = 0; t < threadCount; ++t)
+      threads.emplace_back(worker);
+    for (std::thread &t : threads)
+      t.join();
+    double ms = std::chrono::duration<double, std::milli>(
+      std::chrono::steady_clock::now() - start).count();
+    if (threadCount == 1)
+      baselineMs = ms;
+
+    WEX::Logging::Log::Comment(WEX::Common::String().Format(
+      L"%u thread(s): %u compiles in %.0f ms, %.2fx speedup",
+      threadCount, sourceCount, ms, baselineMs / ms));
+    VERIFY_ARE_EQUAL(0u, failures.load());
+  }
+}
+
 TEST_F(CompilerTest, CompileWhenIncludeAbsoluteThenLoadAbsolute) {
   CComPtr<IDxcCompiler> pCompiler;
   CComPtr<IDxcOperationResult> pResult;
@@ -1832,6 +2285,56 @@ TEST_F(CompilerTest, CompileWhenIncludeHasPathThenOK) {
  }
 }
 
+TEST_F(CompilerTest, CompileWhenIncludeLargeOnDiskThenOK) {
+  CComPtr<IDxcCompiler> pCompiler;
+  CComPtr<IDxcLibrary> pLibrary;
+  CComPtr<IDxcIncludeHandler> pInclude;
+  CComPtr<IDxcBlobEncoding> pSource;
+  CComPtr<IDxcOperationResult> pResult;
+
+  VERIFY_SUCCEEDED(CreateCompiler(&pCompiler));
+  VERIFY_SUCCEEDED(m_dllSupport.CreateInstance(CLSID_DxcLibrary, &pLibrary));
+  VERIFY_SUCCEEDED(pLibrary->CreateIncludeHandler(&pInclude));
+
+  // Large enough for the include handler to map the file rather than read it.
+  wchar_t tempPath[MAX_PATH];
+  VERIFY_ARE_NOT_EQUAL(0, GetTempPathW(_countof(tempPath), tempPath));
+  std::wstring headerPath(tempPath);
+  headerPath += L"dxc-large-include-";
+  headerPath += std::to_wstring(GetCurrentProcessId());
+  headerPath += L".h";
+  {
+    std::ofstream header(headerPath, std::ios::binary);
+    header << "#define ZERO 0\r\n";
+    for (unsigned i = 0; i < 4096; ++i)
+      header << "// padding padding padding padding padding padding\r\n";
+  }
+
+  CComPtr<IDxcBlob> pHeader;
+  VERIFY_SUCCEEDED(pInclude->LoadSource(headerPath.c_str(), &pHeader));
+  VERIFY_IS_TRUE(pHeader->GetBufferSize() >= 64 * 1024);
+
+  // ASCII content is handed to the compiler without conversion.
+  CComPtr<IDxcBlobEncoding> pHeaderUtf8;
+  VERIFY_SUCCEEDED(pLibrary->GetBlobAsUtf8(pHeader, &pHeaderUtf8));
+  VERIFY_ARE_EQUAL(pHeader->GetBufferPointer(),
+                   pHeaderUtf8->GetBufferPointer());
+  pHeaderUtf8.Release();
+  pHeader.Release();
+
+  std::string text("#include \"");
+  text += Unicode::UTF16ToUTF8StringOrThrow(headerPath.c_str());
+  text += "\"\r\nfloat4 main() : SV_Target { return ZERO; }";
+  CreateBlobFromText(text.c_str(), &pSource);
+  VERIFY_SUCCEEDED(pCompiler->Compile(pSource, L"source.hlsl", L"main",
+    L"ps_6_0", nullptr, 0, nullptr, 0, pInclude, &pResult));
+  VerifyOperationSucceeded(pResult);
+  pResult.Release();
+
+  // The mapping is released with the last reference to the blob.
+  VERIFY_IS_TRUE(DeleteFileW(headerPath.c_str()) != FALSE);
+}
+
 static const char EmptyCompute[] = "[numthreads(8,8,1)] void main() { }";
 
 TEST_F(CompilerTest, CompileWhenODumpThenPassConfig) {
@@ -1853,6 +2356,79 @@ TEST_F(CompilerTest, CompileWhenODumpThenPassConfig) {
   VERIFY_ARE_NOT_EQUAL(string::npos, passes.find("inline"));
 }
 
+TEST_F(CompilerTest, CompileWhenTimeReportThenPhasesAndPassesReported) {
+  CComPtr<IDxcCompiler> pCompiler;
+  CComPtr<IDxcOperationResult> pResult;
+  CComPtr<IDxcBlobEncoding> pSource;
+  CComPtr<IDxcCompileTimeReport> pTimeReport;
+
+  VERIFY_SUCCEEDED(CreateCompiler(&pCompiler));
+  CreateBlobFromText(
+    "float4x4 m; float4 main(float4 p : POSITION) : SV_Target { return mul(p, m); }",
+    &pSource);
+
+  // Without the option, no report is attached to the result.
+  VERIFY_SUCCEEDED(pCompiler->Compile(pSource, L"source.hlsl", L"main",
+    L"ps_6_0", nullptr, 0, nullptr, 0, nullptr, &pResult));
+  VerifyOperationSucceeded(pResult);
+  VERIFY_FAILED(pResult.QueryInterface(&pTimeReport));
+  pResult.Release();
+
+  LPCWSTR Args[] = { L"/time_report" };
+  VERIFY_SUCCEEDED(pCompiler->Compile(pSource, L"source.hlsl", L"main",
+    L"ps_6_0", Args, _countof(Args), nullptr, 0, nullptr, &pResult));
+  VerifyOperationSucceeded(pResult);
+  VERIFY_SUCCEEDED(pResult.QueryInterface(&pTimeReport));
+  CComPtr<IDxcBlobEncoding> pReport;
+  VERIFY_SUCCEEDED(pTimeReport->GetTimeReport(&pReport));
+  string report = BlobToUtf8(pReport);
+  CA2W reportWide(report.c_str(), CP_UTF8);
+  WEX::Logging::Log::Comment(reportWide);
+
+  for (const char *pExpected :
+       { "\"phases\"", "\"frontend\"", "\"codegen\"", "\"optimize\"",
+         "\"container\"", "\"validation\"", "\"passes\"",
+         "\"DXIL Generator\"", "\"instructionsBefore\"",
+         "\"instructionsAfter\"", "\"peakBytes\"" }) {
+    VERIFY_ARE_NOT_EQUAL(string::npos, report.find(pExpected));
+  }
+  // Packing statistics are only reported for /pack_minimal.
+  VERIFY_ARE_EQUAL(string::npos, report.find("\"signatureRowsSaved\""));
+}
+
+TEST_F(CompilerTest, CompileWhenTimeReportAndPackMinimalThenRowsSavedReported) {
+  CComPtr<IDxcCompiler> pCompiler;
+  CComPtr<IDxcOperationResult> pResult;
+  CComPtr<IDxcBlobEncoding> pSource;
+  CComPtr<IDxcCompileTimeReport> pTimeReport;
+
+  VERIFY_SUCCEEDED(CreateCompiler(&pCompiler));
+  CreateBlobFromText(
+    "struct VSOut { float4 pos : SV_Position; float3 a : A; float b : B;\r\n"
+    "  nointerpolation uint c : C; float2 d : D; float2 e : E; };\r\n"
+    "VSOut main(float4 p : POSITION) { VSOut o = (VSOut)p.x; o.pos = p; return o; }",
+    &pSource);
+
+  LPCWSTR Args[] = { L"/time_report", L"/pack_minimal" };
+  VERIFY_SUCCEEDED(pCompiler->Compile(pSource, L"source.hlsl", L"main",
+    L"vs_6_0", Args, _countof(Args), nullptr, 0, nullptr, &pResult));
+  VerifyOperationSucceeded(pResult);
+  VERIFY_SUCCEEDED(pResult.QueryInterface(&pTimeReport));
+  CComPtr<IDxcBlobEncoding> pReport;
+  VERIFY_SUCCEEDED(pTimeReport->GetTimeReport(&pReport));
+  string report = BlobToUtf8(pReport);
+  CA2W reportWide(report.c_str(), CP_UTF8);
+  WEX::Logging::Log::Comment(reportWide);
+
+  // The DXIL Generator entry carries the rows saved over /pack_optimized.
+  size_t generator = report.find("\"DXIL Generator\"");
+  VERIFY_ARE_NOT_EQUAL(string::npos, generator);
+  size_t statistic = report.find("\"statistics\": { \"signatureRowsSaved\": ",
+                                 generator);
+  VERIFY_ARE_NOT_EQUAL(string::npos, statistic);
+  VERIFY_IS_TRUE(statistic < report.find('}', generator));
+}
+
 TEST_F(CompilerTest, CompileWhenVdThenProducesDxilContainer) {
   CComPtr<IDxcCompiler> pCompiler;
   CComPtr<IDxcOperationResult> pResult;
@@ -1959,6 +2535,112 @@ TEST_F(CompilerTest, CompileWhenODumpThenOptimizerMatch) {
   }
 }
 
+TEST_F(CompilerTest, OptimizerPipelineWhenParallelThenMatchesRunOptimizer) {
+  const char *Sources[] = {
+    "float4 main() : SV_Target { return 0; }",
+    "float4 main(float4 a : A) : SV_Target { if (a.x > 0) return a; return 1; }",
+    "float4 main(float4 a : A) : SV_Target { float4 r = 0; for (int i = 0; i < 4; ++i) r += a * i; return r; }",
+  };
+  LPCWSTR Options[] = { L"-simplifycfg", L"-S" };
+  CComPtr<IDxcCompiler> pCompiler;
+  CComPtr<IDxcOptimizer> pOptimizer;
+  CComPtr<IDxcOptimizerPipelineBuilder> pBuilder;
+  CComPtr<IDxcOptimizerPipeline> pPipeline;
+  VERIFY_SUCCEEDED(CreateCompiler(&pCompiler));
+  VERIFY_SUCCEEDED(m_dllSupport.CreateInstance(CLSID_DxcOptimizer, &pOptimizer));
+  VERIFY_SUCCEEDED(pOptimizer.QueryInterface(&pBuilder));
+  VERIFY_SUCCEEDED(pBuilder->CreatePipeline(Options, _countof(Options), &pPipeline));
+
+  const UINT32 count = _countof(Sources);
+  CComPtr<IDxcBlob> pModules[count];
+  CComPtr<IDxcBlob> pExpectedModules[count];
+  CComPtr<IDxcBlobEncoding> pExpectedTexts[count];
+  for (UINT32 i = 0; i < count; ++i) {
+    CComPtr<IDxcBlobEncoding> pSource;
+    CComPtr<IDxcOperationResult> pResult;
+    LPCWSTR Args[] = { L"/fcgl" };
+    CreateBlobFromText(Sources[i], &pSource);
+    VERIFY_SUCCEEDED(pCompiler->Compile(pSource, L"source.hlsl", L"main",
+      L"ps_6_0", Args, _countof(Args), nullptr, 0, nullptr, &pResult));
+    VerifyOperationSucceeded(pResult);
+    VERIFY_SUCCEEDED(pResult->GetResult(&pModules[i]));
+    VERIFY_SUCCEEDED(pOptimizer->RunOptimizer(pModules[i], Options,
+      _countof(Options), &pExpectedModules[i], &pExpectedTexts[i]));
+  }
+
+  IDxcBlob *pInputs[count];
+  IDxcBlob *pOutputModules[count];
+  IDxcBlobEncoding *pOutputTexts[count];
+  HRESULT results[count];
+  for (UINT32 i = 0; i < count; ++i)
+    pInputs[i] = pModules[i];
+  VERIFY_SUCCEEDED(pPipeline->RunOptimizerParallel(count, pInputs, 0,
+    pOutputModules, pOutputTexts, results));
+  for (UINT32 i = 0; i < count; ++i) {
+    CComPtr<IDxcBlob> pModule;
+    CComPtr<IDxcBlobEncoding> pText;
+    pModule.Attach(pOutputModules[i]);
+    pText.Attach(pOutputTexts[i]);
+    VERIFY_SUCCEEDED(results[i]);
+    VERIFY_ARE_EQUAL(pExpectedModules[i]->GetBufferSize(), pModule->GetBufferSize());
+    VERIFY_IS_TRUE(0 == memcmp(pExpectedModules[i]->GetBufferPointer(),
+      pModule->GetBufferPointer(), pModule->GetBufferSize()));
+    VERIFY_ARE_EQUAL_STR(BlobToUtf8(pExpectedTexts[i]).c_str(),
+      BlobToUtf8(pText).c_str());
+  }
+}
+
+// The bitcode reader installs its own fatal error handler, so this has each
+// worker thread (including the calling one) parse and reject bad bitcode
+// while other modules are being optimized.
+TEST_F(CompilerTest, OptimizerPipelineWhenParallelBadBitcodeThenOthersSucceed) {
+  static const char BadBitcode[] = "BC\xC0\xDE\x35\x14\x00\x00\x05\x00\x00\x00";
+  LPCWSTR Options[] = { L"-simplifycfg", L"-S" };
+  CComPtr<IDxcCompiler> pCompiler;
+  CComPtr<IDxcOptimizer> pOptimizer;
+  CComPtr<IDxcOptimizerPipelineBuilder> pBuilder;
+  CComPtr<IDxcOptimizerPipeline> pPipeline;
+  VERIFY_SUCCEEDED(CreateCompiler(&pCompiler));
+  VERIFY_SUCCEEDED(m_dllSupport.CreateInstance(CLSID_DxcOptimizer, &pOptimizer));
+  VERIFY_SUCCEEDED(pOptimizer.QueryInterface(&pBuilder));
+  VERIFY_SUCCEEDED(pBuilder->CreatePipeline(Options, _countof(Options), &pPipeline));
+
+  CComPtr<IDxcBlobEncoding> pSource;
+  CComPtr<IDxcOperationResult> pResult;
+  CComPtr<IDxcBlob> pGood;
+  CComPtr<IDxcBlobEncoding> pBad;
+  LPCWSTR Args[] = { L"/fcgl" };
+  CreateBlobFromText("float4 main() : SV_Target { return 1; }", &pSource);
+  VERIFY_SUCCEEDED(pCompiler->Compile(pSource, L"source.hlsl", L"main",
+    L"ps_6_0", Args, _countof(Args), nullptr, 0, nullptr, &pResult));
+  VerifyOperationSucceeded(pResult);
+  VERIFY_SUCCEEDED(pResult->GetResult(&pGood));
+  CreateBlobPinned(BadBitcode, sizeof(BadBitcode) - 1, CP_ACP, &pBad);
+
+  // One thread runs everything on the calling thread; eight spread it out.
+  const UINT32 count = 8;
+  for (UINT32 threadCount : { 1u, count }) {
+    IDxcBlob *pInputs[count];
+    IDxcBlob *pOutputModules[count];
+    HRESULT results[count];
+    for (UINT32 i = 0; i < count; ++i)
+      pInputs[i] = (i % 2) ? (IDxcBlob *)pBad.p : pGood.p;
+    VERIFY_SUCCEEDED(pPipeline->RunOptimizerParallel(count, pInputs,
+      threadCount, pOutputModules, nullptr, results));
+    for (UINT32 i = 0; i < count; ++i) {
+      CComPtr<IDxcBlob> pModule;
+      pModule.Attach(pOutputModules[i]);
+      if (i % 2) {
+        VERIFY_FAILED(results[i]);
+        VERIFY_IS_NULL(pModule.p);
+      } else {
+        VERIFY_SUCCEEDED(results[i]);
+        VERIFY_IS_NOT_NULL(pModule.p);
+      }
+    }
+  }
+}
+
 TEST_F(CompilerTest, CompileWhenShaderModelMismatchAttributeThenFail) {
   CComPtr<IDxcCompiler> pCompiler;
   CComPtr<IDxcOperationResult> pResult;
@@ -2292,6 +2974,10 @@ TEST_F(CompilerTest, CodeGenClipPlanes) {
   CodeGenTestCheck(L"..\\CodeGenHLSL\\clip_planes.hlsl");
 }
 
+TEST_F(CompilerTest, CodeGenCoalesceBufferLoads) {
+  CodeGenTestCheck(L"..\\CodeGenHLSL\\coalesce_buffer_loads.hlsl");
+}
+
 TEST_F(CompilerTest, CodeGenConstoperand1) {
   CodeGenTest(L"..\\CodeGenHLSL\\constoperand1.hlsl");
 }
@@ -2559,6 +3245,10 @@ TEST_F(CompilerTest, CodeGenIntrinsic5) {
   CodeGenTestCheck(L"..\\CodeGenHLSL\\intrinsic5.hlsl");
 }
 
+TEST_F(CompilerTest, CodeGenIntrinsicConstFold) {
+  CodeGenTestCheck(L"..\\CodeGenHLSL\\intrinsic_const_fold.hlsl");
+}
+
 TEST_F(CompilerTest, CodeGenInvalidInputOutputTypes) {
   CodeGenTestCheck(L"..\\CodeGenHLSL\\invalid_input_output_types.hlsl");
 }
@@ -2874,6 +3564,10 @@ TEST_F(CompilerTest, CodeGenRedundantinput1) {
   CodeGenTest(L"..\\CodeGenHLSL\\redundantinput1.hlsl");
 }
 
+TEST_F(CompilerTest, CodeGenRedundantLoadElim) {
+  CodeGenTestCheck(L"..\\CodeGenHLSL\\redundant_load_elim.hlsl");
+}
+
 TEST_F(CompilerTest, CodeGenRes64bit) {
   CodeGenTestCheck(L"..\\CodeGenHLSL\\res64bit.hlsl");
 }
@@ -4423,6 +5117,205 @@ TEST_F(CompilerTest, PreprocessWhenValidThenOK) {
     "int BAR;\n", text.c_str());
 }
 
+TEST_F(CompilerTest, PrecompiledHeaderWhenUsedThenHeadersNotLoaded) {
+  CComPtr<IDxcCompiler> pCompiler;
+  CComPtr<IDxcOperationResult> pResult;
+  CComPtr<IDxcBlobEncoding> pHeader;
+  CComPtr<IDxcBlobEncoding> pSource;
+  CComPtr<TestIncludeHandler> pInclude;
+
+  VERIFY_SUCCEEDED(CreateCompiler(&pCompiler));
+  CreateBlobFromText(
+    "#include \"b.h\"\r\n"
+    "float4 Scale(float4 v) { return v * B; }", &pHeader);
+  pInclude = new TestIncludeHandler(m_dllSupport);
+  pInclude->CallResults.emplace_back("#pragma once\r\n#define B 2");
+
+  LPCWSTR createArgs[] = { L"-Yc", L"-T", L"ps_6_0" };
+  VERIFY_SUCCEEDED(pCompiler->Preprocess(pHeader, L"common.hlsli",
+    createArgs, _countof(createArgs), nullptr, 0, pInclude, &pResult));
+  VerifyOperationSucceeded(pResult);
+  CComPtr<IDxcBlob> pPch;
+  VERIFY_SUCCEEDED(pResult->GetResult(&pPch));
+  std::string pchText = BlobToUtf8(pPch);
+  VERIFY_IS_TRUE(0 == pchText.find(
+    "// DXC precompiled header\n"
+    "// target: ps_6_0\n"
+    "// hlsl: 2016\n"
+    "// covers: ./common.hlsli\n"
+    "// covers: ./b.h\n"));
+  VERIFY_IS_TRUE(std::string::npos != pchText.find("#define B 2"));
+
+  // The source includes the header again, but only the precompiled header
+  // is loaded.
+  pResult.Release();
+  CreateBlobFromText(
+    "#include \"common.hlsli\"\r\n"
+    "float4 main() : SV_Target { return Scale(1); }", &pSource);
+  pInclude = new TestIncludeHandler(m_dllSupport);
+  pInclude->CallResults.emplace_back(pchText.c_str());
+
+  LPCWSTR useArgs[] = { L"-Yu", L"common.pch" };
+  VERIFY_SUCCEEDED(pCompiler->Compile(pSource, L"source.hlsl", L"main",
+    L"ps_6_0", useArgs, _countof(useArgs), nullptr, 0, pInclude, &pResult));
+  VerifyOperationSucceeded(pResult);
+  VERIFY_ARE_EQUAL_WSTR(L"./common.pch;", pInclude->GetAllFileNames().c_str());
+}
+
+TEST_F(CompilerTest, PrecompiledHeaderWhenDefinesDifferThenFail) {
+  CComPtr<IDxcCompiler> pCompiler;
+  CComPtr<IDxcOperationResult> pResult;
+  CComPtr<IDxcBlobEncoding> pHeader;
+  CComPtr<IDxcBlobEncoding> pSource;
+  CComPtr<TestIncludeHandler> pInclude;
+
+  VERIFY_SUCCEEDED(CreateCompiler(&pCompiler));
+  CreateBlobFromText(
+    "#ifdef HALF\r\n"
+    "float4 Scale(float4 v) { return v * 0.5; }\r\n"
+    "#else\r\n"
+    "float4 Scale(float4 v) { return v * 2; }\r\n"
+    "#endif", &pHeader);
+
+  LPCWSTR createArgs[] = { L"-Yc", L"-T", L"ps_6_0", L"-D", L"HALF" };
+  VERIFY_SUCCEEDED(pCompiler->Preprocess(pHeader, L"common.hlsli",
+    createArgs, _countof(createArgs), nullptr, 0, nullptr, &pResult));
+  VerifyOperationSucceeded(pResult);
+  CComPtr<IDxcBlob> pPch;
+  VERIFY_SUCCEEDED(pResult->GetResult(&pPch));
+  std::string pchText = BlobToUtf8(pPch);
+  VERIFY_IS_TRUE(std::string::npos != pchText.find("// define: HALF=1\n"));
+
+  CreateBlobFromText(
+    "#include \"common.hlsli\"\r\n"
+    "float4 main() : SV_Target { return Scale(1); }", &pSource);
+
+  // The same define, passed through the API instead of -D, matches.
+  pResult.Release();
+  pInclude = new TestIncludeHandler(m_dllSupport);
+  pInclude->CallResults.emplace_back(pchText.c_str());
+  DxcDefine half = { L"HALF", nullptr };
+  LPCWSTR useArgs[] = { L"-Yu", L"common.pch" };
+  VERIFY_SUCCEEDED(pCompiler->Compile(pSource, L"source.hlsl", L"main",
+    L"ps_6_0", useArgs, _countof(useArgs), &half, 1, pInclude, &pResult));
+  VerifyOperationSucceeded(pResult);
+
+  // Without HALF the header would take the other branch, so the
+  // precompiled header is rejected rather than silently used.
+  pResult.Release();
+  pInclude = new TestIncludeHandler(m_dllSupport);
+  pInclude->CallResults.emplace_back(pchText.c_str());
+  LPCWSTR otherDefineArgs[] = { L"-Yu", L"common.pch", L"-D", L"FULL" };
+  VERIFY_SUCCEEDED(pCompiler->Compile(pSource, L"source.hlsl", L"main",
+    L"ps_6_0", otherDefineArgs, _countof(otherDefineArgs), nullptr, 0,
+    pInclude, &pResult));
+  std::string errors = VerifyOperationFailed(pResult);
+  VERIFY_IS_TRUE(std::string::npos !=
+                 errors.find("precompiled header 'common.pch' was created "
+                             "with different defines"));
+
+  // So is one made for another target.
+  pResult.Release();
+  pInclude = new TestIncludeHandler(m_dllSupport);
+  pInclude->CallResults.emplace_back(pchText.c_str());
+  VERIFY_SUCCEEDED(pCompiler->Compile(pSource, L"source.hlsl", L"main",
+    L"ps_6_1", useArgs, _countof(useArgs), &half, 1, pInclude, &pResult));
+  VerifyOperationFailed(pResult);
+}
+
+TEST_F(CompilerTest, PrecompiledHeaderWhenUnusedDefinesDifferThenReused) {
+  CComPtr<IDxcCompiler> pCompiler;
+  CComPtr<IDxcOperationResult> pResult;
+  CComPtr<IDxcBlobEncoding> pHeader;
+  CComPtr<IDxcBlobEncoding> pSource;
+  CComPtr<TestIncludeHandler> pInclude;
+
+  VERIFY_SUCCEEDED(CreateCompiler(&pCompiler));
+  CreateBlobFromText(
+    "#if defined(HALF) || QUALITY > 1\r\n"
+    "float4 Scale(float4 v) { return v * 0.5; }\r\n"
+    "#else\r\n"
+    "float4 Scale(float4 v) { return v * 2; }\r\n"
+    "#endif", &pHeader);
+
+  // Only the macros the header tests are recorded, not PERMUTATION.
+  LPCWSTR createArgs[] = { L"-Yc", L"-T", L"ps_6_0", L"-D", L"QUALITY=2",
+                           L"-D", L"PERMUTATION=1" };
+  VERIFY_SUCCEEDED(pCompiler->Preprocess(pHeader, L"common.hlsli",
+    createArgs, _countof(createArgs), nullptr, 0, nullptr, &pResult));
+  VerifyOperationSucceeded(pResult);
+  CComPtr<IDxcBlob> pPch;
+  VERIFY_SUCCEEDED(pResult->GetResult(&pPch));
+  std::string pchText = BlobToUtf8(pPch);
+  VERIFY_IS_TRUE(0 == pchText.find(
+    "// DXC precompiled header\n"
+    "// target: ps_6_0\n"
+    "// hlsl: 2016\n"
+    "// undefined: HALF\n"
+    "// define: QUALITY=2\n"
+    "// covers: ./common.hlsli\n"));
+
+  CreateBlobFromText(
+    "#include \"common.hlsli\"\r\n"
+    "float4 main() : SV_Target { return Scale(PERMUTATION); }", &pSource);
+
+  // Other permutations share the precompiled header.
+  pResult.Release();
+  pInclude = new TestIncludeHandler(m_dllSupport);
+  pInclude->CallResults.emplace_back(pchText.c_str());
+  LPCWSTR otherPermutationArgs[] = { L"-Yu", L"common.pch", L"-D",
+                                     L"QUALITY=2", L"-D", L"PERMUTATION=3" };
+  VERIFY_SUCCEEDED(pCompiler->Compile(pSource, L"source.hlsl", L"main",
+    L"ps_6_0", otherPermutationArgs, _countof(otherPermutationArgs), nullptr,
+    0, pInclude, &pResult));
+  VerifyOperationSucceeded(pResult);
+
+  // A macro the header tests must keep its value, and one it found
+  // undefined must stay undefined.
+  LPCWSTR otherQualityArgs[] = { L"-Yu", L"common.pch", L"-D", L"QUALITY=1",
+                                 L"-D", L"PERMUTATION=3" };
+  LPCWSTR halfArgs[] = { L"-Yu", L"common.pch", L"-D", L"QUALITY=2",
+                         L"-D", L"PERMUTATION=3", L"-D", L"HALF" };
+  for (auto &args : { std::make_pair(otherQualityArgs, _countof(otherQualityArgs)),
+                      std::make_pair(halfArgs, _countof(halfArgs)) }) {
+    pResult.Release();
+    pInclude = new TestIncludeHandler(m_dllSupport);
+    pInclude->CallResults.emplace_back(pchText.c_str());
+    VERIFY_SUCCEEDED(pCompiler->Compile(pSource, L"source.hlsl", L"main",
+      L"ps_6_0", args.first, args.second, nullptr, 0, pInclude, &pResult));
+    VerifyOperationFailed(pResult);
+  }
+}
+
+TEST_F(CompilerTest, ScanDependenciesWhenIncludesThenListed) {
+  CComPtr<IDxcCompiler> pCompiler;
+  CComPtr<IDxcDependencyScanner> pScanner;
+  CComPtr<IDxcOperationResult> pResult;
+  CComPtr<IDxcBlobEncoding> pSource;
+  CComPtr<TestIncludeHandler> pInclude;
+
+  VERIFY_SUCCEEDED(CreateCompiler(&pCompiler));
+  VERIFY_SUCCEEDED(pCompiler.QueryInterface(&pScanner));
+  // The body doesn't compile; only the preprocessor runs, so it isn't seen.
+  CreateBlobFromText(
+    "#include \"a.h\"\r\n"
+    "#ifdef USE_C\r\n"
+    "#include \"c.h\"\r\n"
+    "#endif\r\n"
+    "float4 main() : SV_Target { return undeclared; }", &pSource);
+
+  pInclude = new TestIncludeHandler(m_dllSupport);
+  pInclude->CallResults.emplace_back("#include \"b.h\"");
+  pInclude->CallResults.emplace_back("#define B 1");
+
+  VERIFY_SUCCEEDED(pScanner->ScanDependencies(pSource, L"source.hlsl", nullptr,
+    0, nullptr, 0, pInclude, &pResult));
+  VerifyOperationSucceeded(pResult);
+  CComPtr<IDxcBlob> pList;
+  VERIFY_SUCCEEDED(pResult->GetResult(&pList));
+  VERIFY_ARE_EQUAL_STR("source.hlsl\n./a.h\n./b.h\n", BlobToUtf8(pList).c_str());
+}
+
 TEST_F(CompilerTest, WhenSigMismatchPCFunctionThenFail) {
   CComPtr<IDxcCompiler> pCompiler;
   CComPtr<IDxcOperationResult> pResult;
@@ -107,6 +107,8 @@ protected:
   TEST_METHOD(TUWhenRegionInactiveThenEndIsBeforeEndifHash);
   TEST_METHOD(TUWhenRegionInactiveThenStartIsAtIfdefEol);
   TEST_METHOD(TUWhenUnsaveFileThenOK);
+  TEST_METHOD(TUWhenReparseUnchangedThenSkipped);
+  TEST_METHOD(TUWhenIncludeEditedWithinSecondThenReparsed);
 
   TEST_METHOD(QualifiedNameClass);
   TEST_METHOD(QualifiedNameVariable);
@@ -416,6 +418,146 @@ TEST_F(DXIntellisenseTest, TUWhenUnsaveFileThenOK) {
   }
 }
 
+TEST_F(DXIntellisenseTest, TUWhenReparseUnchangedThenSkipped) {
+  const char fileName[] = "filename.hlsl";
+  char program[] =
+    "float4 main() : SV_Target\r\n"
+    "{\r\n"
+    "  return 0;\r\n"
+    "}";
+  char editedProgram[] =
+    "float4 main() : SV_Target\r\n"
+    "{\r\n"
+    "  return 1;\r\n"
+    "}";
+
+  HlslIntellisenseSupport support;
+  VERIFY_SUCCEEDED(support.Initialize());
+  CComPtr<IDxcIntelliSense> isense;
+  CComPtr<IDxcIndex> tuIndex;
+  CComPtr<IDxcTranslationUnit> tu;
+  CComPtr<IDxcTranslationUnitStatistics> tuStats;
+  CComPtr<IDxcUnsavedFile> unsavedFile;
+  CComPtr<IDxcUnsavedFile> editedFile;
+  DxcTranslationUnitFlags localOptions;
+  DxcTranslationUnitStatistics stats;
+
+  VERIFY_SUCCEEDED(support.CreateIntellisense(&isense));
+  VERIFY_SUCCEEDED(isense->CreateIndex(&tuIndex));
+  VERIFY_SUCCEEDED(isense->GetDefaultEditingTUOptions(&localOptions));
+  VERIFY_SUCCEEDED(isense->CreateUnsavedFile(fileName, program, strlen(program), &unsavedFile));
+  VERIFY_SUCCEEDED(isense->CreateUnsavedFile(fileName, editedProgram, strlen(editedProgram), &editedFile));
+  VERIFY_SUCCEEDED(tuIndex->ParseTranslationUnit(fileName, nullptr, 0,
+    &(unsavedFile.p), 1, localOptions, &tu));
+  VERIFY_SUCCEEDED(tu.QueryInterface(&tuStats));
+
+  VERIFY_SUCCEEDED(tuStats->GetStatistics(&stats));
+  VERIFY_ARE_EQUAL(1, stats.ParseCount);
+  VERIFY_ARE_EQUAL(0, stats.ReparseCount);
+
+  // Same contents: the AST is reused.
+  VERIFY_SUCCEEDED(tu->Reparse(&(unsavedFile.p), 1));
+  VERIFY_SUCCEEDED(tuStats->GetStatistics(&stats));
+  VERIFY_ARE_EQUAL(1, stats.ParseCount);
+  VERIFY_ARE_EQUAL(1, stats.ReparseCount);
+  VERIFY_ARE_EQUAL(1, stats.ReparseSkippedCount);
+  VERIFY_ARE_EQUAL(0, stats.LastChangedFileCount);
+
+  // Edited contents: the sources are parsed again.
+  VERIFY_SUCCEEDED(tu->Reparse(&(editedFile.p), 1));
+  VERIFY_SUCCEEDED(tuStats->GetStatistics(&stats));
+  VERIFY_ARE_EQUAL(2, stats.ParseCount);
+  VERIFY_ARE_EQUAL(2, stats.ReparseCount);
+  VERIFY_ARE_EQUAL(1, stats.ReparseSkippedCount);
+  VERIFY_ARE_EQUAL(1, stats.LastChangedFileCount);
+  VERIFY_IS_TRUE(stats.TotalParseMicroseconds >= stats.LastParseMicroseconds);
+
+  // Dropping the unsaved file falls back to disk, so it must reparse too; the
+  // file doesn't exist there, so the result itself isn't interesting.
+  tu->Reparse(nullptr, 0);
+  VERIFY_SUCCEEDED(tuStats->GetStatistics(&stats));
+  VERIFY_ARE_EQUAL(3, stats.ParseCount);
+  VERIFY_ARE_EQUAL(1, stats.ReparseSkippedCount);
+}
+
+TEST_F(DXIntellisenseTest, TUWhenIncludeEditedWithinSecondThenReparsed) {
+  char tempPath[MAX_PATH];
+  VERIFY_ARE_NOT_EQUAL(0u, GetTempPathA(_countof(tempPath), tempPath));
+  std::string headerPath(tempPath);
+  headerPath += "dxc-isense-include-";
+  headerPath += std::to_string(GetCurrentProcessId());
+  headerPath += ".h";
+  // Removes the header however the test ends.
+  struct FileRemover {
+    std::string Path;
+    ~FileRemover() { DeleteFileA(Path.c_str()); }
+  } remover = { headerPath };
+
+  // Writes the header and returns its modification time, which is set to
+  // pTime if given.
+  auto writeHeader = [&](const char *pText, const FILETIME *pTime) {
+    HANDLE hFile = CreateFileA(headerPath.c_str(), GENERIC_WRITE, 0, nullptr,
+                               CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    VERIFY_ARE_NOT_EQUAL(INVALID_HANDLE_VALUE, hFile);
+    DWORD written;
+    VERIFY_WIN32_BOOL_SUCCEEDED(
+        WriteFile(hFile, pText, (DWORD)strlen(pText), &written, nullptr));
+    if (pTime != nullptr)
+      VERIFY_WIN32_BOOL_SUCCEEDED(SetFileTime(hFile, nullptr, nullptr, pTime));
+    FILETIME lastWrite;
+    VERIFY_WIN32_BOOL_SUCCEEDED(GetFileTime(hFile, nullptr, nullptr, &lastWrite));
+    CloseHandle(hFile);
+    return lastWrite;
+  };
+  FILETIME written = writeHeader("#define VALUE 1\r\n", nullptr);
+
+  const char fileName[] = "filename.hlsl";
+  std::string program("#include \"");
+  program += headerPath;
+  program += "\"\r\nfloat4 main() : SV_Target { return VALUE; }";
+
+  HlslIntellisenseSupport support;
+  VERIFY_SUCCEEDED(support.Initialize());
+  CComPtr<IDxcIntelliSense> isense;
+  CComPtr<IDxcIndex> tuIndex;
+  CComPtr<IDxcTranslationUnit> tu;
+  CComPtr<IDxcTranslationUnitStatistics> tuStats;
+  CComPtr<IDxcUnsavedFile> unsavedFile;
+  DxcTranslationUnitFlags localOptions;
+  DxcTranslationUnitStatistics stats;
+
+  VERIFY_SUCCEEDED(support.CreateIntellisense(&isense));
+  VERIFY_SUCCEEDED(isense->CreateIndex(&tuIndex));
+  VERIFY_SUCCEEDED(isense->GetDefaultEditingTUOptions(&localOptions));
+  VERIFY_SUCCEEDED(isense->CreateUnsavedFile(fileName, program.c_str(),
+                                             program.size(), &unsavedFile));
+  VERIFY_SUCCEEDED(tuIndex->ParseTranslationUnit(fileName, nullptr, 0,
+    &(unsavedFile.p), 1, localOptions, &tu));
+  VERIFY_SUCCEEDED(tu.QueryInterface(&tuStats));
+
+  // The header is untouched: the AST is reused.
+  VERIFY_SUCCEEDED(tu->Reparse(&(unsavedFile.p), 1));
+  VERIFY_SUCCEEDED(tuStats->GetStatistics(&stats));
+  VERIFY_ARE_EQUAL(1, stats.ParseCount);
+  VERIFY_ARE_EQUAL(1, stats.ReparseSkippedCount);
+
+  // Same size, and a timestamp only one tick later, so the edit falls within
+  // the same second as the original write.
+  ULARGE_INTEGER time;
+  time.LowPart = written.dwLowDateTime;
+  time.HighPart = written.dwHighDateTime;
+  time.QuadPart += 1;
+  FILETIME edited;
+  edited.dwLowDateTime = time.LowPart;
+  edited.dwHighDateTime = time.HighPart;
+  writeHeader("#define VALUE 2\r\n", &edited);
+
+  VERIFY_SUCCEEDED(tu->Reparse(&(unsavedFile.p), 1));
+  VERIFY_SUCCEEDED(tuStats->GetStatistics(&stats));
+  VERIFY_ARE_EQUAL(2, stats.ParseCount);
+  VERIFY_ARE_EQUAL(1, stats.ReparseSkippedCount);
+}
+
 TEST_F(DXIntellisenseTest, QualifiedNameClass) {
   char program[] =
     "class TheClass {\r\n"
@@ -22,6 +22,7 @@
 #include <algorithm>
 #include "dxc/Support/WinIncludes.h"
 #include "dxc/dxcapi.h"
+#include "dxc/dxcapi.internal.h"
 #include <atlfile.h>
 
 #include "HLSLTestData.h"
@@ -33,6 +34,8 @@
 #include "dxc/Support/dxcapi.use.h"
 #include "dxc/Support/HLSLOptions.h"
 #include "dxc/HLSL/DxilContainer.h"
+#include "dxc/Support/FileIOHelper.h"
+#include "dxc/Support/microcom.h"
 
 #include <fstream>
 #include <filesystem>
@@ -58,6 +61,36 @@ static uint8_t MaskCount(uint8_t V) {
   return Count[V];
 }
 
+// Forwards to the COM allocator, counting allocations.
+class CountingMalloc : public IMalloc {
+private:
+  DXC_MICROCOM_REF_FIELD(m_dwRef)
+  CComPtr<IMalloc> m_pMalloc;
+public:
+  DXC_MICROCOM_ADDREF_RELEASE_IMPL(m_dwRef)
+  ULONG AllocCount = 0;
+  ULONG ReallocCount = 0;
+
+  CountingMalloc() : m_dwRef(0) {
+    VERIFY_SUCCEEDED(CoGetMalloc(1, &m_pMalloc));
+  }
+  HRESULT STDMETHODCALLTYPE QueryInterface(REFIID iid, void **ppvObject) {
+    return DoBasicQueryInterface<IMalloc>(this, iid, ppvObject);
+  }
+  void *STDMETHODCALLTYPE Alloc(SIZE_T cb) {
+    ++AllocCount;
+    return m_pMalloc->Alloc(cb);
+  }
+  void *STDMETHODCALLTYPE Realloc(void *pv, SIZE_T cb) {
+    ++ReallocCount;
+    return m_pMalloc->Realloc(pv, cb);
+  }
+  void STDMETHODCALLTYPE Free(void *pv) { m_pMalloc->Free(pv); }
+  SIZE_T STDMETHODCALLTYPE GetSize(void *pv) { return m_pMalloc->GetSize(pv); }
+  int STDMETHODCALLTYPE DidAlloc(void *pv) { return m_pMalloc->DidAlloc(pv); }
+  void STDMETHODCALLTYPE HeapMinimize(void) { m_pMalloc->HeapMinimize(); }
+};
+
 class DxilContainerTest {
 public:
   BEGIN_TEST_CLASS(DxilContainerTest)
@@ -74,6 +107,10 @@ public:
   TEST_METHOD(DisassemblyWhenValidThenOK)
   TEST_METHOD(ValidateFromLL_Abs2)
   TEST_METHOD(DxilContainerUnitTest)
+  TEST_METHOD(ContainerWriterWhenPartsSizedThenAllocatesOnce)
+  TEST_METHOD(ContainerWriterWhenWrittenThenHashVerifies)
+  TEST_METHOD(CompileWhenShaderHashThenHashVerifies)
+  TEST_METHOD(ReflectionWhenLoopThenCostScaledByTripCount)
 
   TEST_METHOD(ReflectionMatchesDXBC_CheckIn)
   BEGIN_TEST_METHOD(ReflectionMatchesDXBC_Full)
@@ -597,6 +634,116 @@ TEST_F(DxilContainerTest, CompileWhenOKThenIncludesFeatureInfo) {
   VERIFY_ARE_EQUAL(0, *(uint64_t *)hlsl::GetDxilPartData(*pPartIter));
 }
 
+TEST_F(DxilContainerTest, CompileWhenShaderHashThenHashVerifies) {
+  CComPtr<IDxcCompiler> pCompiler;
+  CComPtr<IDxcBlobEncoding> pSource;
+  CComPtr<IDxcBlob> pProgram;
+  CComPtr<IDxcOperationResult> pResult;
+
+  VERIFY_SUCCEEDED(CreateCompiler(&pCompiler));
+  CreateBlobFromText("float4 main() : SV_Target { return 0; }", &pSource);
+
+  // The part is only added on request, as older validators reject it.
+  VERIFY_SUCCEEDED(pCompiler->Compile(pSource, L"hlsl.hlsl", L"main", L"ps_6_0",
+    nullptr, 0, nullptr, 0, nullptr,
+    &pResult));
+  VERIFY_SUCCEEDED(pResult->GetResult(&pProgram));
+  const hlsl::DxilContainerHeader *pHeader =
+      (const hlsl::DxilContainerHeader *)pProgram->GetBufferPointer();
+  VERIFY_IS_NULL(hlsl::GetDxilPartByType(pHeader, hlsl::DFCC_ShaderHash));
+
+  LPCWSTR shaderHashArg = L"/shader_hash";
+  pResult.Release();
+  pProgram.Release();
+  VERIFY_SUCCEEDED(pCompiler->Compile(pSource, L"hlsl.hlsl", L"main", L"ps_6_0",
+    &shaderHashArg, 1, nullptr, 0, nullptr,
+    &pResult));
+  VERIFY_SUCCEEDED(pResult->GetResult(&pProgram));
+
+  pHeader = (const hlsl::DxilContainerHeader *)pProgram->GetBufferPointer();
+  const hlsl::DxilPartHeader *pPart =
+      hlsl::GetDxilPartByType(pHeader, hlsl::DFCC_ShaderHash);
+  VERIFY_IS_NOT_NULL(pPart);
+  VERIFY_ARE_EQUAL(sizeof(hlsl::DxilShaderHash), pPart->PartSize);
+  VERIFY_IS_TRUE(hlsl::VerifyDxilContainerHash(pHeader, pProgram->GetBufferSize()));
+}
+
+TEST_F(DxilContainerTest, ReflectionWhenLoopThenCostScaledByTripCount) {
+  CComPtr<IDxcCompiler> pCompiler;
+  CComPtr<IDxcBlobEncoding> pSource;
+  CComPtr<IDxcBlob> pProgram;
+  CComPtr<IDxcOperationResult> pResult;
+  CComPtr<ID3D12ShaderReflection> pReflection;
+  CComPtr<IDxcShaderCostReflection> pCostReflection;
+
+  VERIFY_SUCCEEDED(CreateCompiler(&pCompiler));
+  CreateBlobFromText(
+    "Texture2D t; SamplerState s;\r\n"
+    "float4 main(float2 uv : UV) : SV_Target {\r\n"
+    "  float4 r = 0;\r\n"
+    "  [loop] for (uint i = 0; i < 5; ++i) r += t.Sample(s, uv * i);\r\n"
+    "  return r;\r\n"
+    "}", &pSource);
+  VERIFY_SUCCEEDED(pCompiler->Compile(pSource, L"hlsl.hlsl", L"main", L"ps_6_0",
+    nullptr, 0, nullptr, 0, nullptr, &pResult));
+  VERIFY_SUCCEEDED(pResult->GetResult(&pProgram));
+  CreateReflectionFromBlob(pProgram, &pReflection);
+
+  // The compiler stores the statistics in the STAT part for GetDesc.
+  const hlsl::DxilContainerHeader *pHeader =
+      (const hlsl::DxilContainerHeader *)pProgram->GetBufferPointer();
+  const hlsl::DxilPartHeader *pPart =
+      hlsl::GetDxilPartByType(pHeader, hlsl::DFCC_ShaderStatistics);
+  VERIFY_IS_NOT_NULL(pPart);
+  VERIFY_ARE_EQUAL(sizeof(hlsl::DxilShaderStatistics), pPart->PartSize);
+
+  D3D12_SHADER_DESC desc;
+  VERIFY_SUCCEEDED(pReflection->GetDesc(&desc));
+  VERIFY_ARE_EQUAL(2U, desc.BoundResources);
+  VERIFY_IS_TRUE(desc.InstructionCount > 0);
+  VERIFY_ARE_EQUAL(1U, desc.TextureNormalInstructions);
+  VERIFY_IS_TRUE(desc.FloatInstructionCount > 0);
+  VERIFY_IS_TRUE(desc.DynamicFlowControlCount > 0);
+
+  // Without the part, GetDesc computes the same statistics from the program.
+  CComPtr<IDxcContainerBuilder> pBuilder;
+  CComPtr<IDxcBlob> pStripped;
+  CComPtr<ID3D12ShaderReflection> pStrippedReflection;
+  VERIFY_SUCCEEDED(m_dllSupport.CreateInstance(CLSID_DxcContainerBuilder, &pBuilder));
+  VERIFY_SUCCEEDED(pBuilder->Load(pProgram));
+  VERIFY_SUCCEEDED(pBuilder->RemovePart(hlsl::DFCC_ShaderStatistics));
+  pResult.Release();
+  VERIFY_SUCCEEDED(pBuilder->SerializeContainer(&pResult));
+  VERIFY_SUCCEEDED(pResult->GetResult(&pStripped));
+  VERIFY_IS_NULL(hlsl::GetDxilPartByType(
+      (const hlsl::DxilContainerHeader *)pStripped->GetBufferPointer(),
+      hlsl::DFCC_ShaderStatistics));
+  CreateReflectionFromBlob(pStripped, &pStrippedReflection);
+  D3D12_SHADER_DESC strippedDesc;
+  VERIFY_SUCCEEDED(pStrippedReflection->GetDesc(&strippedDesc));
+  VERIFY_ARE_EQUAL(desc.InstructionCount, strippedDesc.InstructionCount);
+  VERIFY_ARE_EQUAL(desc.FloatInstructionCount, strippedDesc.FloatInstructionCount);
+  VERIFY_ARE_EQUAL(desc.DynamicFlowControlCount, strippedDesc.DynamicFlowControlCount);
+
+  // The block with the sample runs once per iteration.
+  VERIFY_SUCCEEDED(pReflection.QueryInterface(&pCostReflection));
+  UINT32 blockCount;
+  UINT64 estimatedCost;
+  VERIFY_SUCCEEDED(pCostReflection->GetBlockCount(&blockCount));
+  VERIFY_SUCCEEDED(pCostReflection->GetEstimatedCost(&estimatedCost));
+  bool foundLoopBlock = false;
+  for (UINT32 i = 0; i < blockCount; ++i) {
+    DxcShaderBlockCost block;
+    VERIFY_SUCCEEDED(pCostReflection->GetBlockCost(i, &block));
+    VERIFY_IS_TRUE(block.Cost <= estimatedCost);
+    if (block.LoopDepth == 1) {
+      VERIFY_ARE_EQUAL(5ULL, block.ExecutionCount);
+      foundLoopBlock = true;
+    }
+  }
+  VERIFY_IS_TRUE(foundLoopBlock);
+}
+
 TEST_F(DxilContainerTest, DisassemblyWhenBCInvalidThenFails) {
   CComPtr<IDxcCompiler> pCompiler;
   CComPtr<IDxcBlobEncoding> pSource;
@@ -886,4 +1033,90 @@ TEST_F(DxilContainerTest, DxilContainerUnitTest) {
   VERIFY_IS_NULL(hlsl::GetDxilProgramHeader(&header, hlsl::DxilFourCC::DFCC_DXIL));
   VERIFY_IS_NULL(hlsl::GetDxilPartByType(&header, hlsl::DxilFourCC::DFCC_DXIL));
 
-}
\ No newline at end of file
+}
+
+TEST_F(DxilContainerTest, ContainerWriterWhenPartsSizedThenAllocatesOnce) {
+  CComPtr<CountingMalloc> pMalloc = new CountingMalloc();
+  CComPtr<hlsl::AbstractMemoryStream> pStream;
+  VERIFY_SUCCEEDED(hlsl::CreateMemoryStream(pMalloc, &pStream));
+
+  const char partA[] = "0123456789abcdef";
+  const char partB[] = "0123";
+  std::unique_ptr<hlsl::DxilContainerWriter> pWriter(hlsl::NewDxilContainerWriter());
+  auto writePart = [](const char *pData, ULONG size) {
+    return [=](hlsl::AbstractMemoryStream *pStream) {
+      ULONG cbWritten;
+      IFT(pStream->Write(pData, size, &cbWritten));
+    };
+  };
+  pWriter->AddPart(hlsl::DFCC_FeatureInfo, sizeof(partA), writePart(partA, sizeof(partA)));
+  pWriter->AddPart(hlsl::DFCC_InputSignature, sizeof(partB), writePart(partB, sizeof(partB)));
+  pWriter->write(pStream);
+
+  // The container is reserved at its final size and parts are written in place.
+  VERIFY_ARE_EQUAL(1UL, pMalloc->AllocCount);
+  VERIFY_ARE_EQUAL(0UL, pMalloc->ReallocCount);
+  VERIFY_ARE_EQUAL((ULONG)pWriter->size(), pStream->GetPtrSize());
+  const hlsl::DxilContainerHeader *pHeader =
+      (const hlsl::DxilContainerHeader *)pStream->GetPtr();
+  VERIFY_IS_TRUE(hlsl::IsValidDxilContainer(pHeader, pStream->GetPtrSize()));
+  VERIFY_IS_NOT_NULL(hlsl::GetDxilPartByType(pHeader, hlsl::DFCC_InputSignature));
+}
+
+TEST_F(DxilContainerTest, ContainerWriterWhenWrittenThenHashVerifies) {
+  const char sig[] = "0123456789abcdef";
+  const char privA[] = "first";
+  const char privB[] = "other";
+  auto writeContainer = [&](const char *pPriv,
+                            hlsl::AbstractMemoryStream **ppStream) {
+    CComPtr<IMalloc> pMalloc;
+    VERIFY_SUCCEEDED(CoGetMalloc(1, &pMalloc));
+    VERIFY_SUCCEEDED(hlsl::CreateMemoryStream(pMalloc, ppStream));
+    std::unique_ptr<hlsl::DxilContainerWriter> pWriter(hlsl::NewDxilContainerWriter());
+    auto writePart = [](const char *pData, ULONG size) {
+      return [=](hlsl::AbstractMemoryStream *pStream) {
+        ULONG cbWritten;
+        IFT(pStream->Write(pData, size, &cbWritten));
+      };
+    };
+    pWriter->AddPart(hlsl::DFCC_InputSignature, sizeof(sig), writePart(sig, sizeof(sig)));
+    pWriter->AddPart(hlsl::DFCC_PrivateData, sizeof(privA), writePart(pPriv, sizeof(privA)));
+    hlsl::DxilShaderHash emptyHash = {};
+    pWriter->AddPart(hlsl::DFCC_ShaderHash, sizeof(emptyHash),
+                     writePart((const char *)&emptyHash, sizeof(emptyHash)));
+    pWriter->write(*ppStream);
+  };
+  auto getShaderHash = [](const hlsl::DxilContainerHeader *pHeader) {
+    const hlsl::DxilPartHeader *pPart =
+        hlsl::GetDxilPartByType(pHeader, hlsl::DFCC_ShaderHash);
+    VERIFY_IS_NOT_NULL(pPart);
+    return (const hlsl::DxilShaderHash *)hlsl::GetDxilPartData(pPart);
+  };
+
+  CComPtr<hlsl::AbstractMemoryStream> pStreamA, pStreamB;
+  writeContainer(privA, &pStreamA);
+  writeContainer(privB, &pStreamB);
+  hlsl::DxilContainerHeader *pHeaderA =
+      (hlsl::DxilContainerHeader *)pStreamA->GetPtr();
+  const hlsl::DxilContainerHeader *pHeaderB =
+      (const hlsl::DxilContainerHeader *)pStreamB->GetPtr();
+  VERIFY_IS_TRUE(hlsl::VerifyDxilContainerHash(pHeaderA, pStreamA->GetPtrSize()));
+  VERIFY_IS_TRUE(hlsl::VerifyDxilContainerHash(pHeaderB, pStreamB->GetPtrSize()));
+
+  // Private data doesn't contribute to the digest.
+  VERIFY_IS_TRUE(0 == memcmp(getShaderHash(pHeaderA)->Digest,
+                             getShaderHash(pHeaderB)->Digest,
+                             hlsl::DxilContainerHashSize));
+
+  // The header hash is reserved for the validator signature.
+  const hlsl::DxilContainerHash zeroHash = {};
+  VERIFY_IS_TRUE(0 == memcmp(pHeaderA->Hash.Digest, zeroHash.Digest,
+                             hlsl::DxilContainerHashSize));
+
+  // Any change to a runtime-relevant part is detected.
+  hlsl::DxilPartHeader *pSig =
+      hlsl::GetDxilPartByType(pHeaderA, hlsl::DFCC_InputSignature);
+  VERIFY_IS_NOT_NULL(pSig);
+  hlsl::GetDxilPartData(pSig)[0] ^= 1;
+  VERIFY_IS_FALSE(hlsl::VerifyDxilContainerHash(pHeaderA, pStreamA->GetPtrSize()));
+}
@@ -0,0 +1,164 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// DxilCpuExecutorTest.cpp                                                   //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Provides tests for the CPU executor used by the execution tests.          //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#include <memory>
+#include <vector>
+#include <string>
+#include "dxc/Support/WinIncludes.h"
+#include "dxc/dxcapi.h"
+
+#include "WexTestClass.h"
+#include "HlslTestUtils.h"
+#include "DxcTestUtils.h"
+#include "DxilCpuExecutor.h"
+
+#include "dxc/Support/Global.h"
+#include "dxc/Support/dxcapi.use.h"
+#include "dxc/HLSL/DxilContainer.h"
+#include "llvm/Bitcode/ReaderWriter.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/MemoryBuffer.h"
+
+using namespace std;
+using namespace hlsl_test;
+
+class DxilCpuExecutorTest {
+public:
+  BEGIN_TEST_CLASS(DxilCpuExecutorTest)
+    TEST_CLASS_PROPERTY(L"Parallel", L"true")
+    TEST_METHOD_PROPERTY(L"Priority", L"0")
+  END_TEST_CLASS()
+
+  TEST_CLASS_SETUP(InitSupport);
+
+  TEST_METHOD(DispatchWhenGroupSharedThenGroupsIndependent)
+  TEST_METHOD(DispatchWhenWaveOpThenLanesOfWaveCombined)
+  TEST_METHOD(DispatchWhenTextureThenNotImplemented)
+
+  dxc::DxcDllSupport m_dllSupport;
+
+  // Compiles a compute shader and loads its DXIL into a module in Context.
+  std::unique_ptr<llvm::Module> CompileToModule(LPCSTR pText,
+                                                llvm::LLVMContext &Context) {
+    CComPtr<IDxcCompiler> pCompiler;
+    CComPtr<IDxcBlobEncoding> pSource;
+    CComPtr<IDxcOperationResult> pResult;
+    CComPtr<IDxcBlob> pProgram;
+    VERIFY_SUCCEEDED(m_dllSupport.CreateInstance(CLSID_DxcCompiler, &pCompiler));
+    Utf8ToBlob(m_dllSupport, pText, &pSource);
+    VERIFY_SUCCEEDED(pCompiler->Compile(pSource, L"source.hlsl", L"main",
+                                        L"cs_6_0", nullptr, 0, nullptr, 0,
+                                        nullptr, &pResult));
+    CheckOperationSucceeded(pResult, &pProgram);
+
+    const hlsl::DxilContainerHeader *pContainer = hlsl::IsDxilContainerLike(
+        pProgram->GetBufferPointer(), pProgram->GetBufferSize());
+    VERIFY_IS_NOT_NULL(pContainer);
+    const hlsl::DxilProgramHeader *pProgramHeader =
+        hlsl::GetDxilProgramHeader(pContainer, hlsl::DFCC_DXIL);
+    VERIFY_IS_NOT_NULL(pProgramHeader);
+    const char *pBitcode;
+    uint32_t bitcodeLength;
+    hlsl::GetDxilProgramBitcode(pProgramHeader, &pBitcode, &bitcodeLength);
+
+    std::unique_ptr<llvm::MemoryBuffer> pBuffer(llvm::MemoryBuffer::getMemBuffer(
+        llvm::StringRef(pBitcode, bitcodeLength), "", false));
+    llvm::ErrorOr<std::unique_ptr<llvm::Module>> pModule =
+        llvm::parseBitcodeFile(pBuffer->getMemBufferRef(), Context);
+    VERIFY_IS_TRUE((bool)pModule);
+    return std::move(pModule.get());
+  }
+};
+
+bool DxilCpuExecutorTest::InitSupport() {
+  if (!m_dllSupport.IsEnabled()) {
+    VERIFY_SUCCEEDED(m_dllSupport.Initialize());
+  }
+  return true;
+}
+
+TEST_F(DxilCpuExecutorTest, DispatchWhenGroupSharedThenGroupsIndependent) {
+  llvm::LLVMContext context;
+  std::unique_ptr<llvm::Module> pModule = CompileToModule(
+    "RWStructuredBuffer<uint> g_out : register(u0);\r\n"
+    "groupshared uint g_shared[64];\r\n"
+    "[numthreads(64, 1, 1)]\r\n"
+    "void main(uint gi : SV_GroupIndex, uint3 gid : SV_GroupID,\r\n"
+    "          uint3 dtid : SV_DispatchThreadID) {\r\n"
+    "  g_shared[gi] = dtid.x * 2;\r\n"
+    "  GroupMemoryBarrierWithGroupSync();\r\n"
+    "  g_out[dtid.x] = g_shared[63 - gi] + gid.x;\r\n"
+    "}", context);
+
+  const unsigned groupCount = 4;
+  std::vector<uint32_t> values(64 * groupCount, 0xcdcdcdcd);
+  hlsl::DxilCpuExecutor executor(*pModule);
+  executor.BindResource(hlsl::DXIL::ResourceClass::UAV, 0, 0, values.data(),
+                        values.size() * sizeof(uint32_t));
+  executor.Dispatch(groupCount, 1, 1);
+
+  // Each group reads back what its own threads wrote, reversed.
+  for (unsigned i = 0; i < values.size(); ++i) {
+    unsigned group = i / 64, index = i % 64;
+    VERIFY_ARE_EQUAL((group * 64 + 63 - index) * 2 + group, values[i]);
+  }
+}
+
+TEST_F(DxilCpuExecutorTest, DispatchWhenWaveOpThenLanesOfWaveCombined) {
+  llvm::LLVMContext context;
+  std::unique_ptr<llvm::Module> pModule = CompileToModule(
+    "RWStructuredBuffer<uint> g_out : register(u0);\r\n"
+    "[numthreads(8, 1, 1)]\r\n"
+    "void main(uint gi : SV_GroupIndex) {\r\n"
+    "  g_out[gi] = WaveActiveSum(gi);\r\n"
+    "}", context);
+
+  std::vector<uint32_t> values(8, 0);
+  hlsl::DxilCpuExecutor executor(*pModule);
+  executor.SetWaveSize(4);
+  executor.SetHostThreadCount(1);
+  executor.BindResource(hlsl::DXIL::ResourceClass::UAV, 0, 0, values.data(),
+                        values.size() * sizeof(uint32_t));
+  executor.Dispatch(1, 1, 1);
+
+  // Threads 0-3 and 4-7 form the two waves of the group.
+  for (unsigned i = 0; i < 4; ++i)
+    VERIFY_ARE_EQUAL(0u + 1 + 2 + 3, values[i]);
+  for (unsigned i = 4; i < 8; ++i)
+    VERIFY_ARE_EQUAL(4u + 5 + 6 + 7, values[i]);
+}
+
+TEST_F(DxilCpuExecutorTest, DispatchWhenTextureThenNotImplemented) {
+  llvm::LLVMContext context;
+  std::unique_ptr<llvm::Module> pModule = CompileToModule(
+    "Texture2D<float> g_tex : register(t0);\r\n"
+    "RWStructuredBuffer<float> g_out : register(u0);\r\n"
+    "[numthreads(1, 1, 1)]\r\n"
+    "void main() {\r\n"
+    "  g_out[0] = g_tex.Load(int3(0, 0, 0));\r\n"
+    "}", context);
+
+  float texel = 1, value = 0;
+  HRESULT hr = S_OK;
+  try {
+    hlsl::DxilCpuExecutor executor(*pModule);
+    executor.BindResource(hlsl::DXIL::ResourceClass::SRV, 0, 0, &texel,
+                          sizeof(texel));
+    executor.BindResource(hlsl::DXIL::ResourceClass::UAV, 0, 0, &value,
+                          sizeof(value));
+    executor.Dispatch(1, 1, 1);
+  }
+  catch (const hlsl::Exception &E) {
+    hr = E.hr;
+  }
+  VERIFY_ARE_EQUAL(E_NOTIMPL, hr);
+}
@@ -526,6 +526,10 @@ public:
     return true;
   }
 
+  bool UseCpuExecutor() {
+    return GetTestParamBool(L"CpuExecutor");
+  }
+
   bool SaveImages() {
     return GetTestParamBool(L"SaveImages");
   }
@@ -651,6 +655,15 @@ public:
     return true;
   }
 
+  // Leaves the device null when shader ops run on the CPU executor.
+  bool CreateDeviceOrUseCpu(ID3D12Device **ppDevice) {
+    if (UseCpuExecutor()) {
+      *ppDevice = nullptr;
+      return true;
+    }
+    return CreateDevice(ppDevice);
+  }
+
   void CreateGraphicsCommandQueue(ID3D12Device *pDevice, ID3D12CommandQueue **ppCommandQueue) {
     D3D12_COMMAND_QUEUE_DESC queueDesc = {};
     queueDesc.Flags = D3D12_COMMAND_QUEUE_FLAG_NONE;
@@ -2150,6 +2163,7 @@ RunShaderOpTestAfterParse(ID3D12Device *pDevice, dxc::DxcDllSupport &support,
   test->SetDxcSupport(&support);
   test->SetInitCallback(pInitCallback);
   test->SetDevice(pDevice);
+  test->SetUseCpuExecutor(pDevice == nullptr);
   test->RunShaderOp(pShaderOp);
 
   std::shared_ptr<ShaderOpTestResult> result =
@@ -2897,7 +2911,7 @@ TEST_F(ExecutionTest, UnaryFloatOpTest) {
     ReadHlslDataIntoNewStream(L"ShaderOpArith.xml", &pStream);
 
     CComPtr<ID3D12Device> pDevice;
-    if (!CreateDevice(&pDevice)) {
+    if (!CreateDeviceOrUseCpu(&pDevice)) {
       return;
     }
     // Read data from the table
@@ -2970,7 +2984,7 @@ TEST_F(ExecutionTest, BinaryFloatOpTest) {
     ReadHlslDataIntoNewStream(L"ShaderOpArith.xml", &pStream);
 
     CComPtr<ID3D12Device> pDevice;
-    if (!CreateDevice(&pDevice)) {
+    if (!CreateDeviceOrUseCpu(&pDevice)) {
         return;
     }
     // Read data from the table
@@ -3059,7 +3073,7 @@ TEST_F(ExecutionTest, TertiaryFloatOpTest) {
     ReadHlslDataIntoNewStream(L"ShaderOpArith.xml", &pStream);
 
     CComPtr<ID3D12Device> pDevice;
-    if (!CreateDevice(&pDevice)) {
+    if (!CreateDeviceOrUseCpu(&pDevice)) {
         return;
     }
     // Read data from the table
@@ -3146,7 +3160,7 @@ TEST_F(ExecutionTest, UnaryIntOpTest) {
     ReadHlslDataIntoNewStream(L"ShaderOpArith.xml", &pStream);
 
     CComPtr<ID3D12Device> pDevice;
-    if (!CreateDevice(&pDevice)) {
+    if (!CreateDeviceOrUseCpu(&pDevice)) {
         return;
     }
     // Read data from the table
@@ -3213,7 +3227,7 @@ TEST_F(ExecutionTest, UnaryUintOpTest) {
     ReadHlslDataIntoNewStream(L"ShaderOpArith.xml", &pStream);
 
     CComPtr<ID3D12Device> pDevice;
-    if (!CreateDevice(&pDevice)) {
+    if (!CreateDeviceOrUseCpu(&pDevice)) {
         return;
     }
     // Read data from the table
@@ -3280,7 +3294,7 @@ TEST_F(ExecutionTest, BinaryIntOpTest) {
     ReadHlslDataIntoNewStream(L"ShaderOpArith.xml", &pStream);
 
     CComPtr<ID3D12Device> pDevice;
-    if (!CreateDevice(&pDevice)) {
+    if (!CreateDeviceOrUseCpu(&pDevice)) {
       return;
     }
     // Read data from the table
@@ -3379,7 +3393,7 @@ TEST_F(ExecutionTest, TertiaryIntOpTest) {
     ReadHlslDataIntoNewStream(L"ShaderOpArith.xml", &pStream);
 
     CComPtr<ID3D12Device> pDevice;
-    if (!CreateDevice(&pDevice)) {
+    if (!CreateDeviceOrUseCpu(&pDevice)) {
         return;
     }
     // Read data from the table
@@ -3457,7 +3471,7 @@ TEST_F(ExecutionTest, BinaryUintOpTest) {
     ReadHlslDataIntoNewStream(L"ShaderOpArith.xml", &pStream);
 
     CComPtr<ID3D12Device> pDevice;
-    if (!CreateDevice(&pDevice)) {
+    if (!CreateDeviceOrUseCpu(&pDevice)) {
         return;
     }
     // Read data from the table
@@ -3555,7 +3569,7 @@ TEST_F(ExecutionTest, TertiaryUintOpTest) {
     ReadHlslDataIntoNewStream(L"ShaderOpArith.xml", &pStream);
 
     CComPtr<ID3D12Device> pDevice;
-    if (!CreateDevice(&pDevice)) {
+    if (!CreateDeviceOrUseCpu(&pDevice)) {
         return;
     }
     // Read data from the table
@@ -3633,7 +3647,7 @@ TEST_F(ExecutionTest, DotTest) {
     ReadHlslDataIntoNewStream(L"ShaderOpArith.xml", &pStream);
 
     CComPtr<ID3D12Device> pDevice;
-    if (!CreateDevice(&pDevice)) {
+    if (!CreateDeviceOrUseCpu(&pDevice)) {
         return;
     }
 
@@ -3724,7 +3738,7 @@ TEST_F(ExecutionTest, Msad4Test) {
     ReadHlslDataIntoNewStream(L"ShaderOpArith.xml", &pStream);
 
     CComPtr<ID3D12Device> pDevice;
-    if (!CreateDevice(&pDevice)) {
+    if (!CreateDeviceOrUseCpu(&pDevice)) {
         return;
     }
     size_t tableSize = sizeof(Msad4OpParameters) / sizeof(TableParameter);
@@ -3821,10 +3835,10 @@ void ExecutionTest::WaveIntrinsicsActiveTest(
   ReadHlslDataIntoNewStream(L"ShaderOpArith.xml", &pStream);
 
   CComPtr<ID3D12Device> pDevice;
-  if (!CreateDevice(&pDevice)) {
+  if (!CreateDeviceOrUseCpu(&pDevice)) {
     return;
   }
-  if (!DoesDeviceSupportWaveOps(pDevice)) {
+  if (pDevice != nullptr && !DoesDeviceSupportWaveOps(pDevice)) {
     // Optional feature, so it's correct to not support it if declared as such.
     WEX::Logging::Log::Comment(L"Device does not support wave operations.");
     return;
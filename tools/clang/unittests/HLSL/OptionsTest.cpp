@@ -62,6 +62,8 @@ public:
   TEST_METHOD(ReadOptionsWhenJoinedThenOK)
   TEST_METHOD(ReadOptionsWhenNoEntryThenOK)
   TEST_METHOD(ReadOptionsForOutputObject)
+  TEST_METHOD(ReadOptionsForBatch)
+  TEST_METHOD(ReadOptionsForDependencyScan)
 
   TEST_METHOD(ReadOptionsForDxcWhenApiArgMissingThenFail)
   TEST_METHOD(ReadOptionsForApiWhenApiArgMissingThenOK)
@@ -127,6 +129,37 @@ TEST_F(OptionsTest, ReadOptionsForOutputObject) {
   VERIFY_ARE_EQUAL_STR("hlsl.dxbc", o->OutputObject.data());  
 }
 
+TEST_F(OptionsTest, ReadOptionsForBatch) {
+  // Inputs and profiles come from the batch file, so dxc doesn't require them.
+  const wchar_t *Args[] = { L"exe.exe", L"-batch", L"jobs.txt", L"-batch_threads", L"4" };
+  MainArgsArr ArgsArr(Args);
+  std::unique_ptr<DxcOpts> o = ReadOptsTest(ArgsArr, DxcFlags);
+  VERIFY_ARE_EQUAL_STR("jobs.txt", o->BatchFile.data());
+  VERIFY_ARE_EQUAL(4, o->BatchThreads);
+
+  const wchar_t *ArgsWithInput[] = { L"exe.exe", L"-batch", L"jobs.txt", L"/T", L"ps_6_0", L"hlsl.hlsl" };
+  MainArgsArr ArgsWithInputArr(ArgsWithInput);
+  ReadOptsTest(ArgsWithInputArr, DxcFlags, true, true);
+
+  const wchar_t *ArgsNoBatch[] = { L"exe.exe", L"-batch_threads", L"4", L"/T", L"ps_6_0", L"hlsl.hlsl" };
+  MainArgsArr ArgsNoBatchArr(ArgsNoBatch);
+  ReadOptsTest(ArgsNoBatchArr, DxcFlags, "Cannot specify a batch thread count without a batch file.");
+}
+
+TEST_F(OptionsTest, ReadOptionsForDependencyScan) {
+  // No target profile is needed, as nothing is compiled.
+  const wchar_t *Args[] = { L"exe.exe", L"-M", L"-MF", L"deps.json", L"-Mjson", L"shaders" };
+  MainArgsArr ArgsArr(Args);
+  std::unique_ptr<DxcOpts> o = ReadOptsTest(ArgsArr, DxcFlags);
+  VERIFY_IS_TRUE(o->ScanDependencies);
+  VERIFY_IS_TRUE(o->DependenciesAsJson);
+  VERIFY_ARE_EQUAL_STR("deps.json", o->DependencyFile.data());
+
+  const wchar_t *ArgsNoM[] = { L"exe.exe", L"-MF", L"deps.d", L"/T", L"ps_6_0", L"hlsl.hlsl" };
+  MainArgsArr ArgsNoMArr(ArgsNoM);
+  ReadOptsTest(ArgsNoMArr, DxcFlags, "Cannot specify /MF, /MT or /Mjson without /M.");
+}
+
 TEST_F(OptionsTest, ReadOptionsConflict) {
   const wchar_t *matrixArgs[] = {
       L"exe.exe",   L"/E",        L"main",    L"/T",           L"ps_6_0",
@@ -19,11 +19,17 @@
 #include "ShaderOpTest.h"
 
 #include "dxc/dxcapi.h"             // IDxcCompiler
+#include "dxc/HLSL/DxilContainer.h" // GetDxilProgramBitcode
+#include "DxilCpuExecutor.h"        // DxilCpuExecutor
 #include "dxc/Support/Global.h"     // OutputDebugBytes
 #include "dxc/Support/Unicode.h"    // IsStarMatchUTF16
 #include "dxc/Support/dxcapi.use.h" // DxcDllSupport
 #include "WexTestClass.h"           // TAEF
 #include "HLSLTestUtils.h"          // LogCommentFmt
+#include "llvm/Bitcode/ReaderWriter.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/MemoryBuffer.h"
 
 #include <stdlib.h>
 #include <DirectXMath.h>
@@ -197,6 +203,12 @@ void MappedData::reset(ID3D12Resource *pResource, UINT32 sizeInBytes) {
   m_size = sizeInBytes;
 }
 
+void MappedData::reset(std::vector<BYTE> &data) {
+  reset();
+  m_pData = data.data();
+  m_size = (UINT32)data.size();
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 // ShaderOpTest library implementation.
 
@@ -456,42 +468,9 @@ void ShaderOpTest::CreateResources() {
     if (m_ResourceData.count(R.Name) > 0) continue;
     // Initialize the upload resource early, to allow a by-name initializer
     // to set the desired width.
-    bool initByName = R.Init && 0 == _stricmp("byname", R.Init);
-    bool initZero = R.Init && 0 == _stricmp("zero", R.Init);
-    bool initFromBytes = R.Init && 0 == _stricmp("frombytes", R.Init);
-    bool hasInit = initByName || initZero || initFromBytes;
     bool isBuffer = R.Desc.Dimension == D3D12_RESOURCE_DIMENSION_BUFFER;
     std::vector<BYTE> values;
-    if (hasInit) {
-      if (isBuffer) {
-        values.resize((size_t)R.Desc.Width);
-      }
-      else {
-        // Probably needs more information.
-        values.resize((size_t)(R.Desc.Width * R.Desc.Height *
-          GetByteSizeForFormat(R.Desc.Format)));
-      }
-      if (initZero) {
-        memset(values.data(), 0, values.size());
-      }
-      else if (initByName) {
-        m_InitCallbackFn(R.Name, values, m_pShaderOp);
-        if (isBuffer) {
-          R.Desc.Width = values.size();
-        }
-      }
-      else if (initFromBytes) {
-        values = R.InitBytes;
-        if (R.Desc.Width == 0) {
-          if (isBuffer) {
-            R.Desc.Width = values.size();
-          }
-          else if (R.Desc.Dimension == D3D12_RESOURCE_DIMENSION_TEXTURE1D) {
-            R.Desc.Width = values.size() / GetByteSizeForFormat(R.Desc.Format);
-          }
-        }
-      }
-    }
+    bool hasInit = GetInitialValues(R, values);
 
     CComPtr<ID3D12Resource> pResource;
     CHECK_HR(m_pDevice->CreateCommittedResource(
@@ -590,6 +569,46 @@ void ShaderOpTest::CreateResources() {
   WaitForSignal(ResCommandList.Queue, m_pFence, m_hFence, m_FenceValue++);
 }
 
+bool ShaderOpTest::GetInitialValues(ShaderOpResource &R,
+                                    std::vector<BYTE> &values) {
+  bool initByName = R.Init && 0 == _stricmp("byname", R.Init);
+  bool initZero = R.Init && 0 == _stricmp("zero", R.Init);
+  bool initFromBytes = R.Init && 0 == _stricmp("frombytes", R.Init);
+  bool isBuffer = R.Desc.Dimension == D3D12_RESOURCE_DIMENSION_BUFFER;
+  if (!initByName && !initZero && !initFromBytes) {
+    return false;
+  }
+  if (isBuffer) {
+    values.resize((size_t)R.Desc.Width);
+  }
+  else {
+    // Probably needs more information.
+    values.resize((size_t)(R.Desc.Width * R.Desc.Height *
+      GetByteSizeForFormat(R.Desc.Format)));
+  }
+  if (initZero) {
+    memset(values.data(), 0, values.size());
+  }
+  else if (initByName) {
+    m_InitCallbackFn(R.Name, values, m_pShaderOp);
+    if (isBuffer) {
+      R.Desc.Width = values.size();
+    }
+  }
+  else if (initFromBytes) {
+    values = R.InitBytes;
+    if (R.Desc.Width == 0) {
+      if (isBuffer) {
+        R.Desc.Width = values.size();
+      }
+      else if (R.Desc.Dimension == D3D12_RESOURCE_DIMENSION_TEXTURE1D) {
+        R.Desc.Width = values.size() / GetByteSizeForFormat(R.Desc.Format);
+      }
+    }
+  }
+  return true;
+}
+
 void ShaderOpTest::CreateRootSignature() {
   if (m_pShaderOp->RootSignature == nullptr) {
     AtlThrow(E_INVALIDARG);
@@ -683,6 +702,10 @@ void ShaderOpTest::GetPipelineStats(D3D12_QUERY_DATA_PIPELINE_STATISTICS *pStats
 
 void ShaderOpTest::GetReadBackData(LPCSTR pResourceName, MappedData *pData) {
   pResourceName = m_pShaderOp->Strings.insert(pResourceName); // Unique
+  if (m_UseCpuExecutor) {
+    pData->reset(m_CpuResourceData.at(pResourceName));
+    return;
+  }
   ShaderOpResourceData &D = m_ResourceData.at(pResourceName);
   D3D12_RESOURCE_DESC Desc = D.ReadBack->GetDesc();
   UINT32 sizeInBytes = (UINT32)Desc.Width;
@@ -794,6 +817,11 @@ void ShaderOpTest::RunCommandList() {
 void ShaderOpTest::RunShaderOp(ShaderOp *pShaderOp) {
   m_pShaderOp = pShaderOp;
 
+  if (m_UseCpuExecutor) {
+    RunShaderOpOnCpu();
+    return;
+  }
+
   CreateDevice();
   CreateResources();
   CreateDescriptorHeaps();
@@ -808,6 +836,133 @@ void ShaderOpTest::RunShaderOp(std::shared_ptr<ShaderOp> ShaderOp) {
   RunShaderOp(m_OrigShaderOp.get());
 }
 
+// Register bound by a root parameter; descriptor tables and root constants
+// are recorded with an invalid class.
+struct RootRegister {
+  hlsl::DXIL::ResourceClass Class;
+  unsigned Register;
+  unsigned Space;
+};
+
+static std::vector<RootRegister> GetRootRegisters(LPCSTR pRootSignature) {
+  // Split the top-level parameters, which are separated by commas outside of
+  // parentheses.
+  std::vector<std::string> params;
+  std::string cur;
+  int depth = 0;
+  for (LPCSTR pCh = pRootSignature; *pCh; ++pCh) {
+    if (*pCh == '(') ++depth;
+    if (*pCh == ')') --depth;
+    if (*pCh == ',' && depth == 0) {
+      params.push_back(cur);
+      cur.clear();
+    }
+    else if (!isspace((unsigned char)*pCh)) {
+      cur.push_back(*pCh);
+    }
+  }
+  params.push_back(cur);
+
+  std::vector<RootRegister> registers;
+  for (const std::string &P : params) {
+    if (P.empty() || 0 == _strnicmp(P.c_str(), "RootFlags(", 10) ||
+        0 == _strnicmp(P.c_str(), "StaticSampler(", 14)) {
+      continue;
+    }
+    RootRegister R = { hlsl::DXIL::ResourceClass::Invalid, 0, 0 };
+    if (0 == _strnicmp(P.c_str(), "CBV(b", 5))
+      R.Class = hlsl::DXIL::ResourceClass::CBuffer;
+    else if (0 == _strnicmp(P.c_str(), "SRV(t", 5))
+      R.Class = hlsl::DXIL::ResourceClass::SRV;
+    else if (0 == _strnicmp(P.c_str(), "UAV(u", 5))
+      R.Class = hlsl::DXIL::ResourceClass::UAV;
+    if (R.Class != hlsl::DXIL::ResourceClass::Invalid) {
+      R.Register = strtoul(P.c_str() + 5, nullptr, 10);
+      size_t spacePos = P.find("space=");
+      if (spacePos != std::string::npos) {
+        R.Space = strtoul(P.c_str() + spacePos + 6, nullptr, 10);
+      }
+    }
+    registers.push_back(R);
+  }
+  return registers;
+}
+
+void ShaderOpTest::RunShaderOpOnCpu() {
+  if (!m_pShaderOp->IsCompute()) {
+    ShaderOpLogFmt(L"The CPU executor only runs compute shader ops.\r\n");
+    CHECK_HR(E_NOTIMPL);
+  }
+
+  for (ShaderOpResource &R : m_pShaderOp->Resources) {
+    if (m_CpuResourceData.count(R.Name) > 0) continue;
+    if (R.Desc.Dimension != D3D12_RESOURCE_DIMENSION_BUFFER) {
+      ShaderOpLogFmt(L"The CPU executor only supports buffers; %S is not one.\r\n",
+                     R.Name);
+      CHECK_HR(E_NOTIMPL);
+    }
+    std::vector<BYTE> &values = m_CpuResourceData[R.Name];
+    GetInitialValues(R, values);
+    values.resize((size_t)R.Desc.Width);
+  }
+
+  CreateShaders();
+  ID3D10Blob *pCS = m_Shaders[m_pShaderOp->CS];
+  const hlsl::DxilContainerHeader *pContainer =
+      hlsl::IsDxilContainerLike(pCS->GetBufferPointer(), pCS->GetBufferSize());
+  const hlsl::DxilProgramHeader *pProgram =
+      pContainer ? hlsl::GetDxilProgramHeader(pContainer, hlsl::DFCC_DXIL)
+                 : nullptr;
+  if (pProgram == nullptr) {
+    ShaderOpLogFmt(L"The CPU executor requires a DXIL shader.\r\n");
+    CHECK_HR(E_INVALIDARG);
+  }
+  const char *pBitcode;
+  uint32_t bitcodeLength;
+  hlsl::GetDxilProgramBitcode(pProgram, &pBitcode, &bitcodeLength);
+
+  llvm::LLVMContext context;
+  std::unique_ptr<llvm::MemoryBuffer> pBuffer(llvm::MemoryBuffer::getMemBuffer(
+      llvm::StringRef(pBitcode, bitcodeLength), "", false));
+  llvm::ErrorOr<std::unique_ptr<llvm::Module>> pModule =
+      llvm::parseBitcodeFile(pBuffer->getMemBufferRef(), context);
+  if (!pModule) {
+    ShaderOpLogFmt(L"Failed to load DXIL: %S\r\n",
+                   pModule.getError().message().c_str());
+    CHECK_HR(E_FAIL);
+  }
+
+  try {
+    hlsl::DxilCpuExecutor executor(*pModule.get());
+    std::vector<RootRegister> registers =
+        GetRootRegisters(m_pShaderOp->RootSignature);
+    for (size_t i = 0; i < m_pShaderOp->RootValues.size(); ++i) {
+      ShaderOpRootValue &V = m_pShaderOp->RootValues[i];
+      UINT idx = V.Index == 0 ? (UINT)i : V.Index;
+      if (V.HeapName || idx >= registers.size() ||
+          registers[idx].Class == hlsl::DXIL::ResourceClass::Invalid) {
+        ShaderOpLogFmt(L"The CPU executor only supports root descriptors; "
+                       L"root value #%u is not one.\r\n", (unsigned)i);
+        CHECK_HR(E_NOTIMPL);
+      }
+      auto r_it = m_CpuResourceData.find(V.ResName);
+      if (r_it == m_CpuResourceData.end()) {
+        ShaderOpLogFmt(L"Root value #%u refers to missing resource %S", (unsigned)i, V.ResName);
+        CHECK_HR(E_INVALIDARG);
+      }
+      const RootRegister &R = registers[idx];
+      executor.BindResource(R.Class, R.Space, R.Register, r_it->second.data(),
+                            r_it->second.size());
+    }
+    executor.Dispatch(m_pShaderOp->DispatchX, m_pShaderOp->DispatchY,
+                      m_pShaderOp->DispatchZ);
+  }
+  catch (const hlsl::Exception &E) {
+    ShaderOpLogFmt(L"CPU executor failed: %S\r\n", E.msg.c_str());
+    CHECK_HR(E.hr);
+  }
+}
+
 void ShaderOpTest::SetRootValues(ID3D12GraphicsCommandList *pList,
   bool isCompute) {
   for (size_t i = 0; i < m_pShaderOp->RootValues.size(); ++i) {
@@ -877,6 +1032,10 @@ void ShaderOpTest::SetDxcSupport(dxc::DxcDllSupport *pDxcSupport) {
   m_pDxcSupport = pDxcSupport;
 }
 
+void ShaderOpTest::SetUseCpuExecutor(bool value) {
+  m_UseCpuExecutor = value;
+}
+
 void ShaderOpTest::SetInitCallback(TInitCallbackFn InitCallbackFn) {
   m_InitCallbackFn = InitCallbackFn;
 }
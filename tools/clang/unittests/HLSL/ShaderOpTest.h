@@ -70,6 +70,7 @@ public:
   void dump() const;
   void reset();
   void reset(ID3D12Resource *pResource, UINT32 sizeInBytes);
+  void reset(std::vector<BYTE> &data); // Data kept in CPU memory.
 };
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -240,6 +241,8 @@ public:
   void SetDevice(ID3D12Device* pDevice);
   void SetDxcSupport(dxc::DxcDllSupport *pDxcSupport);
   void SetInitCallback(TInitCallbackFn InitCallbackFn);
+  // Runs compute shader ops with the DXIL CPU executor instead of a device.
+  void SetUseCpuExecutor(bool value);
   void SetupRenderTarget(ShaderOp *pShaderOp, ID3D12Device *pDevice,
                          ID3D12CommandQueue *pCommandQueue,
                          ID3D12Resource *pRenderTarget);
@@ -277,6 +280,8 @@ private:
   std::vector<ID3D12DescriptorHeap *> m_DescriptorHeaps;
   std::shared_ptr<ShaderOp> m_OrigShaderOp;
   TInitCallbackFn m_InitCallbackFn = nullptr;
+  bool m_UseCpuExecutor = false;
+  std::map<LPCSTR, std::vector<BYTE> > m_CpuResourceData;
   void CopyBackResources();
   void CreateCommandList();
   void CreateDescriptorHeaps();
@@ -285,7 +290,9 @@ private:
   void CreateResources();
   void CreateRootSignature();
   void CreateShaders();
+  bool GetInitialValues(ShaderOpResource &R, std::vector<BYTE> &values);
   void RunCommandList();
+  void RunShaderOpOnCpu();
   void SetRootValues(ID3D12GraphicsCommandList *pList, bool isCompute);
 };
 
@@ -15,6 +15,7 @@
 #include <cassert>
 #include <sstream>
 #include <algorithm>
+#include <chrono>
 #include "dxc/Support/WinIncludes.h"
 #include "dxc/dxcapi.h"
 
@@ -32,6 +33,7 @@
 #include "dxc/HLSL/DxilSemantic.h"
 #include "dxc/HLSL/DxilSigPoint.h"
 #include "dxc/HLSL/DxilShaderModel.h"
+#include "dxc/HLSL/DxilSignatureAllocator.h"
 
 #include <fstream>
 
@@ -62,6 +64,10 @@ public:
   TEST_METHOD(VerifyShadowEntries)
   TEST_METHOD(VerifyVersionedSemantics)
   TEST_METHOD(VerifyMissingSemanticFailure)
+  TEST_METHOD(VerifyMinimalPacking)
+  BEGIN_TEST_METHOD(BenchmarkMinimalPacking)
+    TEST_METHOD_PROPERTY(L"Priority", L"2")
+  END_TEST_METHOD()
 
   void CompileHLSLTemplate(CComPtr<IDxcOperationResult> &pResult, DXIL::SigPointKind sigPointKind, DXIL::SemanticKind semKind, bool addArb, unsigned Major = 6, unsigned Minor = 0) {
     const Semantic *sem = Semantic::Get(semKind);
@@ -447,3 +453,159 @@ TEST_F(SystemValueTest, VerifyMissingSemanticFailure) {
     CheckAnyOperationResultMsg(pResult, Errors, _countof(Errors));
   }
 }
+
+struct PackingTestElement {
+  const char *Name;
+  unsigned Rows;
+  unsigned Cols;
+  DXIL::InterpolationMode Interp;
+};
+
+struct PackingTestSignature {
+  const char *Name;
+  DXIL::SigPointKind SigPoint;
+  std::vector<PackingTestElement> Elements;
+};
+
+// Vertex and pixel shader signatures modeled on common material shaders,
+// plus cases where greedy placement leaves unusable gaps.
+static std::vector<PackingTestSignature> GetPackingTestSignatures() {
+  const DXIL::InterpolationMode L = DXIL::InterpolationMode::Linear;
+  const DXIL::InterpolationMode N = DXIL::InterpolationMode::LinearNoperspective;
+  const DXIL::InterpolationMode C = DXIL::InterpolationMode::Constant;
+  return {
+    { "VS lit", DXIL::SigPointKind::VSOut,
+      { {"SV_Position", 1, 4, N}, {"NORMAL", 1, 3, L}, {"TANGENT", 1, 3, L}, {"TEXCOORD0", 1, 2, L},
+        {"TEXCOORD1", 1, 2, L}, {"COLOR", 1, 4, L}, {"FOG", 1, 1, L} } },
+    { "VS skinned", DXIL::SigPointKind::VSOut,
+      { {"SV_Position", 1, 4, N}, {"WORLDPOS", 1, 3, L}, {"NORMAL", 1, 3, L}, {"TEXCOORD", 1, 2, L},
+        {"SHADOWCOORD", 3, 3, L}, {"INSTANCE", 1, 1, C}, {"SV_ClipDistance", 1, 2, L},
+        {"SV_CullDistance", 1, 1, L} } },
+    { "VS particles", DXIL::SigPointKind::VSOut,
+      { {"SV_Position", 1, 4, N}, {"SIZE", 3, 1, L}, {"TEXCOORD", 2, 2, L}, {"COLOR", 1, 3, L},
+        {"VELOCITY", 1, 3, L}, {"FADE", 1, 2, L} } },
+    { "PS deferred", DXIL::SigPointKind::PSIn,
+      { {"SV_Position", 1, 4, N}, {"NORMAL", 1, 3, L}, {"TANGENT", 1, 3, L}, {"BINORMAL", 1, 3, L},
+        {"TEXCOORD", 1, 2, L}, {"MATERIAL", 1, 1, C}, {"SV_IsFrontFace", 1, 1, C},
+        {"SV_PrimitiveID", 1, 1, C} } },
+    { "PS terrain", DXIL::SigPointKind::PSIn,
+      { {"SV_Position", 1, 4, N}, {"BLEND", 4, 3, L}, {"TEXCOORD", 1, 2, L}, {"HEIGHT", 1, 1, L},
+        {"LAYER", 2, 1, L}, {"DETAIL", 1, 3, L}, {"SLOPE", 1, 1, L}, {"VIEWDIR", 1, 3, L},
+        {"SV_ClipDistance", 1, 3, L}, {"SV_CullDistance", 1, 3, L}, {"EXTRA", 1, 2, L} } },
+  };
+}
+
+static void CreatePackingElements(const PackingTestSignature &sig,
+                                  std::vector<std::unique_ptr<DxilSignatureElement> > &storage,
+                                  std::vector<DxilSignatureElement*> &elements) {
+  unsigned ID = 0;
+  for (const PackingTestElement &E : sig.Elements) {
+    std::unique_ptr<DxilSignatureElement> pSE(new DxilSignatureElement(sig.SigPoint));
+    std::vector<unsigned> indexVector;
+    for (unsigned i = 0; i < E.Rows; ++i)
+      indexVector.push_back(i);
+    CompType compType = (E.Interp == DXIL::InterpolationMode::Constant) ? CompType::getU32() : CompType::getF32();
+    pSE->Initialize(E.Name, compType, InterpolationMode(E.Interp), E.Rows, E.Cols, -1, -1, ID++, indexVector);
+    elements.push_back(pSE.get());
+    storage.push_back(std::move(pSE));
+  }
+}
+
+// Re-place every element in a fresh allocator, checking it does not conflict.
+static bool IsValidPacking(const std::vector<DxilSignatureElement*> &elements, unsigned numRows) {
+  DxilSignatureAllocator alloc(numRows);
+  for (DxilSignatureElement *SE : elements) {
+    if (!SE->IsAllocated())
+      return false;
+    unsigned row = SE->GetStartRow(), col = SE->GetStartCol();
+    if (alloc.DetectRowConflict(SE, row) || alloc.DetectColConflict(SE, row, col))
+      return false;
+    alloc.PlaceElement(SE, row, col);
+  }
+  return true;
+}
+
+TEST_F(SystemValueTest, VerifyMinimalPacking) {
+  for (const PackingTestSignature &sig : GetPackingTestSignatures()) {
+    std::vector<std::unique_ptr<DxilSignatureElement> > storage;
+    std::vector<DxilSignatureElement*> elements;
+    CreatePackingElements(sig, storage, elements);
+
+    DxilSignatureAllocator optimizedAlloc(32);
+    unsigned optimizedRows = optimizedAlloc.PackOptimized(elements, 0, 32);
+    VERIFY_IS_TRUE(IsValidPacking(elements, 32));
+
+    DxilSignatureAllocator minimalAlloc(32);
+    unsigned reportedRows = 0;
+    unsigned minimalRows = minimalAlloc.PackMinimal(elements, 0, 32, &reportedRows);
+    VERIFY_ARE_EQUAL(optimizedRows, reportedRows);
+    VERIFY_IS_TRUE(minimalRows <= optimizedRows);
+    VERIFY_IS_TRUE(IsValidPacking(elements, 32));
+    std::vector<std::pair<int, int> > placement;
+    for (DxilSignatureElement *SE : elements) {
+      VERIFY_IS_TRUE((unsigned)(SE->GetStartRow() + SE->GetRows()) <= minimalRows);
+      placement.push_back(std::make_pair(SE->GetStartRow(), SE->GetStartCol()));
+    }
+
+    // Packing must be deterministic.
+    DxilSignatureAllocator repeatAlloc(32);
+    VERIFY_ARE_EQUAL(minimalRows, repeatAlloc.PackMinimal(elements, 0, 32));
+    for (unsigned i = 0; i < elements.size(); ++i) {
+      VERIFY_ARE_EQUAL(placement[i].first, elements[i]->GetStartRow());
+      VERIFY_ARE_EQUAL(placement[i].second, elements[i]->GetStartCol());
+    }
+  }
+
+  // A 3x1 element placed first in column 0 leaves no room for two 1x3 elements
+  // beside the 2x2 element; the search moves it to column 3.
+  PackingTestSignature gaps = { "gaps", DXIL::SigPointKind::VSOut,
+    { {"A", 3, 1, DXIL::InterpolationMode::Linear}, {"B", 2, 2, DXIL::InterpolationMode::Linear},
+      {"C", 1, 3, DXIL::InterpolationMode::Linear}, {"D", 1, 3, DXIL::InterpolationMode::Linear},
+      {"E", 1, 2, DXIL::InterpolationMode::Linear} } };
+  std::vector<std::unique_ptr<DxilSignatureElement> > storage;
+  std::vector<DxilSignatureElement*> elements;
+  CreatePackingElements(gaps, storage, elements);
+  DxilSignatureAllocator alloc(32);
+  unsigned optimizedRows = 0;
+  VERIFY_ARE_EQUAL(4U, alloc.PackMinimal(elements, 0, 32, &optimizedRows));
+  VERIFY_ARE_EQUAL(5U, optimizedRows);
+  VERIFY_IS_TRUE(IsValidPacking(elements, 32));
+}
+
+TEST_F(SystemValueTest, BenchmarkMinimalPacking) {
+  const unsigned kIterations = 100;
+  unsigned totalOptimizedRows = 0, totalMinimalRows = 0;
+  for (const PackingTestSignature &sig : GetPackingTestSignatures()) {
+    std::vector<std::unique_ptr<DxilSignatureElement> > storage;
+    std::vector<DxilSignatureElement*> elements;
+    CreatePackingElements(sig, storage, elements);
+
+    unsigned optimizedRows = 0, minimalRows = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (unsigned i = 0; i < kIterations; ++i) {
+      DxilSignatureAllocator alloc(32);
+      optimizedRows = alloc.PackOptimized(elements, 0, 32);
+    }
+    double optimizedUs = std::chrono::duration<double, std::micro>(
+      std::chrono::steady_clock::now() - start).count() / kIterations;
+
+    start = std::chrono::steady_clock::now();
+    for (unsigned i = 0; i < kIterations; ++i) {
+      DxilSignatureAllocator alloc(32);
+      minimalRows = alloc.PackMinimal(elements, 0, 32);
+    }
+    double minimalUs = std::chrono::duration<double, std::micro>(
+      std::chrono::steady_clock::now() - start).count() / kIterations;
+
+    totalOptimizedRows += optimizedRows;
+    totalMinimalRows += minimalRows;
+    CA2W nameW(sig.Name, CP_UTF8);
+    WEX::Logging::Log::Comment(WEX::Common::String().Format(
+      L"%s: optimized %u rows (%.1f us), minimal %u rows (%.1f us), %u rows saved",
+      (LPCWSTR)nameW, optimizedRows, optimizedUs, minimalRows, minimalUs,
+      optimizedRows - minimalRows));
+  }
+  WEX::Logging::Log::Comment(WEX::Common::String().Format(
+    L"Total: optimized %u rows, minimal %u rows, %u rows saved",
+    totalOptimizedRows, totalMinimalRows, totalOptimizedRows - totalMinimalRows));
+}
@@ -111,6 +111,9 @@ public:
   TEST_CLASS_SETUP(InitSupport);
 
   TEST_METHOD(WhenCorrectThenOK);
+  TEST_METHOD(WhenHullShaderCorrectThenOK);
+  TEST_METHOD(WhenDomainShaderCorrectThenOK);
+  TEST_METHOD(WhenUavCounterCorrectThenOK);
   TEST_METHOD(WhenMisalignedThenFail);
   TEST_METHOD(WhenEmptyFileThenFail);
   TEST_METHOD(WhenIncorrectMagicThenFail);
@@ -531,6 +534,60 @@ TEST_F(ValidationTest, WhenCorrectThenOK) {
   CheckValidationMsgs(pProgram, nullptr);
 }
 
+// Hull shaders have two function bodies, and the module-level output and
+// patch constant checks depend on what validating those bodies found.
+TEST_F(ValidationTest, WhenHullShaderCorrectThenOK) {
+  CComPtr<IDxcBlob> pProgram;
+  CompileSource(
+      "struct CP { float4 pos : POSITION; };\n"
+      "struct PC { float edges[3] : SV_TessFactor;\n"
+      "            float inside : SV_InsideTessFactor; };\n"
+      "PC PatchFunc(InputPatch<CP, 3> ip) {\n"
+      "  PC pc;\n"
+      "  pc.edges[0] = pc.edges[1] = pc.edges[2] = ip[0].pos.x;\n"
+      "  pc.inside = ip[1].pos.y;\n"
+      "  return pc;\n"
+      "}\n"
+      "[domain(\"tri\")]\n"
+      "[partitioning(\"integer\")]\n"
+      "[outputtopology(\"triangle_cw\")]\n"
+      "[outputcontrolpoints(3)]\n"
+      "[patchconstantfunc(\"PatchFunc\")]\n"
+      "CP main(InputPatch<CP, 3> ip, uint id : SV_OutputControlPointID) {\n"
+      "  return ip[id];\n"
+      "}",
+      "hs_6_0", &pProgram);
+  CheckValidationMsgs(pProgram, nullptr);
+}
+
+TEST_F(ValidationTest, WhenDomainShaderCorrectThenOK) {
+  CComPtr<IDxcBlob> pProgram;
+  CompileSource(
+      "struct CP { float4 pos : POSITION; };\n"
+      "struct PC { float edges[3] : SV_TessFactor;\n"
+      "            float inside : SV_InsideTessFactor; };\n"
+      "[domain(\"tri\")]\n"
+      "float4 main(PC pc, float3 loc : SV_DomainLocation,\n"
+      "            const OutputPatch<CP, 3> op) : SV_Position {\n"
+      "  return op[0].pos * loc.x + op[1].pos * loc.y + op[2].pos * loc.z;\n"
+      "}",
+      "ds_6_0", &pProgram);
+  CheckValidationMsgs(pProgram, nullptr);
+}
+
+TEST_F(ValidationTest, WhenUavCounterCorrectThenOK) {
+  CComPtr<IDxcBlob> pProgram;
+  CompileSource(
+      "RWStructuredBuffer<uint> buf;\n"
+      "[numthreads(8, 1, 1)]\n"
+      "void main(uint id : SV_DispatchThreadID) {\n"
+      "  buf[buf.IncrementCounter()] = id;\n"
+      "  buf[buf.IncrementCounter()] = id + 1;\n"
+      "}",
+      "cs_6_0", &pProgram);
+  CheckValidationMsgs(pProgram, nullptr);
+}
+
 // Lots of these going on below for simplicity in setting up payloads.
 //
 // warning C4838: conversion from 'int' to 'const char' requires a narrowing conversion
@@ -66,6 +66,7 @@ public:
   TEST_METHOD(RunUint4Add3);
   TEST_METHOD(RunBadInclude);
   TEST_METHOD(RunWave);
+  TEST_METHOD(RunBuiltinObjectTypes);
 
   void CheckVerifies(const wchar_t* path) {
     WEX::TestExecution::SetVerifyOutput verifySettings(WEX::TestExecution::VerifyOutputSettings::LogOnlyFailures);
@@ -260,3 +261,7 @@ TEST_F(VerifierTest, RunBadInclude) {
 TEST_F(VerifierTest, RunWave) {
   CheckVerifiesHLSL(L"wave.hlsl");
 }
+
+TEST_F(VerifierTest, RunBuiltinObjectTypes) {
+  CheckVerifiesHLSL(L"builtin-object-types.hlsl");
+}
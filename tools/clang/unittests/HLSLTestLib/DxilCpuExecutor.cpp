@@ -0,0 +1,1769 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// DxilCpuExecutor.cpp                                                       //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Reference executor that runs DXIL compute shaders on the CPU.             //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#include "DxilCpuExecutor.h"
+#include "dxc/HLSL/DxilCBuffer.h"
+#include "dxc/HLSL/DxilModule.h"
+#include "dxc/HLSL/DxilOperations.h"
+#include "dxc/HLSL/DxilResource.h"
+#include "dxc/HLSL/DxilShaderModel.h"
+#include "dxc/Support/Global.h"
+
+#include "llvm/ADT/APFloat.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/PostOrderIterator.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/IR/CFG.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/DataLayout.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/GetElementPtrTypeIterator.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/Module.h"
+#include "llvm/IR/Operator.h"
+#include "llvm/IR/TypeFinder.h"
+#include "llvm/Support/MathExtras.h"
+#include "llvm/Support/raw_ostream.h"
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include <cmath>
+#include <cstring>
+#include <exception>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <tuple>
+
+using namespace llvm;
+using namespace hlsl;
+
+namespace {
+
+typedef DXIL::OpCode OpCode;
+
+LLVM_ATTRIBUTE_NORETURN void ThrowNotSupported(const Value *V) {
+  std::string msg;
+  raw_string_ostream OS(msg);
+  OS << "CPU executor does not support:";
+  V->print(OS);
+  throw hlsl::Exception(E_NOTIMPL, OS.str());
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Scalar values.
+//
+// Each scalar occupies a 64-bit slot. Integers are zero-extended from their
+// width and pointers hold host addresses. Floating-point values hold their
+// bits; half values are kept as float, as min precision allows.
+
+float SlotToFloat(uint64_t Slot) {
+  uint32_t Bits = (uint32_t)Slot;
+  float F;
+  memcpy(&F, &Bits, sizeof(F));
+  return F;
+}
+
+uint64_t FloatToSlot(float F) {
+  uint32_t Bits;
+  memcpy(&Bits, &F, sizeof(Bits));
+  return Bits;
+}
+
+double SlotToDouble(uint64_t Slot) {
+  double D;
+  memcpy(&D, &Slot, sizeof(D));
+  return D;
+}
+
+uint64_t DoubleToSlot(double D) {
+  uint64_t Slot;
+  memcpy(&Slot, &D, sizeof(Slot));
+  return Slot;
+}
+
+// Single precision operations computed in double and rounded once give the
+// correctly rounded result, so floats of all widths are evaluated in double.
+double GetFloat(Type *Ty, uint64_t Slot) {
+  return Ty->isDoubleTy() ? SlotToDouble(Slot) : (double)SlotToFloat(Slot);
+}
+
+uint64_t MakeFloat(Type *Ty, double V) {
+  return Ty->isDoubleTy() ? DoubleToSlot(V) : FloatToSlot((float)V);
+}
+
+uint64_t MaskToWidth(uint64_t V, unsigned Width) {
+  return Width >= 64 ? V : V & ((1ull << Width) - 1);
+}
+
+int64_t SignExtend(uint64_t V, unsigned Width) {
+  return Width >= 64 ? (int64_t)V
+                     : ((int64_t)(V << (64 - Width))) >> (64 - Width);
+}
+
+float HalfBitsToFloat(uint16_t Bits) {
+  APFloat F(APFloat::IEEEhalf, APInt(16, Bits));
+  bool LosesInfo;
+  F.convert(APFloat::IEEEsingle, APFloat::rmNearestTiesToEven, &LosesInfo);
+  return F.convertToFloat();
+}
+
+uint16_t FloatToHalfBits(float V) {
+  APFloat F(V);
+  bool LosesInfo;
+  F.convert(APFloat::IEEEhalf, APFloat::rmNearestTiesToEven, &LosesInfo);
+  return (uint16_t)F.bitcastToAPInt().getZExtValue();
+}
+
+uint64_t FloatToSigned(double X, unsigned Width) {
+  if (std::isnan(X))
+    return 0;
+  double Limit = std::ldexp(1.0, Width - 1);
+  if (X >= Limit)
+    return MaskToWidth((1ull << (Width - 1)) - 1, Width);
+  if (X < -Limit)
+    return MaskToWidth(1ull << (Width - 1), Width);
+  return MaskToWidth((uint64_t)(int64_t)X, Width);
+}
+
+uint64_t FloatToUnsigned(double X, unsigned Width) {
+  if (!(X > 0))
+    return 0;
+  if (X >= std::ldexp(1.0, Width))
+    return MaskToWidth(~0ull, Width);
+  return (uint64_t)X;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Aggregates are flattened into consecutive slots.
+
+unsigned GetSlotCount(Type *Ty) {
+  if (StructType *ST = dyn_cast<StructType>(Ty)) {
+    unsigned Count = 0;
+    for (Type *ETy : ST->elements())
+      Count += GetSlotCount(ETy);
+    return Count;
+  }
+  if (ArrayType *AT = dyn_cast<ArrayType>(Ty))
+    return AT->getNumElements() * GetSlotCount(AT->getElementType());
+  if (VectorType *VT = dyn_cast<VectorType>(Ty))
+    return VT->getNumElements() * GetSlotCount(VT->getElementType());
+  return 1;
+}
+
+// Slot offset of the element at Indices within an aggregate of type Ty.
+unsigned GetSlotOffset(Type *Ty, ArrayRef<unsigned> Indices) {
+  unsigned Offset = 0;
+  for (unsigned Idx : Indices) {
+    if (StructType *ST = dyn_cast<StructType>(Ty)) {
+      for (unsigned i = 0; i < Idx; ++i)
+        Offset += GetSlotCount(ST->getElementType(i));
+      Ty = ST->getElementType(Idx);
+    } else {
+      Type *ETy = Ty->getSequentialElementType();
+      Offset += Idx * GetSlotCount(ETy);
+      Ty = ETy;
+    }
+  }
+  return Offset;
+}
+
+// Fills slots for constants that don't depend on the executing lane.
+void GetConstantDataSlots(const Constant *C, uint64_t *pSlots) {
+  Type *Ty = C->getType();
+  if (const ConstantInt *CI = dyn_cast<ConstantInt>(C)) {
+    *pSlots = CI->getZExtValue();
+    return;
+  }
+  if (const ConstantFP *CF = dyn_cast<ConstantFP>(C)) {
+    APFloat F = CF->getValueAPF();
+    if (Ty->isDoubleTy()) {
+      *pSlots = DoubleToSlot(F.convertToDouble());
+    } else {
+      bool LosesInfo;
+      F.convert(APFloat::IEEEsingle, APFloat::rmNearestTiesToEven, &LosesInfo);
+      *pSlots = FloatToSlot(F.convertToFloat());
+    }
+    return;
+  }
+  if (isa<UndefValue>(C) || isa<ConstantAggregateZero>(C) ||
+      isa<ConstantPointerNull>(C)) {
+    std::fill(pSlots, pSlots + GetSlotCount(Ty), 0);
+    return;
+  }
+  if (const ConstantDataSequential *CDS = dyn_cast<ConstantDataSequential>(C)) {
+    Type *ETy = CDS->getElementType();
+    for (unsigned i = 0, e = CDS->getNumElements(); i < e; ++i) {
+      if (ETy->isIntegerTy()) {
+        pSlots[i] = CDS->getElementAsInteger(i);
+      } else if (ETy->isDoubleTy()) {
+        pSlots[i] = DoubleToSlot(CDS->getElementAsDouble(i));
+      } else if (ETy->isFloatTy()) {
+        pSlots[i] = FloatToSlot(CDS->getElementAsFloat(i));
+      } else {
+        APFloat F = CDS->getElementAsAPFloat(i);
+        bool LosesInfo;
+        F.convert(APFloat::IEEEsingle, APFloat::rmNearestTiesToEven,
+                  &LosesInfo);
+        pSlots[i] = FloatToSlot(F.convertToFloat());
+      }
+    }
+    return;
+  }
+  if (isa<ConstantArray>(C) || isa<ConstantStruct>(C) ||
+      isa<ConstantVector>(C)) {
+    for (const Use &Op : C->operands()) {
+      const Constant *E = cast<Constant>(Op);
+      GetConstantDataSlots(E, pSlots);
+      pSlots += GetSlotCount(E->getType());
+    }
+    return;
+  }
+  ThrowNotSupported(C);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Memory uses the module data layout.
+
+void ReadMemory(const DataLayout &DL, Type *Ty, const char *pMem,
+                uint64_t *pSlots) {
+  if (StructType *ST = dyn_cast<StructType>(Ty)) {
+    const StructLayout *SL = DL.getStructLayout(ST);
+    for (unsigned i = 0, e = ST->getNumElements(); i < e; ++i) {
+      Type *ETy = ST->getElementType(i);
+      ReadMemory(DL, ETy, pMem + SL->getElementOffset(i), pSlots);
+      pSlots += GetSlotCount(ETy);
+    }
+    return;
+  }
+  if (isa<ArrayType>(Ty) || isa<VectorType>(Ty)) {
+    Type *ETy = Ty->getSequentialElementType();
+    uint64_t Stride = DL.getTypeAllocSize(ETy);
+    unsigned Count = isa<ArrayType>(Ty) ? Ty->getArrayNumElements()
+                                        : Ty->getVectorNumElements();
+    unsigned ESlots = GetSlotCount(ETy);
+    for (unsigned i = 0; i < Count; ++i)
+      ReadMemory(DL, ETy, pMem + i * Stride, pSlots + i * ESlots);
+    return;
+  }
+  if (Ty->isHalfTy()) {
+    uint16_t Bits;
+    memcpy(&Bits, pMem, sizeof(Bits));
+    *pSlots = FloatToSlot(HalfBitsToFloat(Bits));
+  } else if (Ty->isFloatTy()) {
+    uint32_t Bits;
+    memcpy(&Bits, pMem, sizeof(Bits));
+    *pSlots = Bits;
+  } else if (Ty->isDoubleTy()) {
+    memcpy(pSlots, pMem, sizeof(uint64_t));
+  } else if (Ty->isIntegerTy()) {
+    unsigned Width = Ty->getIntegerBitWidth();
+    uint64_t V = 0;
+    memcpy(&V, pMem, (Width + 7) / 8);
+    *pSlots = MaskToWidth(V, Width);
+  } else if (Ty->isPointerTy()) {
+    uintptr_t P;
+    memcpy(&P, pMem, sizeof(P));
+    *pSlots = P;
+  } else {
+    throw hlsl::Exception(E_NOTIMPL, "CPU executor cannot load this type");
+  }
+}
+
+void WriteMemory(const DataLayout &DL, Type *Ty, char *pMem,
+                 const uint64_t *pSlots) {
+  if (StructType *ST = dyn_cast<StructType>(Ty)) {
+    const StructLayout *SL = DL.getStructLayout(ST);
+    for (unsigned i = 0, e = ST->getNumElements(); i < e; ++i) {
+      Type *ETy = ST->getElementType(i);
+      WriteMemory(DL, ETy, pMem + SL->getElementOffset(i), pSlots);
+      pSlots += GetSlotCount(ETy);
+    }
+    return;
+  }
+  if (isa<ArrayType>(Ty) || isa<VectorType>(Ty)) {
+    Type *ETy = Ty->getSequentialElementType();
+    uint64_t Stride = DL.getTypeAllocSize(ETy);
+    unsigned Count = isa<ArrayType>(Ty) ? Ty->getArrayNumElements()
+                                        : Ty->getVectorNumElements();
+    unsigned ESlots = GetSlotCount(ETy);
+    for (unsigned i = 0; i < Count; ++i)
+      WriteMemory(DL, ETy, pMem + i * Stride, pSlots + i * ESlots);
+    return;
+  }
+  if (Ty->isHalfTy()) {
+    uint16_t Bits = FloatToHalfBits(SlotToFloat(*pSlots));
+    memcpy(pMem, &Bits, sizeof(Bits));
+  } else if (Ty->isFloatTy()) {
+    uint32_t Bits = (uint32_t)*pSlots;
+    memcpy(pMem, &Bits, sizeof(Bits));
+  } else if (Ty->isDoubleTy()) {
+    memcpy(pMem, pSlots, sizeof(uint64_t));
+  } else if (Ty->isIntegerTy()) {
+    memcpy(pMem, pSlots, (Ty->getIntegerBitWidth() + 7) / 8);
+  } else if (Ty->isPointerTy()) {
+    uintptr_t P = (uintptr_t)*pSlots;
+    memcpy(pMem, &P, sizeof(P));
+  } else {
+    throw hlsl::Exception(E_NOTIMPL, "CPU executor cannot store this type");
+  }
+}
+
+// Buffer components are 32 bits wide unless the type is 64 bits wide.
+unsigned GetBufferComponentSize(Type *Ty) {
+  return Ty->getPrimitiveSizeInBits() == 64 ? 8 : 4;
+}
+
+uint64_t ReadBufferComponent(Type *Ty, unsigned Size, const char *pMem) {
+  if (Size == 2) {
+    uint16_t Bits;
+    memcpy(&Bits, pMem, sizeof(Bits));
+    return Ty->isHalfTy() ? FloatToSlot(HalfBitsToFloat(Bits)) : Bits;
+  }
+  if (Size == 8) {
+    uint64_t Bits;
+    memcpy(&Bits, pMem, sizeof(Bits));
+    return Bits;
+  }
+  uint32_t Bits;
+  memcpy(&Bits, pMem, sizeof(Bits));
+  // Min precision values are stored in 32 bits.
+  return Ty->isIntegerTy() ? MaskToWidth(Bits, Ty->getIntegerBitWidth())
+                           : Bits;
+}
+
+void WriteBufferComponent(Type *Ty, unsigned Size, char *pMem, uint64_t V) {
+  if (Size == 8) {
+    memcpy(pMem, &V, sizeof(V));
+    return;
+  }
+  uint32_t Bits = (uint32_t)V;
+  if (Ty->isIntegerTy() && Ty->getIntegerBitWidth() < 32)
+    Bits = (uint32_t)SignExtend(V, Ty->getIntegerBitWidth());
+  memcpy(pMem, &Bits, sizeof(Bits));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Instruction semantics.
+
+uint64_t EvalBinary(unsigned Opcode, Type *Ty, uint64_t A, uint64_t B) {
+  if (Ty->isFloatingPointTy()) {
+    double X = GetFloat(Ty, A), Y = GetFloat(Ty, B);
+    switch (Opcode) {
+    case Instruction::FAdd: return MakeFloat(Ty, X + Y);
+    case Instruction::FSub: return MakeFloat(Ty, X - Y);
+    case Instruction::FMul: return MakeFloat(Ty, X * Y);
+    case Instruction::FDiv: return MakeFloat(Ty, X / Y);
+    case Instruction::FRem: return MakeFloat(Ty, std::fmod(X, Y));
+    }
+    llvm_unreachable("else not a floating-point binary operator");
+  }
+
+  unsigned W = Ty->getIntegerBitWidth();
+  int64_t X = SignExtend(A, W), Y = SignExtend(B, W);
+  // Division by zero yields all bits set, as on hardware.
+  switch (Opcode) {
+  case Instruction::Add: return MaskToWidth(A + B, W);
+  case Instruction::Sub: return MaskToWidth(A - B, W);
+  case Instruction::Mul: return MaskToWidth(A * B, W);
+  case Instruction::UDiv: return B ? A / B : MaskToWidth(~0ull, W);
+  case Instruction::URem: return B ? A % B : MaskToWidth(~0ull, W);
+  case Instruction::SDiv:
+    if (Y == 0)
+      return MaskToWidth(~0ull, W);
+    if (Y == -1)
+      return MaskToWidth(0 - (uint64_t)X, W);
+    return MaskToWidth((uint64_t)(X / Y), W);
+  case Instruction::SRem:
+    if (Y == 0)
+      return MaskToWidth(~0ull, W);
+    if (Y == -1)
+      return 0;
+    return MaskToWidth((uint64_t)(X % Y), W);
+  case Instruction::Shl: return MaskToWidth(A << (B % W), W);
+  case Instruction::LShr: return A >> (B % W);
+  case Instruction::AShr: return MaskToWidth((uint64_t)(X >> (B % W)), W);
+  case Instruction::And: return A & B;
+  case Instruction::Or: return A | B;
+  case Instruction::Xor: return A ^ B;
+  }
+  llvm_unreachable("else not an integer binary operator");
+}
+
+bool EvalCompare(CmpInst::Predicate P, Type *Ty, uint64_t A, uint64_t B) {
+  if (CmpInst::isFPPredicate(P)) {
+    double X = GetFloat(Ty, A), Y = GetFloat(Ty, B);
+    bool U = std::isnan(X) || std::isnan(Y);
+    switch (P) {
+    case CmpInst::FCMP_FALSE: return false;
+    case CmpInst::FCMP_OEQ: return !U && X == Y;
+    case CmpInst::FCMP_OGT: return !U && X > Y;
+    case CmpInst::FCMP_OGE: return !U && X >= Y;
+    case CmpInst::FCMP_OLT: return !U && X < Y;
+    case CmpInst::FCMP_OLE: return !U && X <= Y;
+    case CmpInst::FCMP_ONE: return !U && X != Y;
+    case CmpInst::FCMP_ORD: return !U;
+    case CmpInst::FCMP_UNO: return U;
+    case CmpInst::FCMP_UEQ: return U || X == Y;
+    case CmpInst::FCMP_UGT: return U || X > Y;
+    case CmpInst::FCMP_UGE: return U || X >= Y;
+    case CmpInst::FCMP_ULT: return U || X < Y;
+    case CmpInst::FCMP_ULE: return U || X <= Y;
+    case CmpInst::FCMP_UNE: return U || X != Y;
+    default: return true;
+    }
+  }
+
+  unsigned W = Ty->isPointerTy() ? 64 : Ty->getIntegerBitWidth();
+  int64_t X = SignExtend(A, W), Y = SignExtend(B, W);
+  switch (P) {
+  case CmpInst::ICMP_EQ: return A == B;
+  case CmpInst::ICMP_NE: return A != B;
+  case CmpInst::ICMP_UGT: return A > B;
+  case CmpInst::ICMP_UGE: return A >= B;
+  case CmpInst::ICMP_ULT: return A < B;
+  case CmpInst::ICMP_ULE: return A <= B;
+  case CmpInst::ICMP_SGT: return X > Y;
+  case CmpInst::ICMP_SGE: return X >= Y;
+  case CmpInst::ICMP_SLT: return X < Y;
+  default: return X <= Y;
+  }
+}
+
+uint64_t EvalCast(unsigned Opcode, Type *SrcTy, Type *DstTy, uint64_t V) {
+  unsigned DstW = DstTy->isIntegerTy() ? DstTy->getIntegerBitWidth() : 64;
+  switch (Opcode) {
+  case Instruction::Trunc:
+  case Instruction::PtrToInt:
+    return MaskToWidth(V, DstW);
+  case Instruction::SExt:
+    return MaskToWidth((uint64_t)SignExtend(V, SrcTy->getIntegerBitWidth()),
+                       DstW);
+  case Instruction::FPToUI:
+    return FloatToUnsigned(GetFloat(SrcTy, V), DstW);
+  case Instruction::FPToSI:
+    return FloatToSigned(GetFloat(SrcTy, V), DstW);
+  case Instruction::UIToFP:
+    return DstTy->isDoubleTy() ? DoubleToSlot((double)V)
+                               : FloatToSlot((float)V);
+  case Instruction::SIToFP: {
+    int64_t S = SignExtend(V, SrcTy->getIntegerBitWidth());
+    return DstTy->isDoubleTy() ? DoubleToSlot((double)S)
+                               : FloatToSlot((float)S);
+  }
+  case Instruction::FPTrunc:
+    return SrcTy->isDoubleTy() ? FloatToSlot((float)SlotToDouble(V)) : V;
+  case Instruction::FPExt:
+    return DstTy->isDoubleTy() ? DoubleToSlot((double)SlotToFloat(V)) : V;
+  case Instruction::BitCast:
+    if (SrcTy->isHalfTy() && DstTy->isIntegerTy())
+      return FloatToHalfBits(SlotToFloat(V));
+    if (SrcTy->isIntegerTy() && DstTy->isHalfTy())
+      return FloatToSlot(HalfBitsToFloat((uint16_t)V));
+    return V;
+  default: // ZExt, IntToPtr, AddrSpaceCast
+    return V;
+  }
+}
+
+uint64_t EvalAtomic(AtomicRMWInst::BinOp Op, unsigned W, uint64_t Old,
+                    uint64_t V) {
+  switch (Op) {
+  case AtomicRMWInst::Xchg: return V;
+  case AtomicRMWInst::Add: return MaskToWidth(Old + V, W);
+  case AtomicRMWInst::Sub: return MaskToWidth(Old - V, W);
+  case AtomicRMWInst::And: return Old & V;
+  case AtomicRMWInst::Nand: return MaskToWidth(~(Old & V), W);
+  case AtomicRMWInst::Or: return Old | V;
+  case AtomicRMWInst::Xor: return Old ^ V;
+  case AtomicRMWInst::Max:
+    return SignExtend(Old, W) > SignExtend(V, W) ? Old : V;
+  case AtomicRMWInst::Min:
+    return SignExtend(Old, W) < SignExtend(V, W) ? Old : V;
+  case AtomicRMWInst::UMax: return std::max(Old, V);
+  case AtomicRMWInst::UMin: return std::min(Old, V);
+  default:
+    throw hlsl::Exception(E_NOTIMPL, "CPU executor does not support atomic");
+  }
+}
+
+AtomicRMWInst::BinOp GetAtomicRMWOp(DXIL::AtomicBinOpCode Op) {
+  switch (Op) {
+  case DXIL::AtomicBinOpCode::Add: return AtomicRMWInst::Add;
+  case DXIL::AtomicBinOpCode::And: return AtomicRMWInst::And;
+  case DXIL::AtomicBinOpCode::Or: return AtomicRMWInst::Or;
+  case DXIL::AtomicBinOpCode::Xor: return AtomicRMWInst::Xor;
+  case DXIL::AtomicBinOpCode::IMin: return AtomicRMWInst::Min;
+  case DXIL::AtomicBinOpCode::IMax: return AtomicRMWInst::Max;
+  case DXIL::AtomicBinOpCode::UMin: return AtomicRMWInst::UMin;
+  case DXIL::AtomicBinOpCode::UMax: return AtomicRMWInst::UMax;
+  case DXIL::AtomicBinOpCode::Exchange: return AtomicRMWInst::Xchg;
+  default: return AtomicRMWInst::BAD_BINOP;
+  }
+}
+
+uint64_t EvalWaveOp(DXIL::WaveOpKind Kind, bool IsUnsigned, Type *Ty,
+                    uint64_t A, uint64_t B) {
+  if (Ty->isFloatingPointTy()) {
+    double X = GetFloat(Ty, A), Y = GetFloat(Ty, B);
+    switch (Kind) {
+    case DXIL::WaveOpKind::Sum: return MakeFloat(Ty, X + Y);
+    case DXIL::WaveOpKind::Product: return MakeFloat(Ty, X * Y);
+    case DXIL::WaveOpKind::Min: return MakeFloat(Ty, std::fmin(X, Y));
+    case DXIL::WaveOpKind::Max: return MakeFloat(Ty, std::fmax(X, Y));
+    }
+  }
+  unsigned W = Ty->getIntegerBitWidth();
+  switch (Kind) {
+  case DXIL::WaveOpKind::Sum: return MaskToWidth(A + B, W);
+  case DXIL::WaveOpKind::Product: return MaskToWidth(A * B, W);
+  case DXIL::WaveOpKind::Min:
+    if (IsUnsigned)
+      return std::min(A, B);
+    return SignExtend(A, W) < SignExtend(B, W) ? A : B;
+  case DXIL::WaveOpKind::Max:
+    if (IsUnsigned)
+      return std::max(A, B);
+    return SignExtend(A, W) > SignExtend(B, W) ? A : B;
+  }
+  llvm_unreachable("else invalid wave op kind");
+}
+
+uint32_t ReverseBits(uint32_t V) {
+  uint32_t R = 0;
+  for (unsigned i = 0; i < 32; ++i, V >>= 1)
+    R = (R << 1) | (V & 1);
+  return R;
+}
+
+uint32_t FirstBitFromMsb(uint64_t V, unsigned W) {
+  for (unsigned i = 0; i < W; ++i)
+    if (V & (1ull << (W - 1 - i)))
+      return i;
+  return UINT32_MAX;
+}
+
+uint32_t BitfieldExtract(uint32_t Width, uint32_t Offset, uint32_t V,
+                         bool IsSigned) {
+  Width &= 31;
+  Offset &= 31;
+  if (Width == 0)
+    return 0;
+  if (Width + Offset < 32) {
+    V <<= 32 - (Width + Offset);
+    return IsSigned ? (uint32_t)((int32_t)V >> (32 - Width)) : V >> (32 - Width);
+  }
+  return IsSigned ? (uint32_t)((int32_t)V >> Offset) : V >> Offset;
+}
+
+uint32_t MaskedSad(uint32_t Ref, uint32_t Src, uint32_t Accum) {
+  for (unsigned i = 0; i < 4; ++i) {
+    uint32_t RefByte = (Ref >> (i * 8)) & 0xFF;
+    if (!RefByte)
+      continue;
+    uint32_t SrcByte = (Src >> (i * 8)) & 0xFF;
+    uint32_t AbsDiff = RefByte >= SrcByte ? RefByte - SrcByte : SrcByte - RefByte;
+    if (UINT32_MAX - Accum < AbsDiff)
+      return UINT32_MAX;
+    Accum += AbsDiff;
+  }
+  return Accum;
+}
+
+bool IsSynchronizingWaveOp(OpCode Op) {
+  switch (Op) {
+  case OpCode::WaveIsFirstLane:
+  case OpCode::WaveAnyTrue:
+  case OpCode::WaveAllTrue:
+  case OpCode::WaveActiveAllEqual:
+  case OpCode::WaveActiveBallot:
+  case OpCode::WaveReadLaneAt:
+  case OpCode::WaveReadLaneFirst:
+  case OpCode::WaveActiveOp:
+  case OpCode::WaveActiveBit:
+  case OpCode::WavePrefixOp:
+  case OpCode::WaveAllBitCount:
+  case OpCode::WavePrefixBitCount:
+  case OpCode::QuadReadLaneAt:
+  case OpCode::QuadOp:
+    return true;
+  default:
+    return false;
+  }
+}
+
+OpCode GetDxilOpCode(const CallInst *CI) {
+  return (OpCode)cast<ConstantInt>(CI->getArgOperand(0))->getZExtValue();
+}
+
+} // namespace
+
+///////////////////////////////////////////////////////////////////////////////
+// Program state shared by all groups.
+
+namespace hlsl {
+
+class DxilCpuExecutorImpl {
+public:
+  struct BufferBinding {
+    char *pData;
+    size_t Size;
+    int32_t Counter;
+  };
+
+  struct ResourceHandle {
+    DXIL::ResourceKind Kind;
+    unsigned ElementSize; // Structure stride or typed element size.
+    BufferBinding *pBinding;
+  };
+
+  enum class GlobalRegion { Constant, Group, Thread };
+  struct GlobalInfo {
+    GlobalRegion Region;
+    uint64_t Offset;
+  };
+
+  explicit DxilCpuExecutorImpl(Module &M);
+
+  void BindResource(DXIL::ResourceClass Class, unsigned Space,
+                    unsigned Register, void *pData, size_t Size);
+  void Dispatch(unsigned X, unsigned Y, unsigned Z);
+
+  const ResourceHandle *GetHandle(unsigned Class, unsigned RangeId,
+                                  unsigned Index);
+
+  const DataLayout &DL;
+  const Function *Entry;
+  unsigned NumThreads[3];
+  unsigned WaveSize = 32;
+  unsigned HostThreadCount = 0;
+
+  // Base slot of each non-void instruction, and the position of each
+  // instruction in reverse post-order, which orders pending wave operations.
+  DenseMap<const Instruction *, unsigned> SlotOf;
+  DenseMap<const Instruction *, unsigned> ProgramOrder;
+  unsigned SlotCount = 0;
+
+  DenseMap<const GlobalVariable *, GlobalInfo> Globals;
+  std::vector<char> ConstantMemory;
+  std::vector<char> GroupMemoryInit;
+  std::vector<char> ThreadMemoryInit;
+
+  std::mutex AtomicMutex;
+
+private:
+  struct RangeInfo {
+    unsigned Space;
+    DXIL::ResourceKind Kind;
+    unsigned ElementSize;
+  };
+
+  void AddRange(const DxilResourceBase &R, unsigned ElementSize);
+  void AddGlobal(const GlobalVariable &GV);
+
+  typedef std::tuple<unsigned, unsigned, unsigned> ResourceKey;
+  std::map<std::pair<unsigned, unsigned>, RangeInfo> m_ranges;
+  std::map<ResourceKey, BufferBinding> m_bindings;
+  std::map<ResourceKey, ResourceHandle> m_handles;
+  std::mutex m_handleMutex;
+};
+
+} // namespace hlsl
+
+static unsigned GetTypedElementSize(const DxilResource &R) {
+  Type *Ty = R.GetGlobalSymbol()->getType();
+  if (Ty->isPointerTy())
+    Ty = Ty->getPointerElementType();
+  if (Ty->isStructTy() && Ty->getStructNumElements() > 0)
+    Ty = Ty->getStructElementType(0);
+  unsigned Count = Ty->isVectorTy() ? Ty->getVectorNumElements() : 1;
+  return Count * 4;
+}
+
+DxilCpuExecutorImpl::DxilCpuExecutorImpl(Module &M) : DL(M.getDataLayout()) {
+  DxilModule &DM = M.GetOrCreateDxilModule();
+  if (!DM.GetShaderModel()->IsCS())
+    throw hlsl::Exception(E_INVALIDARG,
+                          "CPU executor only runs compute shaders");
+  Entry = DM.GetEntryFunction();
+  std::copy(DM.m_NumThreads, DM.m_NumThreads + 3, NumThreads);
+
+  for (const auto &R : DM.GetSRVs())
+    AddRange(*R, R->IsStructuredBuffer() ? R->GetElementStride()
+                                         : GetTypedElementSize(*R));
+  for (const auto &R : DM.GetUAVs())
+    AddRange(*R, R->IsStructuredBuffer() ? R->GetElementStride()
+                                         : GetTypedElementSize(*R));
+  for (const auto &R : DM.GetCBuffers())
+    AddRange(*R, 0);
+
+  for (const GlobalVariable &GV : M.globals())
+    AddGlobal(GV);
+
+  unsigned Order = 0;
+  for (const BasicBlock *BB : ReversePostOrderTraversal<const Function *>(Entry)) {
+    for (const Instruction &I : *BB) {
+      ProgramOrder[&I] = Order++;
+      if (!I.getType()->isVoidTy()) {
+        SlotOf[&I] = SlotCount;
+        SlotCount += GetSlotCount(I.getType());
+      }
+    }
+  }
+
+  // The data layout caches struct layouts on first use; fill the cache here
+  // so that host threads only read it.
+  TypeFinder StructTypes;
+  StructTypes.run(M, false);
+  for (StructType *ST : StructTypes)
+    if (ST->isSized())
+      DL.getStructLayout(ST);
+}
+
+void DxilCpuExecutorImpl::AddRange(const DxilResourceBase &R,
+                                   unsigned ElementSize) {
+  RangeInfo &Info = m_ranges[std::make_pair((unsigned)R.GetClass(), R.GetID())];
+  Info.Space = R.GetSpaceID();
+  Info.Kind = R.GetKind();
+  Info.ElementSize = ElementSize;
+}
+
+void DxilCpuExecutorImpl::AddGlobal(const GlobalVariable &GV) {
+  Type *Ty = GV.getType()->getElementType();
+  GlobalInfo Info;
+  std::vector<char> *pMemory;
+  if (GV.getType()->getAddressSpace() == DXIL::kTGSMAddrSpace) {
+    Info.Region = GlobalRegion::Group;
+    pMemory = &GroupMemoryInit;
+  } else if (!GV.hasInitializer() || !Ty->isSized()) {
+    // Resource symbols and other declarations aren't accessed directly.
+    return;
+  } else if (GV.isConstant()) {
+    Info.Region = GlobalRegion::Constant;
+    pMemory = &ConstantMemory;
+  } else {
+    Info.Region = GlobalRegion::Thread;
+    pMemory = &ThreadMemoryInit;
+  }
+
+  uint64_t Align = std::max(16u, DL.getPrefTypeAlignment(Ty));
+  Info.Offset = RoundUpToAlignment(pMemory->size(), Align);
+  pMemory->resize(Info.Offset + DL.getTypeAllocSize(Ty));
+  if (GV.hasInitializer() && !isa<UndefValue>(GV.getInitializer())) {
+    std::vector<uint64_t> Slots(GetSlotCount(Ty));
+    GetConstantDataSlots(GV.getInitializer(), Slots.data());
+    WriteMemory(DL, Ty, pMemory->data() + Info.Offset, Slots.data());
+  }
+  Globals[&GV] = Info;
+}
+
+void DxilCpuExecutorImpl::BindResource(DXIL::ResourceClass Class,
+                                       unsigned Space, unsigned Register,
+                                       void *pData, size_t Size) {
+  std::lock_guard<std::mutex> Lock(m_handleMutex);
+  BufferBinding &B = m_bindings[std::make_tuple((unsigned)Class, Space, Register)];
+  B.pData = (char *)pData;
+  B.Size = Size;
+  B.Counter = 0;
+  m_handles.clear();
+}
+
+const DxilCpuExecutorImpl::ResourceHandle *
+DxilCpuExecutorImpl::GetHandle(unsigned Class, unsigned RangeId,
+                               unsigned Index) {
+  std::lock_guard<std::mutex> Lock(m_handleMutex);
+  ResourceKey Key = std::make_tuple(Class, RangeId, Index);
+  auto It = m_handles.find(Key);
+  if (It != m_handles.end())
+    return &It->second;
+
+  auto RangeIt = m_ranges.find(std::make_pair(Class, RangeId));
+  if (RangeIt == m_ranges.end())
+    throw hlsl::Exception(E_INVALIDARG, "handle created for unknown range");
+  const RangeInfo &Range = RangeIt->second;
+  auto BindingIt = m_bindings.find(std::make_tuple(Class, Range.Space, Index));
+  if (BindingIt == m_bindings.end()) {
+    std::string msg;
+    raw_string_ostream OS(msg);
+    OS << "no memory bound for register " << Index << ", space "
+       << Range.Space;
+    throw hlsl::Exception(E_INVALIDARG, OS.str());
+  }
+  ResourceHandle &H = m_handles[Key];
+  H.Kind = Range.Kind;
+  H.ElementSize = Range.ElementSize;
+  H.pBinding = &BindingIt->second;
+  return &H;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Thread group execution.
+
+namespace {
+
+enum class LaneState { Running, AtWaveOp, AtBarrier, Done };
+
+struct Lane {
+  std::vector<uint64_t> Slots;
+  const BasicBlock *Block;
+  BasicBlock::const_iterator Next;
+  LaneState State;
+  unsigned ThreadIdInGroup[3];
+  unsigned FlatIndex;
+  unsigned LaneIndex; // Within the wave.
+  std::vector<char> ThreadMemory;
+  std::vector<std::unique_ptr<char[]>> Allocas;
+};
+
+class GroupRunner {
+public:
+  GroupRunner(DxilCpuExecutorImpl &E, unsigned X, unsigned Y, unsigned Z)
+      : E(E) {
+    GroupId[0] = X;
+    GroupId[1] = Y;
+    GroupId[2] = Z;
+  }
+
+  void Run();
+
+private:
+  typedef DxilCpuExecutorImpl::ResourceHandle ResourceHandle;
+
+  DxilCpuExecutorImpl &E;
+  unsigned GroupId[3];
+  std::vector<char> GroupMemory;
+  std::vector<Lane> Lanes;
+  std::vector<uint64_t> PhiValues;
+
+  bool RunWaveOp(unsigned Wave);
+  void Step(Lane &L);
+  void Branch(Lane &L, const BasicBlock *To);
+  bool ExecuteDxilOp(Lane &L, const CallInst *CI);
+  void ExecuteWaveOp(const CallInst *CI, ArrayRef<Lane *> Active);
+
+  uint64_t *GetResult(Lane &L, const Instruction *I) {
+    return &L.Slots[E.SlotOf.lookup(I)];
+  }
+  uint64_t GetScalar(Lane &L, const Value *V);
+  void GetSlots(Lane &L, const Value *V, uint64_t *pSlots);
+  void GetConstantSlots(Lane &L, const Constant *C, uint64_t *pSlots);
+  char *GetGlobalAddress(Lane &L, const GlobalVariable *GV);
+  char *ComputeGEP(Lane &L, const GEPOperator *GEP);
+  const ResourceHandle &GetHandle(Lane &L, const Value *V) {
+    return *(const ResourceHandle *)(uintptr_t)GetScalar(L, V);
+  }
+  char *GetBufferAddress(const ResourceHandle &H, uint64_t Coord0,
+                         uint64_t Coord1, unsigned Component, unsigned Size);
+};
+
+} // namespace
+
+void GroupRunner::Run() {
+  const unsigned *N = E.NumThreads;
+  unsigned Count = N[0] * N[1] * N[2];
+  GroupMemory = E.GroupMemoryInit;
+  Lanes.resize(Count);
+  for (unsigned i = 0; i < Count; ++i) {
+    Lane &L = Lanes[i];
+    L.Slots.assign(E.SlotCount, 0);
+    L.Block = &E.Entry->getEntryBlock();
+    L.Next = L.Block->begin();
+    L.State = LaneState::Running;
+    L.FlatIndex = i;
+    L.ThreadIdInGroup[0] = i % N[0];
+    L.ThreadIdInGroup[1] = (i / N[0]) % N[1];
+    L.ThreadIdInGroup[2] = i / (N[0] * N[1]);
+    L.LaneIndex = i % E.WaveSize;
+    L.ThreadMemory = E.ThreadMemoryInit;
+  }
+
+  // Lanes run until they finish or wait. Waves then run their earliest
+  // pending wave operation, and once none is pending, barriers release.
+  unsigned WaveCount = (Count + E.WaveSize - 1) / E.WaveSize;
+  for (;;) {
+    for (Lane &L : Lanes) {
+      while (L.State == LaneState::Running)
+        Step(L);
+    }
+    bool Resumed = false;
+    for (unsigned w = 0; w < WaveCount; ++w)
+      Resumed |= RunWaveOp(w);
+    if (Resumed)
+      continue;
+    for (Lane &L : Lanes) {
+      if (L.State == LaneState::AtBarrier) {
+        L.State = LaneState::Running;
+        Resumed = true;
+      }
+    }
+    if (!Resumed)
+      break;
+  }
+}
+
+bool GroupRunner::RunWaveOp(unsigned Wave) {
+  unsigned Begin = Wave * E.WaveSize;
+  unsigned End = std::min<unsigned>(Begin + E.WaveSize, Lanes.size());
+  const Instruction *Earliest = nullptr;
+  unsigned EarliestOrder = UINT_MAX;
+  for (unsigned i = Begin; i < End; ++i) {
+    if (Lanes[i].State != LaneState::AtWaveOp)
+      continue;
+    const Instruction *I = &*Lanes[i].Next;
+    unsigned Order = E.ProgramOrder.lookup(I);
+    if (Order < EarliestOrder) {
+      Earliest = I;
+      EarliestOrder = Order;
+    }
+  }
+  if (!Earliest)
+    return false;
+
+  SmallVector<Lane *, 32> Active;
+  for (unsigned i = Begin; i < End; ++i) {
+    Lane &L = Lanes[i];
+    if (L.State == LaneState::AtWaveOp && &*L.Next == Earliest)
+      Active.push_back(&L);
+  }
+  ExecuteWaveOp(cast<CallInst>(Earliest), Active);
+  for (Lane *L : Active) {
+    ++L->Next;
+    L->State = LaneState::Running;
+  }
+  return true;
+}
+
+uint64_t GroupRunner::GetScalar(Lane &L, const Value *V) {
+  if (const Instruction *I = dyn_cast<Instruction>(V))
+    return L.Slots[E.SlotOf.lookup(I)];
+  if (const ConstantInt *CI = dyn_cast<ConstantInt>(V))
+    return CI->getZExtValue();
+  uint64_t Slot;
+  GetConstantSlots(L, cast<Constant>(V), &Slot);
+  return Slot;
+}
+
+void GroupRunner::GetSlots(Lane &L, const Value *V, uint64_t *pSlots) {
+  if (const Instruction *I = dyn_cast<Instruction>(V)) {
+    const uint64_t *pSrc = &L.Slots[E.SlotOf.lookup(I)];
+    std::copy(pSrc, pSrc + GetSlotCount(I->getType()), pSlots);
+    return;
+  }
+  GetConstantSlots(L, cast<Constant>(V), pSlots);
+}
+
+void GroupRunner::GetConstantSlots(Lane &L, const Constant *C,
+                                   uint64_t *pSlots) {
+  if (const GlobalVariable *GV = dyn_cast<GlobalVariable>(C)) {
+    *pSlots = (uintptr_t)GetGlobalAddress(L, GV);
+    return;
+  }
+  if (const ConstantExpr *CE = dyn_cast<ConstantExpr>(C)) {
+    switch (CE->getOpcode()) {
+    case Instruction::GetElementPtr:
+      *pSlots = (uintptr_t)ComputeGEP(L, cast<GEPOperator>(CE));
+      return;
+    case Instruction::BitCast:
+    case Instruction::AddrSpaceCast:
+      GetConstantSlots(L, CE->getOperand(0), pSlots);
+      return;
+    default:
+      ThrowNotSupported(CE);
+    }
+  }
+  GetConstantDataSlots(C, pSlots);
+}
+
+char *GroupRunner::GetGlobalAddress(Lane &L, const GlobalVariable *GV) {
+  auto It = E.Globals.find(GV);
+  if (It == E.Globals.end())
+    ThrowNotSupported(GV);
+  switch (It->second.Region) {
+  case DxilCpuExecutorImpl::GlobalRegion::Constant:
+    return E.ConstantMemory.data() + It->second.Offset;
+  case DxilCpuExecutorImpl::GlobalRegion::Group:
+    return GroupMemory.data() + It->second.Offset;
+  default:
+    return L.ThreadMemory.data() + It->second.Offset;
+  }
+}
+
+char *GroupRunner::ComputeGEP(Lane &L, const GEPOperator *GEP) {
+  char *Base = (char *)(uintptr_t)GetScalar(L, GEP->getPointerOperand());
+  int64_t Offset = 0;
+  for (gep_type_iterator GTI = gep_type_begin(GEP), GTE = gep_type_end(GEP);
+       GTI != GTE; ++GTI) {
+    const Value *Idx = GTI.getOperand();
+    if (StructType *ST = dyn_cast<StructType>(*GTI)) {
+      unsigned Field = (unsigned)cast<ConstantInt>(Idx)->getZExtValue();
+      Offset += E.DL.getStructLayout(ST)->getElementOffset(Field);
+    } else {
+      int64_t Index =
+          SignExtend(GetScalar(L, Idx), Idx->getType()->getIntegerBitWidth());
+      Offset += Index * (int64_t)E.DL.getTypeAllocSize(GTI.getIndexedType());
+    }
+  }
+  return Base + Offset;
+}
+
+void GroupRunner::Branch(Lane &L, const BasicBlock *To) {
+  // Phis read their incoming values before any of them is written.
+  PhiValues.clear();
+  for (const Instruction &I : *To) {
+    const PHINode *Phi = dyn_cast<PHINode>(&I);
+    if (!Phi)
+      break;
+    size_t At = PhiValues.size();
+    PhiValues.resize(At + GetSlotCount(Phi->getType()));
+    GetSlots(L, Phi->getIncomingValueForBlock(L.Block), &PhiValues[At]);
+  }
+  const uint64_t *pValue = PhiValues.data();
+  for (const Instruction &I : *To) {
+    const PHINode *Phi = dyn_cast<PHINode>(&I);
+    if (!Phi)
+      break;
+    unsigned Count = GetSlotCount(Phi->getType());
+    std::copy(pValue, pValue + Count, GetResult(L, Phi));
+    pValue += Count;
+  }
+  L.Block = To;
+  L.Next = To->getFirstNonPHI();
+}
+
+void GroupRunner::Step(Lane &L) {
+  const Instruction *I = &*L.Next;
+  unsigned Opcode = I->getOpcode();
+
+  if (I->isBinaryOp() || isa<CmpInst>(I) || I->isCast()) {
+    Type *Ty = I->getOperand(0)->getType();
+    Type *ElTy = Ty->getScalarType();
+    unsigned Count = GetSlotCount(Ty);
+    SmallVector<uint64_t, 4> A(Count), B(Count);
+    GetSlots(L, I->getOperand(0), A.data());
+    if (!I->isCast())
+      GetSlots(L, I->getOperand(1), B.data());
+    uint64_t *pResult = GetResult(L, I);
+    for (unsigned i = 0; i < Count; ++i) {
+      if (const CmpInst *Cmp = dyn_cast<CmpInst>(I))
+        pResult[i] = EvalCompare(Cmp->getPredicate(), ElTy, A[i], B[i]);
+      else if (I->isCast())
+        pResult[i] =
+            EvalCast(Opcode, ElTy, I->getType()->getScalarType(), A[i]);
+      else
+        pResult[i] = EvalBinary(Opcode, ElTy, A[i], B[i]);
+    }
+    ++L.Next;
+    return;
+  }
+
+  switch (Opcode) {
+  case Instruction::Br: {
+    const BranchInst *BI = cast<BranchInst>(I);
+    bool Taken = BI->isUnconditional() || GetScalar(L, BI->getCondition());
+    Branch(L, BI->getSuccessor(Taken ? 0 : 1));
+    return;
+  }
+  case Instruction::Switch: {
+    const SwitchInst *SI = cast<SwitchInst>(I);
+    uint64_t V = GetScalar(L, SI->getCondition());
+    const BasicBlock *To = SI->getDefaultDest();
+    for (auto Case : SI->cases()) {
+      if (Case.getCaseValue()->getZExtValue() == V) {
+        To = Case.getCaseSuccessor();
+        break;
+      }
+    }
+    Branch(L, To);
+    return;
+  }
+  case Instruction::Ret:
+    L.State = LaneState::Done;
+    return;
+  case Instruction::Alloca: {
+    const AllocaInst *AI = cast<AllocaInst>(I);
+    uint64_t Size = E.DL.getTypeAllocSize(AI->getAllocatedType()) *
+                    GetScalar(L, AI->getArraySize());
+    L.Allocas.emplace_back(new char[Size]());
+    *GetResult(L, I) = (uintptr_t)L.Allocas.back().get();
+    break;
+  }
+  case Instruction::Load: {
+    const char *pAddr = (const char *)(uintptr_t)GetScalar(L, I->getOperand(0));
+    ReadMemory(E.DL, I->getType(), pAddr, GetResult(L, I));
+    break;
+  }
+  case Instruction::Store: {
+    const StoreInst *SI = cast<StoreInst>(I);
+    Type *Ty = SI->getValueOperand()->getType();
+    SmallVector<uint64_t, 4> Value(GetSlotCount(Ty));
+    GetSlots(L, SI->getValueOperand(), Value.data());
+    WriteMemory(E.DL, Ty, (char *)(uintptr_t)GetScalar(L, SI->getPointerOperand()),
+                Value.data());
+    break;
+  }
+  case Instruction::GetElementPtr:
+    *GetResult(L, I) = (uintptr_t)ComputeGEP(L, cast<GEPOperator>(I));
+    break;
+  case Instruction::Select: {
+    const SelectInst *SI = cast<SelectInst>(I);
+    unsigned Count = GetSlotCount(SI->getType());
+    SmallVector<uint64_t, 4> Cond(Count), T(Count), F(Count);
+    GetSlots(L, SI->getCondition(), Cond.data());
+    GetSlots(L, SI->getTrueValue(), T.data());
+    GetSlots(L, SI->getFalseValue(), F.data());
+    bool VectorCond = SI->getCondition()->getType()->isVectorTy();
+    uint64_t *pResult = GetResult(L, I);
+    for (unsigned i = 0; i < Count; ++i)
+      pResult[i] = Cond[VectorCond ? i : 0] ? T[i] : F[i];
+    break;
+  }
+  case Instruction::ExtractValue: {
+    const ExtractValueInst *EV = cast<ExtractValueInst>(I);
+    Type *AggTy = EV->getAggregateOperand()->getType();
+    SmallVector<uint64_t, 8> Agg(GetSlotCount(AggTy));
+    GetSlots(L, EV->getAggregateOperand(), Agg.data());
+    unsigned Offset = GetSlotOffset(AggTy, EV->getIndices());
+    std::copy(Agg.begin() + Offset,
+              Agg.begin() + Offset + GetSlotCount(EV->getType()),
+              GetResult(L, I));
+    break;
+  }
+  case Instruction::InsertValue: {
+    const InsertValueInst *IV = cast<InsertValueInst>(I);
+    Type *AggTy = IV->getType();
+    uint64_t *pResult = GetResult(L, I);
+    GetSlots(L, IV->getAggregateOperand(), pResult);
+    GetSlots(L, IV->getInsertedValueOperand(),
+             pResult + GetSlotOffset(AggTy, IV->getIndices()));
+    break;
+  }
+  case Instruction::ExtractElement: {
+    const ExtractElementInst *EE = cast<ExtractElementInst>(I);
+    Type *VecTy = EE->getVectorOperand()->getType();
+    SmallVector<uint64_t, 4> Vec(GetSlotCount(VecTy));
+    GetSlots(L, EE->getVectorOperand(), Vec.data());
+    uint64_t Idx = GetScalar(L, EE->getIndexOperand());
+    *GetResult(L, I) = Idx < Vec.size() ? Vec[Idx] : 0;
+    break;
+  }
+  case Instruction::InsertElement: {
+    const InsertElementInst *IE = cast<InsertElementInst>(I);
+    uint64_t *pResult = GetResult(L, I);
+    GetSlots(L, IE->getOperand(0), pResult);
+    uint64_t Idx = GetScalar(L, IE->getOperand(2));
+    if (Idx < GetSlotCount(IE->getType()))
+      pResult[Idx] = GetScalar(L, IE->getOperand(1));
+    break;
+  }
+  case Instruction::AtomicRMW: {
+    const AtomicRMWInst *RMW = cast<AtomicRMWInst>(I);
+    Type *Ty = RMW->getType();
+    char *pAddr = (char *)(uintptr_t)GetScalar(L, RMW->getPointerOperand());
+    uint64_t V = GetScalar(L, RMW->getValOperand());
+    std::lock_guard<std::mutex> Lock(E.AtomicMutex);
+    uint64_t Old;
+    ReadMemory(E.DL, Ty, pAddr, &Old);
+    uint64_t New =
+        EvalAtomic(RMW->getOperation(), Ty->getIntegerBitWidth(), Old, V);
+    WriteMemory(E.DL, Ty, pAddr, &New);
+    *GetResult(L, I) = Old;
+    break;
+  }
+  case Instruction::AtomicCmpXchg: {
+    const AtomicCmpXchgInst *CX = cast<AtomicCmpXchgInst>(I);
+    Type *Ty = CX->getNewValOperand()->getType();
+    char *pAddr = (char *)(uintptr_t)GetScalar(L, CX->getPointerOperand());
+    uint64_t Cmp = GetScalar(L, CX->getCompareOperand());
+    uint64_t New = GetScalar(L, CX->getNewValOperand());
+    std::lock_guard<std::mutex> Lock(E.AtomicMutex);
+    uint64_t *pResult = GetResult(L, I);
+    ReadMemory(E.DL, Ty, pAddr, &pResult[0]);
+    pResult[1] = pResult[0] == Cmp;
+    if (pResult[1])
+      WriteMemory(E.DL, Ty, pAddr, &New);
+    break;
+  }
+  case Instruction::Call: {
+    const CallInst *CI = cast<CallInst>(I);
+    const Function *F = CI->getCalledFunction();
+    // Intrinsics left in DXIL are annotations such as lifetime markers.
+    if (F && F->isIntrinsic())
+      break;
+    if (!F || !OP::IsDxilOpFunc(F))
+      ThrowNotSupported(I);
+    if (!ExecuteDxilOp(L, CI))
+      return;
+    break;
+  }
+  default:
+    ThrowNotSupported(I);
+  }
+  ++L.Next;
+}
+
+char *GroupRunner::GetBufferAddress(const ResourceHandle &H, uint64_t Coord0,
+                                    uint64_t Coord1, unsigned Component,
+                                    unsigned Size) {
+  uint64_t Offset = Component * Size;
+  switch (H.Kind) {
+  case DXIL::ResourceKind::RawBuffer:
+    Offset += Coord0;
+    break;
+  case DXIL::ResourceKind::StructuredBuffer:
+    Offset += Coord0 * H.ElementSize + Coord1;
+    break;
+  case DXIL::ResourceKind::TypedBuffer:
+    if (Offset >= H.ElementSize)
+      return nullptr;
+    Offset += Coord0 * H.ElementSize;
+    break;
+  default:
+    throw hlsl::Exception(E_NOTIMPL, "CPU executor only supports buffers");
+  }
+  // Out-of-bounds accesses read zero and drop writes, as on hardware.
+  if (Offset + Size > H.pBinding->Size)
+    return nullptr;
+  return H.pBinding->pData + Offset;
+}
+
+// Returns false if the lane must wait before the operation completes.
+bool GroupRunner::ExecuteDxilOp(Lane &L, const CallInst *CI) {
+  OpCode Op = GetDxilOpCode(CI);
+  if (IsSynchronizingWaveOp(Op)) {
+    L.State = LaneState::AtWaveOp;
+    return false;
+  }
+
+  auto Arg = [&](unsigned i) { return GetScalar(L, CI->getArgOperand(i)); };
+  auto FArg = [&](unsigned i) {
+    return GetFloat(CI->getArgOperand(i)->getType(), Arg(i));
+  };
+  Type *RetTy = CI->getType();
+  Type *ArgTy = CI->getNumArgOperands() > 1 ? CI->getArgOperand(1)->getType()
+                                            : nullptr;
+  unsigned W = ArgTy && ArgTy->isIntegerTy() ? ArgTy->getIntegerBitWidth() : 0;
+  uint64_t *pResult = RetTy->isVoidTy() ? nullptr : GetResult(L, CI);
+
+  switch (Op) {
+  // Unary float operations.
+  case OpCode::FAbs: *pResult = MakeFloat(RetTy, std::fabs(FArg(1))); break;
+  case OpCode::Saturate: {
+    double X = FArg(1);
+    *pResult = MakeFloat(RetTy, std::isnan(X) ? 0 : std::min(std::max(X, 0.0), 1.0));
+    break;
+  }
+  case OpCode::IsNaN: *pResult = std::isnan(FArg(1)); break;
+  case OpCode::IsInf: *pResult = std::isinf(FArg(1)); break;
+  case OpCode::IsFinite: *pResult = std::isfinite(FArg(1)); break;
+  case OpCode::IsNormal:
+    *pResult = ArgTy->isDoubleTy() ? std::isnormal(FArg(1))
+                                   : std::isnormal((float)FArg(1));
+    break;
+  case OpCode::Cos: *pResult = MakeFloat(RetTy, std::cos(FArg(1))); break;
+  case OpCode::Sin: *pResult = MakeFloat(RetTy, std::sin(FArg(1))); break;
+  case OpCode::Tan: *pResult = MakeFloat(RetTy, std::tan(FArg(1))); break;
+  case OpCode::Acos: *pResult = MakeFloat(RetTy, std::acos(FArg(1))); break;
+  case OpCode::Asin: *pResult = MakeFloat(RetTy, std::asin(FArg(1))); break;
+  case OpCode::Atan: *pResult = MakeFloat(RetTy, std::atan(FArg(1))); break;
+  case OpCode::Hcos: *pResult = MakeFloat(RetTy, std::cosh(FArg(1))); break;
+  case OpCode::Hsin: *pResult = MakeFloat(RetTy, std::sinh(FArg(1))); break;
+  case OpCode::Htan: *pResult = MakeFloat(RetTy, std::tanh(FArg(1))); break;
+  case OpCode::Exp: *pResult = MakeFloat(RetTy, std::exp2(FArg(1))); break;
+  case OpCode::Log: *pResult = MakeFloat(RetTy, std::log2(FArg(1))); break;
+  case OpCode::Sqrt: *pResult = MakeFloat(RetTy, std::sqrt(FArg(1))); break;
+  case OpCode::Rsqrt: *pResult = MakeFloat(RetTy, 1.0 / std::sqrt(FArg(1))); break;
+  case OpCode::Frc: {
+    double X = FArg(1);
+    *pResult = MakeFloat(RetTy, X - std::floor(X));
+    break;
+  }
+  case OpCode::Round_ne: *pResult = MakeFloat(RetTy, std::nearbyint(FArg(1))); break;
+  case OpCode::Round_ni: *pResult = MakeFloat(RetTy, std::floor(FArg(1))); break;
+  case OpCode::Round_pi: *pResult = MakeFloat(RetTy, std::ceil(FArg(1))); break;
+  case OpCode::Round_z: *pResult = MakeFloat(RetTy, std::trunc(FArg(1))); break;
+
+  // Unary integer operations.
+  case OpCode::Bfrev: *pResult = ReverseBits((uint32_t)Arg(1)); break;
+  case OpCode::Countbits: {
+    uint64_t V = Arg(1);
+    unsigned Count = 0;
+    for (; V; V &= V - 1)
+      ++Count;
+    *pResult = Count;
+    break;
+  }
+  case OpCode::FirstbitLo: {
+    uint64_t V = Arg(1);
+    uint32_t Pos = UINT32_MAX;
+    for (unsigned i = 0; i < W; ++i) {
+      if (V & (1ull << i)) {
+        Pos = i;
+        break;
+      }
+    }
+    *pResult = Pos;
+    break;
+  }
+  case OpCode::FirstbitHi: *pResult = FirstBitFromMsb(Arg(1), W); break;
+  case OpCode::FirstbitSHi: {
+    uint64_t V = Arg(1);
+    if (SignExtend(V, W) < 0)
+      V = MaskToWidth(~V, W);
+    *pResult = FirstBitFromMsb(V, W);
+    break;
+  }
+
+  // Binary operations.
+  case OpCode::FMax: *pResult = MakeFloat(RetTy, std::fmax(FArg(1), FArg(2))); break;
+  case OpCode::FMin: *pResult = MakeFloat(RetTy, std::fmin(FArg(1), FArg(2))); break;
+  case OpCode::IMax:
+    *pResult = SignExtend(Arg(1), W) > SignExtend(Arg(2), W) ? Arg(1) : Arg(2);
+    break;
+  case OpCode::IMin:
+    *pResult = SignExtend(Arg(1), W) < SignExtend(Arg(2), W) ? Arg(1) : Arg(2);
+    break;
+  case OpCode::UMax: *pResult = std::max(Arg(1), Arg(2)); break;
+  case OpCode::UMin: *pResult = std::min(Arg(1), Arg(2)); break;
+  case OpCode::IMul: {
+    int64_t P = (int64_t)(int32_t)Arg(1) * (int64_t)(int32_t)Arg(2);
+    pResult[0] = (uint32_t)((uint64_t)P >> 32);
+    pResult[1] = (uint32_t)P;
+    break;
+  }
+  case OpCode::UMul: {
+    uint64_t P = Arg(1) * Arg(2);
+    pResult[0] = P >> 32;
+    pResult[1] = (uint32_t)P;
+    break;
+  }
+  case OpCode::UDiv: {
+    uint64_t A = Arg(1), B = Arg(2);
+    pResult[0] = B ? A / B : UINT32_MAX;
+    pResult[1] = B ? A % B : UINT32_MAX;
+    break;
+  }
+  case OpCode::UAddc: {
+    uint64_t S = Arg(1) + Arg(2);
+    pResult[0] = (uint32_t)S;
+    pResult[1] = S >> 32;
+    break;
+  }
+  case OpCode::USubb: {
+    uint64_t A = Arg(1), B = Arg(2);
+    pResult[0] = (uint32_t)(A - B);
+    pResult[1] = A < B;
+    break;
+  }
+
+  // Tertiary operations.
+  case OpCode::FMad:
+  case OpCode::Fma:
+    *pResult = MakeFloat(RetTy, std::fma(FArg(1), FArg(2), FArg(3)));
+    break;
+  case OpCode::IMad:
+  case OpCode::UMad:
+    *pResult = MaskToWidth(Arg(1) * Arg(2) + Arg(3), W);
+    break;
+  case OpCode::Msad:
+    *pResult = MaskedSad((uint32_t)Arg(1), (uint32_t)Arg(2), (uint32_t)Arg(3));
+    break;
+  case OpCode::Ibfe:
+  case OpCode::Ubfe:
+    *pResult = BitfieldExtract((uint32_t)Arg(1), (uint32_t)Arg(2),
+                               (uint32_t)Arg(3), Op == OpCode::Ibfe);
+    break;
+  case OpCode::Bfi: {
+    uint32_t Width = Arg(1) & 31, Offset = Arg(2) & 31;
+    uint32_t Mask = (uint32_t)(((1ull << Width) - 1) << Offset);
+    *pResult = (((uint32_t)Arg(3) << Offset) & Mask) | ((uint32_t)Arg(4) & ~Mask);
+    break;
+  }
+  case OpCode::Dot2:
+  case OpCode::Dot3:
+  case OpCode::Dot4: {
+    unsigned N = 2 + (unsigned)Op - (unsigned)OpCode::Dot2;
+    uint64_t Sum = MakeFloat(RetTy, 0.0);
+    for (unsigned i = 0; i < N; ++i)
+      Sum = MakeFloat(RetTy, GetFloat(RetTy, Sum) + FArg(1 + i) * FArg(1 + N + i));
+    *pResult = Sum;
+    break;
+  }
+
+  // Conversions.
+  case OpCode::BitcastI16toF16:
+    *pResult = FloatToSlot(HalfBitsToFloat((uint16_t)Arg(1)));
+    break;
+  case OpCode::BitcastF16toI16:
+    *pResult = FloatToHalfBits(SlotToFloat(Arg(1)));
+    break;
+  case OpCode::BitcastI32toF32:
+  case OpCode::BitcastF32toI32:
+  case OpCode::BitcastI64toF64:
+  case OpCode::BitcastF64toI64:
+    *pResult = Arg(1);
+    break;
+  case OpCode::MakeDouble: *pResult = Arg(1) | (Arg(2) << 32); break;
+  case OpCode::SplitDouble: {
+    uint64_t V = Arg(1);
+    pResult[0] = (uint32_t)V;
+    pResult[1] = V >> 32;
+    break;
+  }
+  case OpCode::LegacyF32ToF16: *pResult = FloatToHalfBits((float)FArg(1)); break;
+  case OpCode::LegacyF16ToF32:
+    *pResult = FloatToSlot(HalfBitsToFloat((uint16_t)Arg(1)));
+    break;
+  case OpCode::LegacyDoubleToFloat: *pResult = FloatToSlot((float)FArg(1)); break;
+  case OpCode::LegacyDoubleToSInt32: *pResult = FloatToSigned(FArg(1), 32); break;
+  case OpCode::LegacyDoubleToUInt32: *pResult = FloatToUnsigned(FArg(1), 32); break;
+
+  // Compute shader inputs.
+  case OpCode::ThreadId: {
+    unsigned C = (unsigned)Arg(1);
+    *pResult = GroupId[C] * E.NumThreads[C] + L.ThreadIdInGroup[C];
+    break;
+  }
+  case OpCode::GroupId: *pResult = GroupId[Arg(1)]; break;
+  case OpCode::ThreadIdInGroup: *pResult = L.ThreadIdInGroup[Arg(1)]; break;
+  case OpCode::FlattenedThreadIdInGroup: *pResult = L.FlatIndex; break;
+
+  // Resources.
+  case OpCode::CreateHandle:
+    *pResult = (uintptr_t)E.GetHandle((unsigned)Arg(1), (unsigned)Arg(2),
+                                      (unsigned)Arg(3));
+    break;
+  case OpCode::CBufferLoadLegacy: {
+    const ResourceHandle &H = GetHandle(L, CI->getArgOperand(1));
+    unsigned Count = RetTy->getStructNumElements();
+    Type *ETy = RetTy->getStructElementType(0);
+    unsigned Size = 16 / Count;
+    uint64_t Row = Arg(2) * 16;
+    for (unsigned i = 0; i < Count; ++i) {
+      uint64_t At = Row + i * Size;
+      pResult[i] = At + Size <= H.pBinding->Size
+                       ? ReadBufferComponent(ETy, Size, H.pBinding->pData + At)
+                       : 0;
+    }
+    break;
+  }
+  case OpCode::CBufferLoad: {
+    const ResourceHandle &H = GetHandle(L, CI->getArgOperand(1));
+    unsigned Size = GetBufferComponentSize(RetTy);
+    uint64_t At = Arg(2);
+    *pResult = At + Size <= H.pBinding->Size
+                   ? ReadBufferComponent(RetTy, Size, H.pBinding->pData + At)
+                   : 0;
+    break;
+  }
+  case OpCode::BufferLoad: {
+    const ResourceHandle &H = GetHandle(L, CI->getArgOperand(1));
+    Type *ETy = RetTy->getStructElementType(0);
+    unsigned Size = GetBufferComponentSize(ETy);
+    for (unsigned c = 0; c < 4; ++c) {
+      char *pAddr = GetBufferAddress(H, Arg(2), Arg(3), c, Size);
+      pResult[c] = pAddr ? ReadBufferComponent(ETy, Size, pAddr) : 0;
+    }
+    pResult[4] = 1; // Status: all accesses mapped.
+    break;
+  }
+  case OpCode::BufferStore: {
+    const ResourceHandle &H = GetHandle(L, CI->getArgOperand(1));
+    Type *ETy = CI->getArgOperand(4)->getType();
+    unsigned Size = GetBufferComponentSize(ETy);
+    unsigned Mask = (unsigned)Arg(8);
+    for (unsigned c = 0; c < 4; ++c) {
+      if (!(Mask & (1 << c)))
+        continue;
+      char *pAddr = GetBufferAddress(H, Arg(2), Arg(3), c, Size);
+      if (pAddr)
+        WriteBufferComponent(ETy, Size, pAddr, Arg(4 + c));
+    }
+    break;
+  }
+  case OpCode::BufferUpdateCounter: {
+    const ResourceHandle &H = GetHandle(L, CI->getArgOperand(1));
+    int8_t Inc = (int8_t)Arg(2);
+    std::lock_guard<std::mutex> Lock(E.AtomicMutex);
+    // Increments return the old value and decrements the new one.
+    if (Inc > 0)
+      *pResult = (uint32_t)H.pBinding->Counter++;
+    else
+      *pResult = (uint32_t)--H.pBinding->Counter;
+    break;
+  }
+  case OpCode::CheckAccessFullyMapped: *pResult = Arg(1) != 0; break;
+  case OpCode::GetDimensions: {
+    const ResourceHandle &H = GetHandle(L, CI->getArgOperand(1));
+    uint64_t Size = H.pBinding->Size;
+    pResult[0] = H.Kind == DXIL::ResourceKind::RawBuffer
+                     ? Size
+                     : H.ElementSize ? Size / H.ElementSize : 0;
+    pResult[1] = pResult[2] = pResult[3] = 0;
+    break;
+  }
+  case OpCode::AtomicBinOp: {
+    const ResourceHandle &H = GetHandle(L, CI->getArgOperand(1));
+    AtomicRMWInst::BinOp RMWOp = GetAtomicRMWOp((DXIL::AtomicBinOpCode)Arg(2));
+    char *pAddr = GetBufferAddress(H, Arg(3), Arg(4), 0, 4);
+    std::lock_guard<std::mutex> Lock(E.AtomicMutex);
+    uint32_t Old = 0;
+    if (pAddr) {
+      memcpy(&Old, pAddr, sizeof(Old));
+      uint32_t New = (uint32_t)EvalAtomic(RMWOp, 32, Old, Arg(6));
+      memcpy(pAddr, &New, sizeof(New));
+    }
+    *pResult = Old;
+    break;
+  }
+  case OpCode::AtomicCompareExchange: {
+    const ResourceHandle &H = GetHandle(L, CI->getArgOperand(1));
+    char *pAddr = GetBufferAddress(H, Arg(2), Arg(3), 0, 4);
+    std::lock_guard<std::mutex> Lock(E.AtomicMutex);
+    uint32_t Old = 0;
+    if (pAddr) {
+      memcpy(&Old, pAddr, sizeof(Old));
+      if (Old == (uint32_t)Arg(5)) {
+        uint32_t New = (uint32_t)Arg(6);
+        memcpy(pAddr, &New, sizeof(New));
+      }
+    }
+    *pResult = Old;
+    break;
+  }
+  case OpCode::Barrier:
+    if (Arg(1) & (unsigned)DXIL::BarrierMode::SyncThreadGroup) {
+      ++L.Next;
+      L.State = LaneState::AtBarrier;
+      return false;
+    }
+    break;
+
+  // Wave queries that don't depend on the other lanes.
+  case OpCode::WaveGetLaneIndex: *pResult = L.LaneIndex; break;
+  case OpCode::WaveGetLaneCount: *pResult = E.WaveSize; break;
+
+  default:
+    ThrowNotSupported(CI);
+  }
+  return true;
+}
+
+void GroupRunner::ExecuteWaveOp(const CallInst *CI, ArrayRef<Lane *> Active) {
+  OpCode Op = GetDxilOpCode(CI);
+  const Value *V = CI->getArgOperand(1);
+  Type *Ty = V->getType();
+  auto Arg = [&](Lane *L, unsigned i) {
+    return GetScalar(*L, CI->getArgOperand(i));
+  };
+  auto Result = [&](Lane *L) { return GetResult(*L, CI); };
+
+  // Active lanes by their index in the wave.
+  SmallVector<Lane *, 32> ByIndex(E.WaveSize, nullptr);
+  for (Lane *L : Active)
+    ByIndex[L->LaneIndex] = L;
+
+  switch (Op) {
+  case OpCode::WaveIsFirstLane:
+    for (Lane *L : Active)
+      *Result(L) = L == Active.front();
+    break;
+  case OpCode::WaveAnyTrue:
+  case OpCode::WaveAllTrue: {
+    bool Any = false, All = true;
+    for (Lane *L : Active) {
+      bool B = Arg(L, 1) != 0;
+      Any |= B;
+      All &= B;
+    }
+    for (Lane *L : Active)
+      *Result(L) = Op == OpCode::WaveAnyTrue ? Any : All;
+    break;
+  }
+  case OpCode::WaveActiveAllEqual: {
+    uint64_t First = Arg(Active.front(), 1);
+    bool Equal = true;
+    for (Lane *L : Active)
+      Equal &= Arg(L, 1) == First;
+    for (Lane *L : Active)
+      *Result(L) = Equal;
+    break;
+  }
+  case OpCode::WaveActiveBallot: {
+    uint64_t Mask[4] = {0, 0, 0, 0};
+    for (Lane *L : Active)
+      if (Arg(L, 1))
+        Mask[L->LaneIndex / 32] |= 1ull << (L->LaneIndex % 32);
+    for (Lane *L : Active)
+      std::copy(Mask, Mask + 4, Result(L));
+    break;
+  }
+  case OpCode::WaveReadLaneFirst: {
+    uint64_t First = Arg(Active.front(), 1);
+    for (Lane *L : Active)
+      *Result(L) = First;
+    break;
+  }
+  case OpCode::WaveReadLaneAt: {
+    // Reading an inactive lane is undefined; the first active lane is used.
+    for (Lane *L : Active) {
+      uint64_t Index = Arg(L, 2);
+      Lane *Src = Index < ByIndex.size() && ByIndex[Index] ? ByIndex[Index]
+                                                           : Active.front();
+      *Result(L) = Arg(Src, 1);
+    }
+    break;
+  }
+  case OpCode::WaveActiveOp:
+  case OpCode::WavePrefixOp: {
+    DXIL::WaveOpKind Kind = (DXIL::WaveOpKind)Arg(Active.front(), 2);
+    bool IsUnsigned = Arg(Active.front(), 3) ==
+                      (unsigned)DXIL::SignedOpKind::Unsigned;
+    if (Op == OpCode::WavePrefixOp) {
+      uint64_t Acc;
+      if (Kind == DXIL::WaveOpKind::Product)
+        Acc = Ty->isFloatingPointTy() ? MakeFloat(Ty, 1.0) : 1;
+      else
+        Acc = Ty->isFloatingPointTy() ? MakeFloat(Ty, 0.0) : 0;
+      for (Lane *L : Active) {
+        uint64_t Value = Arg(L, 1);
+        *Result(L) = Acc;
+        Acc = EvalWaveOp(Kind, IsUnsigned, Ty, Acc, Value);
+      }
+      break;
+    }
+    uint64_t Acc = Arg(Active.front(), 1);
+    for (Lane *L : Active.slice(1))
+      Acc = EvalWaveOp(Kind, IsUnsigned, Ty, Acc, Arg(L, 1));
+    for (Lane *L : Active)
+      *Result(L) = Acc;
+    break;
+  }
+  case OpCode::WaveActiveBit: {
+    DXIL::WaveBitOpKind Kind = (DXIL::WaveBitOpKind)Arg(Active.front(), 2);
+    uint64_t Acc = Arg(Active.front(), 1);
+    for (Lane *L : Active.slice(1)) {
+      uint64_t Value = Arg(L, 1);
+      switch (Kind) {
+      case DXIL::WaveBitOpKind::And: Acc &= Value; break;
+      case DXIL::WaveBitOpKind::Or: Acc |= Value; break;
+      case DXIL::WaveBitOpKind::Xor: Acc ^= Value; break;
+      }
+    }
+    for (Lane *L : Active)
+      *Result(L) = Acc;
+    break;
+  }
+  case OpCode::WaveAllBitCount:
+  case OpCode::WavePrefixBitCount: {
+    uint64_t Count = 0;
+    for (Lane *L : Active) {
+      bool B = Arg(L, 1) != 0;
+      if (Op == OpCode::WavePrefixBitCount)
+        *Result(L) = Count;
+      Count += B;
+    }
+    if (Op == OpCode::WaveAllBitCount)
+      for (Lane *L : Active)
+        *Result(L) = Count;
+    break;
+  }
+  case OpCode::QuadReadLaneAt:
+  case OpCode::QuadOp: {
+    SmallVector<uint64_t, 32> Values;
+    for (Lane *L : Active)
+      Values.push_back(Arg(L, 1));
+    for (unsigned i = 0; i < Active.size(); ++i) {
+      Lane *L = Active[i];
+      unsigned Index;
+      if (Op == OpCode::QuadReadLaneAt)
+        Index = (L->LaneIndex & ~3u) | (Arg(L, 2) & 3);
+      else
+        Index = L->LaneIndex ^ ((unsigned)Arg(L, 2) + 1);
+      Lane *Src = Index < ByIndex.size() && ByIndex[Index] ? ByIndex[Index] : L;
+      *Result(L) = Values[std::find(Active.begin(), Active.end(), Src) -
+                          Active.begin()];
+    }
+    break;
+  }
+  default:
+    ThrowNotSupported(CI);
+  }
+}
+
+void DxilCpuExecutorImpl::Dispatch(unsigned X, unsigned Y, unsigned Z) {
+  unsigned GroupCount = X * Y * Z;
+  if (GroupCount == 0)
+    return;
+  unsigned ThreadCount = HostThreadCount;
+  if (ThreadCount == 0)
+    ThreadCount = std::max(1u, std::thread::hardware_concurrency());
+  ThreadCount = std::min(ThreadCount, GroupCount);
+
+  std::atomic<unsigned> NextGroup(0);
+  std::atomic<bool> Failed(false);
+  std::exception_ptr Error;
+  std::mutex ErrorMutex;
+  auto Worker = [&]() {
+    try {
+      while (!Failed) {
+        unsigned G = NextGroup++;
+        if (G >= GroupCount)
+          return;
+        GroupRunner Runner(*this, G % X, (G / X) % Y, G / (X * Y));
+        Runner.Run();
+      }
+    } catch (...) {
+      std::lock_guard<std::mutex> Lock(ErrorMutex);
+      if (!Error)
+        Error = std::current_exception();
+      Failed = true;
+    }
+  };
+
+  std::vector<std::thread> Threads;
+  for (unsigned i = 1; i < ThreadCount; ++i)
+    Threads.emplace_back(Worker);
+  Worker();
+  for (std::thread &T : Threads)
+    T.join();
+  if (Error)
+    std::rethrow_exception(Error);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// DxilCpuExecutor
+
+DxilCpuExecutor::DxilCpuExecutor(Module &M)
+    : m_pImpl(new DxilCpuExecutorImpl(M)) {}
+
+DxilCpuExecutor::~DxilCpuExecutor() {}
+
+void DxilCpuExecutor::BindResource(DXIL::ResourceClass Class, unsigned Space,
+                                   unsigned Register, void *pData,
+                                   size_t Size) {
+  m_pImpl->BindResource(Class, Space, Register, pData, Size);
+}
+
+void DxilCpuExecutor::SetWaveSize(unsigned WaveSize) {
+  if (WaveSize < 4 || WaveSize > 128 || !isPowerOf2_32(WaveSize))
+    throw hlsl::Exception(E_INVALIDARG,
+                          "wave size must be a power of two from 4 to 128");
+  m_pImpl->WaveSize = WaveSize;
+}
+
+void DxilCpuExecutor::SetHostThreadCount(unsigned Count) {
+  m_pImpl->HostThreadCount = Count;
+}
+
+void DxilCpuExecutor::Dispatch(unsigned GroupCountX, unsigned GroupCountY,
+                               unsigned GroupCountZ) {
+  m_pImpl->Dispatch(GroupCountX, GroupCountY, GroupCountZ);
+}
@@ -0,0 +1,65 @@
+///////////////////////////////////////////////////////////////////////////////
+//                                                                           //
+// DxilCpuExecutor.h                                                         //
+// Copyright (C) Microsoft Corporation. All rights reserved.                 //
+// This file is distributed under the University of Illinois Open Source     //
+// License. See LICENSE.TXT for details.                                     //
+//                                                                           //
+// Reference executor that runs DXIL compute shaders on the CPU.             //
+//                                                                           //
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "dxc/HLSL/DxilConstants.h"
+#include <cstddef>
+#include <memory>
+
+namespace llvm {
+class Module;
+}
+
+namespace hlsl {
+
+class DxilCpuExecutorImpl;
+
+/// Runs a compute shader by interpreting its DXIL, so that codegen can be
+/// checked on machines without a D3D12 device.
+///
+/// The threads of a group run as the lanes of waves of a fixed size. Lanes
+/// step independently and wait for the rest of their wave at wave
+/// operations; an operation sees the lanes that wait at it together, which
+/// is the set of active lanes for structured control flow. Thread groups are
+/// independent and are spread across host threads.
+///
+/// Buffers, structured and raw buffers and constant buffers are supported;
+/// textures, samplers and graphics-only operations are not. Operations that
+/// are not supported throw an hlsl::Exception with E_NOTIMPL.
+class DxilCpuExecutor {
+public:
+  /// M must hold a compute shader DXIL module with materialized function
+  /// bodies, and must outlive the executor.
+  explicit DxilCpuExecutor(llvm::Module &M);
+  ~DxilCpuExecutor();
+
+  /// Binds memory to the resource declared at the given register. The memory
+  /// must stay valid during Dispatch; UAVs are updated in place.
+  void BindResource(DXIL::ResourceClass Class, unsigned Space,
+                    unsigned Register, void *pData, size_t Size);
+
+  /// Number of lanes in a wave, a power of two from 4 to 128; defaults to 32.
+  void SetWaveSize(unsigned WaveSize);
+
+  /// Number of host threads to run groups on; 0, the default, uses one per
+  /// hardware thread.
+  void SetHostThreadCount(unsigned Count);
+
+  /// Runs the given number of thread groups and returns once all are done.
+  void Dispatch(unsigned GroupCountX, unsigned GroupCountY,
+                unsigned GroupCountZ);
+
+private:
+  std::unique_ptr<DxilCpuExecutorImpl> m_pImpl;
+};
+
+} // namespace hlsl
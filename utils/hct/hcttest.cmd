@@ -93,6 +93,8 @@ if "%1"=="-clean" (
 ) else if "%1"=="-adapter" (
   set TEST_ADAPTER= /p:"Adapter=%~2"
   shift /1
+) else if "%1"=="-cpu" (
+  set TEST_ADAPTER= /p:"CpuExecutor=*"
 ) else if "%1"=="-verbose" (
   set LOG_FILTER=
   set PARALLEL_OPTION=
@@ -253,6 +255,7 @@ echo   -clean - deletes test directory before copying binaries and testing
 echo   -ninja - artifacts were built using the Ninja generator
 echo   -rel   - builds release rather than debug
 echo   -adapter "adapter name" - overrides Adapter for execution tests
+echo   -cpu - runs supported execution tests on the DXIL CPU executor
 echo   -verbose - for TAEF: turns off /parallel and removes logging filter
 echo.
 echo current BUILD_ARCH=%BUILD_ARCH%.  Override with: